@@ -0,0 +1,168 @@
+'use strict';
+
+// Builds the trees the archive benchmarks use, once as a real directory and
+// once as a zip that the benchmark processes mount with --archive.path.
+// The same relative path can then be read from `dir` or from `mount`.
+
+const crypto = require('crypto');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const zlib = require('zlib');
+
+const tmpdir = require('../../test/common/tmpdir');
+
+// True in the processes that run main(), the parent only builds the fixture.
+const isRunner = process.env.hasOwnProperty('NODE_RUN_BENCHMARK_FN');
+
+const crcTable = new Int32Array(256);
+for (var n = 0; n < 256; n++) {
+  var c = n;
+  for (var k = 0; k < 8; k++)
+    c = (c & 1) ? (0xedb88320 ^ (c >>> 1)) : (c >>> 1);
+  crcTable[n] = c;
+}
+
+function crc32(buf) {
+  var crc = -1;
+  for (var i = 0; i < buf.length; i++)
+    crc = crcTable[(crc ^ buf[i]) & 0xff] ^ (crc >>> 8);
+  return (crc ^ -1) >>> 0;
+}
+
+// 1980-01-01 00:00, the earliest DOS date, keeps the zip's hash stable.
+const kDosDate = (1 << 5) | 1;
+
+// Writes entries, [{ name, data }] with dirs named 'dir/' and no data, to a
+// zip at filepath. compress is a boolean or a function that is passed each
+// file's name, files are deflated when it's true else stored.
+function writeZip(filepath, entries, compress) {
+  const chunks = [];
+  const central = [];
+  var offset = 0;
+
+  for (const entry of entries) {
+    const name = Buffer.from(entry.name);
+    const data = entry.data || Buffer.alloc(0);
+    const deflate = data.length > 0 &&
+      (typeof compress === 'function' ? compress(entry.name) : compress);
+    const body = deflate ? zlib.deflateRawSync(data) : data;
+    const crc = crc32(data);
+
+    const local = Buffer.alloc(30);
+    local.writeUInt32LE(0x04034b50, 0);
+    local.writeUInt16LE(20, 4);
+    local.writeUInt16LE(deflate ? 8 : 0, 8);
+    local.writeUInt16LE(kDosDate, 12);
+    local.writeUInt32LE(crc, 14);
+    local.writeUInt32LE(body.length, 18);
+    local.writeUInt32LE(data.length, 22);
+    local.writeUInt16LE(name.length, 26);
+
+    const header = Buffer.alloc(46);
+    header.writeUInt32LE(0x02014b50, 0);
+    header.writeUInt16LE(20, 4);
+    header.writeUInt16LE(20, 6);
+    header.writeUInt16LE(deflate ? 8 : 0, 10);
+    header.writeUInt16LE(kDosDate, 14);
+    header.writeUInt32LE(crc, 16);
+    header.writeUInt32LE(body.length, 20);
+    header.writeUInt32LE(data.length, 24);
+    header.writeUInt16LE(name.length, 28);
+    header.writeUInt32LE(entry.data ? 0 : 0x10, 38);
+    header.writeUInt32LE(offset, 42);
+
+    chunks.push(local, name, body);
+    central.push(header, name);
+    offset += local.length + name.length + body.length;
+  }
+
+  const centralSize = central.reduce((size, chunk) => size + chunk.length, 0);
+  const end = Buffer.alloc(22);
+  end.writeUInt32LE(0x06054b50, 0);
+  end.writeUInt16LE(entries.length, 8);
+  end.writeUInt16LE(entries.length, 10);
+  end.writeUInt32LE(centralSize, 12);
+  end.writeUInt32LE(offset, 16);
+
+  fs.writeFileSync(filepath, Buffer.concat(chunks.concat(central, [end])));
+}
+
+// Text that compresses about as well as source code does.
+function content(size, seed) {
+  const line = `// ${seed} module.exports = function() { return ${seed}; };\n`;
+  return Buffer.from(line.repeat(Math.ceil(size / line.length)).slice(0, size));
+}
+
+// A fixture named name under the benchmark tmpdir:
+//   dir   - the tree as a real directory
+//   zip   - the tree as a zip
+//   mount - where the benchmark processes see the zip
+//   flags - the node flags that mount zip at mount
+function fixture(name) {
+  const base = path.join(tmpdir.path, `archive-${name}`);
+  const zip = `${base}.zip`;
+  const mount = `${base}-mount`;
+
+  return {
+    dir: base,
+    zip,
+    mount,
+    flags: ['--archive.path', zip, '--archive.mount', mount],
+    isRunner,
+
+    // files is { relativePath: Buffer } and compress is as for writeZip(),
+    // only the parent writes anything.
+    build(files, compress) {
+      if (isRunner)
+        return;
+
+      if (!fs.existsSync(tmpdir.path))
+        tmpdir.refresh();
+
+      const entries = [];
+      const dirs = new Set();
+      fs.mkdirSync(base, { recursive: true });
+
+      for (const file of Object.keys(files).sort()) {
+        const parts = file.split('/');
+        for (var i = 1; i < parts.length; i++) {
+          const dir = parts.slice(0, i).join('/');
+          if (!dirs.has(dir)) {
+            dirs.add(dir);
+            entries.push({ name: `${dir}/` });
+            fs.mkdirSync(path.join(base, dir), { recursive: true });
+          }
+        }
+        entries.push({ name: file, data: files[file] });
+        fs.writeFileSync(path.join(base, file), files[file]);
+      }
+
+      writeZip(zip, entries, compress);
+    },
+
+    // Where the archive's entries are extracted to, see Manager::CacheRoot().
+    cacheDir(zipPath = zip) {
+      const md5 = crypto.createHash('md5')
+        .update(fs.readFileSync(zipPath)).digest('hex');
+      return path.join(os.tmpdir(), 'archive_cache', md5);
+    },
+
+    // Removes the extraction cache so the next mount is a cold one.
+    removeCache(zipPath = zip) {
+      const cache = this.cacheDir(zipPath);
+      if (!fs.existsSync(cache))
+        return;
+      for (const entry of fs.readdirSync(cache))
+        fs.unlinkSync(path.join(cache, entry));
+      fs.rmdirSync(cache);
+    },
+
+    // The root to use for a `source` config of 'dir' or 'archive'.
+    root(source) {
+      return source === 'archive' ? mount : base;
+    }
+  };
+}
+
+module.exports = { fixture, writeZip, content };
@@ -0,0 +1,54 @@
+'use strict';
+// Startup time of a process that mounts an archive of `entries` files.
+// A cold mount extracts every deflated entry into a new cache, a warm one
+// finds the cache from an earlier run and only checks it. `none` starts
+// without mounting anything to give the baseline.
+const common = require('../common.js');
+const fs = require('fs');
+const { spawnSync } = require('child_process');
+const { fixture, writeZip, content } = require('./_fixture.js');
+const tmpdir = require('../../test/common/tmpdir');
+
+const bench = common.createBenchmark(main, {
+  cache: ['none', 'cold', 'warm'],
+  entries: [100, 1000],
+  n: [10]
+});
+
+function startup(flags) {
+  const child = spawnSync(process.execPath, flags.concat(['-e', '0']));
+  if (child.status !== 0)
+    throw new Error(`startup failed: ${child.stderr}`);
+}
+
+function main({ cache, entries, n }) {
+  fs.mkdirSync(tmpdir.path, { recursive: true });
+
+  // A cold mount needs a zip no earlier run has seen, so each one gets a
+  // different salt and with it a different hash.
+  const zips = [];
+  for (var i = 0; i < (cache === 'cold' ? n : 1); i++) {
+    const tree = fixture(`mount${i}`);
+    const items = [{ name: 'salt', data: Buffer.from(`${process.pid} ${i}`) }];
+    for (var e = 0; e < entries; e++)
+      items.push({ name: `e${e}.js`, data: content(1024, e) });
+    writeZip(tree.zip, items, true);
+    tree.removeCache();
+    zips.push(tree);
+  }
+
+  if (cache === 'warm')
+    startup(zips[0].flags);
+
+  bench.start();
+  for (i = 0; i < n; i++) {
+    if (cache === 'none')
+      startup([]);
+    else
+      startup(zips[cache === 'cold' ? i : 0].flags);
+  }
+  bench.end(n);
+
+  for (const tree of zips)
+    tree.removeCache();
+}
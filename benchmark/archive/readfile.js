@@ -0,0 +1,50 @@
+'use strict';
+// readFile throughput for entries that are stored (served from memory) or
+// deflated (served from the extraction cache) in the archive, against the
+// same files in a real directory.
+const path = require('path');
+const common = require('../common.js');
+const fs = require('fs');
+const { fixture, content } = require('./_fixture.js');
+
+const tree = fixture('readfile');
+
+const bench = common.createBenchmark(main, {
+  source: ['dir', 'archive'],
+  entry: ['stored', 'deflated'],
+  api: ['sync', 'async'],
+  len: [1024, 64 * 1024, 1024 * 1024],
+  n: [2000]
+}, { flags: tree.flags });
+
+const lens = new Set(bench.queue.map((config) => config.len));
+const files = {};
+for (const len of lens) {
+  files[`stored/${len}.txt`] = content(len, len);
+  files[`deflated/${len}.txt`] = content(len, len);
+}
+tree.build(files, (name) => name.startsWith('deflated/'));
+
+function main({ source, entry, api, len, n }) {
+  const filepath = path.join(tree.root(source), entry, `${len}.txt`);
+
+  if (api === 'sync') {
+    bench.start();
+    for (var i = 0; i < n; i++)
+      fs.readFileSync(filepath);
+    bench.end(n);
+    return;
+  }
+
+  var reads = 0;
+  bench.start();
+  (function next() {
+    fs.readFile(filepath, (err) => {
+      if (err)
+        throw err;
+      if (++reads === n)
+        return bench.end(n);
+      next();
+    });
+  })();
+}
@@ -0,0 +1,34 @@
+'use strict';
+// A require() storm: every module of a tree is loaded once, from a real
+// directory or from the same tree mounted from an archive.
+const path = require('path');
+const common = require('../common.js');
+const { fixture, content } = require('./_fixture.js');
+
+const tree = fixture('require');
+
+const bench = common.createBenchmark(main, {
+  source: ['dir', 'archive'],
+  n: [1000]
+}, { flags: tree.flags });
+
+const maxN = Math.max(...bench.queue.map((config) => config.n));
+
+// 50 modules per dir, each one requires nothing else.
+function modulePath(i) {
+  return `node_modules/pkg${Math.floor(i / 50)}/m${i}.js`;
+}
+
+const files = {};
+for (var i = 0; i < maxN; i++)
+  files[modulePath(i)] = content(512, i);
+tree.build(files, true);
+
+function main({ source, n }) {
+  const root = tree.root(source);
+
+  bench.start();
+  for (var i = 0; i < n; i++)
+    require(path.join(root, modulePath(i)));
+  bench.end(n);
+}
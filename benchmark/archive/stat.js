@@ -0,0 +1,60 @@
+'use strict';
+// stat and readdir calls, the cost the archive wrappers add on their fast
+// path shows up as the gap between the dir and archive sources.
+const path = require('path');
+const common = require('../common.js');
+const fs = require('fs');
+const { fixture, content } = require('./_fixture.js');
+
+const tree = fixture('stat');
+
+const bench = common.createBenchmark(main, {
+  source: ['dir', 'archive'],
+  call: ['stat', 'statSync', 'readdir', 'readdirSync'],
+  n: [2e4]
+}, { flags: tree.flags });
+
+const files = {};
+for (var i = 0; i < 100; i++)
+  files[`lib/f${i}.js`] = content(128, i);
+tree.build(files, true);
+
+function main({ source, call, n }) {
+  const root = tree.root(source);
+  const file = path.join(root, 'lib', 'f0.js');
+  const dir = path.join(root, 'lib');
+  var i;
+
+  switch (call) {
+    case 'statSync':
+      bench.start();
+      for (i = 0; i < n; i++)
+        fs.statSync(file);
+      bench.end(n);
+      break;
+    case 'readdirSync':
+      bench.start();
+      for (i = 0; i < n; i++)
+        fs.readdirSync(dir);
+      bench.end(n);
+      break;
+    case 'stat':
+    case 'readdir':
+      const fn = call === 'stat' ? fs.stat : fs.readdir;
+      const target = call === 'stat' ? file : dir;
+      var calls = 0;
+      bench.start();
+      (function next() {
+        fn(target, (err) => {
+          if (err)
+            throw err;
+          if (++calls === n)
+            return bench.end(n);
+          next();
+        });
+      })();
+      break;
+    default:
+      throw new Error(`Unsupported call ${call}`);
+  }
+}
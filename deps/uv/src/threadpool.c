@@ -297,6 +297,11 @@ int uv_cancel(uv_req_t* req) {
   case UV_FS:
     loop =  ((uv_fs_t*) req)->loop;
     wreq = &((uv_fs_t*) req)->work_req;
+#if defined(__linux__)
+    /* Requests on the loop's io_uring have no done callback. */
+    if (wreq->done == NULL)
+      return uv__iou_fs_cancel(loop, (uv_fs_t*) req);
+#endif
     break;
   case UV_GETADDRINFO:
     loop =  ((uv_getaddrinfo_t*) req)->loop;
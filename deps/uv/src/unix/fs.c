@@ -1217,6 +1217,11 @@ int uv_fs_chown(uv_loop_t* loop,
 int uv_fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
   INIT(CLOSE);
   req->file = file;
+
+  if (cb != NULL)
+    if (uv__iou_fs_close(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1264,6 +1269,11 @@ int uv_fs_lchown(uv_loop_t* loop,
 int uv_fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
   INIT(FDATASYNC);
   req->file = file;
+
+  if (cb != NULL)
+    if (uv__iou_fs_fsync_or_fdatasync(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1271,6 +1281,11 @@ int uv_fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
 int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
   INIT(FSTAT);
   req->file = file;
+
+  if (cb != NULL)
+    if (uv__iou_fs_statx(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1278,6 +1293,11 @@ int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
 int uv_fs_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb) {
   INIT(FSYNC);
   req->file = file;
+
+  if (cb != NULL)
+    if (uv__iou_fs_fsync_or_fdatasync(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1311,6 +1331,11 @@ int uv_fs_futime(uv_loop_t* loop,
 int uv_fs_lstat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
   INIT(LSTAT);
   PATH;
+
+  if (cb != NULL)
+    if (uv__iou_fs_statx(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1360,6 +1385,11 @@ int uv_fs_open(uv_loop_t* loop,
   PATH;
   req->flags = flags;
   req->mode = mode;
+
+  if (cb != NULL)
+    if (uv__iou_fs_open(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1388,6 +1418,11 @@ int uv_fs_read(uv_loop_t* loop, uv_fs_t* req,
   memcpy(req->bufs, bufs, nbufs * sizeof(*bufs));
 
   req->off = off;
+
+  if (cb != NULL)
+    if (uv__iou_fs_read_or_write(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1461,6 +1496,11 @@ int uv_fs_sendfile(uv_loop_t* loop,
 int uv_fs_stat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb) {
   INIT(STAT);
   PATH;
+
+  if (cb != NULL)
+    if (uv__iou_fs_statx(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -1524,6 +1564,11 @@ int uv_fs_write(uv_loop_t* loop,
   memcpy(req->bufs, bufs, nbufs * sizeof(*bufs));
 
   req->off = off;
+
+  if (cb != NULL)
+    if (uv__iou_fs_read_or_write(loop, req))
+      return 0;
+
   POST;
 }
 
@@ -325,4 +325,25 @@ UV_UNUSED(static char* uv__basename_r(const char* path)) {
 int uv__inotify_fork(uv_loop_t* loop, void* old_watchers);
 #endif
 
+/* Async fs requests the loop's io_uring takes instead of the threadpool.
+ * Each returns 1 if the request was queued on the ring, 0 if the caller has
+ * to post it to the threadpool as usual.
+ */
+#if defined(__linux__)
+int uv__iou_fs_close(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_fsync_or_fdatasync(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_open(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_read_or_write(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_statx(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_fs_cancel(uv_loop_t* loop, uv_fs_t* req);
+int uv__iou_flush(uv_loop_t* loop);
+void uv__iou_delete(uv_loop_t* loop);
+#else
+#define uv__iou_fs_close(loop, req) 0
+#define uv__iou_fs_fsync_or_fdatasync(loop, req) 0
+#define uv__iou_fs_open(loop, req) 0
+#define uv__iou_fs_read_or_write(loop, req) 0
+#define uv__iou_fs_statx(loop, req) 0
+#endif
+
 #endif /* UV_UNIX_INTERNAL_H_ */
@@ -126,6 +126,8 @@ int uv__io_fork(uv_loop_t* loop) {
 
 
 void uv__platform_loop_delete(uv_loop_t* loop) {
+  uv__iou_delete(loop);
+
   if (loop->inotify_fd == -1) return;
   uv__io_stop(loop, &loop->inotify_read_watcher, POLLIN);
   uv__close(loop->inotify_fd);
@@ -267,6 +269,13 @@ void uv__io_poll(uv_loop_t* loop, int timeout) {
   real_timeout = timeout;
 
   for (;;) {
+    /* fs requests put on the io_uring since the last poll go to the kernel
+     * before we block.  Ones the kernel couldn't take yet are retried on the
+     * next poll, which mustn't wait for them.
+     */
+    if (uv__iou_flush(loop))
+      timeout = 0;
+
     /* See the comment for max_safe_timeout for an explanation of why
      * this is necessary.  Executive summary: kernel bug workaround.
      */
@@ -0,0 +1,650 @@
+/* Copyright Joyent, Inc. and other Node contributors. All rights reserved.
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Async fs requests on an io_uring instead of the threadpool.  Each loop gets
+ * a ring the first time it's given one of the requests the ring takes.  The
+ * ring's submissions are handed to the kernel in one io_uring_enter() per
+ * poll of the loop and its completions are reaped when epoll says the ring fd
+ * is readable, so the request's callback runs on the loop like any other.
+ *
+ * The ring is only used with UV_USE_IO_URING=1 in the environment.  Anything
+ * it can't take (no io_uring, a kernel missing what's used here or a full
+ * ring) goes to the threadpool as before, and so does everything once the
+ * process's effective uid or gid differ from the ones the ring was set up
+ * with, as the kernel may run a request with the ring's credentials.
+ *
+ * uv_cancel() takes a request back until it's handed to the kernel.  A child
+ * of uv_loop_fork() doesn't see the parent's requests complete, it completes
+ * them with UV_ECANCELED and sets up a ring of its own.
+ */
+
+#include "uv.h"
+#include "internal.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/mman.h>
+#include <sys/sysmacros.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+/* Entries in the submission queue, the kernel makes the completion queue twice
+ * that.  A full submission queue is flushed to make room, requests past what
+ * the completion queue holds go to the threadpool so it never overflows.
+ */
+#define UV__IOU_ENTRIES 64
+
+struct uv__iou {
+  uv__io_t watcher;
+  int ringfd;
+  /* Whether the ring has been set up, or found not to be available. */
+  int probed;
+  /* Set while completions run callbacks, which may call uv_loop_fork(). */
+  int reaping;
+  unsigned int forks;
+  int can_close;
+  uint32_t* sqhead;
+  uint32_t* sqtail;
+  uint32_t sqmask;
+  uint32_t sqentries;
+  uint32_t* cqhead;
+  uint32_t* cqtail;
+  uint32_t cqmask;
+  uint32_t cqentries;
+  unsigned int in_flight;
+  struct uv__io_uring_sqe* sqe;
+  struct uv__io_uring_cqe* cqe;
+  void* ring;
+  size_t ringlen;
+  size_t sqelen;
+  /* The next free submission slot, ahead of *sqtail until the next flush. */
+  uint32_t tail;
+  /* The credentials the ring was set up with. */
+  uid_t euid;
+  gid_t egid;
+  /* Requests on the ring, linked through work_req.wq. */
+  QUEUE requests;
+  /* Requests that were on the parent's ring at uv_loop_fork(). */
+  QUEUE dropped;
+};
+
+
+static void uv__iou_io(uv_loop_t* loop, uv__io_t* w, unsigned int events);
+
+
+static void uv__iou_cancelled(struct uv__work* w) {
+  abort();
+}
+
+
+static int uv__iou_enabled(void) {
+  const char* val;
+
+  val = getenv("UV_USE_IO_URING");
+  return val != NULL && atoi(val) != 0;
+}
+
+
+static unsigned int uv__iou_kernel_version(void) {
+  struct utsname u;
+  unsigned int major;
+  unsigned int minor;
+  unsigned int patch;
+
+  if (uname(&u))
+    return 0;
+
+  major = 0;
+  minor = 0;
+  patch = 0;
+  if (sscanf(u.release, "%u.%u.%u", &major, &minor, &patch) < 2)
+    return 0;
+
+  if (patch > 255)
+    patch = 255;
+
+  return major * 65536 + minor * 256 + patch;
+}
+
+
+static void uv__iou_setup(uv_loop_t* loop, struct uv__iou* iou) {
+  struct uv__io_uring_params params;
+  size_t sqlen;
+  size_t cqlen;
+  char* ring;
+  void* sqe;
+  uint32_t* sqarray;
+  uint32_t i;
+  int ringfd;
+
+  memset(&params, 0, sizeof(params));
+  ringfd = uv__io_uring_setup(UV__IOU_ENTRIES, &params);
+  if (ringfd == -1)
+    return;
+
+  /* Resource tags came in 5.13, by then the ring has all the ops used here,
+   * reads and writes at the file position and no dropped completions.
+   */
+  if (!(params.features & UV__IORING_FEAT_RSRC_TAGS) ||
+      !(params.features & UV__IORING_FEAT_SINGLE_MMAP) ||
+      !(params.features & UV__IORING_FEAT_NODROP) ||
+      !(params.features & UV__IORING_FEAT_RW_CUR_POS)) {
+    uv__close(ringfd);
+    return;
+  }
+
+  sqlen = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cqlen = params.cq_off.cqes +
+          params.cq_entries * sizeof(struct uv__io_uring_cqe);
+  iou->ringlen = sqlen > cqlen ? sqlen : cqlen;
+  iou->sqelen = params.sq_entries * sizeof(struct uv__io_uring_sqe);
+
+  ring = mmap(NULL,
+              iou->ringlen,
+              PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_POPULATE,
+              ringfd,
+              UV__IORING_OFF_SQ_RING);
+  sqe = mmap(NULL,
+             iou->sqelen,
+             PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE,
+             ringfd,
+             UV__IORING_OFF_SQES);
+
+  if (ring == MAP_FAILED || sqe == MAP_FAILED) {
+    if (ring != MAP_FAILED)
+      munmap(ring, iou->ringlen);
+    if (sqe != MAP_FAILED)
+      munmap(sqe, iou->sqelen);
+    uv__close(ringfd);
+    return;
+  }
+
+  iou->ring = ring;
+  iou->sqe = sqe;
+  iou->sqhead = (uint32_t*) (ring + params.sq_off.head);
+  iou->sqtail = (uint32_t*) (ring + params.sq_off.tail);
+  iou->sqmask = *(uint32_t*) (ring + params.sq_off.ring_mask);
+  iou->sqentries = *(uint32_t*) (ring + params.sq_off.ring_entries);
+  iou->cqhead = (uint32_t*) (ring + params.cq_off.head);
+  iou->cqtail = (uint32_t*) (ring + params.cq_off.tail);
+  iou->cqmask = *(uint32_t*) (ring + params.cq_off.ring_mask);
+  iou->cqentries = *(uint32_t*) (ring + params.cq_off.ring_entries);
+  iou->cqe = (struct uv__io_uring_cqe*) (ring + params.cq_off.cqes);
+  iou->tail = *iou->sqtail;
+
+  /* Submission slot i always holds entry i. */
+  sqarray = (uint32_t*) (ring + params.sq_off.array);
+  for (i = 0; i <= iou->sqmask; i++)
+    sqarray[i] = i;
+
+  /* Before 5.15.90 a file closed by the ring can keep a reference to it
+   * around long enough for a following execve() of it to fail with ETXTBSY.
+   */
+  iou->can_close = uv__iou_kernel_version() >= 0x050F5A;
+
+  iou->euid = geteuid();
+  iou->egid = getegid();
+
+  /* io_uring_setup() makes the fd close-on-exec. */
+  iou->ringfd = ringfd;
+  uv__io_init(&iou->watcher, uv__iou_io, ringfd);
+  uv__io_start(loop, &iou->watcher, POLLIN);
+}
+
+
+static struct uv__iou* uv__iou_get(uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  iou = loop->internal_fields;
+  if (iou == NULL) {
+    iou = uv__malloc(sizeof(*iou));
+    if (iou == NULL)
+      return NULL;
+
+    memset(iou, 0, sizeof(*iou));
+    iou->ringfd = -1;
+    QUEUE_INIT(&iou->requests);
+    QUEUE_INIT(&iou->dropped);
+    loop->internal_fields = iou;
+  }
+
+  if (!iou->probed) {
+    iou->probed = 1;
+    if (uv__iou_enabled())
+      uv__iou_setup(loop, iou);
+  }
+
+  if (iou->ringfd == -1)
+    return NULL;
+
+  /* setuid() and friends don't reach a ring that's already set up. */
+  if (geteuid() != iou->euid || getegid() != iou->egid)
+    return NULL;
+
+  return iou;
+}
+
+
+static void uv__iou_submit(struct uv__iou* iou) {
+  uint32_t head;
+  int rc;
+
+  head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+  if (head == iou->tail)
+    return;
+
+  __atomic_store_n(iou->sqtail, iou->tail, __ATOMIC_RELEASE);
+
+  do
+    rc = uv__io_uring_enter(iou->ringfd, iou->tail - head, 0, 0);
+  while (rc == -1 && errno == EINTR);
+
+  /* Short of memory, what wasn't taken stays queued for the next flush. */
+  if (rc == -1 && errno != EAGAIN && errno != EBUSY)
+    abort();
+}
+
+
+static struct uv__io_uring_sqe* uv__iou_get_sqe(struct uv__iou* iou,
+                                                uv_loop_t* loop,
+                                                uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+
+  if (iou->in_flight >= iou->cqentries)
+    return NULL;
+
+  if (iou->tail - __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE) >=
+      iou->sqentries) {
+    uv__iou_submit(iou);
+
+    if (iou->tail - __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE) >=
+        iou->sqentries) {
+      return NULL;
+    }
+  }
+
+  sqe = &iou->sqe[iou->tail & iou->sqmask];
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->user_data = (uintptr_t) req;
+  iou->tail++;
+  iou->in_flight++;
+
+  /* No done callback tells uv_cancel() to come to uv__iou_fs_cancel(). */
+  req->work_req.loop = loop;
+  req->work_req.work = NULL;
+  req->work_req.done = NULL;
+  QUEUE_INSERT_TAIL(&iou->requests, &req->work_req.wq);
+
+  uv__req_register(loop, req);
+
+  return sqe;
+}
+
+
+static void uv__iou_statx_to_stat(const struct uv__statx* src,
+                                  uv_stat_t* dst) {
+  dst->st_dev = makedev(src->stx_dev_major, src->stx_dev_minor);
+  dst->st_mode = src->stx_mode;
+  dst->st_nlink = src->stx_nlink;
+  dst->st_uid = src->stx_uid;
+  dst->st_gid = src->stx_gid;
+  dst->st_rdev = makedev(src->stx_rdev_major, src->stx_rdev_minor);
+  dst->st_ino = src->stx_ino;
+  dst->st_size = src->stx_size;
+  dst->st_blksize = src->stx_blksize;
+  dst->st_blocks = src->stx_blocks;
+  dst->st_atim.tv_sec = src->stx_atime.tv_sec;
+  dst->st_atim.tv_nsec = src->stx_atime.tv_nsec;
+  dst->st_mtim.tv_sec = src->stx_mtime.tv_sec;
+  dst->st_mtim.tv_nsec = src->stx_mtime.tv_nsec;
+  dst->st_ctim.tv_sec = src->stx_ctime.tv_sec;
+  dst->st_ctim.tv_nsec = src->stx_ctime.tv_nsec;
+  /* The same as uv_fs_stat() from the threadpool, which has no birth time. */
+  dst->st_birthtim.tv_sec = src->stx_ctime.tv_sec;
+  dst->st_birthtim.tv_nsec = src->stx_ctime.tv_nsec;
+  dst->st_flags = 0;
+  dst->st_gen = 0;
+}
+
+
+static void uv__iou_fs_done(uv_fs_t* req, int32_t res) {
+  struct uv__statx* statxbuf;
+
+  uv__req_unregister(req->loop, req);
+
+  if (req->work_req.work == uv__iou_cancelled)
+    res = UV_ECANCELED;
+
+  /* The ring gives errors as negated errno values, the same as libuv. */
+  req->result = res;
+
+  switch (req->fs_type) {
+    case UV_FS_READ:
+    case UV_FS_WRITE:
+      if (req->bufs != req->bufsml)
+        uv__free(req->bufs);
+      req->bufs = NULL;
+      req->nbufs = 0;
+      break;
+
+    case UV_FS_FSTAT:
+    case UV_FS_LSTAT:
+    case UV_FS_STAT:
+      statxbuf = req->ptr;
+      req->ptr = NULL;
+      if (res == 0) {
+        uv__iou_statx_to_stat(statxbuf, &req->statbuf);
+        req->ptr = &req->statbuf;
+      }
+      uv__free(statxbuf);
+      break;
+
+    default:
+      break;
+  }
+
+  req->cb(req);
+}
+
+
+static void uv__iou_io(uv_loop_t* loop, uv__io_t* w, unsigned int events) {
+  struct uv__io_uring_cqe* cqe;
+  struct uv__iou* iou;
+  unsigned int forks;
+  uv_fs_t* req;
+  uint32_t head;
+  uint32_t tail;
+  int32_t res;
+
+  iou = container_of(w, struct uv__iou, watcher);
+
+  head = *iou->cqhead;
+  tail = __atomic_load_n(iou->cqtail, __ATOMIC_ACQUIRE);
+  forks = iou->forks;
+  iou->reaping = 1;
+
+  for (; head != tail; head++) {
+    cqe = &iou->cqe[head & iou->cqmask];
+    req = (uv_fs_t*) (uintptr_t) cqe->user_data;
+    res = cqe->res;
+
+    __atomic_store_n(iou->cqhead, head + 1, __ATOMIC_RELEASE);
+    iou->in_flight--;
+
+    assert(req->type == UV_FS);
+    QUEUE_REMOVE(&req->work_req.wq);
+    uv__iou_fs_done(req, res);
+
+    /* uv_loop_fork() in the callback has dropped the ring. */
+    if (iou->forks != forks)
+      break;
+  }
+
+  iou->reaping = 0;
+}
+
+
+int uv__iou_flush(uv_loop_t* loop) {
+  struct uv__iou* iou;
+  struct uv__work* w;
+  uv_fs_t* req;
+  QUEUE* q;
+  int dropped;
+
+  iou = loop->internal_fields;
+  if (iou == NULL)
+    return 0;
+
+  /* A callback that forks adds what's on the child's ring to dropped. */
+  dropped = !QUEUE_EMPTY(&iou->dropped);
+  iou->reaping = 1;
+
+  while (!QUEUE_EMPTY(&iou->dropped)) {
+    q = QUEUE_HEAD(&iou->dropped);
+    QUEUE_REMOVE(q);
+    QUEUE_INIT(q);
+
+    w = QUEUE_DATA(q, struct uv__work, wq);
+    req = container_of(w, uv_fs_t, work_req);
+    uv__iou_fs_done(req, UV_ECANCELED);
+  }
+
+  iou->reaping = 0;
+
+  /* Tell the caller not to block, callbacks that ran may have started
+   * something or stopped the loop.
+   */
+  if (iou->ringfd == -1)
+    return dropped;
+
+  uv__iou_submit(iou);
+
+  return dropped ||
+         __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE) != iou->tail;
+}
+
+
+/* Called on uv_loop_close() and from the child on uv_loop_fork(), which is
+ * the only way requests can still be on the ring.
+ */
+void uv__iou_delete(uv_loop_t* loop) {
+  struct uv__iou* iou;
+
+  iou = loop->internal_fields;
+  if (iou == NULL)
+    return;
+
+  if (iou->ringfd != -1) {
+    uv__io_close(loop, &iou->watcher);
+    munmap(iou->sqe, iou->sqelen);
+    munmap(iou->ring, iou->ringlen);
+    uv__close(iou->ringfd);
+    iou->ringfd = -1;
+  }
+
+  /* The kernel completes them on the parent's ring, never on the child's. */
+  if (!QUEUE_EMPTY(&iou->requests)) {
+    QUEUE_ADD(&iou->dropped, &iou->requests);
+    QUEUE_INIT(&iou->requests);
+  }
+
+  iou->in_flight = 0;
+  iou->probed = 0;
+  iou->forks++;
+
+  if (iou->reaping || !QUEUE_EMPTY(&iou->dropped))
+    return;
+
+  loop->internal_fields = NULL;
+  uv__free(iou);
+}
+
+
+int uv__iou_fs_cancel(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+  uint32_t head;
+
+  iou = loop->internal_fields;
+  if (iou == NULL || iou->ringfd == -1)
+    return UV_EBUSY;
+
+  if (req->work_req.work == uv__iou_cancelled)
+    return UV_EBUSY;
+
+  /* Without SQPOLL the kernel only reads submissions in io_uring_enter(),
+   * made on this thread, so those it hasn't consumed yet can be changed.  The
+   * request turns into a no-op, which completes like any other.
+   */
+  head = __atomic_load_n(iou->sqhead, __ATOMIC_ACQUIRE);
+  for (; head != iou->tail; head++) {
+    sqe = &iou->sqe[head & iou->sqmask];
+    if (sqe->user_data != (uintptr_t) req)
+      continue;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->user_data = (uintptr_t) req;
+    sqe->opcode = UV__IORING_OP_NOP;
+    req->work_req.work = uv__iou_cancelled;
+    return 0;
+  }
+
+  return UV_EBUSY;
+}
+
+
+int uv__iou_fs_close(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL || !iou->can_close)
+    return 0;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  sqe->fd = req->file;
+  sqe->opcode = UV__IORING_OP_CLOSE;
+
+  return 1;
+}
+
+
+int uv__iou_fs_fsync_or_fdatasync(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL)
+    return 0;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  sqe->fd = req->file;
+  sqe->opcode = UV__IORING_OP_FSYNC;
+  if (req->fs_type == UV_FS_FDATASYNC)
+    sqe->fsync_flags = UV__IORING_FSYNC_DATASYNC;
+
+  return 1;
+}
+
+
+int uv__iou_fs_open(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL)
+    return 0;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  sqe->addr = (uintptr_t) req->path;
+  sqe->fd = UV__AT_FDCWD;
+  sqe->len = req->mode;
+  sqe->opcode = UV__IORING_OP_OPENAT;
+  sqe->open_flags = req->flags | O_CLOEXEC;
+
+  return 1;
+}
+
+
+int uv__iou_fs_read_or_write(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__iou* iou;
+
+  /* The threadpool splits up more buffers than one readv() takes. */
+  if (req->nbufs > (unsigned int) uv__getiovmax())
+    return 0;
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL)
+    return 0;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL)
+    return 0;
+
+  sqe->addr = (uintptr_t) req->bufs;
+  sqe->fd = req->file;
+  sqe->len = req->nbufs;
+  /* An offset of -1 is the file position, as read() and write() use. */
+  sqe->off = req->off < 0 ? (uint64_t) -1 : (uint64_t) req->off;
+  sqe->opcode = req->fs_type == UV_FS_READ ? UV__IORING_OP_READV
+                                           : UV__IORING_OP_WRITEV;
+
+  return 1;
+}
+
+
+int uv__iou_fs_statx(uv_loop_t* loop, uv_fs_t* req) {
+  struct uv__io_uring_sqe* sqe;
+  struct uv__statx* statxbuf;
+  struct uv__iou* iou;
+
+  iou = uv__iou_get(loop);
+  if (iou == NULL)
+    return 0;
+
+  statxbuf = uv__malloc(sizeof(*statxbuf));
+  if (statxbuf == NULL)
+    return 0;
+
+  sqe = uv__iou_get_sqe(iou, loop, req);
+  if (sqe == NULL) {
+    uv__free(statxbuf);
+    return 0;
+  }
+
+  /* Until the request completes req->ptr is the statx buffer, after it's
+   * &req->statbuf as it is for the threadpool.
+   */
+  req->ptr = statxbuf;
+
+  sqe->addr2 = (uintptr_t) statxbuf;
+  sqe->len = UV__STATX_BASIC_STATS;
+  sqe->opcode = UV__IORING_OP_STATX;
+
+  if (req->fs_type == UV_FS_FSTAT) {
+    sqe->addr = (uintptr_t) "";
+    sqe->fd = req->file;
+    sqe->statx_flags = UV__AT_EMPTY_PATH;
+  } else {
+    sqe->addr = (uintptr_t) req->path;
+    sqe->fd = UV__AT_FDCWD;
+    if (req->fs_type == UV_FS_LSTAT)
+      sqe->statx_flags = UV__AT_SYMLINK_NOFOLLOW;
+  }
+
+  return 1;
+}
@@ -675,4 +675,95 @@ TEST_IMPL(fork_threadpool_queue_work_simple) {
 #endif /* !__MVS__ */
 
 
+#if defined(__linux__)
+static uv_fs_t fork_read_req;
+static int fork_read_cb_called;
+static int fork_read_result;
+static int fork_stat_cb_called;
+
+
+static void fork_read_cb(uv_fs_t* req) {
+  ASSERT(req == &fork_read_req);
+  fork_read_result = req->result;
+  fork_read_cb_called++;
+  uv_fs_req_cleanup(req);
+}
+
+
+static void fork_stat_cb(uv_fs_t* req) {
+  ASSERT(req->result == 0);
+  fork_stat_cb_called++;
+  uv_fs_req_cleanup(req);
+}
+#endif
+
+
+TEST_IMPL(fork_fs_io_uring) {
+#if defined(__linux__)
+  /* A read on the parent's io_uring is cancelled in the child, which doesn't
+   * see it complete, and the child can go on with a ring of its own.
+   */
+  pid_t child_pid;
+  pid_t waited_pid;
+  int child_stat;
+  uv_loop_t* loop;
+  uv_fs_t stat_req;
+  uv_buf_t iov;
+  char buf[1];
+  int fds[2];
+
+  ASSERT(0 == uv_os_setenv("UV_USE_IO_URING", "1"));
+  loop = uv_default_loop();
+  ASSERT(0 == pipe(fds));
+  iov = uv_buf_init(buf, sizeof(buf));
+
+  /* Handed to the kernel, where it waits for something to read. */
+  ASSERT(0 == uv_fs_read(loop, &fork_read_req, fds[0], &iov, 1, -1,
+                         fork_read_cb));
+  uv_run(loop, UV_RUN_NOWAIT);
+
+  child_pid = fork();
+  ASSERT(child_pid != -1);
+
+  if (child_pid != 0) {
+    /* parent */
+    ASSERT(1 == write(fds[1], "x", 1));
+    ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+    ASSERT(1 == fork_read_cb_called);
+    ASSERT(1 == fork_read_result);
+
+    waited_pid = waitpid(child_pid, &child_stat, 0);
+    ASSERT(child_pid == waited_pid);
+    ASSERT(WIFEXITED(child_stat));
+    if (WEXITSTATUS(child_stat) == TEST_SKIP)
+      RETURN_SKIP("io_uring is not available, fs requests used the threadpool.");
+    ASSERT(0 == WEXITSTATUS(child_stat));
+  } else {
+    /* child */
+    ASSERT(0 == uv_loop_fork(loop));
+    uv_run(loop, UV_RUN_NOWAIT);
+
+    /* A read on the threadpool is left blocked in the parent's thread. */
+    if (fork_read_cb_called == 0)
+      return TEST_SKIP;
+
+    ASSERT(1 == fork_read_cb_called);
+    ASSERT(UV_ECANCELED == fork_read_result);
+
+    ASSERT(0 == uv_fs_stat(loop, &stat_req, "/", fork_stat_cb));
+    ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+    ASSERT(1 == fork_stat_cb_called);
+  }
+
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#else
+  RETURN_SKIP("io_uring is only used on Linux.");
+#endif
+}
+
+
 #endif /* !_WIN32 */
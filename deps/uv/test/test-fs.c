@@ -31,6 +31,9 @@
 #if defined(__unix__) || defined(__POSIX__) || \
     defined(__APPLE__) || defined(_AIX) || defined(__MVS__)
 #include <unistd.h> /* unlink, rmdir, etc. */
+#if defined(__linux__)
+# include <pwd.h>  /* getpwnam */
+#endif
 #else
 # include <winioctl.h>
 # include <direct.h>
@@ -3109,6 +3112,216 @@ TEST_IMPL(fs_file_pos_after_op_with_offset) {
   return 0;
 }
 
+#if defined(__linux__)
+static uv_work_t busy_work_reqs[4];
+static uv_sem_t busy_sem;
+static uv_timer_t busy_timer;
+static uv_fs_t busy_req;
+static uv_file busy_file;
+static int busy_step;
+static int busy_timed_out;
+
+
+static void busy_work_cb(uv_work_t* req) {
+  uv_sem_wait(&busy_sem);
+}
+
+
+static void busy_after_work_cb(uv_work_t* req, int status) {
+  ASSERT(status == 0);
+}
+
+
+static void busy_unblock(void) {
+  size_t i;
+
+  for (i = 0; i < ARRAY_SIZE(busy_work_reqs); i++)
+    uv_sem_post(&busy_sem);
+}
+
+
+static void busy_timer_cb(uv_timer_t* handle) {
+  busy_timed_out = 1;
+  busy_unblock();
+}
+
+
+static void busy_fs_cb(uv_fs_t* req) {
+  static char data[] = "busy\n";
+  static char out[sizeof(data)];
+  uv_buf_t iov;
+
+  ASSERT(req == &busy_req);
+
+  switch (busy_step++) {
+    case 0:
+      ASSERT(req->result >= 0);
+      busy_file = req->result;
+      uv_fs_req_cleanup(req);
+      iov = uv_buf_init(data, sizeof(data) - 1);
+      ASSERT(0 == uv_fs_write(loop, req, busy_file, &iov, 1, 0, busy_fs_cb));
+      break;
+    case 1:
+      ASSERT(req->result == sizeof(data) - 1);
+      uv_fs_req_cleanup(req);
+      ASSERT(0 == uv_fs_fsync(loop, req, busy_file, busy_fs_cb));
+      break;
+    case 2:
+      ASSERT(req->result == 0);
+      uv_fs_req_cleanup(req);
+      iov = uv_buf_init(out, sizeof(out));
+      ASSERT(0 == uv_fs_read(loop, req, busy_file, &iov, 1, 0, busy_fs_cb));
+      break;
+    case 3:
+      ASSERT(req->result == sizeof(data) - 1);
+      ASSERT(0 == memcmp(out, data, sizeof(data) - 1));
+      uv_fs_req_cleanup(req);
+      ASSERT(0 == uv_fs_fstat(loop, req, busy_file, busy_fs_cb));
+      break;
+    case 4:
+      ASSERT(req->result == 0);
+      ASSERT(req->ptr == &req->statbuf);
+      ASSERT(req->statbuf.st_size == sizeof(data) - 1);
+      uv_fs_req_cleanup(req);
+      ASSERT(0 == uv_fs_stat(loop, req, "test_file", busy_fs_cb));
+      break;
+    case 5:
+      ASSERT(req->result == 0);
+      ASSERT(req->statbuf.st_size == sizeof(data) - 1);
+      uv_fs_req_cleanup(req);
+      ASSERT(0 == uv_fs_close(loop, req, busy_file, busy_fs_cb));
+      break;
+    case 6:
+      ASSERT(req->result == 0);
+      uv_fs_req_cleanup(req);
+      uv_timer_stop(&busy_timer);
+      if (!busy_timed_out)
+        busy_unblock();
+      break;
+    default:
+      ASSERT(0 && "unexpected fs callback");
+  }
+}
+#endif
+
+
+TEST_IMPL(fs_async_with_busy_threadpool) {
+#if defined(__linux__)
+  size_t i;
+
+  /* Async open, write, fsync, read, fstat, stat and close go to the loop's
+   * io_uring so they finish while every threadpool thread is busy.
+   */
+  unlink("test_file");
+  loop = uv_default_loop();
+
+  ASSERT(0 == uv_sem_init(&busy_sem, 0));
+  ASSERT(0 == uv_os_setenv("UV_THREADPOOL_SIZE", "4"));
+  ASSERT(0 == uv_os_setenv("UV_USE_IO_URING", "1"));
+  for (i = 0; i < ARRAY_SIZE(busy_work_reqs); i++) {
+    ASSERT(0 == uv_queue_work(loop,
+                              busy_work_reqs + i,
+                              busy_work_cb,
+                              busy_after_work_cb));
+  }
+
+  ASSERT(0 == uv_timer_init(loop, &busy_timer));
+  ASSERT(0 == uv_timer_start(&busy_timer, busy_timer_cb, 1000, 0));
+
+  ASSERT(0 == uv_fs_open(loop,
+                         &busy_req,
+                         "test_file",
+                         O_RDWR | O_CREAT | O_TRUNC,
+                         S_IWUSR | S_IRUSR,
+                         busy_fs_cb));
+
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(busy_step == 7);
+
+  uv_sem_destroy(&busy_sem);
+  unlink("test_file");
+
+  if (busy_timed_out)
+    RETURN_SKIP("io_uring is not available, fs requests used the threadpool.");
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#else
+  RETURN_SKIP("io_uring is only used on Linux.");
+#endif
+}
+
+
+#if defined(__linux__)
+static uv_fs_t seteuid_req;
+static int seteuid_result;
+
+
+static void seteuid_open_cb(uv_fs_t* req) {
+  ASSERT(req == &seteuid_req);
+  seteuid_result = req->result;
+  if (req->result >= 0)
+    uv_fs_close(NULL, req, req->result, NULL);
+  uv_fs_req_cleanup(req);
+}
+#endif
+
+
+TEST_IMPL(fs_async_after_seteuid) {
+#if defined(__linux__)
+  struct passwd* pw;
+  uv_fs_t req;
+  int r;
+
+  if (getuid() != 0)
+    RETURN_SKIP("It should be run as root user");
+
+  /* A file only root may read, opened once as root to set up the loop's
+   * io_uring, must not open through it as nobody.
+   */
+  pw = getpwnam("nobody");
+  ASSERT(pw != NULL);
+  unlink("test_file");
+  loop = uv_default_loop();
+  ASSERT(0 == uv_os_setenv("UV_USE_IO_URING", "1"));
+
+  r = uv_fs_open(NULL, &req, "test_file", O_WRONLY | O_CREAT, S_IRUSR, NULL);
+  ASSERT(r >= 0);
+  uv_fs_req_cleanup(&req);
+  uv_fs_close(NULL, &req, r, NULL);
+  uv_fs_req_cleanup(&req);
+
+  ASSERT(0 == uv_fs_open(loop,
+                         &seteuid_req,
+                         "test_file",
+                         O_RDONLY,
+                         0,
+                         seteuid_open_cb));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(seteuid_result >= 0);
+
+  ASSERT(0 == setegid(pw->pw_gid));
+  ASSERT(0 == seteuid(pw->pw_uid));
+  ASSERT(0 == uv_fs_open(loop,
+                         &seteuid_req,
+                         "test_file",
+                         O_RDONLY,
+                         0,
+                         seteuid_open_cb));
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(0 == seteuid(0));
+  ASSERT(0 == setegid(0));
+  ASSERT(seteuid_result == UV_EACCES);
+
+  unlink("test_file");
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#else
+  RETURN_SKIP("io_uring is only used on Linux.");
+#endif
+}
+
 TEST_IMPL(fs_null_req) {
   /* Verify that all fs functions return UV_EINVAL when the request is NULL. */
   int r;
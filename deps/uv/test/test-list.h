@@ -337,6 +337,8 @@ TEST_DECLARE   (get_osfhandle_valid_handle)
 TEST_DECLARE   (fs_write_alotof_bufs)
 TEST_DECLARE   (fs_write_alotof_bufs_with_offset)
 TEST_DECLARE   (fs_file_pos_after_op_with_offset)
+TEST_DECLARE   (fs_async_with_busy_threadpool)
+TEST_DECLARE   (fs_async_after_seteuid)
 TEST_DECLARE   (fs_null_req)
 #ifdef _WIN32
 TEST_DECLARE   (fs_exclusive_sharing_mode)
@@ -350,6 +352,7 @@ TEST_DECLARE   (threadpool_cancel_getaddrinfo)
 TEST_DECLARE   (threadpool_cancel_getnameinfo)
 TEST_DECLARE   (threadpool_cancel_work)
 TEST_DECLARE   (threadpool_cancel_fs)
+TEST_DECLARE   (threadpool_cancel_fs_io_uring)
 TEST_DECLARE   (threadpool_cancel_single)
 TEST_DECLARE   (thread_local_storage)
 TEST_DECLARE   (thread_stack_size)
@@ -431,6 +434,7 @@ TEST_DECLARE  (fork_fs_events_file_parent_child)
 #ifndef __MVS__
 TEST_DECLARE  (fork_threadpool_queue_work_simple)
 #endif
+TEST_DECLARE  (fork_fs_io_uring)
 #endif
 
 TASK_LIST_START
@@ -880,6 +884,8 @@ TASK_LIST_START
   TEST_ENTRY  (fs_write_alotof_bufs_with_offset)
   TEST_ENTRY  (fs_read_write_null_arguments)
   TEST_ENTRY  (fs_file_pos_after_op_with_offset)
+  TEST_ENTRY  (fs_async_with_busy_threadpool)
+  TEST_ENTRY  (fs_async_after_seteuid)
   TEST_ENTRY  (fs_null_req)
 #ifdef _WIN32
   TEST_ENTRY  (fs_exclusive_sharing_mode)
@@ -894,6 +900,7 @@ TASK_LIST_START
   TEST_ENTRY  (threadpool_cancel_getnameinfo)
   TEST_ENTRY  (threadpool_cancel_work)
   TEST_ENTRY  (threadpool_cancel_fs)
+  TEST_ENTRY  (threadpool_cancel_fs_io_uring)
   TEST_ENTRY  (threadpool_cancel_single)
   TEST_ENTRY  (thread_local_storage)
   TEST_ENTRY  (thread_stack_size)
@@ -925,6 +932,7 @@ TASK_LIST_START
 #ifndef __MVS__
   TEST_ENTRY  (fork_threadpool_queue_work_simple)
 #endif
+  TEST_ENTRY  (fork_fs_io_uring)
 #endif
 
 #if 0
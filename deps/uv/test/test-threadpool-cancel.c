@@ -22,6 +22,11 @@
 #include "uv.h"
 #include "task.h"
 
+#if defined(__linux__)
+# include <fcntl.h>
+# include <unistd.h>
+#endif
+
 #define INIT_CANCEL_INFO(ci, what)                                            \
   do {                                                                        \
     (ci)->reqs = (what);                                                      \
@@ -290,6 +295,78 @@ TEST_IMPL(threadpool_cancel_fs) {
 }
 
 
+#if defined(__linux__)
+static uv_fs_t pipe_read_req;
+static int pipe_read_result;
+
+
+static void pipe_read_cb(uv_fs_t* req) {
+  ASSERT(req == &pipe_read_req);
+  pipe_read_result = req->result;
+  uv_fs_req_cleanup(req);
+}
+#endif
+
+
+TEST_IMPL(threadpool_cancel_fs_io_uring) {
+#if defined(__linux__)
+  uv_fs_t reqs[3];
+  uv_loop_t* loop;
+  uv_buf_t iov;
+  char buf[1];
+  int fds[2];
+  int r;
+
+  /* Requests on the loop's io_uring can be cancelled until the loop's next
+   * poll for I/O hands them to the kernel, after that uv_cancel() fails.
+   */
+  ASSERT(0 == uv_os_setenv("UV_USE_IO_URING", "1"));
+  loop = uv_default_loop();
+  saturate_threadpool();
+  ASSERT(0 == pipe(fds));
+  iov = uv_buf_init(buf, sizeof(buf));
+
+  ASSERT(0 == uv_fs_open(loop, reqs + 0, "/", O_RDONLY, 0, fs_cb));
+  ASSERT(0 == uv_fs_stat(loop, reqs + 1, "/", fs_cb));
+  ASSERT(0 == uv_fs_read(loop, reqs + 2, fds[0], &iov, 1, -1, fs_cb));
+  ASSERT(0 == uv_cancel((uv_req_t*) (reqs + 0)));
+  ASSERT(0 == uv_cancel((uv_req_t*) (reqs + 1)));
+  ASSERT(0 == uv_cancel((uv_req_t*) (reqs + 2)));
+
+  /* The threadpool is busy with work that doesn't finish until it's
+   * unblocked, so only run the loop until the callbacks have come.
+   */
+  while (fs_cb_called < ARRAY_SIZE(reqs))
+    uv_run(loop, UV_RUN_ONCE);
+
+  ASSERT(0 == uv_fs_read(loop, &pipe_read_req, fds[0], &iov, 1, -1,
+                         pipe_read_cb));
+  uv_run(loop, UV_RUN_NOWAIT);
+  r = uv_cancel((uv_req_t*) &pipe_read_req);
+
+  ASSERT(1 == write(fds[1], "x", 1));
+  unblock_threadpool();
+  ASSERT(0 == uv_run(loop, UV_RUN_DEFAULT));
+  ASSERT(0 == close(fds[0]));
+  ASSERT(0 == close(fds[1]));
+
+  /* A request queued on the saturated threadpool is still cancellable. */
+  if (r == 0) {
+    ASSERT(pipe_read_result == UV_ECANCELED);
+    RETURN_SKIP("io_uring is not available, fs requests used the threadpool.");
+  }
+
+  ASSERT(r == UV_EBUSY);
+  ASSERT(pipe_read_result == 1);
+
+  MAKE_VALGRIND_HAPPY();
+  return 0;
+#else
+  RETURN_SKIP("io_uring is only used on Linux.");
+#endif
+}
+
+
 TEST_IMPL(threadpool_cancel_single) {
   uv_loop_t* loop;
   uv_work_t req;
@@ -60,6 +60,7 @@ const {
   copyObject,
   Dirent,
   getDirents,
+  getDirentsWithStats,
   getOptions,
   nullCheck,
   preprocessSymlinkDestination,
@@ -802,6 +803,80 @@ function readdirSync(path, options) {
   return options.withFileTypes ? getDirents(path, result) : result;
 }
 
+function readdirStats(path, options, callback) {
+  callback = makeCallback(typeof options === 'function' ? options : callback);
+  options = getOptions(options, {});
+  path = getPathFromURL(path);
+  validatePath(path);
+
+  const req = new FSReqCallback();
+  req.oncomplete = (err, result) => {
+    if (err) {
+      callback(err);
+      return;
+    }
+    callback(null, getDirentsWithStats(result));
+  };
+  binding.readdirStats(pathModule.toNamespacedPath(path), options.encoding,
+                       req);
+}
+
+function readdirStatsSync(path, options) {
+  options = getOptions(options, {});
+  path = getPathFromURL(path);
+  validatePath(path);
+  const ctx = { path };
+  const result = binding.readdirStats(pathModule.toNamespacedPath(path),
+                                      options.encoding, undefined, ctx);
+  handleErrorFromBinding(ctx);
+  return getDirentsWithStats(result);
+}
+
+function getWalkResult([paths, types], options) {
+  if (!options.withFileTypes)
+    return paths;
+  for (var i = 0; i < paths.length; i++)
+    paths[i] = new Dirent(paths[i], types[i]);
+  return paths;
+}
+
+function validateWalkPattern(pattern) {
+  if (pattern !== undefined && typeof pattern !== 'string')
+    throw new ERR_INVALID_ARG_TYPE('options.pattern', 'string', pattern);
+}
+
+function walk(path, options, callback) {
+  callback = makeCallback(typeof options === 'function' ? options : callback);
+  options = getOptions(options, {});
+  path = getPathFromURL(path);
+  validatePath(path);
+  validateWalkPattern(options.pattern);
+
+  const req = new FSReqCallback();
+  req.oncomplete = (err, result) => {
+    if (err) {
+      callback(err);
+      return;
+    }
+    callback(null, getWalkResult(result, options));
+  };
+  binding.walk(pathModule.toNamespacedPath(path), options.pattern,
+               options.encoding, req);
+}
+
+function walkSync(path, options) {
+  options = getOptions(options, {});
+  path = getPathFromURL(path);
+  validatePath(path);
+  validateWalkPattern(options.pattern);
+  const ctx = { path };
+  const result = binding.walk(pathModule.toNamespacedPath(path),
+                              options.pattern, options.encoding,
+                              undefined, ctx);
+  handleErrorFromBinding(ctx);
+  return getWalkResult(result, options);
+}
+
 function fstat(fd, options, callback) {
   if (arguments.length < 3) {
     callback = options;
@@ -1387,6 +1462,29 @@ if (isWindows) {
   nextPart = function nextPart(p, i) { return p.indexOf('/', i); };
 }
 
+// Files in a mounted archive are never links, so their real path comes from
+// the archive's index instead of an lstat() of each part of the path.  The
+// archives are mounted for the life of the process so found paths are kept,
+// unless there is an upper dir where a path can be copied up or removed.
+let archiveRealpathCache;
+
+// Returns undefined when p is not in a mounted archive, a negative error
+// number when the archive has no such file or else the real path of p.
+function archiveRealpath(p) {
+  if (archiveRealpathCache === undefined)
+    archiveRealpathCache = binding.archiveHasUpperDir() ? null : new Map();
+  if (archiveRealpathCache === null)
+    return binding.archiveRealpath(p);
+
+  let result = archiveRealpathCache.get(p);
+  if (result === undefined) {
+    result = binding.archiveRealpath(p);
+    if (typeof result === 'string')
+      archiveRealpathCache.set(p, result);
+  }
+  return result;
+}
+
 const emptyObj = Object.create(null);
 function realpathSync(p, options) {
   if (!options)
@@ -1406,6 +1504,14 @@ function realpathSync(p, options) {
     return maybeCachedResult;
   }
 
+  const archived = archiveRealpath(p);
+  if (typeof archived === 'number')
+    handleErrorFromBinding({ errno: archived, syscall: 'lstat', path: p });
+  if (archived !== undefined) {
+    if (cache) cache.set(p, archived);
+    return encodeRealpathResult(archived, options);
+  }
+
   const seenLinks = Object.create(null);
   const knownHard = Object.create(null);
   const original = p;
@@ -1547,6 +1653,19 @@ function realpath(p, options, callback) {
   validatePath(p);
   p = pathModule.resolve(p);
 
+  const archived = archiveRealpath(p);
+  if (typeof archived === 'number') {
+    const err = errors.uvException({
+      errno: archived,
+      syscall: 'lstat',
+      path: p
+    });
+    return process.nextTick(callback, err);
+  }
+  if (archived !== undefined)
+    return process.nextTick(callback, null,
+                            encodeRealpathResult(archived, options));
+
   const seenLinks = Object.create(null);
   const knownHard = Object.create(null);
 
@@ -1804,6 +1923,8 @@ module.exports = fs = {
   openSync,
   readdir,
   readdirSync,
+  readdirStats,
+  readdirStatsSync,
   read,
   readSync,
   readFile,
@@ -1827,6 +1948,8 @@ module.exports = fs = {
   unlinkSync,
   utimes,
   utimesSync,
+  walk,
+  walkSync,
   watch,
   watchFile,
   writeFile,
@@ -20,7 +20,7 @@
                                 _setupProcessObject, _setupNextTick,
                                 _setupPromises, _chdir, _cpuUsage,
                                 _hrtime, _hrtimeBigInt,
-                                _memoryUsage, _rawDebug,
+                                _memoryUsage, _archiveStats, _rawDebug,
                                 _umask, _initgroups, _setegid, _seteuid,
                                 _setgid, _setuid, _setgroups,
                                 _shouldAbortOnUncaughtToggle },
@@ -96,6 +96,7 @@
     perThreadSetup.setupHrtime(_hrtime, _hrtimeBigInt);
     perThreadSetup.setupCpuUsage(_cpuUsage);
     perThreadSetup.setupMemoryUsage(_memoryUsage);
+    perThreadSetup.setupArchiveStats(_archiveStats);
     perThreadSetup.setupKillAndExit();
 
     if (global.__coverage__)
@@ -43,6 +43,7 @@ const {
   UV_DIRENT_CHAR,
   UV_DIRENT_BLOCK
 } = process.binding('constants').fs;
+const { kFsStatsFieldsLength } = process.binding('fs');
 
 const isWindows = process.platform === 'win32';
 
@@ -111,6 +112,26 @@ for (const name of Reflect.ownKeys(Dirent.prototype)) {
   };
 }
 
+class DirentWithStats extends Dirent {
+  constructor(name, type, stats) {
+    super(name, type);
+    this.stats = stats;
+  }
+}
+
+// Turns the [names, types, stats, errors] given by binding.readdirStats()
+// into DirentWithStats, stats is null for a child which failed to stat.
+function getDirentsWithStats([names, types, stats, errors]) {
+  const len = names.length;
+  const result = new Array(len);
+  for (var i = 0; i < len; i++) {
+    const childStats = errors[i] === 0 ?
+      getStatsFromBinding(stats, i * kFsStatsFieldsLength) : null;
+    result[i] = new DirentWithStats(names[i], types[i], childStats);
+  }
+  return result;
+}
+
 function copyObject(source) {
   var target = {};
   for (var key in source)
@@ -457,6 +478,7 @@ module.exports = {
   copyObject,
   Dirent,
   getDirents,
+  getDirentsWithStats,
   getOptions,
   nullCheck,
   preprocessSymlinkDestination,
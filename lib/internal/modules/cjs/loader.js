@@ -30,8 +30,15 @@ const internalFS = require('internal/fs/utils');
 const path = require('path');
 const {
   internalModuleReadJSON,
-  internalModuleStat
+  internalModuleStat,
+  internalModuleReadSource,
+  internalModuleReadCodeCache,
+  internalModuleWriteCodeCache
 } = process.binding('fs');
+const {
+  compileFunction,
+  createFunctionCachedData
+} = process.binding('contextify');
 const { safeGetenv } = process.binding('util');
 const {
   makeRequireFunction,
@@ -130,6 +137,20 @@ Module.wrapper = [
   '\n});'
 ];
 
+// Modules in a mounted archive are compiled as the body of a function with
+// these parameters rather than through Module.wrap(), as long as neither has
+// been replaced, so their source is never copied into a wrapped string.
+const defaultWrap = Module.wrap;
+const defaultWrapper = Module.wrapper.slice();
+const wrapperParameters =
+  ['exports', 'require', 'module', '__filename', '__dirname'];
+
+function isDefaultWrap() {
+  return Module.wrap === defaultWrap &&
+    Module.wrapper[0] === defaultWrapper[0] &&
+    Module.wrapper[1] === defaultWrapper[1];
+}
+
 const debug = util.debuglog('module');
 
 Module._debug = util.deprecate(debug, 'Module._debug is deprecated.',
@@ -651,14 +672,26 @@ Module.prototype._compile = function(content, filename) {
 
   content = stripShebang(content);
 
-  // create wrapper function
-  var wrapper = Module.wrap(content);
-
-  var compiledWrapper = vm.runInThisContext(wrapper, {
-    filename: filename,
-    lineOffset: 0,
-    displayErrors: true
-  });
+  // Modules in a mounted archive never change so their V8 code cache is kept,
+  // codeCache is undefined for any other module.
+  var codeCache = isDefaultWrap() ?
+    internalModuleReadCodeCache(filename) : undefined;
+  var compiledWrapper;
+  var cachedDataRejected = false;
+  if (codeCache === undefined) {
+    // create wrapper function
+    var wrapper = Module.wrap(content);
+
+    compiledWrapper = vm.runInThisContext(wrapper, {
+      filename: filename,
+      lineOffset: 0,
+      displayErrors: true
+    });
+  } else {
+    [compiledWrapper, cachedDataRejected] = compileFunction(
+      content, filename, wrapperParameters,
+      codeCache === null ? undefined : codeCache);
+  }
 
   var inspectorWrapper = null;
   if (process._breakFirstLine && process._eval == null) {
@@ -690,13 +723,20 @@ Module.prototype._compile = function(content, filename) {
                                   filename, dirname);
   }
   if (depth === 0) stat.cache = null;
+  // Made after the module has run so the functions it called are in it.
+  if (codeCache === null || cachedDataRejected)
+    internalModuleWriteCodeCache(filename,
+                                 createFunctionCachedData(compiledWrapper));
   return result;
 };
 
 
 // Native extension for .js
 Module._extensions['.js'] = function(module, filename) {
-  var content = fs.readFileSync(filename, 'utf8');
+  // Undefined unless the source can be used straight from a mounted archive.
+  var content = internalModuleReadSource(filename);
+  if (content === undefined)
+    content = fs.readFileSync(filename, 'utf8');
   module._compile(stripBOM(content), filename);
 };
 
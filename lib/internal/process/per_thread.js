@@ -143,6 +143,35 @@ function setupMemoryUsage(_memoryUsage) {
   };
 }
 
+function setupArchiveStats(_archiveStats) {
+  process.archiveStats = function archiveStats() {
+    // The binding names the fields, in the order each mount's are laid out.
+    const [mountPoints, archivePaths, fields, names] = _archiveStats();
+    const [counters, timers, timerFields] = names;
+    const fieldsLength = counters.length + timers.length * timerFields.length;
+    const mounts = [];
+
+    for (var i = 0; i < mountPoints.length; i++) {
+      let offset = i * fieldsLength;
+      const mount = { mount: mountPoints[i], archive: archivePaths[i] };
+
+      for (const counter of counters)
+        mount[counter] = fields[offset++];
+
+      mount.timings = {};
+      for (const timer of timers) {
+        const timing = mount.timings[timer] = {};
+        for (const field of timerFields)
+          timing[field] = fields[offset++];
+      }
+
+      mounts.push(mount);
+    }
+
+    return mounts;
+  };
+}
+
 function setupConfig(_source) {
   // NativeModule._source
   // used for `process.config`, but not a real module
@@ -235,6 +264,7 @@ module.exports = {
   setupCpuUsage,
   setupHrtime,
   setupMemoryUsage,
+  setupArchiveStats,
   setupConfig,
   setupKillAndExit,
   setupRawDebug,
@@ -327,6 +327,14 @@
         'src/archive/manager.cc',
         'src/archive/archive_junzip.cc',
         'src/archive/uv_schedule_delay.cc',      
+        'src/archive/startup_profile.cc',
+        'src/archive/walk.cc',
+        'src/archive/overlay.cc',
+        'src/archive/metrics.cc',
+        'src/archive/trace.cc',
+        'src/archive/shared_index.cc',
+        'src/archive/request_pool.cc',
+        'src/archive/manifest.cc',
         'src/async_wrap.cc',
         'src/bootstrapper.cc',
         'src/callback_scope.cc',
@@ -400,6 +408,14 @@
         'src/archive/manager.h',
         'src/archive/archive_junzip.h',
         'src/archive/uv_schedule_delay.h',        
+        'src/archive/startup_profile.h',
+        'src/archive/walk.h',
+        'src/archive/overlay.h',
+        'src/archive/metrics.h',
+        'src/archive/trace.h',
+        'src/archive/shared_index.h',
+        'src/archive/request_pool.h',
+        'src/archive/manifest.h',
         'src/aliased_buffer.h',
         'src/async_wrap.h',
         'src/async_wrap-inl.h',
@@ -967,8 +983,24 @@
       'defines': [ 'NODE_WANT_INTERNALS=1' ],
 
       'sources': [
+        'test/cctest/archive_test_util.cc',
         'test/cctest/node_test_fixture.cc',
         'test/cctest/test_aliased_buffer.cc',
+        'test/cctest/test_archive_dedup.cc',
+        'test/cctest/test_archive_library.cc',
+        'test/cctest/test_archive_manifest.cc',
+        'test/cctest/test_archive_overlay.cc',
+        'test/cctest/test_archive_readdir.cc',
+        'test/cctest/test_archive_realpath.cc',
+        'test/cctest/test_archive_relayout.cc',
+        'test/cctest/test_archive_request_pool.cc',
+        'test/cctest/test_archive_sendfile.cc',
+        'test/cctest/test_archive_shared_index.cc',
+        'test/cctest/test_archive_source.cc',
+        'test/cctest/test_archive_startup_profile.cc',
+        'test/cctest/test_archive_threads.cc',
+        'test/cctest/test_archive_trace.cc',
+        'test/cctest/test_archive_watch.cc',
         'test/cctest/test_base64.cc',
         'test/cctest/test_node_postmortem_metadata.cc',
         'test/cctest/test_environment.cc',
@@ -1002,6 +1034,53 @@
           'ldflags': [ '-I<(SHARED_INTERMEDIATE_DIR)' ]
         }],
       ],
+    },
+    {
+      # The archive micro-benchmarks replace the global operator new to count
+      # allocations so they are kept out of cctest.
+      'target_name': 'archive_bench',
+      'type': 'executable',
+
+      'dependencies': [
+        '<(node_lib_target_name)',
+        'rename_node_bin_win',
+        'deps/gtest/gtest.gyp:gtest',
+        'node_js2c#host',
+        'node_dtrace_header',
+        'node_dtrace_ustack',
+        'node_dtrace_provider',
+      ],
+
+      'includes': [
+        'node.gypi'
+      ],
+
+      'include_dirs': [
+        'src',
+        'tools/msvs/genfiles',
+        'deps/v8/include',
+        'deps/cares/include',
+        'deps/uv/include',
+        '<(SHARED_INTERMEDIATE_DIR)', # for node_natives.h
+      ],
+
+      'defines': [ 'NODE_WANT_INTERNALS=1' ],
+
+      'sources': [
+        'test/cctest/archive_test_util.cc',
+        'test/cctest/test_archive_bench.cc',
+      ],
+
+      'conditions': [
+        [ 'node_use_openssl=="true"', {
+          'defines': [
+            'HAVE_OPENSSL=1',
+          ],
+        }],
+        ['OS=="solaris"', {
+          'ldflags': [ '-I<(SHARED_INTERMEDIATE_DIR)' ]
+        }],
+      ],
     }
   ], # end targets
 
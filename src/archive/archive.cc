@@ -1,5 +1,6 @@
 #include "archive/archive.h"
 #include "archive/manager.h"
+#include "archive/walk.h"
 
 #include <cstdio>
 #include <cstring>
@@ -41,6 +42,53 @@ int ArchiveDir::Add( const std::string& name, struct _ArchiveDir* dir_node )
 	return 0;
 }
 
+void ArchiveDir::BuildListing()
+{
+  size_t names_size = 0;
+
+  for( std::map< std::string, ArchiveDir* >::const_iterator dir=dirs_.begin(); dir!=dirs_.end(); ++dir )
+  {
+    names_size += dir->first.length() + 1;
+  }
+
+  for( std::map< std::string, ArchiveFile* >::const_iterator file=files_.begin(); file!=files_.end(); ++file )
+  {
+    names_size += file->first.length() + 1;
+  }
+
+  listing_.clear();
+  listing_.reserve( dirs_.size() + files_.size() );
+  listing_names_.assign( names_size, 0 );
+
+  char* name = listing_names_.data();
+
+  for( std::map< std::string, ArchiveDir* >::const_iterator dir=dirs_.begin(); dir!=dirs_.end(); ++dir )
+  {
+    std::memcpy( name, dir->first.c_str(), dir->first.length() );
+
+    uv_dirent_t entry;
+    entry.name = name;
+    entry.type = UV_DIRENT_DIR;
+    listing_.push_back( entry );
+
+    name += dir->first.length() + 1;
+
+    dir->second->BuildListing();
+  }
+
+  for( std::map< std::string, ArchiveFile* >::const_iterator file=files_.begin(); file!=files_.end(); ++file )
+  {
+    std::memcpy( name, file->first.c_str(), file->first.length() );
+
+    uv_dirent_t entry;
+    entry.name = name;
+    entry.type = UV_DIRENT_FILE;
+    listing_.push_back( entry );
+
+    name += file->first.length() + 1;
+  }
+}
+
 Archive::Archive( Manager* manager, int archiveId, const std::string& mount_point, const std::string& archive_filepath )
   : manager_(manager)
   , id_(archiveId)
@@ -78,6 +126,30 @@ std::string Archive::GetMD5( const std::string& filepath )
   return ret;
 }
 
+// Formats an MD5 digest as lower case hex.
+static std::string DigestToString( const unsigned char* digest_buff )
+{
+  char string_buffer[ MD5_DIGEST_LENGTH * 3 ];
+  std::memset( string_buffer, 0, MD5_DIGEST_LENGTH * 3 );
+
+#if defined(_WIN32)
+// sprintf!
+#pragma warning(push)
+#pragma warning(disable:4996)
+#endif
+
+  for( int i=0; i<MD5_DIGEST_LENGTH; ++i )
+  {
+    std::sprintf( ( string_buffer + ( i * 2 ) ), "%02x", digest_buff[ i ] );
+  }
+
+#if defined(_WIN32)
+#pragma warning(pop)
+#endif
+
+  return std::string( string_buffer );
+}
+
 std::string Archive::GetMD5(FILE* file_handle)
 {
   // we can only do this in C++11 
@@ -98,25 +170,16 @@ std::string Archive::GetMD5(FILE* file_handle)
   // reset the file pointer
   ::fseek( file_handle, 0, SEEK_SET );
 
-  char string_buffer[ MD5_DIGEST_LENGTH * 3 ];
-  std::memset( string_buffer, 0, MD5_DIGEST_LENGTH * 3 );
-
-#if defined(_WIN32)
-// sprintf!
-#pragma warning(push)
-#pragma warning(disable:4996)
-#endif
+  return DigestToString( digest_buff );
+}
 
-  for( int i=0; i<MD5_DIGEST_LENGTH; ++i )
-  {
-    std::sprintf( ( string_buffer + ( i * 2 ) ), "%02x", digest_buff[ i ] );
-  }
+std::string Archive::GetMD5( const char* data, size_t size )
+{
+  unsigned char digest_buff[ MD5_DIGEST_LENGTH ];
 
-#if defined(_WIN32)
-#pragma warning(pop)
-#endif
+  ::MD5( reinterpret_cast< const unsigned char* >( data ), size, digest_buff );
 
-  return std::string( string_buffer );
+  return DigestToString( digest_buff );
 }
 
 static std::size_t FindNextPathMarker( const std::string& str, const std::size_t offset )
@@ -183,6 +246,21 @@ const std::string& Archive::MountPoint() const
   return mount_point_;
 }
 
+const std::string& Archive::ArchiveFilePath() const
+{
+  return archive_filepath_;
+}
+
+const std::string& Archive::CachePath() const
+{
+  return temp_path_;
+}
+
+const Metrics& Archive::GetMetrics() const
+{
+  return metrics_;
+}
+
 static size_t FindNextDirSeperator(const std::string& path, size_t starting_position)
 {
 	char* start = const_cast<char*>(path.c_str()) + starting_position;
@@ -285,4 +363,79 @@ ArchiveItem* Archive::Find( const std::vector< std::string >& path_parts )
   return ret;
 }
 
+const ArchiveItem* Archive::Lookup( const char* filePath )
+{
+  return Find( FilePathToParts( filePath ) );
+}
+
+int Archive::RealPath( const char* filePath, std::string& real_path )
+{
+  std::vector< std::string > parts = FilePathToParts( filePath );
+
+  size_t kept = 0;
+  for( size_t i=0; i<parts.size(); ++i )
+  {
+    if( parts[ i ] == "." )
+    {
+      continue;
+    }
+
+    if( parts[ i ] == ".." )
+    {
+      if( kept == 0 )
+      {
+        return UV_ENOENT;
+      }
+      --kept;
+      continue;
+    }
+
+    if( kept != i )
+    {
+      parts[ kept ].swap( parts[ i ] );
+    }
+    ++kept;
+  }
+  parts.resize( kept );
+
+  if( Find( parts ) == nullptr )
+  {
+    return UV_ENOENT;
+  }
+
+#if defined(_WIN32)
+  const char separator = '\\';
+#else
+  const char separator = '/';
+#endif
+
+  real_path = mount_point_;
+  for( std::vector< std::string >::const_iterator i=parts.begin(); i!=parts.end(); ++i )
+  {
+    real_path += separator;
+    real_path += (*i);
+  }
+
+  return 0;
+}
+
+int Archive::fs_walk( const char* path, const std::string& pattern, WalkEntries& entries )
+{
+  ArchiveItem* target_item = Find( FilePathToParts( path ) );
+
+  if( target_item == nullptr )
+  {
+    return UV_ENOENT;
+  }
+
+  if( target_item->IsFile() )
+  {
+    return UV_ENOTDIR;
+  }
+
+  Walk::Dir( static_cast< ArchiveDir* >( target_item ), std::string(), pattern, entries );
+
+  return static_cast< int >( entries.size() );
+}
+
 }
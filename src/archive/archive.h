@@ -2,9 +2,11 @@
 #define SRC_ARCHIVE_ARCHIVE_H_
 
 #include "archive/uv_schedule_delay.h"
+#include "archive/metrics.h"
 
 #include <string>
 #include <map>
+#include <vector>
 #include <functional>
 
 // Can't think of a better place for this currently.
@@ -35,6 +37,8 @@ enum class ErrorCodes
   ArchiveInvalid,
   /// Failed to create the on disk cache folder.
   FailedToCreateCache,
+  /// A public key is set and the archive's Manifest is missing, not signed with it or does not list what the central directory holds.
+  ArchiveNotVerified,
 };
 
 /// The base for file/dir objects
@@ -63,8 +67,16 @@ typedef struct _ArchiveDir : public ArchiveItem
   // map of all the child files known to this object
   std::map< std::string, ArchiveFile* > files_;
 
+  /// The dir's scandir result, dirs then files, built once by BuildListing() after the tree is complete.
+  /// The entry names point into listing_names_ so a scandir of the dir allocates nothing.
+  std::vector< uv_dirent_t > listing_;
+  std::vector< char > listing_names_;
+
   bool IsFile() const { return false; }
 
+  /// Builds listing_ for this dir and every dir below it.
+  void BuildListing();
+
 	/// Used to add a dir to this dir object.
 	int Add( const std::string& name, ArchiveFile* fileNode );
 	int Add( const std::string& name, struct _ArchiveDir* dirNode );
@@ -78,6 +90,26 @@ typedef struct _ArchiveDir : public ArchiveItem
   ArchiveFile* FindFile( const std::string& name ); 
 } ArchiveDir;
 
+/// One child of a dir as returned by Archive::fs_readdir_stats()
+typedef struct
+{
+  std::string name_;
+  uv_dirent_type_t type_ = UV_DIRENT_UNKNOWN;
+  /// 0 or the UV_* error code from stat'ing the child, stat_ is only valid if 0.
+  int stat_result_ = 0;
+  uv_stat_t stat_;
+} DirStatsItem;
+
+/// One item found by Archive::fs_walk()
+typedef struct
+{
+  /// The path relative to the dir walked, parts are separated with '/'
+  std::string path_;
+  uv_dirent_type_t type_ = UV_DIRENT_UNKNOWN;
+} WalkEntry;
+
+using WalkEntries = std::vector< WalkEntry >;
+
 /// Forward for the Manager
 class Manager;
 
@@ -96,6 +128,8 @@ protected:
   std::string archive_filepath_;
   /// The temp location were files are extracted to.
   std::string temp_path_;
+  /// I/O counters and timings, see Manager::TakeMetrics()
+  Metrics metrics_;
 
   /// The root dir object.
   /// Derived classes must imp this and return the root dir object.  This is called when doing finds
@@ -112,6 +146,8 @@ public:
   /// Returns the MD5 (as a string) of a file
   static std::string GetMD5( const std::string& filePath );
   static std::string GetMD5( FILE* hFile );
+  /// Returns the MD5 (as a string) of size bytes of memory, the same as for a file holding them.
+  static std::string GetMD5( const char* data, size_t size );
 
   // Splits a path up into the different parts
   static std::vector< std::string > SplitPath( const std::string& path, bool& does_ends_with_dir_seperator );
@@ -119,9 +155,25 @@ public:
   /// returns the mount position
   const std::string& MountPoint() const;
 
+  /// returns were the archive is on the local file system
+  const std::string& ArchiveFilePath() const;
+
+  /// returns the archive's cache dir
+  const std::string& CachePath() const;
+
+  /// returns the archive's I/O counters and timings
+  const Metrics& GetMetrics() const;
+
   /// takes filepath - mount point and tokenises the result into a string vector.
   std::vector< std::string > FilePathToParts( const char* filePath );
 
+  /// Finds the file or dir at a full filepath, nullptr if the archive has no such item.
+  const ArchiveItem* Lookup( const char* filePath );
+
+  /// Gives the real path of a full filepath, the mount point and its parts with "." and ".." applied as an archive holds no links.
+  /// \return 0 or UV_ENOENT if the archive has no such item or ".." leaves the archive.
+  int RealPath( const char* filePath, std::string& real_path );
+
   /// Test if the archive is mounted or not
   virtual bool IsMounted() = 0;
 
@@ -129,12 +181,43 @@ public:
   virtual ErrorCodes Mount() = 0;
   /// Call this to unmount the archive and release memory/files etc
   virtual void Unmount() = 0;
+  /// Ends any startup profile being recorded, the process is exiting without unmounting.
+  virtual void EndStartupProfile() {}
 
   /// Returns the cache filepath for a given filepath
   /// \param filepath This is the full filepath
   /// \return the filepath to the cache file or empty if a file entry can not be found.
   virtual std::string CacheFilePath(const std::string& full_filepath) = 0;
 
+  /// Returns the filepath of a file's V8 code cache in the cache dir, see Manager::ReadCodeCache()
+  /// \return the filepath or empty if a file entry can not be found.
+  virtual std::string CodeCacheFilePath(const std::string& full_filepath, const std::string& tag) = 0;
+
+  /// Loads the whole of a file into content.
+  /// \param full_filepath This is the full filepath
+  /// \return false if the file is not in the archive or could not be read.
+  virtual bool LoadFile(const std::string& full_filepath, std::vector< char >& content) = 0;
+
+  /// Returns the in memory view of an open file's content if the archive has one.
+  /// Views are immutable and live until the archive is unmounted so they can be read from any thread.
+  /// \param real_fileId The file id as returned by fs_open
+  /// \return false if the file can only be read using fs_read.
+  virtual bool ContentView(uv_file real_fileId, const char** content, size_t* content_size)
+  {
+    return false;
+  }
+
+  /// Gives where sendfile() can copy an open file's content from without going through the file, e.g. the archive file itself for a stored entry.
+  /// \param real_fileId The file id as returned by fs_open
+  /// \param fd Set to the file to send from, it belongs to the archive.
+  /// \param in_offset The offset into the open file, set to the offset into fd.
+  /// \param length The bytes wanted, set to what fd holds of them.
+  /// \return false if real_fileId should be sent from as it is.
+  virtual bool SendfileSource(uv_file real_fileId, uv_file& fd, int64_t& in_offset, size_t& length)
+  {
+    return false;
+  }
+
 
   /// Libuv stuff
   //@{
@@ -149,6 +232,15 @@ public:
 
   virtual int fs_scandir(uv_loop_t* loop, uv_fs_t* request, const char* path, int flags) = 0;
 
+  /// Lists a dir along with the stat of every child, this is always synchronous.
+  /// \return the number of children or a UV_* error code.
+  virtual int fs_readdir_stats(const char* path, std::vector< DirStatsItem >& items) = 0;
+
+  /// Walks every item below a dir straight off the in memory tree, this is always synchronous.
+  /// \param pattern Only items whose path (relative to path) matches this glob are added, see Walk::Match().
+  /// \return the number of items added or a UV_* error code.
+  int fs_walk(const char* path, const std::string& pattern, WalkEntries& entries);
+
 };
 
 }
@@ -1,10 +1,12 @@
 #include "archive/archive_junzip.h"
 #include "archive/manager.h"
+#include "archive/trace.h"
 
 #include <uv.h>
 #include <zlib.h>
 #include <openssl/md5.h>
 
+#include <cstdio>
 #include <ctime>
 #include <cstring>
 
@@ -16,8 +18,11 @@
 
 #include <Windows.h>
 #else
+#include <fcntl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #endif
 
 namespace archive
@@ -63,6 +68,9 @@ void ArchiveFileJUnzip::Set( JZFileHeader* header )
 {
   size_ = header->uncompressedSize;
   offset_ = header->offset;
+  compression_method_ = header->compressionMethod;
+  compressed_size_ = header->compressedSize;
+  crc32_ = header->crc32;
 
   DOSToTimeT( lastModified_, header->lastModFileDate, header->lastModFileTime );
 }
@@ -75,21 +83,90 @@ void ArchiveDirJUnzip::Set( JZFileHeader* header )
 }
 
 
+/*************************************************************************************************************/
+
+ArchiveJUnzip::FsWork::FsWork( ArchiveJUnzip* archive, uv_fs_t* request, uv_fs_type type )
+  : archive_( archive ), type_( type )
+{
+  request_ = request;
+}
+
+ArchiveJUnzip::FsWork* ArchiveJUnzip::FsWork::New( uv_loop_t* loop, ArchiveJUnzip* archive, uv_fs_t* request, uv_fs_type type, const char* path, const uv_buf_t bufs[], unsigned int nbufs )
+{
+  const size_t path_size = ( path != nullptr ) ? std::strlen( path ) + 1 : 0;
+  const size_t bufs_size = nbufs * sizeof( uv_buf_t );
+
+  // bufs go first as FsWork leaves them aligned, the path has no alignment.
+  char* block = static_cast< char* >( archive->manager_->Pool( loop )->Allocate( sizeof( FsWork ) + bufs_size + path_size ) );
+  FsWork* work = new ( block ) FsWork( archive, request, type );
+
+  if( nbufs > 0 )
+  {
+    work->bufs_ = reinterpret_cast< uv_buf_t* >( block + sizeof( FsWork ) );
+    work->nbufs_ = nbufs;
+    std::memcpy( work->bufs_, bufs, bufs_size );
+  }
+
+  if( path != nullptr )
+  {
+    char* path_copy = block + sizeof( FsWork ) + bufs_size;
+    std::memcpy( path_copy, path, path_size );
+    work->path_ = path_copy;
+  }
+
+  return work;
+}
+
+void ArchiveJUnzip::FsWork::Run()
+{
+  switch( type_ )
+  {
+    case UV_FS_STAT:
+      archive_->Stat( request_, path_ );
+      break;
+
+    case UV_FS_FSTAT:
+      archive_->Fstat( request_, real_fileId_ );
+      break;
+
+    case UV_FS_OPEN:
+      archive_->Open( request_, flags_, path_ );
+      break;
+
+    case UV_FS_READ:
+      archive_->Read( request_, real_fileId_, bufs_, nbufs_, offset_ );
+      break;
+
+    case UV_FS_SCANDIR:
+      archive_->Scandir( request_, path_ );
+      break;
+
+    default:
+      request_->result = UV_ENOSYS;
+      break;
+  }
+}
+
 /*************************************************************************************************************/
 
 
 ArchiveJUnzip::ArchiveJUnzip( Manager* manager, int archiveId, const std::string& mountPoint, const std::string& archiveFilePath )
   : Archive( manager, archiveId, mountPoint, archiveFilePath )
 {
+  uv_mutex_init( &lock_ );
+  uv_mutex_init( &zip_file_lock_ );
 }
 
 ArchiveJUnzip::~ArchiveJUnzip()
 {
   // If we have mounted but not unmounted do it.
-  if( zip_file_handle_ != nullptr )
+  if( zip_file_handle_ != nullptr || archive_view_ != nullptr || view_fd_ >= 0 )
   {
     Unmount();
   }
+
+  uv_mutex_destroy( &zip_file_lock_ );
+  uv_mutex_destroy( &lock_ );
 }
 
 ArchiveDir* ArchiveJUnzip::Root()
@@ -99,7 +176,10 @@ ArchiveDir* ArchiveJUnzip::Root()
 
 const std::string ArchiveJUnzip::CacheFilePath( const ArchiveFileJUnzip* file ) const
 {
-  return temp_path_ + std::string( "/" ) + std::to_string( file->archiveId_ ) + std::string( ".cache" );
+  // files with the same content share the first one's cache file.
+  const ArchiveFileJUnzip* source = ( file->same_as_ != nullptr ) ? file->same_as_ : file;
+
+  return temp_path_ + std::string( "/" ) + std::to_string( source->archiveId_ ) + std::string( ".cache" );
 }
 
 void ArchiveJUnzip::Validate( ArchiveFileJUnzip* file )
@@ -129,14 +209,65 @@ void ArchiveJUnzip::Validate( ArchiveFileJUnzip* file )
     std::printf( "Failed to validate extract cache filepath: %s\n", cacheFilePath.c_str() );
     file->exstracted_ = ArchiveFileJUnzip::NotExtracted;
     is_unsafe_ = true;
+    metrics_.Add( Metrics::CacheMisses );
   }
   else
   {
     file->exstracted_ = ArchiveFileJUnzip::Extracted;
     fclose( cache_file );
+    metrics_.Add( Metrics::CacheHits );
   }
 }
 
+bool ArchiveJUnzip::CacheFileMatches( const ArchiveFileJUnzip* file )
+{
+  uv_fs_t request;
+  const std::string cacheFilePath = CacheFilePath( file );
+
+  const bool matches = ::uv_fs_stat( nullptr, &request, cacheFilePath.c_str(), nullptr ) == 0 &&
+                       ( request.statbuf.st_mode & S_IFMT ) == S_IFREG &&
+                       request.statbuf.st_size == static_cast< uint64_t >( file->size_ );
+
+  ::uv_fs_req_cleanup( &request );
+
+  return matches;
+}
+
+bool ArchiveJUnzip::Inflate( const ArchiveFileJUnzip* file, std::vector< char >& buffer )
+{
+  TraceScope trace( "archive.inflate" );
+  trace.SetSize( file->size_ );
+
+  const uint64_t start = uv_hrtime();
+
+  JZFileHeader tmp;
+  char fname[ 1024 ];
+
+  // one reader at a time as the seek moves the handle for everyone.
+  uv_mutex_lock( &zip_file_lock_ );
+
+  size_t currentOffset = zip_file_handle_->tell( zip_file_handle_ );
+
+  zip_file_handle_->seek( zip_file_handle_, file->offset_, SEEK_SET );
+
+  bool ret = ( jzReadLocalFileHeader( zip_file_handle_, &tmp, fname, 1023 ) == 0 );
+
+  if( ret )
+  {
+    buffer.resize( tmp.uncompressedSize );
+
+    ret = ( jzReadData( zip_file_handle_, &tmp, buffer.data() ) == Z_OK );
+  }
+
+  zip_file_handle_->seek( zip_file_handle_, currentOffset, SEEK_SET );
+
+  uv_mutex_unlock( &zip_file_lock_ );
+
+  metrics_.Record( Metrics::InflateTime, start );
+
+  return ret;
+}
+
 void ArchiveJUnzip::Extract( ArchiveFileJUnzip* file )
 {
   // don't do work someone else has or is doing.
@@ -147,18 +278,20 @@ void ArchiveJUnzip::Extract( ArchiveFileJUnzip* file )
 
   file->exstracted_ = ArchiveFileJUnzip::Extracting;
 
-  size_t currentOffset = zip_file_handle_->tell( zip_file_handle_ );
-
-  zip_file_handle_->seek( zip_file_handle_, file->offset_, SEEK_SET );
-
-  JZFileHeader tmp;
-  char fname[ 1024 ];
+  const uint64_t start = uv_hrtime();
+  metrics_.Add( Metrics::CacheMisses );
 
-  jzReadLocalFileHeader( zip_file_handle_, &tmp, fname, 1023 );
+  std::vector<char> buffer;
 
-  std::vector<char> buffer( tmp.uncompressedSize );
+  const bool inflated = Inflate( file, buffer );
 
-	if( jzReadData( zip_file_handle_, &tmp, buffer.data() ) == Z_OK )
+  // content that fails its manifest check never reaches the cache so the file can't be opened.
+  if( inflated && VerifyContent( file, buffer.data(), buffer.size() ) == false )
+  {
+    is_unsafe_ = true;
+    file->exstracted_ = ArchiveFileJUnzip::NotExtracted;
+  }
+	else if( inflated )
 	{
   	std::string cacheFilePath = CacheFilePath( file );
 
@@ -183,7 +316,7 @@ void ArchiveJUnzip::Extract( ArchiveFileJUnzip* file )
 		}
 		else
 		{
-			std::fwrite( buffer.data(), tmp.uncompressedSize, 1, out );
+			std::fwrite( buffer.data(), buffer.size(), 1, out );
 
 			std::fclose( out );
 
@@ -196,7 +329,346 @@ void ArchiveJUnzip::Extract( ArchiveFileJUnzip* file )
     file->exstracted_ = ArchiveFileJUnzip::NotExtracted;
 	}
 
-  zip_file_handle_->seek( zip_file_handle_, currentOffset, SEEK_SET );
+  metrics_.Record( Metrics::ExtractTime, start );
+}
+
+bool ArchiveJUnzip::DataOffset( const ArchiveFileJUnzip* file, size_t& data_offset ) const
+{
+  if( archive_view_ == nullptr )
+  {
+    return false;
+  }
+
+  const size_t header_offset = static_cast< size_t >( file->offset_ );
+
+  if( header_offset + sizeof( JZLocalFileHeader ) > archive_view_size_ )
+  {
+    return false;
+  }
+
+  JZLocalFileHeader local_header;
+  std::memcpy( &local_header, archive_view_ + header_offset, sizeof( JZLocalFileHeader ) );
+
+  data_offset = header_offset + sizeof( JZLocalFileHeader ) + local_header.fileNameLength + local_header.extraFieldLength;
+
+  if( local_header.signature != 0x04034B50 || data_offset + file->compressed_size_ > archive_view_size_ )
+  {
+    return false;
+  }
+
+  return true;
+}
+
+bool ArchiveJUnzip::StoredDataOffset( const ArchiveFileJUnzip* file, size_t& data_offset ) const
+{
+  if( file->compression_method_ != 0 || file->compressed_size_ != file->size_ )
+  {
+    return false;
+  }
+
+  return DataOffset( file, data_offset );
+}
+
+ArchiveFileJUnzip* ArchiveJUnzip::FindSameContent( ArchiveFileJUnzip* file )
+{
+  size_t data_offset = 0;
+
+  // empty files cost nothing to extract, and without a view there is nothing to compare.
+  if( file->size_ == 0 || DataOffset( file, data_offset ) == false )
+  {
+    return nullptr;
+  }
+
+  const ContentKey key( ( static_cast< uint64_t >( file->crc32_ ) << 32 ) | file->size_, ( static_cast< uint64_t >( file->compressed_size_ ) << 16 ) | file->compression_method_ );
+
+  typedef std::multimap< ContentKey, ArchiveFileJUnzip* >::iterator SameContentIterator;
+  std::pair< SameContentIterator, SameContentIterator > candidates = same_content_.equal_range( key );
+
+  for( SameContentIterator candidate=candidates.first; candidate!=candidates.second; ++candidate )
+  {
+    size_t candidate_offset = 0;
+    DataOffset( candidate->second, candidate_offset );
+
+    // the same compressed bytes always inflate to the same content, entries of an archive packed with Relayout() can even share them.
+    if( candidate_offset == data_offset || std::memcmp( archive_view_ + candidate_offset, archive_view_ + data_offset, file->compressed_size_ ) == 0 )
+    {
+      return candidate->second;
+    }
+  }
+
+  same_content_.insert( std::make_pair( key, file ) );
+
+  return nullptr;
+}
+
+struct ManifestEntries
+{
+  JZFileHeader manifest_;
+  JZFileHeader signature_;
+  bool has_manifest_ = false;
+  bool has_signature_ = false;
+};
+
+static int FindManifestForEachEntry( JZFile* /*zip_file*/, int /*archive_index*/, JZFileHeader* header, char* filepath, void* pUser )
+{
+  ManifestEntries* found = reinterpret_cast< ManifestEntries* >( pUser );
+
+  if( std::strcmp( filepath, Manifest::EntryName ) == 0 )
+  {
+    found->manifest_ = *header;
+    found->has_manifest_ = true;
+  }
+  else if( std::strcmp( filepath, Manifest::SignatureEntryName ) == 0 )
+  {
+    found->signature_ = *header;
+    found->has_signature_ = true;
+  }
+
+  return ( found->has_manifest_ && found->has_signature_ ) ? 0 : 1;
+}
+
+bool ArchiveJUnzip::LoadManifest( std::string& manifest_id )
+{
+  ManifestEntries found;
+
+  if( ::jzReadCentralDirectory( zip_file_handle_, &endRecord_, &FindManifestForEachEntry, &found ) != 0 || found.has_manifest_ == false || found.has_signature_ == false )
+  {
+    manager_->Report( "Archive:%s has no manifest\n", archive_filepath_.c_str() );
+    return false;
+  }
+
+  ArchiveFileJUnzip manifest_file;
+  manifest_file.Set( &found.manifest_ );
+  ArchiveFileJUnzip signature_file;
+  signature_file.Set( &found.signature_ );
+
+  std::vector< char > manifest;
+  std::vector< char > signature;
+
+  if( Inflate( &manifest_file, manifest ) == false || Inflate( &signature_file, signature ) == false ||
+      Manifest::VerifySignature( manager_->PublicKey(), manifest.data(), manifest.size(), signature.data(), signature.size() ) == false )
+  {
+    manager_->Report( "Archive:%s manifest is not signed with the public key\n", archive_filepath_.c_str() );
+    return false;
+  }
+
+  if( manifest_.Parse( manifest.data(), manifest.size() ) == false )
+  {
+    manager_->Report( "Archive:%s manifest could not be read\n", archive_filepath_.c_str() );
+    return false;
+  }
+
+  // cache files are named by central directory position, so archives only share a cache when they have this manifest and central directory.
+  const size_t central_directory_size = endRecord_.centralDirectorySize;
+  std::vector< char > identity( manifest );
+  identity.resize( manifest.size() + central_directory_size );
+
+  if( zip_file_handle_->seek( zip_file_handle_, endRecord_.centralDirectoryOffset, SEEK_SET ) != 0 ||
+      zip_file_handle_->read( zip_file_handle_, identity.data() + manifest.size(), central_directory_size ) < central_directory_size )
+  {
+    return false;
+  }
+
+  manifest_id = Archive::GetMD5( identity.data(), identity.size() );
+
+  return true;
+}
+
+bool ArchiveJUnzip::ManifestMatches() const
+{
+  return verify_entries_ == false || ( manifest_mismatch_ == false && manifest_matches_ == manifest_.Count() );
+}
+
+bool ArchiveJUnzip::VerifyContent( ArchiveFileJUnzip* file, const char* content, size_t size )
+{
+  if( file->sha256_ == nullptr )
+  {
+    return true;
+  }
+
+  const int state = file->verified_.load( std::memory_order_acquire );
+  if( state != ArchiveFileJUnzip::NotVerified )
+  {
+    return state == ArchiveFileJUnzip::Verified;
+  }
+
+  TraceScope trace( "archive.verify" );
+  trace.SetSize( size );
+
+  unsigned char digest[ Manifest::DigestLength ];
+  Manifest::Sha256( content, size, digest );
+
+  // threads opening the file at once may each hash it, they all come to the same answer.
+  const bool verified = ( size == file->size_ && std::memcmp( digest, file->sha256_, Manifest::DigestLength ) == 0 );
+  file->verified_.store( verified ? ArchiveFileJUnzip::Verified : ArchiveFileJUnzip::VerifyFailed, std::memory_order_release );
+
+  if( verified == false )
+  {
+    manager_->Report( "Failed to verify file: %d of archive:%s\n", file->archiveId_, archive_filepath_.c_str() );
+  }
+
+  return verified;
+}
+
+bool ArchiveJUnzip::VerifyOpened( ArchiveFileJUnzip* file, uv_file real_fileId )
+{
+  if( file->sha256_ == nullptr || file->verified_.load( std::memory_order_acquire ) != ArchiveFileJUnzip::NotVerified )
+  {
+    return VerifyContent( file, nullptr, 0 );
+  }
+
+  if( file->content_ != nullptr )
+  {
+    return VerifyContent( file, file->content_, file->size_ );
+  }
+
+  // no view of the content, as on Windows, so the cache file is read.
+  std::vector< char > content( file->size_ );
+  size_t content_size = 0;
+
+  while( content_size < content.size() )
+  {
+    uv_fs_t req;
+    uv_buf_t buf = uv_buf_init( content.data() + content_size, static_cast< unsigned int >( content.size() - content_size ) );
+
+    const int read = ::uv_fs_read( nullptr, &req, real_fileId, &buf, 1, static_cast< int64_t >( content_size ), nullptr );
+    ::uv_fs_req_cleanup( &req );
+
+    if( read <= 0 )
+    {
+      break;
+    }
+
+    content_size += static_cast< size_t >( read );
+  }
+
+  return VerifyContent( file, content.data(), content_size );
+}
+
+void ArchiveJUnzip::StartStartupProfile()
+{
+  if( manager_->UseStartupProfile() == false )
+  {
+    return;
+  }
+
+  const std::string profile_filepath = StartupProfile::ProfileFilePath( temp_path_ );
+  std::vector< std::string > entries;
+  std::string profile_md5;
+
+  if( StartupProfile::Load( profile_filepath, entries, &profile_md5 ) == false || profile_md5 != md5_hash_ )
+  {
+    startup_profile_.Record( profile_filepath, md5_hash_ );
+    return;
+  }
+
+  StartupProfile::PrefetchItems items;
+
+  for( std::vector< std::string >::const_iterator entry=entries.begin(); entry!=entries.end(); ++entry )
+  {
+    bool is_dir;
+    ArchiveItem* item = Find( Archive::SplitPath( *entry, is_dir ) );
+
+    if( item == nullptr || !item->IsFile() )
+    {
+      continue;
+    }
+
+    ArchiveFileJUnzip* file = static_cast< ArchiveFileJUnzip* >( item );
+    StartupProfile::PrefetchItem prefetch_item;
+    size_t data_offset = 0;
+
+    if( StoredDataOffset( file, data_offset ) )
+    {
+      prefetch_item.view_ = archive_view_ + data_offset;
+      prefetch_item.view_size_ = file->size_;
+    }
+    else if( file->exstracted_ == ArchiveFileJUnzip::Extracted )
+    {
+      prefetch_item.cache_filepath_ = CacheFilePath( file );
+    }
+    else
+    {
+      continue;
+    }
+
+    items.push_back( prefetch_item );
+  }
+
+  manager_->Report( "Prefetching %d startup entries for archive:%s\n", static_cast< int >( items.size() ), archive_filepath_.c_str() );
+
+  startup_profile_.Prefetch( items );
+
+  // the old profile is still prefetched from while the new one is recorded, it is only replaced once recording ends.
+  if( StartupProfile::IsStale( profile_filepath ) )
+  {
+    startup_profile_.Record( profile_filepath, md5_hash_ );
+  }
+}
+
+void ArchiveJUnzip::MapContent( ArchiveFileJUnzip* file, uv_file real_fileId )
+{
+  // only done once as the content never changes
+  if( file->content_ != nullptr )
+  {
+    return;
+  }
+
+  if( file->size_ == 0 )
+  {
+    static const char empty_content[ 1 ] = { 0 };
+    file->content_ = empty_content;
+    return;
+  }
+
+  // one view for every file with the same content, real_fileId is the shared cache file.
+  if( file->same_as_ != nullptr )
+  {
+    MapContent( file->same_as_, real_fileId );
+    file->content_ = file->same_as_->content_;
+    return;
+  }
+
+#if !defined(_WIN32)
+  // Stored files can be read straight out of the archive.
+  size_t data_offset = 0;
+  if( StoredDataOffset( file, data_offset ) )
+  {
+    file->content_ = archive_view_ + data_offset;
+    return;
+  }
+
+  // Everything else comes from the cache file.
+  void* mapped = ::mmap( nullptr, file->size_, PROT_READ, MAP_PRIVATE, real_fileId, 0 );
+  if( mapped != MAP_FAILED )
+  {
+    file->content_ = static_cast< const char* >( mapped );
+    file->content_is_mapped_ = true;
+  }
+#endif
+}
+
+void ArchiveJUnzip::UnmapContent( ArchiveDir* dir )
+{
+  for( std::map< std::string, ArchiveDir* >::iterator sub_dir=dir->dirs_.begin(); sub_dir!=dir->dirs_.end(); ++sub_dir )
+  {
+    UnmapContent( sub_dir->second );
+  }
+
+  for( std::map< std::string, ArchiveFile* >::iterator sub_file=dir->files_.begin(); sub_file!=dir->files_.end(); ++sub_file )
+  {
+    ArchiveFileJUnzip* file = static_cast< ArchiveFileJUnzip* >( sub_file->second );
+
+#if !defined(_WIN32)
+    if( file->content_is_mapped_ )
+    {
+      ::munmap( const_cast< char* >( file->content_ ), file->size_ );
+    }
+#endif
+
+    file->content_ = nullptr;
+    file->content_is_mapped_ = false;
+  }
 }
 
 int ArchiveJUnzip::AddEntry( JZFile* /*hZipFile*/, int archiveIndexNumber, JZFileHeader* fileHeader, const char* filename )
@@ -204,94 +676,427 @@ int ArchiveJUnzip::AddEntry( JZFile* /*hZipFile*/, int archiveIndexNumber, JZFil
   //std::printf( "Index:%d Name:%s Offset:%d size:%d/%d\n", archiveIndexNumber, filename, fileHeader->offset, fileHeader->compressedSize, fileHeader->uncompressedSize );
   bool is_dir;
 
+  if( build_shared_index_ )
+  {
+    SharedIndex::Add( shared_entries_, shared_names_, archiveIndexNumber, fileHeader->offset, fileHeader->crc32, fileHeader->compressedSize, fileHeader->uncompressedSize,
+                      fileHeader->compressionMethod, fileHeader->lastModFileTime, fileHeader->lastModFileDate, filename );
+  }
+
   std::vector< std::string > parts = Archive::SplitPath( filename, is_dir );
 
+  // a verified archive's files must all be listed, the manifest and its signature are covered by the signature.
+  const Manifest::Entry* listed = nullptr;
+
+  if( verify_entries_ && is_dir == false && std::strcmp( filename, Manifest::EntryName ) != 0 && std::strcmp( filename, Manifest::SignatureEntryName ) != 0 )
+  {
+    listed = manifest_.Find( filename );
+
+    if( listed == nullptr || listed->size_ != fileHeader->uncompressedSize )
+    {
+      manager_->Report( "Archive:%s entry %s does not match its manifest\n", archive_filepath_.c_str(), filename );
+      manifest_mismatch_ = true;
+      return 0;
+    }
+
+    ++manifest_matches_;
+  }
+
   ArchiveDir *node = Root();
 
   // don't use an iterator for this as know position is important.
   for( size_t i=0, sz=parts.size(); i<sz; ++i )
   {
-    const std::string& name = parts[ i ];
+    const std::string& name = parts[ i ];
+
+    ArchiveDir* knownDir = node->FindDir( name );
+    if( knownDir == nullptr )
+    {
+      // we need to add a dir or file.
+      bool addAsFile = false;
+      if( i == ( sz - 1 ) && is_dir == false )
+      {
+        addAsFile = true;
+      }
+
+      if( addAsFile == true )
+      {
+        ArchiveFileJUnzip* newFile = new ArchiveFileJUnzip();
+
+        newFile->archiveId_ = archiveIndexNumber;
+        newFile->Set( fileHeader );
+        newFile->sha256_ = ( listed != nullptr ) ? listed->sha256_ : nullptr;
+        newFile->same_as_ = FindSameContent( newFile );
+
+        node->Add( name, newFile );
+
+        // the file with the same content came earlier so it has been extracted or validated already.
+        if( newFile->same_as_ != nullptr )
+        {
+          newFile->exstracted_ = newFile->same_as_->exstracted_;
+          ++same_content_count_;
+        }
+        else if( extract_on_mount_ == true )
+        {
+          TraceScope trace( "archive.extract", filename );
+          trace.SetSize( newFile->size_ );
+
+          // do sync.
+          Extract( newFile );
+        }
+        else if( trust_cache_ && CacheFileMatches( newFile ) )
+        {
+          newFile->exstracted_ = ArchiveFileJUnzip::Extracted;
+          metrics_.Add( Metrics::CacheHits );
+        }
+        else if( trust_cache_ )
+        {
+          // the cache dir has been pruned or changed since the index was written, put the file back.
+          TraceScope trace( "archive.extract", filename );
+          trace.SetSize( newFile->size_ );
+
+          Extract( newFile );
+        }
+        else
+        {
+          Validate( newFile );
+        }
+
+        return 1;
+      }
+      else
+      {
+        ArchiveDirJUnzip* newDir = new ArchiveDirJUnzip();
+
+        node->Add( name, newDir );
+
+        if( i != ( sz - 1 ) )
+        {
+          newDir->Set( fileHeader );
+          node = newDir;
+        }
+      }
+    }
+    else
+    {
+      // next
+      node = knownDir;
+    }
+  }
+
+  return 1; // read next = 1 abort = 0
+}
+
+int ArchiveJUnzip::onMountEachFile( JZFile* hZipFile, int archivesFileIndex, JZFileHeader* header, char* filepath, void* pUser )
+{
+	ArchiveJUnzip* target = reinterpret_cast<ArchiveJUnzip*>( pUser );
+	return target->AddEntry( hZipFile, archivesFileIndex, header, filepath );
+}
+
+void ArchiveJUnzip::SetSource( uv_file fd, int64_t offset, int64_t size )
+{
+  source_fd_ = fd;
+  source_offset_ = offset;
+  source_size_ = size;
+  source_data_ = nullptr;
+}
+
+void ArchiveJUnzip::SetSource( const char* data, size_t size )
+{
+  source_fd_ = -1;
+  source_offset_ = 0;
+  source_size_ = static_cast< int64_t >( size );
+  source_data_ = data;
+}
+
+ErrorCodes ArchiveJUnzip::OpenFile()
+{
+#if defined(_WIN32)
+  if( ::fopen_s(&file_handle_, archive_filepath_.c_str(), "rb" ))
+  {
+    file_handle_ = nullptr;
+  }
+#else
+  file_handle_ = ::fopen(archive_filepath_.c_str(), "rb");
+#endif
+
+  if(file_handle_ == nullptr)
+  {
+    return ErrorCodes::ArchiveNotFound;
+  }
+
+  identity_ = SharedIndex::Identity( ::fileno( file_handle_ ), 0, 0 );
+
+#if !defined(_WIN32)
+  // Map the archive so stored files can be served without going through the cache files.
+  struct stat archive_stat;
+  if( ::fstat( ::fileno( file_handle_ ), &archive_stat ) == 0 && archive_stat.st_size > 0 )
+  {
+    void* mapped = ::mmap( nullptr, static_cast< size_t >( archive_stat.st_size ), PROT_READ, MAP_PRIVATE, ::fileno( file_handle_ ), 0 );
+    if( mapped != MAP_FAILED )
+    {
+      archive_map_ = mapped;
+      archive_map_size_ = static_cast< size_t >( archive_stat.st_size );
+      archive_view_ = static_cast< const char* >( mapped );
+      archive_view_size_ = archive_map_size_;
+    }
+  }
+#endif
+
+  SetViewFd( ::fileno( file_handle_ ), 0 );
+
+  return ErrorCodes::NoError;
+}
+
+void ArchiveJUnzip::SetViewFd( uv_file fd, int64_t offset )
+{
+#if !defined(_WIN32)
+  // our own so it outlives whatever the mount was given and is not inherited.
+  view_fd_ = ::fcntl( fd, F_DUPFD_CLOEXEC, 0 );
+  view_fd_offset_ = offset;
+#endif
+}
+
+ErrorCodes ArchiveJUnzip::OpenFd()
+{
+  uv_fs_t request;
+
+  int error_code = ::uv_fs_fstat( manager_->Loop(), &request, source_fd_, nullptr );
+  const bool is_file = ( error_code == 0 && ( request.statbuf.st_mode & S_IFMT ) == S_IFREG );
+  const size_t file_size = is_file ? static_cast< size_t >( request.statbuf.st_size ) : 0;
+  ::uv_fs_req_cleanup( &request );
+
+  if( error_code != 0 )
+  {
+    return ErrorCodes::ArchiveNotFound;
+  }
+
+  // A pipe can't be seeked or mapped so it's read to the end.
+  if( is_file == false )
+  {
+    size_t used = 0;
+    source_buffer_.resize( 64 * 1024 );
+
+    for( ;; )
+    {
+      if( used == source_buffer_.size() )
+      {
+        source_buffer_.resize( used * 2 );
+      }
+
+      uv_buf_t buffer = ::uv_buf_init( source_buffer_.data() + used, static_cast< unsigned int >( source_buffer_.size() - used ) );
+      int read = ::uv_fs_read( manager_->Loop(), &request, source_fd_, &buffer, 1, -1, nullptr );
+      ::uv_fs_req_cleanup( &request );
+
+      if( read < 0 )
+      {
+        std::vector< char >().swap( source_buffer_ );
+        return ErrorCodes::ArchiveNotFound;
+      }
+
+      if( read == 0 )
+      {
+        break;
+      }
+
+      used += static_cast< size_t >( read );
+    }
+
+    source_buffer_.resize( used );
+  }
+
+  const size_t total_size = is_file ? file_size : source_buffer_.size();
+  JZFile* whole = is_file ? ::jzfile_from_fd( source_fd_, 0, file_size ) : ::jzfile_from_memory( source_buffer_.data(), source_buffer_.size() );
+
+  size_t base = 0;
+  size_t size = 0;
+  bool in_range = false;
+
+  if( source_offset_ < 0 )
+  {
+    // Whatever the zip was appended to comes before its first entry, the central directory offset is from there.
+    JZEndRecord end_record;
+    size_t end_position = 0;
+
+    if( ::jzLocateEndRecord( whole, &end_record, &end_position ) == Z_OK )
+    {
+      const size_t zip_size = static_cast< size_t >( end_record.centralDirectoryOffset ) + end_record.centralDirectorySize;
+      if( end_position >= zip_size )
+      {
+        base = end_position - zip_size;
+        size = total_size - base;
+        in_range = true;
+      }
+    }
+  }
+  else if( static_cast< uint64_t >( source_offset_ ) <= total_size )
+  {
+    base = static_cast< size_t >( source_offset_ );
+    size = ( source_size_ < 0 ) ? ( total_size - base ) : static_cast< size_t >( source_size_ );
+    in_range = ( size <= total_size - base );
+  }
+
+  whole->close( whole );
+
+  if( in_range == false )
+  {
+    std::vector< char >().swap( source_buffer_ );
+    return ErrorCodes::ArchiveInvalid;
+  }
+
+  if( is_file == false )
+  {
+    archive_view_ = source_buffer_.data() + base;
+    archive_view_size_ = size;
+    return ErrorCodes::NoError;
+  }
+
+  identity_ = SharedIndex::Identity( source_fd_, base, size );
+  SetViewFd( source_fd_, static_cast< int64_t >( base ) );
+
+#if !defined(_WIN32)
+  // mmap() wants a page aligned offset so the map starts at the page the archive starts in.
+  const size_t page_size = static_cast< size_t >( ::sysconf( _SC_PAGESIZE ) );
+  const size_t map_offset = base - ( base % page_size );
+
+  void* mapped = ::mmap( nullptr, size + ( base - map_offset ), PROT_READ, MAP_PRIVATE, source_fd_, static_cast< off_t >( map_offset ) );
+  if( mapped != MAP_FAILED )
+  {
+    archive_map_ = mapped;
+    archive_map_size_ = size + ( base - map_offset );
+    archive_view_ = static_cast< const char* >( mapped ) + ( base - map_offset );
+    archive_view_size_ = size;
+    return ErrorCodes::NoError;
+  }
+#endif
+
+  // Can't map it so read the archive's part of the file.
+  source_buffer_.resize( size );
+
+  JZFile* range = ::jzfile_from_fd( source_fd_, base, size );
+  const size_t read = range->read( range, source_buffer_.data(), size );
+  range->close( range );
+
+  if( read != size )
+  {
+    std::vector< char >().swap( source_buffer_ );
+    return ErrorCodes::ArchiveNotFound;
+  }
+
+  archive_view_ = source_buffer_.data();
+  archive_view_size_ = size;
+
+  return ErrorCodes::NoError;
+}
+
+ErrorCodes ArchiveJUnzip::Mount()
+{
+  TraceScope trace( "archive.mount", archive_filepath_.c_str() );
+
+  ErrorCodes open_error;
+
+  if( source_data_ != nullptr )
+  {
+    archive_view_ = source_data_;
+    archive_view_size_ = static_cast< size_t >( source_size_ );
+    open_error = ErrorCodes::NoError;
+  }
+  else if( source_fd_ >= 0 )
+  {
+    open_error = OpenFd();
+  }
+  else
+  {
+    open_error = OpenFile();
+  }
+
+  if( open_error != ErrorCodes::NoError )
+  {
+    return open_error;
+  }
+
+  trace.SetSize( archive_view_size_ );
+
+  // Another process may have mounted the same archive, if so its index saves hashing the archive and reading the central directory.
+  SharedIndex shared_index;
+  std::string index_filepath;
+  bool from_shared_index = false;
+
+  if( identity_.length() != 0 && manager_->UseSharedIndex() )
+  {
+    index_filepath = SharedIndex::IndexFilePath( manager_->CacheRoot(), identity_ );
 
-    ArchiveDir* knownDir = node->FindDir( name );
-    if( knownDir == nullptr )
-    {
-      // we need to add a dir or file.
-      bool addAsFile = false;
-      if( i == ( sz - 1 ) && is_dir == false )
-      {
-        addAsFile = true;
-      }
+    TraceScope index_trace( "archive.shared_index", index_filepath.c_str() );
+    from_shared_index = shared_index.Open( index_filepath );
+  }
 
-      if( addAsFile == true )
-      {
-        ArchiveFileJUnzip* newFile = new ArchiveFileJUnzip();
+  // Only archives mounted by filepath have a file, everything else is read from the view.
+  if( file_handle_ != nullptr )
+  {
+    zip_file_handle_ = ::jzfile_from_stdio_file( file_handle_ );
+  }
+  else
+  {
+    zip_file_handle_ = ::jzfile_from_memory( archive_view_, archive_view_size_ );
+  }
 
-        newFile->archiveId_ = archiveIndexNumber;
-        newFile->Set( fileHeader );
+  int end_record_error;
+  {
+    TraceScope end_record_trace( "archive.end_record", archive_filepath_.c_str() );
+    end_record_error = ::jzReadEndRecord( zip_file_handle_, &endRecord_ );
+  }
 
-        node->Add( name, newFile );
+  if( end_record_error )
+  {
+    zip_file_handle_->close( zip_file_handle_ );
+    zip_file_handle_ = nullptr;
+    file_handle_ = nullptr;
 
-        // if we need to extract the file.
-        if( extract_on_mount_ == true )
-        {
-          // do sync.
-          Extract( newFile );
-        }
-        else
-        {
-          Validate( newFile );
-        }
+    return ErrorCodes::ArchiveInvalid;
+  }
 
-        return 1;
-      }
-      else
-      {
-        ArchiveDirJUnzip* newDir = new ArchiveDirJUnzip();
+  // With a public key the signed manifest stands in for the archive's hash, only it and the central directory are read.
+  std::string manifest_id;
+  verify_entries_ = ( manager_->PublicKey() != nullptr );
 
-        node->Add( name, newDir );
+  if( verify_entries_ )
+  {
+    TraceScope manifest_trace( "archive.manifest", archive_filepath_.c_str() );
 
-        if( i != ( sz - 1 ) )
-        {
-          newDir->Set( fileHeader );
-          node = newDir;
-        }
-      }
-    }
-    else
+    if( LoadManifest( manifest_id ) == false )
     {
-      // next
-      node = knownDir;
+      zip_file_handle_->close( zip_file_handle_ );
+      zip_file_handle_ = nullptr;
+      file_handle_ = nullptr;
+
+      return ErrorCodes::ArchiveNotVerified;
     }
   }
 
-  return 1; // read next = 1 abort = 0
-}
-
-int ArchiveJUnzip::onMountEachFile( JZFile* hZipFile, int archivesFileIndex, JZFileHeader* header, char* filepath, void* pUser )
-{
-	ArchiveJUnzip* target = reinterpret_cast<ArchiveJUnzip*>( pUser );
-	return target->AddEntry( hZipFile, archivesFileIndex, header, filepath );
-}
-
-ErrorCodes ArchiveJUnzip::Mount()
-{
-#if defined(_WIN32)
-  if( ::fopen_s(&file_handle_, archive_filepath_.c_str(), "rb" ))
+  // we use the archives md5 hash as id in the cache, it's the same hash either way.
+  if( from_shared_index )
   {
-    file_handle_ = nullptr;
+    md5_hash_ = shared_index.Md5();
   }
-#else
-  file_handle_ = ::fopen(archive_filepath_.c_str(), "rb");
-#endif
-
-  if(file_handle_ == nullptr)
+  else if( verify_entries_ )
   {
-    return ErrorCodes::ArchiveNotFound;
+    md5_hash_ = manifest_id;
+  }
+  else
+  {
+    TraceScope hash_trace( "archive.hash", archive_filepath_.c_str() );
+
+    if( archive_view_ != nullptr )
+    {
+      md5_hash_ = Archive::GetMD5( archive_view_, archive_view_size_ );
+    }
+    else
+    {
+      // reading the end record moved the file on.
+      ::fseek( file_handle_, 0, SEEK_SET );
+      md5_hash_ = Archive::GetMD5(file_handle_);
+    }
   }
 
-  // we use the archives md5 hash as id in the cache
-  md5_hash_ = Archive::GetMD5(file_handle_);
   temp_path_ = manager_->CacheRoot() + std::string( "/" ) + md5_hash_;
 
   uv_fs_t test_dir;
@@ -318,6 +1123,7 @@ ErrorCodes ArchiveJUnzip::Mount()
 		error_code = ::uv_fs_mkdir(manager_->Loop(), &mkdirRequest, temp_path_.c_str(), 0777, nullptr);
 		if(error_code < 0)
 		{
+			zip_file_handle_->close( zip_file_handle_ );
 			zip_file_handle_ = nullptr;
 			file_handle_ = nullptr;
 
@@ -327,26 +1133,86 @@ ErrorCodes ArchiveJUnzip::Mount()
     extract_on_mount_ = true;
   }
 
-	zip_file_handle_ = ::jzfile_from_stdio_file( file_handle_ );
+	// we have the archive dir so time to create the cache, on a cold cache this is where the extraction happens.
+  if( from_shared_index && shared_index.Count() == endRecord_.numEntries )
+  {
+    TraceScope shared_index_trace( "archive.shared_index_entries", archive_filepath_.c_str() );
+    shared_index_trace.SetSize( shared_index.Count() );
+
+    // the process that wrote the index had every entry in the cache dir, unless the dir has gone since.
+    trust_cache_ = ( extract_on_mount_ == false );
+
+    for( uint32_t i = 0; i < shared_index.Count(); ++i )
+    {
+      const SharedIndex::Entry& entry = shared_index.At( i );
+
+      JZFileHeader header;
+      header.compressionMethod = entry.compression_method_;
+      header.lastModFileTime = entry.last_mod_file_time_;
+      header.lastModFileDate = entry.last_mod_file_date_;
+      header.crc32 = entry.crc32_;
+      header.compressedSize = entry.compressed_size_;
+      header.uncompressedSize = entry.uncompressed_size_;
+      header.offset = entry.offset_;
+
+      AddEntry( zip_file_handle_, static_cast< int >( entry.index_ ), &header, shared_index.Name( entry ) );
+    }
 
-  if( ::jzReadEndRecord( zip_file_handle_, &endRecord_ ) )
+    trust_cache_ = false;
+  }
+  else
   {
-    zip_file_handle_->close( zip_file_handle_ );
-    zip_file_handle_ = nullptr;
-    file_handle_ = nullptr;
+    int central_directory_error;
+    {
+      TraceScope central_directory_trace( "archive.central_directory", archive_filepath_.c_str() );
+      central_directory_trace.SetSize( endRecord_.numEntries );
 
-    return ErrorCodes::ArchiveInvalid;
+      build_shared_index_ = ( index_filepath.length() != 0 );
+      central_directory_error = ::jzReadCentralDirectory( zip_file_handle_, &endRecord_, &ArchiveJUnzip::onMountEachFile, this );
+      build_shared_index_ = false;
+    }
+
+    // only an index of a complete mount is worth sharing.
+    if( central_directory_error == 0 && is_unsafe_ == false && ManifestMatches() && index_filepath.length() != 0 )
+    {
+      SharedIndex::Write( index_filepath, md5_hash_, shared_entries_, shared_names_ );
+    }
+
+    std::vector< SharedIndex::Entry >().swap( shared_entries_ );
+    std::string().swap( shared_names_ );
+
+    if( central_directory_error )
+    {
+      zip_file_handle_->close( zip_file_handle_ );
+      zip_file_handle_ = nullptr;
+      file_handle_ = nullptr;
+
+      return ErrorCodes::ArchiveInvalid;
+    }
   }
 
-	// we have the archive dir so time to create the cache.
-	if( ::jzReadCentralDirectory( zip_file_handle_, &endRecord_, &ArchiveJUnzip::onMountEachFile, this ) )
-	{
+  shared_index.Close();
+
+  std::multimap< ContentKey, ArchiveFileJUnzip* >().swap( same_content_ );
+
+  if( same_content_count_ != 0 )
+  {
+    manager_->Report( "Archive:%s has %d entries with the same content as an earlier one\n", archive_filepath_.c_str(), same_content_count_ );
+  }
+
+  // every listed file has to have been in the central directory too.
+  if( ManifestMatches() == false )
+  {
     zip_file_handle_->close( zip_file_handle_ );
     zip_file_handle_ = nullptr;
     file_handle_ = nullptr;
 
-		return ErrorCodes::ArchiveInvalid;
-	}
+    return ErrorCodes::ArchiveNotVerified;
+  }
+
+  root_.BuildListing();
+
+  StartStartupProfile();
 
   return ErrorCodes::NoError;
 }
@@ -360,8 +1226,41 @@ bool ArchiveJUnzip::IsMounted()
   return true;
 }
 
+void ArchiveJUnzip::EndStartupProfile()
+{
+  uv_mutex_lock( &lock_ );
+  startup_profile_.EndRecording();
+  uv_mutex_unlock( &lock_ );
+}
+
 void ArchiveJUnzip::Unmount()
 {
+  // the prefetch thread may be looking at the views.
+  startup_profile_.Stop();
+
+  UnmapContent( Root() );
+
+#if !defined(_WIN32)
+  if( archive_map_ != nullptr )
+  {
+    ::munmap( archive_map_, archive_map_size_ );
+  }
+#endif
+  archive_map_ = nullptr;
+  archive_map_size_ = 0;
+  archive_view_ = nullptr;
+  archive_view_size_ = 0;
+  std::vector< char >().swap( source_buffer_ );
+
+#if !defined(_WIN32)
+  if( view_fd_ >= 0 )
+  {
+    ::close( view_fd_ );
+  }
+#endif
+  view_fd_ = -1;
+  view_fd_offset_ = 0;
+
   if( zip_file_handle_ != nullptr )
   {
     zip_file_handle_->close( zip_file_handle_ );
@@ -489,13 +1388,285 @@ bool ArchiveJUnzip::ExtractTo( const std::string& archive_filepath, const std::s
   return ret;
 }
 
-int ArchiveJUnzip::fs_stat( uv_loop_t* loop, uv_fs_t* req, const char* filePath )
+/// An entry read from the central directory while relaying out an archive
+struct ArchiveJUnzipRelayoutEntry
+{
+  std::string name_;
+  JZFileHeader header_;
+  bool is_startup_ = false;
+};
+
+static int RelayoutForEachEntry( JZFile* /*zip_file*/, int /*archive_index*/, JZFileHeader* header, char* filepath, void* pUser )
+{
+  std::vector< ArchiveJUnzipRelayoutEntry >* entries = reinterpret_cast< std::vector< ArchiveJUnzipRelayoutEntry >* >( pUser );
+
+  ArchiveJUnzipRelayoutEntry entry;
+  entry.name_ = filepath;
+  entry.header_ = *header;
+
+  entries->push_back( entry );
+
+  return 1; // 1 = next
+}
+
+static bool WriteAll( FILE* out, const void* data, size_t size )
+{
+  return size == 0 || std::fwrite( data, 1, size, out ) == size;
+}
+
+bool ArchiveJUnzip::Relayout( const std::string& archive_filepath, const std::vector< std::string >& startup_entries, const std::string& output_filepath, uint32_t store_below_size, bool store_identical_once )
+{
+  FILE* hFile = nullptr;
+  FILE* out = nullptr;
+
+#if defined(_WIN32)
+  if( ::fopen_s( &hFile, archive_filepath.c_str(), "rb" ) )
+  {
+    hFile = nullptr;
+  }
+#else
+  hFile = ::fopen( archive_filepath.c_str(), "rb" );
+#endif
+
+  if( hFile == nullptr )
+  {
+    return false;
+  }
+
+  JZFile* hZipFile = ::jzfile_from_stdio_file( hFile );
+  JZEndRecord endRecord;
+  std::vector< ArchiveJUnzipRelayoutEntry > entries;
+
+  if( ::jzReadEndRecord( hZipFile, &endRecord ) || ::jzReadCentralDirectory( hZipFile, &endRecord, &archive::RelayoutForEachEntry, &entries ) )
+  {
+    hZipFile->close( hZipFile );
+    return false;
+  }
+
+  // startup entries first in the order they were opened, then the rest as they were.
+  std::vector< ArchiveJUnzipRelayoutEntry* > ordered;
+  std::map< std::string, ArchiveJUnzipRelayoutEntry* > by_name;
+
+  for( size_t i=0; i<entries.size(); ++i )
+  {
+    by_name.insert( std::pair< std::string, ArchiveJUnzipRelayoutEntry* >( entries[ i ].name_, &entries[ i ] ) );
+  }
+
+  for( std::vector< std::string >::const_iterator startup_entry=startup_entries.begin(); startup_entry!=startup_entries.end(); ++startup_entry )
+  {
+    std::map< std::string, ArchiveJUnzipRelayoutEntry* >::iterator found = by_name.find( *startup_entry );
+    if( found != by_name.end() && found->second->is_startup_ == false )
+    {
+      found->second->is_startup_ = true;
+      ordered.push_back( found->second );
+    }
+  }
+
+  for( size_t i=0; i<entries.size(); ++i )
+  {
+    if( entries[ i ].is_startup_ == false )
+    {
+      ordered.push_back( &entries[ i ] );
+    }
+  }
+
+  // written under a name of its own then renamed so a failed relayout leaves no half written archive behind.
+  const std::string temp_filepath = output_filepath + "." + std::to_string( uv_os_getpid() ) + ".tmp";
+
+#if defined(_WIN32)
+  if( ::fopen_s( &out, temp_filepath.c_str(), "wb" ) )
+  {
+    out = nullptr;
+  }
+#else
+  out = ::fopen( temp_filepath.c_str(), "wb" );
+#endif
+
+  if( out == nullptr )
+  {
+    hZipFile->close( hZipFile );
+    return false;
+  }
+
+  bool ret = true;
+  std::vector< char > buffer;
+  std::vector< JZFileHeader > written_headers;
+  // the offset of each local record written, by its CRC-32, sizes and method and the MD5 of its bytes.
+  std::map< std::string, uint32_t > written_records;
+
+  for( size_t i=0; i<ordered.size() && ret; ++i )
+  {
+    ArchiveJUnzipRelayoutEntry* entry = ordered[ i ];
+    JZFileHeader header = entry->header_;
+    JZFileHeader local_header;
+
+    hZipFile->seek( hZipFile, entry->header_.offset, SEEK_SET );
+
+    if( jzReadLocalFileHeader( hZipFile, &local_header, nullptr, 0 ) != Z_OK )
+    {
+      ret = false;
+      break;
+    }
+
+    // Small startup files are stored so they can be served straight out of the mapped archive.
+    if( entry->is_startup_ && header.compressionMethod != 0 && header.uncompressedSize <= store_below_size )
+    {
+      buffer.resize( header.uncompressedSize );
+
+      if( jzReadData( hZipFile, &entry->header_, buffer.data() ) != Z_OK )
+      {
+        ret = false;
+        break;
+      }
+
+      header.compressionMethod = 0;
+      header.compressedSize = header.uncompressedSize;
+    }
+    else
+    {
+      // copied as is.
+      buffer.resize( header.compressedSize );
+
+      if( hZipFile->read( hZipFile, buffer.data(), header.compressedSize ) < header.compressedSize )
+      {
+        ret = false;
+        break;
+      }
+    }
+
+    header.offset = static_cast< uint32_t >( std::ftell( out ) );
+
+    if( store_identical_once && header.uncompressedSize != 0 )
+    {
+      const std::string record_key = std::to_string( header.crc32 ) + "/" + std::to_string( header.compressedSize ) + "/" + std::to_string( header.uncompressedSize ) + "/" +
+                                     std::to_string( header.compressionMethod ) + "/" + Archive::GetMD5( buffer.data(), header.compressedSize );
+
+      std::pair< std::map< std::string, uint32_t >::iterator, bool > record = written_records.insert( std::make_pair( record_key, header.offset ) );
+
+      // the same bytes are already in the archive, the local record keeps the first entry's name.
+      if( record.second == false )
+      {
+        header.offset = record.first->second;
+        written_headers.push_back( header );
+        continue;
+      }
+    }
+
+    JZLocalFileHeader new_local_header;
+    std::memset( &new_local_header, 0, sizeof( JZLocalFileHeader ) );
+
+    new_local_header.signature = 0x04034B50;
+    new_local_header.versionNeededToExtract = 20;
+    new_local_header.compressionMethod = header.compressionMethod;
+    new_local_header.lastModFileTime = header.lastModFileTime;
+    new_local_header.lastModFileDate = header.lastModFileDate;
+    new_local_header.crc32 = header.crc32;
+    new_local_header.compressedSize = header.compressedSize;
+    new_local_header.uncompressedSize = header.uncompressedSize;
+    new_local_header.fileNameLength = static_cast< uint16_t >( entry->name_.length() );
+
+    ret = WriteAll( out, &new_local_header, sizeof( JZLocalFileHeader ) ) &&
+          WriteAll( out, entry->name_.data(), entry->name_.length() ) &&
+          WriteAll( out, buffer.data(), header.compressedSize );
+
+    written_headers.push_back( header );
+  }
+
+  // now the central directory and end record.
+  JZEndRecord new_end_record;
+  std::memset( &new_end_record, 0, sizeof( JZEndRecord ) );
+
+  new_end_record.signature = 0x06054B50;
+  new_end_record.centralDirectoryOffset = static_cast< uint32_t >( std::ftell( out ) );
+
+  for( size_t i=0; i<written_headers.size() && ret; ++i )
+  {
+    const JZFileHeader& header = written_headers[ i ];
+    const std::string& name = ordered[ i ]->name_;
+
+    JZGlobalFileHeader global_header;
+    std::memset( &global_header, 0, sizeof( JZGlobalFileHeader ) );
+
+    global_header.signature = 0x02014B50;
+    global_header.versionMadeBy = 20;
+    global_header.versionNeededToExtract = 20;
+    global_header.compressionMethod = header.compressionMethod;
+    global_header.lastModFileTime = header.lastModFileTime;
+    global_header.lastModFileDate = header.lastModFileDate;
+    global_header.crc32 = header.crc32;
+    global_header.compressedSize = header.compressedSize;
+    global_header.uncompressedSize = header.uncompressedSize;
+    global_header.fileNameLength = static_cast< uint16_t >( name.length() );
+    global_header.relativeOffsetOflocalHeader = header.offset;
+
+    ret = WriteAll( out, &global_header, sizeof( JZGlobalFileHeader ) ) && WriteAll( out, name.data(), name.length() );
+  }
+
+  new_end_record.numEntries = static_cast< uint16_t >( written_headers.size() );
+  new_end_record.numEntriesThisDisk = new_end_record.numEntries;
+  new_end_record.centralDirectorySize = static_cast< uint32_t >( std::ftell( out ) ) - new_end_record.centralDirectoryOffset;
+
+  ret = ret && WriteAll( out, &new_end_record, sizeof( JZEndRecord ) );
+
+  if( std::fclose( out ) != 0 )
+  {
+    ret = false;
+  }
+
+  hZipFile->close( hZipFile );
+
+  uv_fs_t request;
+
+  if( ret )
+  {
+    ret = ( ::uv_fs_rename( nullptr, &request, temp_filepath.c_str(), output_filepath.c_str(), nullptr ) == 0 );
+    ::uv_fs_req_cleanup( &request );
+  }
+
+  if( ret == false )
+  {
+    ::uv_fs_unlink( nullptr, &request, temp_filepath.c_str(), nullptr );
+    ::uv_fs_req_cleanup( &request );
+  }
+
+  return ret;
+}
+
+void ArchiveJUnzip::FillStat( const ArchiveItem* item, uv_stat_t& stat )
+{
+  std::memset( &stat, 0, sizeof( uv_stat_t ) );
+
+  if( item->IsFile() )
+  {
+    const ArchiveFile *pFile = static_cast< const ArchiveFile* >( item );
+
+    Convsert( stat.st_atim, pFile->lastModified_ );
+    Convsert( stat.st_ctim, pFile->lastModified_ );
+    Convsert( stat.st_mtim, pFile->lastModified_ );
+    Convsert( stat.st_birthtim, pFile->lastModified_ );
+
+    stat.st_mode |= 0x8000;  // _S_IFREG or file
+
+    stat.st_size = pFile->size_;
+  }
+  else
+  {
+    stat.st_mode |= 0x4000;  // _S_IFDIR
+    stat.st_size = 0;
+  }
+}
+
+int ArchiveJUnzip::Stat( uv_fs_t* req, const char* filePath )
 {
+  TraceScope trace( "archive.stat", filePath );
+
+  const uint64_t start = uv_hrtime();
+  metrics_.Add( Metrics::Stats );
+
   std::vector< std::string > parts = FilePathToParts( filePath );
 
   ArchiveItem* pTarget = Find( parts );
-  int r = 0;
- 
+
   if( pTarget == nullptr )
   {
     req->result = UV_ENOENT;
@@ -504,47 +1675,27 @@ int ArchiveJUnzip::fs_stat( uv_loop_t* loop, uv_fs_t* req, const char* filePath
   else
   {
     req->result = 0;
-    req->ptr = reinterpret_cast< void* >( &( req->statbuf ) );
-
     req->ptr = &req->statbuf;
 
-    req->statbuf.st_dev = 0;
-    req->statbuf.st_ino = 0;
-    req->statbuf.st_gid = 0;
-    req->statbuf.st_uid = 0;
-    req->statbuf.st_mode = 0;
-
-    if( pTarget->IsFile() )
-    {
-      ArchiveFile *pFile = static_cast< ArchiveFile* >( pTarget );
-
-      Convsert( req->statbuf.st_atim, pFile->lastModified_ );
-      Convsert( req->statbuf.st_ctim, pFile->lastModified_ );
-      Convsert( req->statbuf.st_mtim, pFile->lastModified_ );
-      Convsert( req->statbuf.st_birthtim, pFile->lastModified_ );
+    FillStat( pTarget, req->statbuf );
+  }
 
-      req->statbuf.st_mode |= 0x8000;  // _S_IFREG or file
+  metrics_.Record( Metrics::StatTime, start );
 
-      req->statbuf.st_size = pFile->size_;
-    }
-    else
-    {
-      req->statbuf.st_mode |= 0x4000;  // _S_IFDIR
-      req->statbuf.st_size = 0;
-    }
-  }
+  return static_cast< int >( req->result );
+}
 
+int ArchiveJUnzip::fs_stat( uv_loop_t* loop, uv_fs_t* req, const char* filePath )
+{
   if( req->cb == nullptr )
   {
-    r = static_cast<int>(req->result);
-  }
-  else
-  {
-		// we have a request callback so it needs to be async.
-    Schedule(loop, req);
+    return Stat( req, filePath );
   }
 
-  return r;
+  // we have a request callback so the lookup is done on the threadpool.
+  FsWork* work = FsWork::New( loop, this, req, UV_FS_STAT, filePath );
+
+  return ScheduleWork( loop, work );
 }
 
 std::string ArchiveJUnzip::CacheFilePath(const std::string& full_filepath)
@@ -563,107 +1714,176 @@ std::string ArchiveJUnzip::CacheFilePath(const std::string& full_filepath)
   return ret;
 }
 
-int ArchiveJUnzip::fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file real_fileId)
+std::string ArchiveJUnzip::CodeCacheFilePath(const std::string& full_filepath, const std::string& tag)
 {
-  int r = 0;
-
-	req->flags = 0;
+  std::string ret;
 
-  OpenFiles::iterator found_entry = open_files_.find( real_fileId );
+  ArchiveItem* target_archive_item = Find(FilePathToParts(full_filepath.c_str()));
 
-  if(found_entry == open_files_.end())
+  if(target_archive_item != nullptr && target_archive_item->IsFile())
   {
-    req->result = UV_ENOENT;
-    req->ptr = nullptr;
+    ArchiveFileJUnzip* juzip_file_item = static_cast<ArchiveFileJUnzip*>(target_archive_item);
+
+    char crc[ 9 ];
+    std::snprintf( crc, sizeof( crc ), "%08x", juzip_file_item->crc32_ );
+
+    ret = temp_path_ + std::string( "/" ) + std::to_string( juzip_file_item->archiveId_ ) + std::string( "." ) + crc + std::string( "." ) + tag + std::string( ".code" );
   }
-  else
-  {
-    req->result = 0;
-    req->ptr = reinterpret_cast< void* >( &( req->statbuf ) );
 
-    req->ptr = &req->statbuf;
+  return ret;
+}
 
-    req->statbuf.st_dev = 0;
-    req->statbuf.st_ino = 0;
-    req->statbuf.st_gid = 0;
-    req->statbuf.st_uid = 0;
-    req->statbuf.st_mode = 0;
+bool ArchiveJUnzip::LoadFile( const std::string& full_filepath, std::vector< char >& content )
+{
+  ArchiveItem* target_archive_item = Find( FilePathToParts( full_filepath.c_str() ) );
 
-    if( found_entry->second.target_->IsFile() )
-    {
-      ArchiveFile *pFile = static_cast< ArchiveFile* >( found_entry->second.target_ );
+  if( target_archive_item == nullptr || !target_archive_item->IsFile() )
+  {
+    return false;
+  }
 
-      Convsert( req->statbuf.st_atim, pFile->lastModified_ );
-      Convsert( req->statbuf.st_ctim, pFile->lastModified_ );
-      Convsert( req->statbuf.st_mtim, pFile->lastModified_ );
-      Convsert( req->statbuf.st_birthtim, pFile->lastModified_ );
+  ArchiveFileJUnzip* file = static_cast< ArchiveFileJUnzip* >( target_archive_item );
+  size_t data_offset = 0;
 
-      req->statbuf.st_mode |= 0x8000;  // _S_IFREG or file
+  bool loaded = false;
 
-      req->statbuf.st_size = pFile->size_;
-    }
-    else
-    {
-      req->statbuf.st_mode |= 0x4000;  // _S_IFDIR
-      req->statbuf.st_size = 0;
-    }
+  // content_ is set by MapContent() when another thread opens the file.
+  uv_mutex_lock( &lock_ );
+
+  if( file->content_ != nullptr )
+  {
+    content.assign( file->content_, file->content_ + file->size_ );
+    loaded = true;
   }
 
-  if(req->cb == nullptr)
+  uv_mutex_unlock( &lock_ );
+
+  if( loaded == false && StoredDataOffset( file, data_offset ) )
   {
-    r = static_cast<int>(req->result);
+    content.assign( archive_view_ + data_offset, archive_view_ + data_offset + file->size_ );
+    loaded = true;
   }
-  else
+  else if( loaded == false )
   {
-    Schedule(loop, req);
+    // straight out of the archive, the cache file is not needed.
+    loaded = Inflate( file, content );
   }
 
-  return r;
+  return loaded && VerifyContent( file, content.data(), content.size() );
 }
 
+bool ArchiveJUnzip::ContentView(uv_file real_fileId, const char** content, size_t* content_size)
+{
+  const char* view = nullptr;
+  size_t view_size = 0;
+
+  uv_mutex_lock( &lock_ );
+
+  OpenFiles::iterator found_entry = open_files_.find( real_fileId );
+  if( found_entry != open_files_.end() && found_entry->second.target_->IsFile() )
+  {
+    const ArchiveFileJUnzip* file = static_cast< const ArchiveFileJUnzip* >( found_entry->second.target_ );
+    view = file->content_;
+    view_size = static_cast< size_t >( file->size_ );
+  }
+
+  uv_mutex_unlock( &lock_ );
+
+  if( view == nullptr )
+  {
+    return false;
+  }
+
+  *content = view;
+  *content_size = view_size;
 
+  return true;
+}
 
-void ArchiveJUnzip::fs_open_on( uv_fs_t* request )
+bool ArchiveJUnzip::SendfileSource(uv_file real_fileId, uv_file& fd, int64_t& in_offset, size_t& length)
 {
-  Shadow_uv_fs_t* true_request = static_cast< Shadow_uv_fs_t* >( request );
+  ArchiveFileJUnzip* file = nullptr;
 
-  ArchiveJUnzip* pThis = static_cast< ArchiveJUnzip* >( true_request->data );
+  uv_mutex_lock( &lock_ );
 
-  if( request->result > 0 )
+  OpenFiles::iterator found_entry = open_files_.find( real_fileId );
+  if( found_entry != open_files_.end() && found_entry->second.target_->IsFile() )
   {
-    OpenFileInfo info;
+    file = static_cast< ArchiveFileJUnzip* >( found_entry->second.target_ );
+  }
 
-    // we are opened.
-    info.target_ = static_cast< ArchiveFileJUnzip* >( true_request->target_ );
-    info.real_fileId_ = ( uv_file )true_request->result;
+  uv_mutex_unlock( &lock_ );
 
-    // insert into the open files table.
-    pThis->open_files_.insert( std::pair<uv_file, OpenFileInfo>( ( uv_file )request->result, info ) );
+  // deflated files are sent from their cache file which real_fileId already is.
+  size_t data_offset = 0;
+  if( file == nullptr || view_fd_ < 0 || in_offset < 0 || StoredDataOffset( file, data_offset ) == false )
+  {
+    return false;
+  }
 
-#if defined(_WIN32)
-		true_request->shadowing_request_->fs.info = request->fs.info;
-#endif		
+  // the file's content is followed by the rest of the archive so the length has to stop at its end.
+  const size_t size = static_cast< size_t >( file->size_ );
+  const size_t start = ( static_cast< uint64_t >( in_offset ) < size ) ? static_cast< size_t >( in_offset ) : size;
+
+  fd = view_fd_;
+  in_offset = view_fd_offset_ + static_cast< int64_t >( data_offset + start );
+  length = ( length < size - start ) ? length : size - start;
+
+  return true;
+}
+
+int ArchiveJUnzip::Fstat(uv_fs_t* req, uv_file real_fileId)
+{
+  TraceScope trace( "archive.fstat" );
+
+  const uint64_t start = uv_hrtime();
+  metrics_.Add( Metrics::Stats );
+
+  uv_mutex_lock( &lock_ );
+
+  OpenFiles::iterator found_entry = open_files_.find( real_fileId );
 
-    // how to update the shadow.
-    true_request->shadowing_request_->result = request->result;
+  if(found_entry == open_files_.end())
+  {
+    req->result = UV_ENOENT;
+    req->ptr = nullptr;
   }
   else
   {
-    // error!
-    true_request->shadowing_request_->result =  request->result;
+    req->result = 0;
+    req->ptr = &req->statbuf;
+
+    FillStat( found_entry->second.target_, req->statbuf );
   }
 
-	( *( true_request->shadowing_request_->cb ) )( true_request->shadowing_request_ );
+  uv_mutex_unlock( &lock_ );
 
-  ::uv_fs_req_cleanup( request );
+  metrics_.Record( Metrics::StatTime, start );
 
-  delete true_request;
+  return static_cast< int >( req->result );
 }
 
-int ArchiveJUnzip::fs_open( uv_loop_t* loop, uv_fs_t* request, int flags, const char* filePath )
+int ArchiveJUnzip::fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file real_fileId)
 {
-  int er = 0;
-  int r = 0;
+	req->flags = 0;
+
+  if(req->cb == nullptr)
+  {
+    return Fstat( req, real_fileId );
+  }
+
+  FsWork* work = FsWork::New( loop, this, req, UV_FS_FSTAT, nullptr );
+  work->real_fileId_ = real_fileId;
+
+  return ScheduleWork( loop, work );
+}
+
+int ArchiveJUnzip::Open( uv_fs_t* request, int flags, const char* filePath )
+{
+  TraceScope trace( "archive.open", filePath );
+
+  const uint64_t start = uv_hrtime();
+  metrics_.Add( Metrics::Opens );
 
   std::vector< std::string > parts = FilePathToParts( filePath );
 
@@ -692,6 +1912,21 @@ int ArchiveJUnzip::fs_open( uv_loop_t* loop, uv_fs_t* request, int flags, const
 	{
 		// now the archive file.
 		zip_file_item = static_cast< ArchiveFileJUnzip* >( target_file_item );
+    trace.SetSize( zip_file_item->size_ );
+
+    if( startup_profile_.IsRecording() )
+    {
+      std::string entry;
+      for( std::vector< std::string >::const_iterator part=parts.begin(); part!=parts.end(); ++part )
+      {
+        entry += ( entry.length() ? "/" : "" ) + *part;
+      }
+
+      uv_mutex_lock( &lock_ );
+      startup_profile_.Add( entry );
+      uv_mutex_unlock( &lock_ );
+    }
+
 		if( zip_file_item->exstracted_ != ArchiveFileJUnzip::Extracted )
 		{
 		  request->result = UV_EIO;
@@ -702,125 +1937,190 @@ int ArchiveJUnzip::fs_open( uv_loop_t* loop, uv_fs_t* request, int flags, const
 		}
 	}
 
-	// if an error
   if( request->result < 0 )
   {
-    if( request->cb != nullptr )
-    {
-      // As fs_open_on needs a shadow request...
-			Shadow_uv_fs_t *openRequest = new Shadow_uv_fs_t();
-			
-			openRequest->cb = &ArchiveJUnzip::fs_open_on;
-			openRequest->data = this;
-			openRequest->target_ = nullptr;
-			openRequest->shadowing_request_ = request;
-			openRequest->result = request->result;
-
-      // post away
-      Schedule( loop, openRequest );
-    }
-    else
-    {
-      r = ( uv_file )request->result;
-    }
-    return r;
+    metrics_.Record( Metrics::OpenTime, start );
+    return static_cast< int >( request->result );
   }
 
-  // async or sync
-  if( request->cb == nullptr )
-  {
-    // sync so do the open and log the real file id and map it to a new fake.
-    uv_fs_t req;
+  // do the open and log the real file id, the manager maps it to a new fake.
+  uv_fs_t req;
 
-    er = ::uv_fs_open( loop, &req, cache_filepath.c_str(), flags, 0x0777, nullptr );
+  int er = ::uv_fs_open( request->loop, &req, cache_filepath.c_str(), flags, 0x0777, nullptr );
 
-		request->result = er;
-    r = er;
+  request->result = er;
 
-    if( er > 0 )
-    {
+  if( er > 0 )
+  {
 #if defined(_WIN32)			
-			request->fs.info = req.fs.info;
+    request->fs.info = req.fs.info;
 #endif
-      // we need to add the opened file.
-      OpenFileInfo fileInfo;
+    // we need to add the opened file.
+    OpenFileInfo fileInfo;
 
-      fileInfo.target_ = zip_file_item;
-      fileInfo.real_fileId_ = er;
+    fileInfo.target_ = zip_file_item;
+    fileInfo.real_fileId_ = er;
 
-      // insert into the open files table.
-      open_files_.insert( std::pair<uv_file, OpenFileInfo>( er, fileInfo ) );
-    }
-  }
-  else
-  {
-    // we are async
-    // This is were things get a bit 'odd'
-    // We need a request to open the file but we can't use the passed request as that has a set path variable set which is the filepath not the real filepath.
-    // to get over this we open using another request and then join the two together.
-    Shadow_uv_fs_t *openRequest = new Shadow_uv_fs_t();
+    // insert into the open files table.
+    uv_mutex_lock( &lock_ );
+
+    open_files_.insert( std::pair<uv_file, OpenFileInfo>( er, fileInfo ) );
 
-    openRequest->data = this;
-    openRequest->target_ = zip_file_item;
-    openRequest->shadowing_request_ = request;
+    MapContent( zip_file_item, er );
 
-    // it's sync call.
-    er = ::uv_fs_open( loop, openRequest, cache_filepath.c_str(), flags, 0x0777, &ArchiveJUnzip::fs_open_on );
-    if( er < 0 )
+    uv_mutex_unlock( &lock_ );
+
+    // outside the lock as the first open hashes the file.
+    if( VerifyOpened( zip_file_item, er ) == false )
     {
-      delete openRequest;
-      r = er;
+      uv_mutex_lock( &lock_ );
+      open_files_.erase( er );
+      uv_mutex_unlock( &lock_ );
+
+      uv_fs_t close_req;
+      ::uv_fs_close( request->loop, &close_req, er, nullptr );
+      ::uv_fs_req_cleanup( &close_req );
+
+      er = UV_EIO;
+      request->result = er;
     }
   }
 
-  return r;
+  ::uv_fs_req_cleanup( &req );
+
+  metrics_.Record( Metrics::OpenTime, start );
+
+  return er;
 }
 
-void ArchiveJUnzip::fs_read_on( uv_fs_t* request )
+int ArchiveJUnzip::fs_open( uv_loop_t* loop, uv_fs_t* request, int flags, const char* filePath )
 {
-  // just pass through to the manager
-  Manager::fs_read_on(request);
+  if( request->cb == nullptr )
+  {
+    return Open( request, flags, filePath );
+  }
+
+  // The lookup, the open of the cache file and mapping its content are all done on the threadpool,
+  // request->cb is the manager's which swaps the real file id for a fake.
+  FsWork* work = FsWork::New( loop, this, request, UV_FS_OPEN, filePath );
+  work->flags_ = flags;
+
+  return ScheduleWork( loop, work );
 }
 
-int ArchiveJUnzip::fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file real_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset )
+int ArchiveJUnzip::Read( uv_fs_t* req, uv_file real_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset )
 {
-  int r = 0;
+  const char* content = nullptr;
+  int64_t position = offset;
+  size_t to_read = 0;
+
+  TraceScope trace( "archive.read" );
+
+  const uint64_t start = uv_hrtime();
+  metrics_.Add( Metrics::Reads );
 
   req->result = 0;
 
-  // Get the file object.
+  // Get the file object and, for a read at the current position, take the range it reads.
+  // Both are done under the one lock so reads racing on the same fd each get their own range.
+  uv_mutex_lock( &lock_ );
+
   OpenFiles::iterator found_file_info = open_files_.find( real_fileId );
   if( found_file_info == open_files_.end() )
   {
     req->result = UV_EBADF;
 	}
- 
-  if( req->cb == nullptr )
+  else if( found_file_info->second.target_->IsFile() )
   {
-    if( req->result == 0 )
-    {
-      // we can do the read.
-      r = ::uv_fs_read( loop, req, real_fileId, bufs, nbufs, offset, nullptr );
-		}
-    else
+    const ArchiveFileJUnzip* file = static_cast< const ArchiveFileJUnzip* >( found_file_info->second.target_ );
+    content = file->content_;
+
+    if( content != nullptr )
     {
-      r = ( int )req->result;
+      if( offset < 0 )
+      {
+        position = found_file_info->second.position_;
+      }
+
+      for( unsigned int i=0; i<nbufs; ++i )
+      {
+        to_read += bufs[ i ].len;
+      }
+
+      const size_t available = ( position < file->size_ ) ? static_cast< size_t >( file->size_ - position ) : 0;
+      to_read = ( to_read < available ) ? to_read : available;
+
+      if( offset < 0 )
+      {
+        found_file_info->second.position_ = position + static_cast< int64_t >( to_read );
+      }
     }
   }
-  else
+
+  uv_mutex_unlock( &lock_ );
+
+  if( req->result < 0 )
   {
-    if( req->result == 0 )
-    {
-      r = ::uv_fs_read( loop, req, real_fileId, bufs, nbufs, offset, &ArchiveJUnzip::fs_read_on );
-    }
-    else
+    metrics_.Record( Metrics::ReadTime, start );
+    return static_cast< int >( req->result );
+  }
+
+  if( content == nullptr )
+  {
+    // not mapped so read the cache file.
+    uv_fs_t read_req;
+
+    req->result = ::uv_fs_read( req->loop, &read_req, real_fileId, bufs, nbufs, offset, nullptr );
+
+    ::uv_fs_req_cleanup( &read_req );
+
+    if( req->result > 0 )
     {
-      req->cb = ArchiveJUnzip::fs_read_on;
-      Schedule( loop, req );
+      metrics_.Add( Metrics::BytesRead, req->result );
+      trace.SetSize( req->result );
     }
+
+    metrics_.Record( Metrics::ReadTime, start );
+
+    return static_cast< int >( req->result );
   }
 
-  return r;
+  // Served from memory, one memcpy per buffer and no syscall.
+  size_t total_read = 0;
+
+  for( unsigned int i=0; i<nbufs && total_read < to_read; ++i )
+  {
+    size_t left = to_read - total_read;
+    size_t to_copy = ( bufs[ i ].len < left ) ? bufs[ i ].len : left;
+
+    std::memcpy( bufs[ i ].base, content + position + total_read, to_copy );
+
+    total_read += to_copy;
+  }
+
+  req->result = static_cast< ssize_t >( total_read );
+
+  metrics_.Add( Metrics::MemoryReads );
+  metrics_.Add( Metrics::BytesRead, total_read );
+  trace.SetSize( total_read );
+  metrics_.Record( Metrics::ReadTime, start );
+
+  return static_cast< int >( req->result );
+}
+
+int ArchiveJUnzip::fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file real_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset )
+{
+  if( req->cb == nullptr )
+  {
+    return Read( req, real_fileId, bufs, nbufs, offset );
+  }
+
+  // The copy out of the mapped content may fault pages in from disk so it is kept off the loop thread.
+  FsWork* work = FsWork::New( loop, this, req, UV_FS_READ, nullptr, bufs, nbufs );
+  work->real_fileId_ = real_fileId;
+  work->offset_ = offset;
+
+  return ScheduleWork( loop, work );
 }
 
 void ArchiveJUnzip::fs_close_on( uv_fs_t* request )
@@ -835,6 +2135,8 @@ int ArchiveJUnzip::fs_close( uv_loop_t* loop, uv_fs_t* req, uv_file real_fileId
   req->result = 0;
 
   // Get the file object.
+  uv_mutex_lock( &lock_ );
+
   OpenFiles::iterator found_file_info = open_files_.find( real_fileId );
   if( found_file_info == open_files_.end() )
   {
@@ -846,6 +2148,8 @@ int ArchiveJUnzip::fs_close( uv_loop_t* loop, uv_fs_t* req, uv_file real_fileId
     open_files_.erase( found_file_info );
   }
 
+  uv_mutex_unlock( &lock_ );
+
   if( req->cb == nullptr )
   {
     if( req->result == 0 )
@@ -874,9 +2178,10 @@ int ArchiveJUnzip::fs_close( uv_loop_t* loop, uv_fs_t* req, uv_file real_fileId
   return r;
 }
 
-int ArchiveJUnzip::fs_scandir(uv_loop_t* loop, uv_fs_t* request, const char* path, int /*flags*/)
+int ArchiveJUnzip::Scandir(uv_fs_t* request, const char* path)
 {
-  int r = 0;
+  TraceScope trace( "archive.scandir", path );
+
 	std::vector< std::string > path_parts = FilePathToParts( path );
 
   ArchiveItem* target_item = Find( path_parts );
@@ -890,103 +2195,73 @@ int ArchiveJUnzip::fs_scandir(uv_loop_t* loop, uv_fs_t* request, const char* pat
 	}
 	else
 	{
-		const size_t pointer_dirent_sz = sizeof(uv__dirent_t*);
-
-		ArchiveDirJUnzip* zip_dir_item = static_cast< ArchiveDirJUnzip* >(target_item);
-
-		const size_t total_items = zip_dir_item->dirs_.size() + zip_dir_item->files_.size();
-
-		request->result = total_items;
-
-		if( total_items > 0 )
-		{
-			size_t current_index = 0;
-
-			// alloc the array
-			uv__dirent_t** results_array = reinterpret_cast<uv__dirent_t**>(scan_dir_alloc(pointer_dirent_sz * total_items));
-
-			// now the fun bit begins.
-			// first do the dir's
-
-			const size_t size_of_direct_t = sizeof( uv__dirent_t );
+		ArchiveDir* dir_item = static_cast< ArchiveDir* >( target_item );
 
-			for( std::map< std::string, struct _ArchiveDir* >::const_iterator sub_dir_item=zip_dir_item->dirs_.begin(); sub_dir_item!=zip_dir_item->dirs_.end(); ++sub_dir_item, ++current_index )
-			{
-				size_t dirent_true_alloc_size = size_of_direct_t + ( sub_dir_item->first.length() + 1 );
-
-				char* raw_data = static_cast< char* >( scan_dir_alloc( dirent_true_alloc_size ) );
-				std::memset( raw_data, 0, dirent_true_alloc_size );
+		// the listing is owned by the dir, Manager::fs_scandir_next() walks it by index and Manager::fs_req_cleanup() leaves it alone.
+		request->result = dir_item->listing_.size();
+		request->ptr = dir_item;
 
-				uv__dirent_t* item = reinterpret_cast< uv__dirent_t* >( raw_data );
-				results_array[ current_index ] = item;
-				
-				item->d_type = UV_DIRENT_DIR;
+    trace.SetSize( dir_item->listing_.size() );
+		request->flags |= EXT_ARCHIVE_LISTING;
 
-				char* name_start = item->d_name;
-				
-				size_t str_size = sub_dir_item->first.length();
-#if defined( _WIN32 )
-				strncpy_s(name_start, str_size + 1, sub_dir_item->first.c_str(), str_size);
+#if defined(_WIN32)
+		request->fs.info.nbufs = 0;
 #else
-				std::strncpy(name_start, sub_dir_item->first.c_str(), str_size);
+		request->nbufs = 0;
 #endif
-			}
+	}
 
-			// now do the files
-			for( std::map< std::string, struct _ArchiveFile* >::const_iterator sub_file_item=zip_dir_item->files_.begin(); sub_file_item!=zip_dir_item->files_.end(); ++sub_file_item, ++current_index )
-			{
-				size_t dirent_true_alloc_size = size_of_direct_t + ( sub_file_item->first.length() + 1 );
+  return static_cast< int >( request->result );
+}
+
+int ArchiveJUnzip::fs_scandir(uv_loop_t* loop, uv_fs_t* request, const char* path, int /*flags*/)
+{
+	if(request->cb == nullptr)
+	{
+		return Scandir( request, path );
+	}
 
-				char* raw_data = static_cast< char* >( scan_dir_alloc( dirent_true_alloc_size ) );
-				std::memset( raw_data, 0, dirent_true_alloc_size );
+  FsWork* work = FsWork::New( loop, this, request, UV_FS_SCANDIR, path );
 
-				uv__dirent_t* item = reinterpret_cast< uv__dirent_t* >( raw_data );
+  return ScheduleWork( loop, work );
+}
 
-				results_array[ current_index ] = item;
+int ArchiveJUnzip::fs_readdir_stats(const char* path, std::vector< DirStatsItem >& items)
+{
+  ArchiveItem* target_item = Find( FilePathToParts( path ) );
 
-				item->d_type = UV_DIRENT_FILE;
+  if( target_item == nullptr )
+  {
+    return UV_ENOENT;
+  }
 
-				char* name_start = item->d_name;
+  if( target_item->IsFile() )
+  {
+    return UV_ENOTDIR;
+  }
 
-				size_t str_size = sub_file_item->first.length();
-#if defined( _WIN32 )
-				strncpy_s(name_start, str_size + 1, sub_file_item->first.c_str(), str_size);
-#else
-				std::strncpy( name_start, sub_file_item->first.c_str(), str_size);
-#endif
-			}
+  ArchiveDir* dir_item = static_cast< ArchiveDir* >( target_item );
 
-			// set the needed flags.
-	#if defined(_WIN32)
-			request->flags |= EXT_UV_FS_FREE_PTR;
-			request->fs.info.nbufs = 0;
-	#else
-			request->nbufs = 0;
-	#endif
-			request->ptr = results_array;
-		}
-		else
-		{
-			request->ptr = nullptr;
+  items.resize( dir_item->listing_.size() );
 
-#if defined(_WIN32)
-			request->fs.info.nbufs = 0;
-#else
-			request->nbufs = 0;
-#endif
-		}
-	}
+  // the listing is dirs then files, the same order as the maps.
+  size_t index = 0;
 
-	if(request->cb == nullptr)
-	{
-		r = static_cast<int>(request->result);
-	}
-	else
-	{
-		Schedule(loop, request);
-	}
+  for( std::map< std::string, ArchiveDir* >::const_iterator dir=dir_item->dirs_.begin(); dir!=dir_item->dirs_.end(); ++dir, ++index )
+  {
+    items[ index ].name_ = dir->first;
+    items[ index ].type_ = UV_DIRENT_DIR;
+    FillStat( dir->second, items[ index ].stat_ );
+  }
 
-  return r;
+  for( std::map< std::string, ArchiveFile* >::const_iterator file=dir_item->files_.begin(); file!=dir_item->files_.end(); ++file, ++index )
+  {
+    items[ index ].name_ = file->first;
+    items[ index ].type_ = UV_DIRENT_FILE;
+    FillStat( file->second, items[ index ].stat_ );
+  }
+
+  return static_cast< int >( items.size() );
 }
 
 }
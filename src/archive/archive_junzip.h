@@ -3,7 +3,12 @@
 
 #include "archive/archive.h"
 #include "archive/junzip.h"
+#include "archive/manifest.h"
+#include "archive/shared_index.h"
+#include "archive/startup_profile.h"
+#include <atomic>
 #include <map>
+#include <string>
 #include <vector>
 
 namespace archive
@@ -23,12 +28,39 @@ typedef struct _ArchiveFileJUnzip : public ArchiveFile
     Extracted
   };
 
+  // Whether the file's content has been checked against its Manifest listing
+  enum VerifiedStates
+  {
+    NotVerified = 0,
+    Verified,
+    VerifyFailed
+  };
+
   // The id of the file in the zip file
   int archiveId_ = 0;
   /// The offset in the zip file were this file belongs
   int offset_ = -1;
 	/// If the file has been decompressed.
 	ExtractStates exstracted_ = NotExtracted;
+  /// How the file is stored in the zip file (0 = stored, 8 = deflated)
+  uint16_t compression_method_ = 0;
+  /// The size of the file as stored in the zip file
+  uint32_t compressed_size_ = 0;
+  /// The CRC-32 of the file's content
+  uint32_t crc32_ = 0;
+
+  /// In memory view of the file's content, nullptr until the file is first opened.
+  /// Stored files point straight into the mapped archive, others at the mapped cache file.
+  const char* content_ = nullptr;
+  /// Set if content_ is a mapping of the cache file we have to release on unmount.
+  bool content_is_mapped_ = false;
+  /// An earlier file in the archive with the same content, its cache file and content_ are used for this one.
+  _ArchiveFileJUnzip* same_as_ = nullptr;
+
+  /// The SHA-256 the archive's Manifest lists for the file, nullptr if the archive is not verified.
+  const unsigned char* sha256_ = nullptr;
+  /// Set by the first open, extract or load to check the content, any thread may do so.
+  std::atomic< int > verified_{ NotVerified };
 
   // setter using the zip file header info
   void Set(JZFileHeader* header);
@@ -51,36 +83,100 @@ class ArchiveJUnzip : public Archive
     ArchiveItem* target_ = nullptr;
     // The real file id
     uv_file real_fileId_ = 0;
+    // The current read position used when a read is passed an offset of -1
+    int64_t position_ = 0;
   } OpenFileInfo;
 
-  // Some operations like open the passed uv_fs_t request does not in fact do the opening but one of these will and
-  // we pass back all needed data of said request
-  typedef struct : public uv_fs_t
+  // An async fs_* call, Run() does the same work as the sync call but on a threadpool thread.
+  struct FsWork : public WorkItem
   {
-		ArchiveItem* target_ = nullptr;
-		uv_file real_fileId = -1;
-		uv_file fake_fileId = -1;
-    uv_fs_t* shadowing_request_ = nullptr;
-  } Shadow_uv_fs_t;
+    ArchiveJUnzip* archive_ = nullptr;
+    // Which fs_* call this is
+    uv_fs_type type_ = UV_FS_UNKNOWN;
+    // Copied in after the work, in the same block, as the caller's need not outlive the call
+    const char* path_ = nullptr;
+    uv_file real_fileId_ = -1;
+    int flags_ = 0;
+    // Copied in after the work like path_
+    uv_buf_t* bufs_ = nullptr;
+    unsigned int nbufs_ = 0;
+    int64_t offset_ = -1;
+
+    FsWork( ArchiveJUnzip* archive, uv_fs_t* request, uv_fs_type type );
+
+    /// Makes a work in one block from loop's pool with room for copies of path and bufs, either can be nullptr.
+    static FsWork* New( uv_loop_t* loop, ArchiveJUnzip* archive, uv_fs_t* request, uv_fs_type type, const char* path, const uv_buf_t bufs[] = nullptr, unsigned int nbufs = 0 );
+
+    void Run() override;
+  };
 
   using OpenFiles = std::map< uv_file, OpenFileInfo >;
 
   /// JUnzip uses fopen! fread et al.
   FILE* file_handle_ = nullptr;
   /// The JUnzip archive interface object
-  JZFile* zip_file_handle_;
+  JZFile* zip_file_handle_ = nullptr;
   /// The end record
   JZEndRecord endRecord_;
+  /// The archive file mapped into memory, nullptr if the platform or file does not allow it.
+  const char* archive_view_ = nullptr;
+  /// The size of archive_view_
+  size_t archive_view_size_ = 0;
+  /// What was mmapped, archive_view_ can start part way into it when the archive is part of a file.
+  void* archive_map_ = nullptr;
+  /// The size of archive_map_
+  size_t archive_map_size_ = 0;
+  /// Set by SetSource() to read the archive from an fd rather than archive_filepath_, -1 if not.
+  uv_file source_fd_ = -1;
+  /// Where in source_fd_ the archive starts, < 0 to find one appended to the file.
+  int64_t source_offset_ = 0;
+  /// The size of the archive in source_fd_ or source_data_, < 0 for the rest of source_fd_.
+  int64_t source_size_ = -1;
+  /// Set by SetSource() to read the archive from memory the caller owns.
+  const char* source_data_ = nullptr;
+  /// Holds the archive when it came from a pipe or a file that could not be mapped.
+  std::vector< char > source_buffer_;
+  /// The archive's file for SendfileSource(), the manager's own descriptor for it, -1 if the archive is not in a file.
+  uv_file view_fd_ = -1;
+  /// Where in view_fd_ archive_view_ starts.
+  int64_t view_fd_offset_ = 0;
   /// The root dir
   ArchiveDirJUnzip root_;
   /// real file Id to OpenFileInfo.
   OpenFiles open_files_;
+  /// Guards open_files_, MapContent() and startup_profile_ as async calls use them from the threadpool.
+  uv_mutex_t lock_;
+  /// Guards zip_file_handle_'s position, Inflate() seeks and reads it from whichever thread needs a file's content.
+  uv_mutex_t zip_file_lock_;
 	/// Should this instance extract the archive on mount.
 	bool extract_on_mount_ = false;
   /// the md5 hash of the archive file.
   std::string md5_hash_;
 	/// Flag used to indecate there was a problem extracting the archive.
 	bool is_unsafe_ = false;
+  /// Records or replays the entries opened at startup.
+  StartupProfile startup_profile_;
+  /// Identifies the archive's bytes on this host for the shared index, empty if they have no such identity (memory or a pipe).
+  std::string identity_;
+  /// Set while mounting from a shared index into an existing cache dir, its entries were all extracted so each only has its cache file's size checked.
+  bool trust_cache_ = false;
+  /// Set while reading the central directory for a mount that should share its index, AddEntry() fills in shared_entries_ and shared_names_.
+  bool build_shared_index_ = false;
+  std::vector< SharedIndex::Entry > shared_entries_;
+  std::string shared_names_;
+  /// The CRC-32 and size, and compressed size and method, of a file's content.
+  typedef std::pair< uint64_t, uint64_t > ContentKey;
+  /// The first file with each content, filled in by AddEntry() during the mount.
+  std::multimap< ContentKey, ArchiveFileJUnzip* > same_content_;
+  /// How many files AddEntry() found to have the same content as an earlier one.
+  int same_content_count_ = 0;
+  /// Set when the manager has a public key, the mount then needs a signed manifest_ and every file is checked against it.
+  bool verify_entries_ = false;
+  Manifest manifest_;
+  /// The files AddEntry() found listed in manifest_ with the right size.
+  size_t manifest_matches_ = 0;
+  /// Set by AddEntry() for a file that is not in manifest_ or has another size.
+  bool manifest_mismatch_ = false;
 
   /// Returns the root dir object of the archive
   ArchiveDir* Root() override;
@@ -88,12 +184,66 @@ class ArchiveJUnzip : public Archive
 	/// Returns the filepath to the cache file for this file
 	const std::string CacheFilePath(const ArchiveFileJUnzip* file) const;
 
+  // Opens the archive file and maps it, for when SetSource() was not called.
+  ErrorCodes OpenFile();
+
+  // Keeps a descriptor of its own for the file the archive is in, offset being where the archive starts in it.
+  void SetViewFd( uv_file fd, int64_t offset );
+
+  // Sets up archive_view_ from source_fd_, mapping the archive's part of it if possible.
+  ErrorCodes OpenFd();
+
+  // Finds the manifest and its signature in the central directory and checks the signature with the manager's public key.
+  // manifest_id is set to a hash of the manifest and the central directory, used in place of the archive's MD5.
+  bool LoadManifest( std::string& manifest_id );
+
+  // True unless the archive is verified and AddEntry() found what's listed and what's in the central directory differ.
+  bool ManifestMatches() const;
+
+  // Checks content against the file's manifest listing the first time, later calls give the same answer.
+  // Returns true for files of an archive that is not verified.
+  bool VerifyContent( ArchiveFileJUnzip* file, const char* content, size_t size );
+
+  // As VerifyContent() for an opened file, hashing content_ or else reading the cache file through real_fileId.
+  bool VerifyOpened( ArchiveFileJUnzip* file, uv_file real_fileId );
+
   // Add a new zip file to the archive
 	int AddEntry(JZFile* zip_file, int index, JZFileHeader* file_header, const char* filename );
 
+  // Used to decompress a file from the zip file into buffer.
+  bool Inflate( const ArchiveFileJUnzip* file, std::vector< char >& buffer );
+
   // Used to extract a file form the zip file and add it to the cache dir
   void Extract(ArchiveFileJUnzip* file);
 
+  // Returns were a file's bytes, compressed or not, start in archive_view_.
+  // Returns false if the archive is not mapped or the file's local header is not valid.
+  bool DataOffset(const ArchiveFileJUnzip* file, size_t& data_offset) const;
+
+  // Returns were a stored file's bytes start in archive_view_.
+  // Returns false if the file is not stored or the archive is not mapped.
+  bool StoredDataOffset(const ArchiveFileJUnzip* file, size_t& data_offset) const;
+
+  // Returns an earlier file whose bytes in the archive are the same as file's, nullptr if there is none.
+  // Files with the same CRC-32 and sizes are compared byte for byte so a CRC-32 collision is never taken for a copy.
+  ArchiveFileJUnzip* FindSameContent(ArchiveFileJUnzip* file);
+
+  // Fills in stat for a file or dir in the archive.
+  static void FillStat(const ArchiveItem* item, uv_stat_t& stat);
+
+  // Starts the startup profile, either recording it or prefetching what it lists.
+  void StartStartupProfile();
+
+  // Sets up file->content_ so reads can be served from memory.
+  // real_fileId is the opened cache file and is only used if the file is not stored in the archive.
+  void MapContent(ArchiveFileJUnzip* file, uv_file real_fileId);
+
+  // Releases any memory views made by MapContent()
+  void UnmapContent(ArchiveDir* dir);
+
+  /// Returns true if the cache file for file is there with the file's size, a stat is all a mount from a shared index can afford per entry.
+  bool CacheFileMatches( const ArchiveFileJUnzip* file );
+
 	// Used to test the cache file for this file object is valid.
   // This is called during mounting if the cache is populated
 	void Validate(ArchiveFileJUnzip* file);
@@ -101,8 +251,14 @@ class ArchiveJUnzip : public Archive
   //Called when mounting a file 
 	static int onMountEachFile(JZFile* zip_file, int archives_file_index, JZFileHeader* header, char* filepath, void* pUser);
 
-  static void fs_open_on( uv_fs_t* request );
-	static void fs_read_on( uv_fs_t* request );
+  // The work of the fs_* calls, done in the calling thread which is a threadpool one for async calls.
+  // Each sets request->result and returns it.
+  int Stat( uv_fs_t* request, const char* filepath );
+  int Fstat( uv_fs_t* request, uv_file real_fileId );
+  int Open( uv_fs_t* request, int flags, const char* filepath );
+  int Read( uv_fs_t* request, uv_file real_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset );
+  int Scandir( uv_fs_t* request, const char* path );
+
 	static void fs_close_on( uv_fs_t* request );
 
 public:
@@ -111,6 +267,14 @@ public:
 
   bool IsMounted() override;
 
+  /// Mount() reads the archive from size bytes of fd at offset rather than from archiveFilePath, which only names it.
+  /// An offset < 0 finds a zip appended to fd, e.g. one cat'ed onto the node executable, and a size < 0 reads to the end.
+  /// fd may be a pipe, it is read to the end.  fd is not used once Mount() returns.
+  void SetSource( uv_file fd, int64_t offset, int64_t size );
+
+  /// Mount() reads the archive from size bytes of data, which must stay valid until the unmount.
+  void SetSource( const char* data, size_t size );
+
   /// Does the mount.
   /// Mounting is an synchronous process so blocks the thread.
   /// \return See the error codes
@@ -118,15 +282,37 @@ public:
 
   /// Does the unmount of the archive.
   void Unmount() override;
+  void EndStartupProfile() override;
 
   /// Used to get a cache filepath from a true filepath
   std::string CacheFilePath(const std::string& full_filepath) override;
 
+  /// Code caches are named after the file's id and CRC-32 so they are never used for other content.
+  std::string CodeCacheFilePath(const std::string& full_filepath, const std::string& tag) override;
+
+  /// Loads a file's content without using the cache file.
+  bool LoadFile( const std::string& full_filepath, std::vector< char >& content ) override;
+
+  /// Gives the in memory view of an open file.
+  bool ContentView(uv_file real_fileId, const char** content, size_t* content_size) override;
+
+  bool SendfileSource(uv_file real_fileId, uv_file& fd, int64_t& in_offset, size_t& length) override;
+
   /// Use to extract a zip archive file to extract_to_path
   /// \param extract_to_path  The root dir used to extract files to.
   /// \return true if the files were all extracted.
   static bool ExtractTo( const std::string& archive_filepath, const std::string& extract_to_path );
 
+  /// Files up to this size opened at startup are stored rather than deflated by Relayout()
+  static const uint32_t RelayoutStoreBelowSize = ( 1024 * 64 );
+
+  /// Rewrites a zip archive so the entries opened at startup come first, in the order they were opened.
+  /// Startup entries up to store_below_size bytes are stored so they can be read straight out of the archive.
+  /// With store_identical_once entries whose written bytes are the same share one local record, their central directory entries all point at it.
+  /// \param startup_entries The entries as listed in a startup profile, see StartupProfile.
+  /// \return true if output_filepath was written.
+  static bool Relayout( const std::string& archive_filepath, const std::vector< std::string >& startup_entries, const std::string& output_filepath, uint32_t store_below_size = RelayoutStoreBelowSize, bool store_identical_once = false );
+
   /// libuv stuff
   //@{
   int fs_stat( uv_loop_t* loop, uv_fs_t* request, const char* filepath ) override;
@@ -135,6 +321,7 @@ public:
   int fs_read( uv_loop_t* loop, uv_fs_t* request, uv_file real_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset ) override;
   int fs_close( uv_loop_t* loop, uv_fs_t* request, uv_file real_fileId ) override;
   int fs_scandir(uv_loop_t* loop, uv_fs_t* request, const char* path, int flags) override;
+  int fs_readdir_stats(const char* path, std::vector< DirStatsItem >& items) override;
   //@}
 };
 
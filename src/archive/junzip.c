@@ -1,9 +1,17 @@
 // JUnzip library by Joonas Pihlajamaa. See junzip.h for license and details.
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 #include <zlib.h>
 
 #include "archive/junzip.h"
@@ -12,6 +20,10 @@ unsigned char jzBuffer[JZ_BUFFER_SIZE]; // limits maximum zip descriptor size
 
 // Read ZIP file end record. Will move within file.
 int jzReadEndRecord(JZFile *zip, JZEndRecord *endRecord) {
+    return jzLocateEndRecord(zip, endRecord, NULL);
+}
+
+int jzLocateEndRecord(JZFile *zip, JZEndRecord *endRecord, size_t *position) {
     size_t fileSize, readBytes, i;
     JZEndRecord *er = NULL;
 
@@ -38,13 +50,14 @@ int jzReadEndRecord(JZFile *zip, JZEndRecord *endRecord) {
     }
 
     // Naively assume signature can only be found in one place...
-    for(i = readBytes - sizeof(JZEndRecord); i >= 0; i--) {
-        er = (JZEndRecord *)(jzBuffer + i);
+    // i is unsigned so count down from one past the candidate.
+    for(i = readBytes - sizeof(JZEndRecord) + 1; i > 0; i--) {
+        er = (JZEndRecord *)(jzBuffer + i - 1);
         if(er->signature == 0x06054B50)
             break;
     }
 
-    if(i < 0) {
+    if(i == 0) {
         fprintf(stderr, "End record signature not found in zip!");
         return Z_ERRNO;
     }
@@ -57,6 +70,9 @@ int jzReadEndRecord(JZFile *zip, JZEndRecord *endRecord) {
         return Z_ERRNO;
     }
 
+    if(position != NULL)
+        *position = fileSize - readBytes + i - 1;
+
     return Z_OK;
 }
 
@@ -163,6 +179,7 @@ int jzReadLocalFileHeader(JZFile *zip, JZFileHeader *header,
 int jzReadData(JZFile *zip, JZFileHeader *header, void *buffer)
 {
     unsigned char *bytes = (unsigned char *)buffer; // cast
+    unsigned char chunk[16384]; // not jzBuffer so archives can be inflated on several threads at once
     size_t compressedLeft, uncompressedLeft;
     z_stream strm;
     int ret;
@@ -194,9 +211,9 @@ int jzReadData(JZFile *zip, JZFileHeader *header, void *buffer)
         for(compressedLeft = header->compressedSize, uncompressedLeft = header->uncompressedSize; compressedLeft && uncompressedLeft && ret != Z_STREAM_END; compressedLeft -= strm.avail_in)
 				{
             // Read next chunk
-            strm.avail_in = zip->read(zip, jzBuffer,
-                    (sizeof(jzBuffer) < compressedLeft) ?
-                    sizeof(jzBuffer) : compressedLeft);
+            strm.avail_in = zip->read(zip, chunk,
+                    (sizeof(chunk) < compressedLeft) ?
+                    sizeof(chunk) : compressedLeft);
 
             if(strm.avail_in == 0 || zip->error(zip))
 						{
@@ -204,7 +221,7 @@ int jzReadData(JZFile *zip, JZFileHeader *header, void *buffer)
                 return Z_ERRNO;
             }
 
-            strm.next_in = jzBuffer;
+            strm.next_in = chunk;
             strm.avail_out = uncompressedLeft;
             strm.next_out = bytes;
 
@@ -298,3 +315,190 @@ jzfile_from_stdio_file(FILE *fp)
 
     return &(handle->handle);
 }
+
+
+typedef struct {
+    JZFile handle;
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+} MemoryJZFile;
+
+// Where a seek on a file of size bytes at position lands, size + 1 if it's
+// outside the file. offset is unsigned so a negative one has wrapped.
+static size_t
+seek_target(size_t position, size_t size, size_t offset, int whence)
+{
+    size_t from = 0;
+
+    if(whence == SEEK_CUR)
+        from = position;
+    else if(whence == SEEK_END)
+        from = size;
+
+    from += offset;
+
+    return (from <= size) ? from : size + 1;
+}
+
+static size_t
+memory_file_handle_read(JZFile *file, void *buf, size_t size)
+{
+    MemoryJZFile *handle = (MemoryJZFile *)file;
+    size_t left = handle->size - handle->position;
+
+    if(size > left)
+        size = left;
+
+    memcpy(buf, handle->data + handle->position, size);
+    handle->position += size;
+
+    return size;
+}
+
+static size_t
+memory_file_handle_tell(JZFile *file)
+{
+    MemoryJZFile *handle = (MemoryJZFile *)file;
+    return handle->position;
+}
+
+static int
+memory_file_handle_seek(JZFile *file, size_t offset, int whence)
+{
+    MemoryJZFile *handle = (MemoryJZFile *)file;
+    size_t target = seek_target(handle->position, handle->size, offset, whence);
+
+    if(target > handle->size)
+        return -1;
+
+    handle->position = target;
+    return 0;
+}
+
+static int
+memory_file_handle_error(JZFile *file)
+{
+    return 0;
+}
+
+static void
+memory_file_handle_close(JZFile *file)
+{
+    free(file);
+}
+
+JZFile *
+jzfile_from_memory(const void *data, size_t size)
+{
+    MemoryJZFile *handle = (MemoryJZFile *)malloc(sizeof(MemoryJZFile));
+
+    handle->handle.read = memory_file_handle_read;
+    handle->handle.tell = memory_file_handle_tell;
+    handle->handle.seek = memory_file_handle_seek;
+    handle->handle.error = memory_file_handle_error;
+    handle->handle.close = memory_file_handle_close;
+    handle->data = (const unsigned char *)data;
+    handle->size = size;
+    handle->position = 0;
+
+    return &(handle->handle);
+}
+
+
+typedef struct {
+    JZFile handle;
+    int fd;
+    size_t base;
+    size_t size;
+    size_t position;
+    int error;
+} FdJZFile;
+
+static size_t
+fd_file_handle_read(JZFile *file, void *buf, size_t size)
+{
+    FdJZFile *handle = (FdJZFile *)file;
+    size_t left = handle->size - handle->position;
+    size_t done = 0;
+
+    if(size > left)
+        size = left;
+
+    while(done < size) {
+#if defined(_WIN32)
+        int chunk = (size - done > INT_MAX) ? INT_MAX : (int)(size - done);
+        int got = -1;
+
+        if(_lseeki64(handle->fd, (__int64)(handle->base + handle->position), SEEK_SET) >= 0)
+            got = _read(handle->fd, (char *)buf + done, chunk);
+#else
+        ssize_t got = pread(handle->fd, (char *)buf + done, size - done,
+                (off_t)(handle->base + handle->position));
+
+        if(got < 0 && errno == EINTR)
+            continue;
+#endif
+        if(got <= 0) {
+            handle->error = (got < 0);
+            break;
+        }
+
+        done += (size_t)got;
+        handle->position += (size_t)got;
+    }
+
+    return done;
+}
+
+static size_t
+fd_file_handle_tell(JZFile *file)
+{
+    FdJZFile *handle = (FdJZFile *)file;
+    return handle->position;
+}
+
+static int
+fd_file_handle_seek(JZFile *file, size_t offset, int whence)
+{
+    FdJZFile *handle = (FdJZFile *)file;
+    size_t target = seek_target(handle->position, handle->size, offset, whence);
+
+    if(target > handle->size)
+        return -1;
+
+    handle->position = target;
+    return 0;
+}
+
+static int
+fd_file_handle_error(JZFile *file)
+{
+    FdJZFile *handle = (FdJZFile *)file;
+    return handle->error;
+}
+
+static void
+fd_file_handle_close(JZFile *file)
+{
+    free(file);
+}
+
+JZFile *
+jzfile_from_fd(int fd, size_t base, size_t size)
+{
+    FdJZFile *handle = (FdJZFile *)malloc(sizeof(FdJZFile));
+
+    handle->handle.read = fd_file_handle_read;
+    handle->handle.tell = fd_file_handle_tell;
+    handle->handle.seek = fd_file_handle_seek;
+    handle->handle.error = fd_file_handle_error;
+    handle->handle.close = fd_file_handle_close;
+    handle->fd = fd;
+    handle->base = base;
+    handle->size = size;
+    handle->position = 0;
+    handle->error = 0;
+
+    return &(handle->handle);
+}
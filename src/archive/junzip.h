@@ -29,6 +29,15 @@ struct JZFile {
 JZFile *
 jzfile_from_stdio_file(FILE *fp);
 
+// size bytes of memory from data, which must outlive the JZFile.
+JZFile *
+jzfile_from_memory(const void *data, size_t size);
+
+// size bytes of fd from base, offsets are relative to base so a zip can be
+// read from the middle of a file. fd is read with pread and is not closed.
+JZFile *
+jzfile_from_fd(int fd, size_t base, size_t size);
+
 /// RHC - Removed typedef struct __attribute__ ((__packed__)) { from all the struct as it's a GCC only thing
 /// so switched to using pragma pack'ed
 
@@ -102,6 +111,10 @@ typedef int (*JZRecordCallback)(JZFile *zip, int index, JZFileHeader *header,
 // Read ZIP file end record. Will move within file.
 int jzReadEndRecord(JZFile *zip, JZEndRecord *endRecord);
 
+// As jzReadEndRecord() but also gives where the end record starts, used to
+// find a zip that has been appended to another file.
+int jzLocateEndRecord(JZFile *zip, JZEndRecord *endRecord, size_t *position);
+
 // Read ZIP file global directory. Will move within file.
 // Callback is called for each record, until callback returns zero
 int jzReadCentralDirectory(JZFile *zip, JZEndRecord *endRecord,
@@ -1,8 +1,26 @@
 #include "archive/manager.h"
 #include "archive/archive_junzip.h"
+#include "archive/trace.h"
+#include "archive/walk.h"
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <cstdarg>
+#include <cstdlib>
+#include <limits>
+
+#include <fcntl.h>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace archive
 {
@@ -26,13 +44,41 @@ static const char* flatten_path(const char* in)
 /// The global manager object.
 static Manager* gManager_ = nullptr;
 
+/// The id passed to every archive that is mounted.
+static int gArchiveIdCounter = 1;
+
 Manager::Manager()
 {
+  uv_mutex_init(&library_images_lock_);
+  uv_rwlock_init(&pools_lock_);
   gManager_ = this;
 }
 
 Manager::~Manager()
 {
+  // node's Manager lives in Start() and is destroyed once V8::Dispose() has run, so no isolate is left holding an external string over an archive's
+  // memory (see ArchiveSourceResource in node_file.cc) and the loop has run dry, so no threadpool work is looking at an archive either.
+  // An exit() never gets here, the archives then stay mapped until the process is gone.
+  Release();
+
+#if defined(__linux__)
+  for( std::map< std::string, int >::iterator image=library_images_.begin(); image!=library_images_.end(); ++image )
+  {
+    ::close( image->second );
+  }
+#endif
+  library_images_.clear();
+  uv_mutex_destroy( &library_images_lock_ );
+
+  for(std::map< uv_loop_t*, RequestPool* >::iterator pool=pools_.begin(); pool!=pools_.end(); ++pool)
+  {
+    delete pool->second;
+  }
+  pools_.clear();
+  uv_rwlock_destroy(&pools_lock_);
+
+  Manifest::FreePublicKey(public_key_);
+  public_key_ = nullptr;
 
   if(report_wrappered_calls_!=nullptr && report_wrappered_calls_!=stdout)
   {
@@ -46,8 +92,12 @@ Manager::~Manager()
 bool Manager::Init(uv_loop_t* loop, int argc, char** argv )
 {
   bool use_archive = false;
+  bool use_self = false;
   std::string archive_path;
   std::string archive_mount;
+  std::string upper_dir;
+  std::string public_key_path;
+  std::string trace_categories;
 
   for(int i=0; i<argc; ++i)
   {
@@ -63,6 +113,48 @@ bool Manager::Init(uv_loop_t* loop, int argc, char** argv )
       use_archive = true;
       archive_mount = argv[i+1];
     }
+    else if(std::strcmp(item, "--archive.nocodecache") == 0)
+    {
+      use_code_cache_ = false;
+    }
+    else if(std::strcmp(item, "--archive.self") == 0)
+    {
+      use_archive = true;
+      use_self = true;
+    }
+    else if(std::strcmp(item, "--archive.relayout") == 0)
+    {
+      relayout_filepath_ = argv[i+1];
+    }
+    else if(std::strcmp(item, "--archive.dedup") == 0)
+    {
+      relayout_dedup_ = true;
+    }
+    else if(std::strcmp(item, "--archive.upper") == 0)
+    {
+      upper_dir = argv[i+1];
+    }
+    else if(std::strcmp(item, "--archive.noprefetch") == 0)
+    {
+      use_startup_profile_ = false;
+    }
+    else if(std::strcmp(item, "--archive.noshareindex") == 0)
+    {
+      use_shared_index_ = false;
+    }
+    else if(std::strcmp(item, "--archive.publickey") == 0)
+    {
+      public_key_path = argv[i+1];
+    }
+    else if(std::strcmp(item, "--trace-events-enabled") == 0 && trace_categories.length() == 0)
+    {
+      // node's default categories.
+      trace_categories = "v8,node,node.async_hooks";
+    }
+    else if(std::strcmp(item, "--trace-event-categories") == 0 && i + 1 < argc)
+    {
+      trace_categories = argv[i+1];
+    }
     else if(std::strcmp(item, "--archive.trace") == 0)
     {
       report_wrappered_calls_ = stdout;
@@ -76,17 +168,64 @@ bool Manager::Init(uv_loop_t* loop, int argc, char** argv )
       }
     }
   }
-  
+
+  // decided before mounting so nothing is kept for tracing that won't happen.
+  Trace::SetCategories(trace_categories);
+
+  // a recording is only put in place when it ends, an exit() skips ~Manager().
+  if(use_startup_profile_)
+  {
+    static bool end_at_exit = false;
+    if(end_at_exit == false)
+    {
+      end_at_exit = true;
+      std::atexit([] ()
+      {
+        if(Get() != nullptr)
+        {
+          Get()->EndStartupProfiles();
+        }
+      });
+    }
+  }
+
   Bind(loop);
 
+  if(public_key_path.length() != 0 && SetPublicKey(public_key_path) == false)
+  {
+    std::fprintf(stderr, "--archive.publickey failed to read a PEM public key from %s\n", public_key_path.c_str());
+    return false;
+  }
+
   if(use_archive)
   {
+    if(use_self)
+    {
+      char exe_path[ 4096 ];
+      size_t exe_path_size = sizeof( exe_path );
+
+      if(uv_exepath(exe_path, &exe_path_size) != 0)
+      {
+        std::fprintf(stderr, "--archive.self failed to find the node executable\n");
+        return false;
+      }
+
+      archive_path = exe_path;
+    }
+
     if(archive_path.length() == 0)
     {
-      std::fprintf(stderr, "You need to pass an archive using --archive.path\n");
+      std::fprintf(stderr, "You need to pass an archive using --archive.path or --archive.self\n");
       return false;
     }
 
+    // --archive.relayout only wants the archive's cache dir, node exits before anything is loaded from the mount.
+    if(archive_mount.length() == 0 && relayout_filepath_.length() != 0)
+    {
+      archive_mount = archive_path;
+      use_startup_profile_ = false;
+    }
+
     if(archive_mount.length() == 0)
     {
       std::fprintf(stderr, "You need to pass a mount point using --archive.mount\n");
@@ -95,15 +234,84 @@ bool Manager::Init(uv_loop_t* loop, int argc, char** argv )
 
     Report("Mounting archive:%s to mount:%s\n", archive_path.c_str(), archive_mount.c_str());
 
-    if(Mount(archive_path, archive_mount)==false)
+    bool mounted = false;
+
+    if(use_self)
+    {
+      // The zip is appended to the executable so only its part of the file is used.
+      uv_fs_t request;
+      uv_file fd = ::uv_fs_open(loop_, &request, archive_path.c_str(), O_RDONLY, 0, nullptr);
+      ::uv_fs_req_cleanup(&request);
+
+      if(fd >= 0)
+      {
+        mounted = MountFd(fd, -1, -1, archive_path, archive_mount);
+
+        ::uv_fs_close(loop_, &request, fd, nullptr);
+        ::uv_fs_req_cleanup(&request);
+      }
+    }
+    else if(archive_path == "-")
+    {
+      mounted = MountFd(0, -1, -1, archive_path, archive_mount);
+    }
+    else
+    {
+      mounted = Mount(archive_path, archive_mount);
+    }
+
+    if(mounted==false)
     {
       std::fprintf(stderr, "Failed to mount archive:%s to mount:%s\n", archive_path.c_str(), archive_mount.c_str());
       return false;
     }
   }
+
+  if(upper_dir.length() != 0)
+  {
+    int er = SetUpperDir(upper_dir);
+    if(er < 0)
+    {
+      std::fprintf(stderr, "Failed to use %s as the archive upper dir: %s\n", upper_dir.c_str(), uv_strerror(er));
+      return false;
+    }
+  }
   return true;
 }
 
+int Manager::RunTools()
+{
+  if(relayout_filepath_.length() == 0)
+  {
+    return -1;
+  }
+
+  if(archives_.size() == 0)
+  {
+    std::fprintf(stderr, "--archive.relayout needs an archive passed using --archive.path\n");
+    return 1;
+  }
+
+  // The layout comes from the startup profile recorded by an earlier run.
+  Archive* target_archive = archives_.front();
+  std::vector< std::string > startup_entries;
+
+  if(StartupProfile::Load(StartupProfile::ProfileFilePath(target_archive->CachePath()), startup_entries) == false)
+  {
+    std::fprintf(stderr, "No startup profile for archive:%s, run the app once from the archive first\n", target_archive->ArchiveFilePath().c_str());
+    return 1;
+  }
+
+  if(ArchiveJUnzip::Relayout(target_archive->ArchiveFilePath(), startup_entries, relayout_filepath_, ArchiveJUnzip::RelayoutStoreBelowSize, relayout_dedup_) == false)
+  {
+    std::fprintf(stderr, "Failed to relayout archive:%s to:%s\n", target_archive->ArchiveFilePath().c_str(), relayout_filepath_.c_str());
+    return 1;
+  }
+
+  std::fprintf(stdout, "Relaid out archive:%s to:%s with %d startup entries first\n", target_archive->ArchiveFilePath().c_str(), relayout_filepath_.c_str(), static_cast< int >( startup_entries.size() ));
+  return 0;
+}
+
 bool Manager::BuildCacheDir( const std::string& path )
 {
   if( cachesRoot_.length() == 0 && path.length() == 0 )
@@ -155,6 +363,14 @@ Manager* Manager::Get()
   return gManager_;
 }
 
+void Manager::EndStartupProfiles()
+{
+  for( Archives::iterator currentArchive=archives_.begin(); currentArchive!=archives_.end(); ++currentArchive )
+  {
+    ( *currentArchive )->EndStartupProfile();
+  }
+}
+
 void Manager::Release()
 {
   for( Archives::iterator currentArchive=archives_.begin(); currentArchive!=archives_.end(); ++currentArchive )
@@ -220,18 +436,112 @@ const std::string& Manager::CacheRoot() const
   return cachesRoot_; 
 }
 
-bool Manager::Mount( const std::string& archive_filepath, const std::string& mount_point )
+bool Manager::UseStartupProfile() const
+{
+  return use_startup_profile_;
+}
+
+void Manager::SetUseStartupProfile( bool use_startup_profile )
 {
-  static int archive_id_counter = 1;
+  use_startup_profile_ = use_startup_profile;
+}
 
-  // we call BuildCacheDir() just in case it was not called before.
-  if( BuildCacheDir() == false )
+bool Manager::UseSharedIndex() const
+{
+  return use_shared_index_;
+}
+
+void Manager::SetUseSharedIndex( bool use_shared_index )
+{
+  use_shared_index_ = use_shared_index;
+}
+
+bool Manager::SetPublicKey( const std::string& pem_filepath )
+{
+  EVP_PKEY* key = Manifest::LoadPublicKey( pem_filepath );
+  if( key == nullptr )
   {
     return false;
   }
 
-  ArchiveJUnzip* created_archive = new ArchiveJUnzip( this, archive_id_counter, mount_point, archive_filepath );
+  Manifest::FreePublicKey( public_key_ );
+  public_key_ = key;
+
+  return true;
+}
+
+EVP_PKEY* Manager::PublicKey() const
+{
+  return public_key_;
+}
+
+int Manager::SetUpperDir( const std::string& upper_dir )
+{
+  Report("Using upper dir:%s\n", upper_dir.c_str());
+
+  return overlay_.SetUpperDir( upper_dir );
+}
+
+bool Manager::HasUpperDir() const
+{
+  return overlay_.IsEnabled();
+}
+
+RequestPool* Manager::Pool( uv_loop_t* loop )
+{
+  RequestPool* pool = nullptr;
+
+  uv_rwlock_rdlock( &pools_lock_ );
+  std::map< uv_loop_t*, RequestPool* >::iterator found = pools_.find( loop );
+  if( found != pools_.end() )
+  {
+    pool = found->second;
+  }
+  uv_rwlock_rdunlock( &pools_lock_ );
+
+  if( pool == nullptr )
+  {
+    // only loop's thread makes its pool so no one else can have added it since.
+    pool = new RequestPool();
+
+    uv_rwlock_wrlock( &pools_lock_ );
+    pools_.insert( std::pair< uv_loop_t*, RequestPool* >( loop, pool ) );
+    uv_rwlock_wrunlock( &pools_lock_ );
+  }
+
+  return pool;
+}
+
+void Manager::TakePoolStats( PoolStats& stats ) const
+{
+  stats = PoolStats();
+
+  uv_rwlock_rdlock( &pools_lock_ );
+  for( std::map< uv_loop_t*, RequestPool* >::const_iterator pool=pools_.begin(); pool!=pools_.end(); ++pool )
+  {
+    pool->second->Take( stats.pools_ );
+  }
+  uv_rwlock_rdunlock( &pools_lock_ );
+
+  TakeQueueCounts( stats.schedule_queues_ );
+}
+
+void Manager::TakeMetrics( std::vector< MountMetrics >& metrics ) const
+{
+  metrics.clear();
+  metrics.resize( archives_.size() );
+
+  for( size_t i=0; i<archives_.size(); ++i )
+  {
+    metrics[ i ].mount_point_ = archives_[ i ]->MountPoint();
+    metrics[ i ].archive_filepath_ = archives_[ i ]->ArchiveFilePath();
+
+    archives_[ i ]->GetMetrics().Take( metrics[ i ].snapshot_ );
+  }
+}
 
+bool Manager::MountArchive( ArchiveJUnzip* created_archive )
+{
   ErrorCodes er = created_archive->Mount();
   if( er != ErrorCodes::NoError )
   {
@@ -244,6 +554,43 @@ bool Manager::Mount( const std::string& archive_filepath, const std::string& mou
   return true;
 }
 
+bool Manager::Mount( const std::string& archive_filepath, const std::string& mount_point )
+{
+  // we call BuildCacheDir() just in case it was not called before.
+  if( BuildCacheDir() == false )
+  {
+    return false;
+  }
+
+  return MountArchive( new ArchiveJUnzip( this, gArchiveIdCounter, mount_point, archive_filepath ) );
+}
+
+bool Manager::MountFd( uv_file fd, int64_t offset, int64_t size, const std::string& name, const std::string& mount_point )
+{
+  if( BuildCacheDir() == false )
+  {
+    return false;
+  }
+
+  ArchiveJUnzip* created_archive = new ArchiveJUnzip( this, gArchiveIdCounter, mount_point, name );
+  created_archive->SetSource( fd, offset, size );
+
+  return MountArchive( created_archive );
+}
+
+bool Manager::MountMemory( const char* data, size_t size, const std::string& name, const std::string& mount_point )
+{
+  if( BuildCacheDir() == false )
+  {
+    return false;
+  }
+
+  ArchiveJUnzip* created_archive = new ArchiveJUnzip( this, gArchiveIdCounter, mount_point, name );
+  created_archive->SetSource( data, size );
+
+  return MountArchive( created_archive );
+}
+
 Archive* Manager::Find(const std::string& filepath)
 {
   Archive* pTarget = nullptr;
@@ -279,91 +626,376 @@ Archive* Manager::Find(const std::string& filepath)
   return pTarget;
 }
 
-std::string Manager::GetTrueFileName(const std::string& full_filepath)
+bool Manager::InArchive(const std::string& filepath)
 {
-  Archive* found_archive=Find(full_filepath);
-  if(found_archive==nullptr)
-  {
-    return full_filepath;
-  }
-
-  return found_archive->CacheFilePath(full_filepath);
+  return Find( filepath ) != nullptr;
 }
 
-void Manager::Sheath( uv_fs_t* request, uv_fs_cb cb, uv_file fake, Archive* pArchive )
+Archive* Manager::FindLayered(const char*& path, std::string& upper_path)
 {
-  RequestSheath* new_sheath = new RequestSheath();
+  Archive* target_archive = Find(path);
 
-  new_sheath->owner_ = this;
-  new_sheath->fake_ = fake;
-  new_sheath->pUserData_ = request->data;
-  new_sheath->cb_ = cb;
-  new_sheath->pArchive_ = pArchive;
+  if(target_archive != nullptr && overlay_.Find(target_archive, path, upper_path))
+  {
+    path = upper_path.c_str();
+    return nullptr;
+  }
 
-  request->data = new_sheath;
+  return target_archive;
 }
 
-void Manager::Unsheath( uv_fs_t* request )
+Archive* Manager::RealPath(const char* path, std::string& real_path, int& result)
 {
-  RequestSheath* sheath = reinterpret_cast< RequestSheath* >( request->data );
+  std::string upper_path;
+  Archive* target_archive = FindLayered(path, upper_path);
 
-  request->data = sheath->pUserData_;
+  if(target_archive != nullptr)
+  {
+    result = target_archive->RealPath(path, real_path);
+  }
 
-  delete sheath;
+  return target_archive;
 }
 
-Manager* Manager::Unsheath( uv_fs_t* request, uv_fs_cb* pCb, uv_file& fake, Archive** ppArchive )
+int Manager::fs_done( uv_loop_t* loop, uv_fs_t* req, uv_fs_type type, int result, uv_fs_cb cb )
 {
-  RequestSheath* sheath = reinterpret_cast< RequestSheath* >( request->data );
-  Manager* pManager = sheath->owner_;
-  fake = sheath->fake_;
+  fs_req_init( loop, req, type, cb );
+  req->result = result;
 
-  *pCb = sheath->cb_;
+  if( cb == nullptr )
+  {
+    return result;
+  }
 
-  request->data = sheath->pUserData_;
+  Schedule( loop, req );
+  return 0;
+}
 
-  if( ppArchive != nullptr )
+std::string Manager::GetTrueFileName(const std::string& full_filepath)
+{
+  Archive* found_archive=Find(full_filepath);
+  if(found_archive==nullptr)
   {
-    *ppArchive = sheath->pArchive_;
+    return full_filepath;
   }
- 
-  delete sheath;
 
-  return pManager;
+  return found_archive->CacheFilePath(full_filepath);
 }
 
-void Manager::fs_req_init( uv_loop_t* loop, uv_fs_t* request, uv_fs_type subType, const uv_fs_cb cb )
+#if defined(__linux__) && defined(__NR_memfd_create)
+static int MakeLibraryImage( const std::string& name, const std::vector< char >& content )
 {
-	// This is lifted from the platform version of libuv's fc.c file.  
-	// under unix fs.c look for #define INIT() and then PATH() micros.
-
-	#if defined(_WIN32)
-  request->u.io.overlapped.Internal = 0;
-  #endif
-  
-	request->fs_type =  subType;
-  request->result = 0;
-  request->ptr = NULL;
-  request->loop = loop;
-  request->path = NULL;
-  request->flags = 0;
+  // MFD_CLOEXEC, glibc may be too old to have memfd_create() so go direct.
+  int fd = static_cast< int >( ::syscall( __NR_memfd_create, name.c_str(), 0x0001U ) );
+  if( fd < 0 )
+  {
+    return -1;
+  }
 
-  #if defined(_WIN32)
+  const char* data = content.data();
+  size_t left = content.size();
 
-	request->fs.info.bufs = request->fs.info.bufsml;
+  while( left != 0 )
+  {
+    ssize_t written = ::write( fd, data, left );
+    if( written <= 0 )
+    {
+      ::close( fd );
+      return -1;
+    }
 
-  #else
-  request->new_path = NULL;
-  request->bufs = request->bufsml;
-  #endif
+    data += written;
+    left -= static_cast< size_t >( written );
+  }
 
-  request->cb = cb; 
+  return fd;
 }
+#endif
 
-int Manager::fs_capture_path( uv_fs_t* req, const char* path, const char* new_path, bool copy_path )
+std::string Manager::GetLibraryFileName( const std::string& full_filepath )
 {
-#if defined( _WIN32 )
-  // Lifted from  fs__capture_path() in the windows code
+  Archive* found_archive = Find( full_filepath );
+  if( found_archive == nullptr )
+  {
+    return full_filepath;
+  }
+
+#if defined(__linux__) && defined(__NR_memfd_create)
+  int image_fd = -1;
+
+  // held while the image is made so two threads loading the same library share one.
+  uv_mutex_lock( &library_images_lock_ );
+
+  std::map< std::string, int >::iterator known_image = library_images_.find( full_filepath );
+  if( known_image != library_images_.end() )
+  {
+    image_fd = known_image->second;
+  }
+  else
+  {
+    std::vector< char > content;
+
+    if( found_archive->LoadFile( full_filepath, content ) )
+    {
+      size_t name_start = full_filepath.find_last_of( '/' );
+      image_fd = MakeLibraryImage( full_filepath.substr( name_start == std::string::npos ? 0 : name_start + 1 ), content );
+    }
+
+    if( image_fd >= 0 )
+    {
+      // kept open so loading the same library again gives dlopen the same file.
+      library_images_.insert( std::pair< std::string, int >( full_filepath, image_fd ) );
+    }
+  }
+
+  uv_mutex_unlock( &library_images_lock_ );
+
+  if( image_fd >= 0 )
+  {
+    Report( "Library:%s loaded from memfd:%d\n", full_filepath.c_str(), image_fd );
+    return std::string( "/proc/self/fd/" ) + std::to_string( image_fd );
+  }
+#endif
+
+  // fall back to the cache file.
+  return found_archive->CacheFilePath( full_filepath );
+}
+
+bool Manager::ContentView( uv_file fake_fileId, const char** content, size_t* content_size )
+{
+  Mappings::RealSource source;
+
+  if( knownFiles_.Get( fake_fileId, source ) == false || source.second == nullptr )
+  {
+    return false;
+  }
+
+  return source.second->ContentView( source.first, content, content_size );
+}
+
+// Reads a whole real file into content, content is left empty if it can't be read.
+static bool ReadRealFile(uv_loop_t* loop, const std::string& filepath, std::vector< char >& content)
+{
+  uv_fs_t request;
+  uv_file fd = ::uv_fs_open(loop, &request, filepath.c_str(), O_RDONLY, 0, nullptr);
+  ::uv_fs_req_cleanup(&request);
+
+  if(fd < 0)
+  {
+    return false;
+  }
+
+  int error_code = ::uv_fs_fstat(loop, &request, fd, nullptr);
+  const size_t size = static_cast< size_t >(request.statbuf.st_size);
+  ::uv_fs_req_cleanup(&request);
+
+  size_t done = 0;
+
+  if(error_code == 0)
+  {
+    content.resize(size);
+
+    while(done < size)
+    {
+      uv_buf_t buffer = ::uv_buf_init(content.data() + done, static_cast< unsigned int >(size - done));
+      int read = ::uv_fs_read(loop, &request, fd, &buffer, 1, static_cast< int64_t >(done), nullptr);
+      ::uv_fs_req_cleanup(&request);
+
+      if(read <= 0)
+      {
+        break;
+      }
+
+      done += static_cast< size_t >(read);
+    }
+  }
+
+  ::uv_fs_close(loop, &request, fd, nullptr);
+  ::uv_fs_req_cleanup(&request);
+
+  if(error_code != 0 || size == 0 || done != size)
+  {
+    content.clear();
+    return false;
+  }
+
+  return true;
+}
+
+bool Manager::ReadCodeCache(const std::string& full_filepath, const std::string& tag, std::vector< char >& content)
+{
+  content.clear();
+
+  if(use_code_cache_ == false)
+  {
+    return false;
+  }
+
+  // a module that has been copied up to the upper dir is not the archive's.
+  const char* path = full_filepath.c_str();
+  std::string upper_path;
+  Archive* found_archive = FindLayered(path, upper_path);
+  if(found_archive == nullptr)
+  {
+    return false;
+  }
+
+  const std::string cache_filepath = found_archive->CodeCacheFilePath(full_filepath, tag);
+  if(cache_filepath.length() == 0)
+  {
+    return false;
+  }
+
+  if(ReadRealFile(loop_, cache_filepath, content) == false && found_archive->LoadFile(full_filepath + ".v8cache", content) == false)
+  {
+    content.clear();
+  }
+
+  Report("Code cache for:%s is %d bytes\n", full_filepath.c_str(), static_cast< int >(content.size()));
+  return true;
+}
+
+bool Manager::WriteCodeCache(const std::string& full_filepath, const std::string& tag, const char* data, size_t size)
+{
+  if(use_code_cache_ == false || size == 0)
+  {
+    return false;
+  }
+
+  const char* path = full_filepath.c_str();
+  std::string upper_path;
+  Archive* found_archive = FindLayered(path, upper_path);
+  if(found_archive == nullptr)
+  {
+    return false;
+  }
+
+  const std::string cache_filepath = found_archive->CodeCacheFilePath(full_filepath, tag);
+  if(cache_filepath.length() == 0)
+  {
+    return false;
+  }
+
+  // written under a name of its own then renamed so no one reads half a cache.
+  const std::string temp_filepath = cache_filepath + "." + std::to_string(uv_os_getpid()) + ".tmp";
+
+  uv_fs_t request;
+  uv_file fd = ::uv_fs_open(loop_, &request, temp_filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644, nullptr);
+  ::uv_fs_req_cleanup(&request);
+
+  if(fd < 0)
+  {
+    return false;
+  }
+
+  size_t done = 0;
+
+  while(done < size)
+  {
+    uv_buf_t buffer = ::uv_buf_init(const_cast< char* >(data + done), static_cast< unsigned int >(size - done));
+    int written = ::uv_fs_write(loop_, &request, fd, &buffer, 1, static_cast< int64_t >(done), nullptr);
+    ::uv_fs_req_cleanup(&request);
+
+    if(written <= 0)
+    {
+      break;
+    }
+
+    done += static_cast< size_t >(written);
+  }
+
+  ::uv_fs_close(loop_, &request, fd, nullptr);
+  ::uv_fs_req_cleanup(&request);
+
+  if(done == size && ::uv_fs_rename(loop_, &request, temp_filepath.c_str(), cache_filepath.c_str(), nullptr) == 0)
+  {
+    ::uv_fs_req_cleanup(&request);
+
+    Report("Code cache for:%s written, %d bytes\n", full_filepath.c_str(), static_cast< int >(size));
+    return true;
+  }
+
+  ::uv_fs_req_cleanup(&request);
+  ::uv_fs_unlink(loop_, &request, temp_filepath.c_str(), nullptr);
+  ::uv_fs_req_cleanup(&request);
+
+  return false;
+}
+
+void Manager::Sheath( uv_loop_t* loop, uv_fs_t* request, uv_fs_cb cb, uv_file fake, Archive* pArchive )
+{
+  RequestSheath* new_sheath = Pool( loop )->New< RequestSheath >();
+
+  new_sheath->owner_ = this;
+  new_sheath->fake_ = fake;
+  new_sheath->pUserData_ = request->data;
+  new_sheath->cb_ = cb;
+  new_sheath->pArchive_ = pArchive;
+
+  request->data = new_sheath;
+}
+
+void Manager::Unsheath( uv_fs_t* request )
+{
+  RequestSheath* sheath = reinterpret_cast< RequestSheath* >( request->data );
+
+  request->data = sheath->pUserData_;
+
+  RequestPool::Delete( sheath );
+}
+
+Manager* Manager::Unsheath( uv_fs_t* request, uv_fs_cb* pCb, uv_file& fake, Archive** ppArchive )
+{
+  RequestSheath* sheath = reinterpret_cast< RequestSheath* >( request->data );
+  Manager* pManager = sheath->owner_;
+  fake = sheath->fake_;
+
+  *pCb = sheath->cb_;
+
+  request->data = sheath->pUserData_;
+
+  if( ppArchive != nullptr )
+  {
+    *ppArchive = sheath->pArchive_;
+  }
+ 
+  RequestPool::Delete( sheath );
+
+  return pManager;
+}
+
+void Manager::fs_req_init( uv_loop_t* loop, uv_fs_t* request, uv_fs_type subType, const uv_fs_cb cb )
+{
+	// This is lifted from the platform version of libuv's fc.c file.  
+	// under unix fs.c look for #define INIT() and then PATH() micros.
+
+	#if defined(_WIN32)
+  request->u.io.overlapped.Internal = 0;
+  #endif
+  
+	request->fs_type =  subType;
+  request->result = 0;
+  request->ptr = NULL;
+  request->loop = loop;
+  request->path = NULL;
+  request->flags = 0;
+
+  #if defined(_WIN32)
+
+	request->fs.info.bufs = request->fs.info.bufsml;
+
+  #else
+  request->new_path = NULL;
+  request->bufs = request->bufsml;
+  #endif
+
+  request->cb = cb; 
+}
+
+int Manager::fs_capture_path( uv_fs_t* req, const char* path, const char* new_path, bool copy_path )
+{
+#if defined( _WIN32 )
+  // Lifted from  fs__capture_path() in the windows code
   char* buf;
   char* pos;
   ssize_t buf_sz = 0, path_len = 0, pathw_len = 0, new_pathw_len = 0;
@@ -513,6 +1145,27 @@ int Manager::fs_capture_path( uv_fs_t* req, const char* path, const char* new_pa
 
 void Manager::fs_req_cleanup( uv_fs_t* request )
 {
+  if( request != nullptr && request->fs_type == UV_FS_SCANDIR && ( request->flags & EXT_ARCHIVE_DIR_STATS ) )
+  {
+    delete static_cast< DirStats* >( request->ptr );
+    request->flags &= ~EXT_ARCHIVE_DIR_STATS;
+    request->ptr = nullptr;
+  }
+
+  if( request != nullptr && request->fs_type == UV_FS_SCANDIR && ( request->flags & EXT_ARCHIVE_WALK ) )
+  {
+    delete static_cast< WalkEntries* >( request->ptr );
+    request->flags &= ~EXT_ARCHIVE_WALK;
+    request->ptr = nullptr;
+  }
+
+  if( request != nullptr && request->fs_type == UV_FS_SCANDIR && ( request->flags & EXT_ARCHIVE_LISTING ) )
+  {
+    // the listing is owned by the archive.
+    request->flags &= ~EXT_ARCHIVE_LISTING;
+    request->ptr = nullptr;
+  }
+
   ::uv_fs_req_cleanup( request );
 }
 
@@ -534,6 +1187,8 @@ void Manager::fs_fstat_on(uv_fs_t* req)
 
 int Manager::fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_fstat" );
+
   int r = 0;
   Mappings::RealSource source;
 
@@ -559,7 +1214,7 @@ int Manager::fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_
     }
     else
     {
-      Sheath( req, cb, fake_fileId, nullptr );
+      Sheath( loop, req, cb, fake_fileId, nullptr );
       Schedule( loop, req );
     }
   }
@@ -573,7 +1228,7 @@ int Manager::fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_
     if( cb != nullptr )
     {
       // if onStatCb is null we don't sheath the request.
-      Sheath( req, cb, fake_fileId, target );
+      Sheath( loop, req, cb, fake_fileId, target );
       req->cb = &Manager::fs_fstat_on;
     }
 
@@ -585,7 +1240,7 @@ int Manager::fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_
     // pass through
     if(cb != nullptr)
     {
-      Sheath(req, cb, fake_fileId, nullptr);
+      Sheath(loop, req, cb, fake_fileId, nullptr);
       r = ::uv_fs_fstat( loop, req, source.first, &Manager::fs_fstat_on);
     }
     else
@@ -616,6 +1271,8 @@ void Manager::fs_stat_on( uv_fs_t* req )
 
 int Manager::fs_stat( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb )
 {
+  TraceScope trace( "archive.fs_stat", path );
+
   int r = 0;
 
   if(Get()->report_wrappered_calls_)
@@ -623,17 +1280,18 @@ int Manager::fs_stat( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb
     std::fprintf(stdout, "@@ fs_stat loop:%p req:%p path:%s callback:%p\n", loop, req, path, cb);
   }
 
-  Archive* pTarget = Find( path );
+  std::string upper_path;
+  Archive* pTarget = FindLayered( path, upper_path );
   if( pTarget == nullptr )
   {
-    // it's a normal file.
+    // it's a normal file or one copied up to the overlay.
     if( cb == nullptr )
     {
       r = ::uv_fs_stat( loop, req, path, nullptr );
     }
     else
     {
-      Sheath( req, cb, 0, nullptr );
+      Sheath( loop, req, cb, 0, nullptr );
       r = ::uv_fs_stat( loop, req, path, &Manager::fs_stat_on );
     }
   }
@@ -644,7 +1302,7 @@ int Manager::fs_stat( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb
     if( cb != nullptr )
     {
       // if onStatCb is null we don't sheath the request.
-      Sheath( req, cb, 0, pTarget );
+      Sheath( loop, req, cb, 0, pTarget );
       req->cb = &Manager::fs_stat_on;
     }
 
@@ -673,6 +1331,8 @@ void Manager::fs_lstat_on( uv_fs_t* req )
 
 int Manager::fs_lstat( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb )
 {
+  TraceScope trace( "archive.fs_lstat", path );
+
   int r = 0;
 
   if(Get()->report_wrappered_calls_)
@@ -680,17 +1340,18 @@ int Manager::fs_lstat( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb
     std::fprintf(stdout, "@@ fs_lstat loop:%p req:%p path:%s\n", loop, req, path);
   }
 
-  Archive* pTarget = Find( path );
+  std::string upper_path;
+  Archive* pTarget = FindLayered( path, upper_path );
   if( pTarget == nullptr )
   {
-    // it's a normal file.
+    // it's a normal file or one copied up to the overlay.
     if( cb == nullptr )
     {
       r = ::uv_fs_lstat( loop, req, path, nullptr );
     }
     else
     {
-      Sheath( req, cb, 0, nullptr );
+      Sheath( loop, req, cb, 0, nullptr );
       r = ::uv_fs_lstat( loop, req, path, &Manager::fs_stat_on );
     }
   }
@@ -701,7 +1362,7 @@ int Manager::fs_lstat( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb
     if( cb != nullptr )
     {
       // if onStatCb is null we don't sheath the request.
-      Sheath( req, cb, 0, pTarget );
+      Sheath( loop, req, cb, 0, pTarget );
       req->cb = &Manager::fs_stat_on;
     }
 
@@ -730,6 +1391,8 @@ void Manager::fs_realpath_on( uv_fs_t* req )
 
 int Manager::fs_realpath( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb )
 {
+  TraceScope trace( "archive.fs_realpath", path );
+
   int r = 0;
 
   if(Get()->report_wrappered_calls_)
@@ -737,7 +1400,9 @@ int Manager::fs_realpath( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs
     std::fprintf(stdout, "@@ fs_realpath loop:%p req:%p path:%s\n", loop, req, path);
   }
 
-  Archive* pTarget = Find( path );
+  // a file copied up to the overlay has the real path of its copy.
+  std::string upper_path;
+  Archive* pTarget = FindLayered( path, upper_path );
   if( pTarget == nullptr )
   {
     // it's a normal file.
@@ -747,7 +1412,7 @@ int Manager::fs_realpath( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs
     }
     else
     {
-      Sheath( req, cb, 0, nullptr );
+      Sheath( loop, req, cb, 0, nullptr );
       r = ::uv_fs_realpath( loop, req, path, &Manager::fs_realpath_on );
     }
   }
@@ -758,15 +1423,17 @@ int Manager::fs_realpath( uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs
 
     // req->path - holds the source
     // req->ptr - holds the result.
-    // we cheat!
-    char* dup = uv__strdup(path);
-    req->ptr = dup;
-    req->result = 0;
+    std::string real_path;
+    req->result = pTarget->RealPath( path, real_path );
+    if( req->result == 0 )
+    {
+      req->ptr = uv__strdup( real_path.c_str() );
+    }
 
     if( cb != nullptr )
     {
       // if onStatCb is null we don't sheath the request.
-      Sheath( req, cb, 0, pTarget );
+      Sheath( loop, req, cb, 0, pTarget );
       req->cb = &Manager::fs_realpath_on;
 
       Schedule(loop, req);
@@ -811,17 +1478,33 @@ void Manager::fs_open_on(uv_fs_t* req)
 
 int Manager::fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags, int mode, uv_fs_cb cb )
 {
+  TraceScope trace( "archive.fs_open", path );
+
   if(Get()->report_wrappered_calls_)
   {
     std::fprintf(stdout, "@@ fs_open loop:%p req:%p path:%s\n", loop, req, path);
   }
 
   int r = 0;
-  Archive* target_archive = Find( path );
+  std::string upper_path;
+  Archive* target_archive = FindLayered( path, upper_path );
+
+  if( target_archive != nullptr && ( flags & ( O_WRONLY | O_RDWR | O_CREAT | O_TRUNC | O_APPEND ) ) != 0 )
+  {
+    // archives are read only so writes go to a copy in the overlay.
+    r = overlay_.Open( target_archive, path, flags, upper_path );
+    if( r < 0 )
+    {
+      return fs_done( loop, req, UV_FS_OPEN, r, cb );
+    }
+
+    path = upper_path.c_str();
+    target_archive = nullptr;
+  }
 
   if( target_archive == nullptr )
   {
-    // it's a normal file.
+    // it's a normal file or one copied up to the overlay.
     if( cb == nullptr )
     {
       // we are sync.
@@ -838,7 +1521,7 @@ int Manager::fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
     }
     else
     {
-      Sheath( req, cb, 0, nullptr );
+      Sheath( loop, req, cb, 0, nullptr );
       r = ::uv_fs_open( loop, req, path, flags, mode, &Manager::fs_open_on );
     }
   }
@@ -865,7 +1548,7 @@ int Manager::fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
     }
     else
     {
-      Sheath( req, cb, 0, target_archive );
+      Sheath( loop, req, cb, 0, target_archive );
       r = target_archive->fs_open( loop, req, flags, FLATTEN_PATH(path) );
     }
   }
@@ -873,79 +1556,547 @@ int Manager::fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags,
   return r;
 }
 
-void Manager::fs_read_on( uv_fs_t* req )
-{
-  uv_fs_cb cb;
-  uv_file fake;
+void Manager::fs_read_on( uv_fs_t* req )
+{
+  uv_fs_cb cb;
+  uv_file fake;
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_read_on req:%p\n", req);
+  }
+
+  Manager::Unsheath(req, &cb, fake, nullptr);
+
+  cb(req);
+}
+
+int Manager::fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset, uv_fs_cb on_read_cb )
+{
+  TraceScope trace( "archive.fs_read" );
+
+  int r = 0;
+  Mappings::RealSource source;
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_read loop:%p req:%p fakeId:%d\n", loop, req, fake_fileId);
+  }
+
+  if( knownFiles_.Get( fake_fileId, source ) == false )
+  {
+    if( on_read_cb != nullptr )
+    {
+      req->result = UV_ENOENT;
+      req->cb = on_read_cb;
+
+      Schedule( loop, req );
+
+      return 0;
+    }
+
+    return UV_ENOENT;
+  }
+
+  if( source.second != nullptr )
+  {
+    Archive* target_archive = source.second;
+
+    if( on_read_cb == nullptr )
+    {
+      fs_req_init( loop, req, UV_FS_READ, nullptr );
+
+      r = target_archive->fs_read( loop, req, source.first, bufs, nbufs, offset );
+      
+      SET_REQUEST_FILE_HANDLE(req, fake_fileId);
+    }
+    else
+    {
+      fs_req_init( loop, req, UV_FS_READ, &Manager::fs_read_on );
+
+      Sheath( loop, req, on_read_cb, fake_fileId, nullptr );
+      r = target_archive->fs_read( loop, req, source.first, bufs, nbufs, offset );
+    }
+  }
+  else
+  {
+    if( on_read_cb == nullptr )
+    {
+      r = ::uv_fs_read( loop, req, source.first, bufs, nbufs, offset, nullptr );
+      
+      SET_REQUEST_FILE_HANDLE(req, fake_fileId);
+    }
+    else
+    {
+      Sheath( loop, req, on_read_cb, fake_fileId, nullptr );
+      r = ::uv_fs_read( loop, req, source.first, bufs, nbufs, offset, &Manager::fs_read_on );
+    }
+  }
+
+  return r;
+}
+
+void Manager::fs_read_batch_work(uv_work_t* work)
+{
+  ReadBatchRequest* req = static_cast< ReadBatchRequest* >( work );
+
+  for( unsigned int i=0; i<req->nitems_; ++i )
+  {
+    ReadBatchItem& item = req->items_[ i ];
+
+    // resolving failed
+    if( item.result_ < 0 )
+    {
+      continue;
+    }
+
+    if( item.content_ != nullptr )
+    {
+      size_t available = 0;
+      if( static_cast< uint64_t >( item.offset_ ) < item.content_size_ )
+      {
+        available = item.content_size_ - static_cast< size_t >( item.offset_ );
+      }
+
+      size_t to_copy = ( item.buf_.len < available ) ? item.buf_.len : available;
+
+      std::memcpy( item.buf_.base, item.content_ + item.offset_, to_copy );
+      item.result_ = static_cast< ssize_t >( to_copy );
+    }
+    else
+    {
+      uv_fs_t read_req;
+      item.result_ = ::uv_fs_read( nullptr, &read_req, item.real_fileId_, &item.buf_, 1, item.offset_, nullptr );
+      ::uv_fs_req_cleanup( &read_req );
+    }
+  }
+}
+
+void Manager::fs_read_batch_on(uv_work_t* work, int status)
+{
+  ReadBatchRequest* req = static_cast< ReadBatchRequest* >( work );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_read_batch_on req:%p status:%d\n", req, status);
+  }
+
+  if( status != 0 )
+  {
+    for( unsigned int i=0; i<req->nitems_; ++i )
+    {
+      req->items_[ i ].result_ = status;
+    }
+  }
+
+  req->cb_( req );
+}
+
+int Manager::fs_read_batch(uv_loop_t* loop, ReadBatchRequest* req, ReadBatchItem* items, unsigned int nitems, ReadBatchCb cb)
+{
+  TraceScope trace( "archive.fs_read_batch" );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_read_batch loop:%p req:%p items:%u\n", loop, req, nitems);
+  }
+
+  if( items == nullptr && nitems != 0 )
+  {
+    return UV_EINVAL;
+  }
+
+  req->items_ = items;
+  req->nitems_ = nitems;
+  req->cb_ = cb;
+
+  // The fd tables are only touched here on the calling thread, the work only sees immutable views and real file ids.
+  for( unsigned int i=0; i<nitems; ++i )
+  {
+    ReadBatchItem& item = items[ i ];
+    Mappings::RealSource source;
+
+    item.result_ = 0;
+    item.content_ = nullptr;
+    item.content_size_ = 0;
+
+    if( item.offset_ < 0 )
+    {
+      item.result_ = UV_EINVAL;
+    }
+    else if( knownFiles_.Get( item.file_, source ) == false )
+    {
+      item.result_ = UV_EBADF;
+    }
+    else
+    {
+      item.real_fileId_ = source.first;
+
+      if( source.second != nullptr && source.second->ContentView( source.first, &item.content_, &item.content_size_ ) == false )
+      {
+        item.content_ = nullptr;
+        item.content_size_ = 0;
+      }
+    }
+  }
+
+  if( cb == nullptr )
+  {
+    fs_read_batch_work( req );
+    return 0;
+  }
+
+  return ::uv_queue_work( loop, req, &Manager::fs_read_batch_work, &Manager::fs_read_batch_on );
+}
+
+// Gives a child the type its stat says it is, some file systems don't give one with the dir entry.
+static void TypeFromStat( DirStatsItem& item )
+{
+  switch( item.stat_.st_mode & 0xF000 )
+  {
+    case 0x4000:  // _S_IFDIR
+      item.type_ = UV_DIRENT_DIR;
+      break;
+    case 0x8000:  // _S_IFREG
+      item.type_ = UV_DIRENT_FILE;
+      break;
+  }
+}
+
+#if defined(_WIN32)
+
+int Manager::ReadDirStats( Archive* archive, const std::string& path, DirStats& items, bool types_only )
+{
+  if( archive != nullptr )
+  {
+    return archive->fs_readdir_stats( path.c_str(), items );
+  }
+
+  uv_fs_t scandir_req;
+  int r = ::uv_fs_scandir( nullptr, &scandir_req, path.c_str(), 0, nullptr );
+
+  if( r < 0 )
+  {
+    ::uv_fs_req_cleanup( &scandir_req );
+    return r;
+  }
+
+  items.reserve( static_cast< size_t >( r ) );
+
+  uv_dirent_t ent;
+  while( ::uv_fs_scandir_next( &scandir_req, &ent ) != UV_EOF )
+  {
+    DirStatsItem item;
+    item.name_ = ent.name;
+    item.type_ = ent.type;
+
+    if( types_only && item.type_ != UV_DIRENT_UNKNOWN )
+    {
+      item.stat_result_ = UV_ECANCELED;
+      items.push_back( item );
+      continue;
+    }
+
+    const std::string child_path = path + std::string( "/" ) + item.name_;
+
+    uv_fs_t stat_req;
+    item.stat_result_ = ::uv_fs_stat( nullptr, &stat_req, child_path.c_str(), nullptr );
+    if( item.stat_result_ == 0 )
+    {
+      item.stat_ = stat_req.statbuf;
+
+      if( item.type_ == UV_DIRENT_UNKNOWN )
+      {
+        TypeFromStat( item );
+      }
+    }
+    ::uv_fs_req_cleanup( &stat_req );
+
+    items.push_back( item );
+  }
+
+  ::uv_fs_req_cleanup( &scandir_req );
+
+  return static_cast< int >( items.size() );
+}
+
+#else
+
+// The same as libuv's stat of a file.
+static void ToUvStat( const struct stat& src, uv_stat_t& dst )
+{
+  dst.st_dev = src.st_dev;
+  dst.st_mode = src.st_mode;
+  dst.st_nlink = src.st_nlink;
+  dst.st_uid = src.st_uid;
+  dst.st_gid = src.st_gid;
+  dst.st_rdev = src.st_rdev;
+  dst.st_ino = src.st_ino;
+  dst.st_size = src.st_size;
+  dst.st_blksize = src.st_blksize;
+  dst.st_blocks = src.st_blocks;
+#if defined(__APPLE__)
+  dst.st_atim.tv_sec = src.st_atimespec.tv_sec;
+  dst.st_atim.tv_nsec = src.st_atimespec.tv_nsec;
+  dst.st_mtim.tv_sec = src.st_mtimespec.tv_sec;
+  dst.st_mtim.tv_nsec = src.st_mtimespec.tv_nsec;
+  dst.st_ctim.tv_sec = src.st_ctimespec.tv_sec;
+  dst.st_ctim.tv_nsec = src.st_ctimespec.tv_nsec;
+  dst.st_birthtim.tv_sec = src.st_birthtimespec.tv_sec;
+  dst.st_birthtim.tv_nsec = src.st_birthtimespec.tv_nsec;
+  dst.st_flags = src.st_flags;
+  dst.st_gen = src.st_gen;
+#else
+  dst.st_atim.tv_sec = src.st_atim.tv_sec;
+  dst.st_atim.tv_nsec = src.st_atim.tv_nsec;
+  dst.st_mtim.tv_sec = src.st_mtim.tv_sec;
+  dst.st_mtim.tv_nsec = src.st_mtim.tv_nsec;
+  dst.st_ctim.tv_sec = src.st_ctim.tv_sec;
+  dst.st_ctim.tv_nsec = src.st_ctim.tv_nsec;
+  dst.st_birthtim.tv_sec = src.st_ctim.tv_sec;
+  dst.st_birthtim.tv_nsec = src.st_ctim.tv_nsec;
+  dst.st_flags = 0;
+  dst.st_gen = 0;
+#endif
+}
+
+static uv_dirent_type_t TypeFromDirEntry( const struct dirent* ent )
+{
+#if defined(DT_UNKNOWN)
+  switch( ent->d_type )
+  {
+    case DT_DIR:
+      return UV_DIRENT_DIR;
+    case DT_REG:
+      return UV_DIRENT_FILE;
+    case DT_LNK:
+      return UV_DIRENT_LINK;
+    case DT_FIFO:
+      return UV_DIRENT_FIFO;
+    case DT_SOCK:
+      return UV_DIRENT_SOCKET;
+    case DT_CHR:
+      return UV_DIRENT_CHAR;
+    case DT_BLK:
+      return UV_DIRENT_BLOCK;
+  }
+#endif
+
+  return UV_DIRENT_UNKNOWN;
+}
+
+int Manager::ReadDirStats( Archive* archive, const std::string& path, DirStats& items, bool types_only )
+{
+  if( archive != nullptr )
+  {
+    return archive->fs_readdir_stats( path.c_str(), items );
+  }
+
+  // the dir is opened once and each child stat'ed relative to it, so the dir's path isn't looked up again for every child.
+  DIR* dir = ::opendir( path.c_str() );
+  if( dir == nullptr )
+  {
+    return ::uv_translate_sys_error( errno );
+  }
+
+  const int dir_fd = ::dirfd( dir );
+
+  errno = 0;
+  while( const struct dirent* ent = ::readdir( dir ) )
+  {
+    if( std::strcmp( ent->d_name, "." ) == 0 || std::strcmp( ent->d_name, ".." ) == 0 )
+    {
+      continue;
+    }
+
+    DirStatsItem item;
+    item.name_ = ent->d_name;
+    item.type_ = TypeFromDirEntry( ent );
+
+    if( types_only && item.type_ != UV_DIRENT_UNKNOWN )
+    {
+      item.stat_result_ = UV_ECANCELED;
+      items.push_back( item );
+      continue;
+    }
+
+    struct stat child_stat;
+    if( ::fstatat( dir_fd, ent->d_name, &child_stat, 0 ) == 0 )
+    {
+      ToUvStat( child_stat, item.stat_ );
+
+      if( item.type_ == UV_DIRENT_UNKNOWN )
+      {
+        TypeFromStat( item );
+      }
+    }
+    else
+    {
+      item.stat_result_ = ::uv_translate_sys_error( errno );
+    }
+
+    items.push_back( item );
+    errno = 0;
+  }
+
+  const int read_error = errno;
+  ::closedir( dir );
+
+  if( read_error != 0 )
+  {
+    items.clear();
+    return ::uv_translate_sys_error( read_error );
+  }
+
+  // in the order uv_fs_scandir() gives.
+  std::sort( items.begin(), items.end(), []( const DirStatsItem& a, const DirStatsItem& b ) { return std::strcmp( a.name_.c_str(), b.name_.c_str() ) < 0; } );
+
+  return static_cast< int >( items.size() );
+}
+
+#endif
+
+void Manager::fs_readdir_stats_work(uv_work_t* work)
+{
+  DirWork* dir_work = static_cast< DirWork* >( work );
+  uv_fs_t* req = dir_work->request_;
+
+  req->result = ReadDirStats( dir_work->archive_, dir_work->path_, *static_cast< DirStats* >( req->ptr ), dir_work->types_only_ );
+}
+
+void Manager::fs_walk_work(uv_work_t* work)
+{
+  DirWork* dir_work = static_cast< DirWork* >( work );
+  uv_fs_t* req = dir_work->request_;
+  WalkEntries& entries = *static_cast< WalkEntries* >( req->ptr );
+
+  if( dir_work->archive_ != nullptr )
+  {
+    req->result = dir_work->archive_->fs_walk( dir_work->path_.c_str(), dir_work->pattern_, entries );
+  }
+  else
+  {
+    req->result = Walk::Disk( dir_work->path_, dir_work->pattern_, entries );
+  }
+}
+
+void Manager::fs_dir_work_on(uv_work_t* work, int status)
+{
+  DirWork* dir_work = static_cast< DirWork* >( work );
+  uv_fs_t* req = dir_work->request_;
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_dir_work_on req:%p status:%d\n", req, status);
+  }
+
+  if( status != 0 )
+  {
+    req->result = status;
+  }
+
+  RequestPool::Delete( dir_work );
+
+  req->cb( req );
+}
+
+int Manager::fs_readdir_stats(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
+{
+  TraceScope trace( "archive.fs_readdir_stats", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_readdir_stats loop:%p req:%p path:%s\n", loop, req, path);
+  }
+
+  return fs_readdir( loop, req, path, false, cb );
+}
+
+int Manager::fs_readdir_types(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
+{
+  TraceScope trace( "archive.fs_readdir_types", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_readdir_types loop:%p req:%p path:%s\n", loop, req, path);
+  }
+
+  return fs_readdir( loop, req, path, true, cb );
+}
+
+int Manager::fs_readdir(uv_loop_t* loop, uv_fs_t* req, const char* path, bool types_only, uv_fs_cb cb)
+{
+  Archive* target_archive = Find( path );
+
+  fs_req_init( loop, req, UV_FS_SCANDIR, cb );
+  fs_capture_path( req, path, nullptr, cb == nullptr );
+
+  req->ptr = new DirStats();
+  req->flags |= EXT_ARCHIVE_DIR_STATS;
+
+  const std::string target_path = ( target_archive != nullptr ) ? FLATTEN_PATH( path ) : path;
 
-  if(Get()->report_wrappered_calls_)
+  if( cb == nullptr )
   {
-    std::fprintf(stdout, "@@ fs_read_on req:%p\n", req);
+    req->result = ReadDirStats( target_archive, target_path, *static_cast< DirStats* >( req->ptr ), types_only );
+    return static_cast< int >( req->result );
   }
 
-  Manager::Unsheath(req, &cb, fake, nullptr);
+  DirWork* work = Pool( loop )->New< DirWork >();
+  work->request_ = req;
+  work->archive_ = target_archive;
+  work->path_ = target_path;
+  work->types_only_ = types_only;
 
-  cb(req);
+  int r = ::uv_queue_work( loop, work, &Manager::fs_readdir_stats_work, &Manager::fs_dir_work_on );
+  if( r != 0 )
+  {
+    RequestPool::Delete( work );
+  }
+
+  return r;
 }
 
-int Manager::fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset, uv_fs_cb on_read_cb )
+int Manager::fs_walk(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* pattern, uv_fs_cb cb)
 {
-  int r = 0;
-  Mappings::RealSource source;
+  TraceScope trace( "archive.fs_walk", path );
 
   if(Get()->report_wrappered_calls_)
   {
-    std::fprintf(stdout, "@@ fs_read loop:%p req:%p fakeId:%d\n", loop, req, fake_fileId);
+    std::fprintf(stdout, "@@ fs_walk loop:%p req:%p path:%s pattern:%s\n", loop, req, path, ( pattern != nullptr ) ? pattern : "");
   }
 
-  if( knownFiles_.Get( fake_fileId, source ) == false )
-  {
-    if( on_read_cb != nullptr )
-    {
-      req->result = UV_ENOENT;
-      req->cb = on_read_cb;
-
-      Schedule( loop, req );
+  Archive* target_archive = Find( path );
 
-      return 0;
-    }
+  fs_req_init( loop, req, UV_FS_SCANDIR, cb );
+  fs_capture_path( req, path, nullptr, cb == nullptr );
 
-    return UV_ENOENT;
-  }
+  req->ptr = new WalkEntries();
+  req->flags |= EXT_ARCHIVE_WALK;
 
-  if( source.second != nullptr )
+  if( cb == nullptr )
   {
-    Archive* target_archive = source.second;
+    DirWork work;
+    work.request_ = req;
+    work.archive_ = target_archive;
+    work.path_ = ( target_archive != nullptr ) ? FLATTEN_PATH( path ) : path;
+    work.pattern_ = ( pattern != nullptr ) ? pattern : "";
 
-    if( on_read_cb == nullptr )
-    {
-      fs_req_init( loop, req, UV_FS_READ, nullptr );
-
-      r = target_archive->fs_read( loop, req, source.first, bufs, nbufs, offset );
-      
-      SET_REQUEST_FILE_HANDLE(req, fake_fileId);
-    }
-    else
-    {
-      fs_req_init( loop, req, UV_FS_READ, &Manager::fs_read_on );
+    fs_walk_work( &work );
 
-      Sheath( req, on_read_cb, fake_fileId, nullptr );
-      r = target_archive->fs_read( loop, req, source.first, bufs, nbufs, offset );
-    }
+    return static_cast< int >( req->result );
   }
-  else
+
+  DirWork* work = Pool( loop )->New< DirWork >();
+  work->request_ = req;
+  work->archive_ = target_archive;
+  work->path_ = ( target_archive != nullptr ) ? FLATTEN_PATH( path ) : path;
+  work->pattern_ = ( pattern != nullptr ) ? pattern : "";
+
+  int r = ::uv_queue_work( loop, work, &Manager::fs_walk_work, &Manager::fs_dir_work_on );
+  if( r != 0 )
   {
-    if( on_read_cb == nullptr )
-    {
-      r = ::uv_fs_read( loop, req, source.first, bufs, nbufs, offset, nullptr );
-      
-      SET_REQUEST_FILE_HANDLE(req, fake_fileId);
-    }
-    else
-    {
-      Sheath( req, on_read_cb, fake_fileId, nullptr );
-      r = ::uv_fs_read( loop, req, source.first, bufs, nbufs, offset, &Manager::fs_read_on );
-    }
+    RequestPool::Delete( work );
   }
 
   return r;
@@ -970,6 +2121,8 @@ void Manager::fs_close_on(uv_fs_t* req)
 
 int Manager::fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_cb on_close_cb )
 {
+  TraceScope trace( "archive.fs_close" );
+
   int r = 0;
   Mappings::RealSource source;
   if(Get()->report_wrappered_calls_)
@@ -1010,7 +2163,7 @@ int Manager::fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_
     {
       fs_req_init(loop, req, UV_FS_CLOSE, &Manager::fs_close_on);
 
-      Sheath(req, on_close_cb, fake_fileId, target_archive);
+      Sheath(loop, req, on_close_cb, fake_fileId, target_archive);
       r = target_archive->fs_close( loop, req, source.first );
     }
   }
@@ -1025,7 +2178,7 @@ int Manager::fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_
     }
     else
     {
-      Sheath( req, on_close_cb, fake_fileId, nullptr );
+      Sheath( loop, req, on_close_cb, fake_fileId, nullptr );
       r = ::uv_fs_close( loop, req, source.first, &Manager::fs_close_on );
     }
   }
@@ -1049,6 +2202,8 @@ void Manager::fs_scandir_on( uv_fs_t* req )
 
 int Manager::fs_scandir(uv_loop_t* loop, uv_fs_t* req, const char* path,  int flags, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_scandir", path );
+
   int r = 0;
 
   if(Get()->report_wrappered_calls_)
@@ -1066,18 +2221,18 @@ int Manager::fs_scandir(uv_loop_t* loop, uv_fs_t* req, const char* path,  int fl
     }
     else
     {
-      Sheath(req, cb, 0, nullptr);
+      Sheath(loop, req, cb, 0, nullptr);
       r = ::uv_fs_scandir(loop, req, path, flags, &Manager::fs_scandir_on);
     }
   }
   else
   {
-    fs_req_init( loop, req, UV_FS_SCANDIR, nullptr );
+    fs_req_init( loop, req, UV_FS_SCANDIR, cb );
     fs_capture_path( req, path, nullptr, cb == nullptr );
 
     if( cb != nullptr )
     {
-      Sheath(req, cb, 0, target_archive );
+      Sheath(loop, req, cb, 0, target_archive );
     
       // we want to run through the managers fs_scandir_on
       req->cb = &Manager::fs_scandir_on;
@@ -1095,9 +2250,108 @@ int Manager::fs_scandir_next(uv_fs_t* req, uv_dirent_t* ent)
     std::fprintf(stdout, "@@ fs_scandir_next req:%p dir:%p\n", req, ent);
   }
 
+  if( req->fs_type == UV_FS_SCANDIR && ( req->flags & EXT_ARCHIVE_LISTING ) )
+  {
+    if( req->result < 0 )
+    {
+      return static_cast< int >( req->result );
+    }
+
+#if defined(_WIN32)
+    unsigned int& index = req->fs.info.nbufs;
+#else
+    unsigned int& index = req->nbufs;
+#endif
+
+    const ArchiveDir* dir = static_cast< const ArchiveDir* >( req->ptr );
+    if( index >= dir->listing_.size() )
+    {
+      return UV_EOF;
+    }
+
+    *ent = dir->listing_[ index ];
+    ++index;
+
+    return 0;
+  }
+
   return ::uv_fs_scandir_next(req, ent);
 }
 
+int Manager::fs_unlink(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
+{
+  TraceScope trace( "archive.fs_unlink", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_unlink loop:%p req:%p path:%s\n", loop, req, path);
+  }
+
+  Archive* target_archive = Find( path );
+  if( target_archive == nullptr )
+  {
+    return ::uv_fs_unlink( loop, req, path, cb );
+  }
+
+  return fs_done( loop, req, UV_FS_UNLINK, overlay_.Remove( target_archive, path, false ), cb );
+}
+
+int Manager::fs_mkdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int mode, uv_fs_cb cb)
+{
+  TraceScope trace( "archive.fs_mkdir", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_mkdir loop:%p req:%p path:%s\n", loop, req, path);
+  }
+
+  Archive* target_archive = Find( path );
+  if( target_archive == nullptr )
+  {
+    return ::uv_fs_mkdir( loop, req, path, mode, cb );
+  }
+
+  return fs_done( loop, req, UV_FS_MKDIR, overlay_.Mkdir( target_archive, path, mode ), cb );
+}
+
+int Manager::fs_rmdir(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
+{
+  TraceScope trace( "archive.fs_rmdir", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_rmdir loop:%p req:%p path:%s\n", loop, req, path);
+  }
+
+  Archive* target_archive = Find( path );
+  if( target_archive == nullptr )
+  {
+    return ::uv_fs_rmdir( loop, req, path, cb );
+  }
+
+  return fs_done( loop, req, UV_FS_RMDIR, overlay_.Remove( target_archive, path, true ), cb );
+}
+
+int Manager::fs_rename(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* new_path, uv_fs_cb cb)
+{
+  TraceScope trace( "archive.fs_rename", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_rename loop:%p req:%p path:%s new_path:%s\n", loop, req, path, new_path);
+  }
+
+  Archive* from_archive = Find( path );
+  Archive* to_archive = Find( new_path );
+
+  if( from_archive == nullptr && to_archive == nullptr )
+  {
+    return ::uv_fs_rename( loop, req, path, new_path, cb );
+  }
+
+  return fs_done( loop, req, UV_FS_RENAME, overlay_.Rename( from_archive, path, to_archive, new_path ), cb );
+}
+
 void Manager::fs_write_on(uv_fs_t* req)
 {
   uv_fs_cb cb;
@@ -1115,6 +2369,8 @@ void Manager::fs_write_on(uv_fs_t* req)
 
 int Manager::fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_write" );
+
   int r = 0;
   Mappings::RealSource source;
 
@@ -1140,20 +2396,8 @@ int Manager::fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, const
 
   if( source.second != nullptr )
   {
-    Archive* target_archive = source.second;
-
-    req->result = UV_ECANCELED;
-
-    if( cb == nullptr )
-    {
-      r = static_cast<int>(req->result);
-    }
-    else
-    {
-      fs_req_init( loop, req, UV_FS_WRITE, &Manager::fs_write_on );
-      Sheath( req, cb, fake_fileId, nullptr );
-      Schedule(loop, req);
-    }
+    // archive files are only ever opened for reading, writes are made to a copy in the overlay.
+    r = fs_done( loop, req, UV_FS_WRITE, UV_EBADF, cb );
   }
   else
   {
@@ -1165,7 +2409,7 @@ int Manager::fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, const
     }
     else
     {
-      Sheath( req, cb, fake_fileId, nullptr );
+      Sheath( loop, req, cb, fake_fileId, nullptr );
       r = ::uv_fs_write( loop, req, source.first, bufs, nbufs, offset, &Manager::fs_write_on );
     }
   }
@@ -1191,6 +2435,8 @@ void Manager::fs_fsync_on(uv_fs_t* req)
 
 int Manager::fs_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_fsync" );
+
   int r = 0;
 
   Mappings::RealSource source;
@@ -1227,7 +2473,7 @@ int Manager::fs_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_
     }
     else
     {
-      Sheath( req, cb, fake_fileId, nullptr );
+      Sheath( loop, req, cb, fake_fileId, nullptr );
       req->cb = &Manager::fs_fsync_on;
       Schedule(loop, req);
     }
@@ -1242,7 +2488,7 @@ int Manager::fs_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_
     }
     else
     {
-      Sheath( req, cb, fake_fileId, nullptr );
+      Sheath( loop, req, cb, fake_fileId, nullptr );
       r = ::uv_fs_fsync( loop, req, source.first, &Manager::fs_fsync_on );
     }
   }
@@ -1268,6 +2514,8 @@ void Manager::fs_fdatasync_on(uv_fs_t* req)
 
 int Manager::fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_fdatasync" );
+
   int r = 0;
 
   Mappings::RealSource source;
@@ -1304,7 +2552,7 @@ int Manager::fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv
     }
     else
     {
-      Sheath( req, cb, fake_fileId, nullptr );
+      Sheath( loop, req, cb, fake_fileId, nullptr );
       req->cb = &Manager::fs_fdatasync_on;
       Schedule(loop, req);
     }
@@ -1319,7 +2567,7 @@ int Manager::fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv
     }
     else
     {
-      Sheath( req, cb, fake_fileId, nullptr );
+      Sheath( loop, req, cb, fake_fileId, nullptr );
       r = ::uv_fs_fdatasync( loop, req, source.first, &Manager::fs_fdatasync_on );
     }
   }
@@ -1329,20 +2577,86 @@ int Manager::fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file fake_fileId, uv
 
 int Manager::fs_ftruncate(uv_loop_t* loop, uv_fs_t* req, uv_file file, int64_t offset, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_ftruncate" );
+
   int r = 0;
 
   return r;
 }
 
+void Manager::fs_sendfile_on(uv_fs_t* req)
+{
+  uv_fs_cb cb;
+  uv_file fake;
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_sendfile_on req:%p\n", req);
+  }
+
+  Manager::Unsheath(req, &cb, fake, nullptr );
+  SET_REQUEST_FILE_HANDLE(req, fake);
+
+  cb(req);
+}
+
 int Manager::fs_sendfile(uv_loop_t* loop, uv_fs_t* req, uv_file out_fd, uv_file in_fd, int64_t in_offset, size_t length, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_sendfile" );
+
   int r = 0;
+  Mappings::RealSource in_source;
+  Mappings::RealSource out_source;
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_sendfile loop:%p req:%p outId:%d inId:%d\n", loop, req, out_fd, in_fd);
+  }
+
+  if( knownFiles_.Get( in_fd, in_source ) == false )
+  {
+    return fs_done( loop, req, UV_FS_SENDFILE, UV_EBADF, cb );
+  }
+
+  // sockets are not opened through the manager so an out_fd it does not know is used as it is.
+  uv_file real_out = out_fd;
+  if( knownFiles_.Get( out_fd, out_source ) )
+  {
+    if( out_source.second != nullptr )
+    {
+      // archive files are only ever opened for reading.
+      return fs_done( loop, req, UV_FS_SENDFILE, UV_EBADF, cb );
+    }
+
+    real_out = out_source.first;
+  }
+
+  // a stored file is sent straight from the archive file, anything else from the cache file it was opened as.
+  uv_file real_in = in_source.first;
+  if( in_source.second != nullptr )
+  {
+    in_source.second->SendfileSource( in_source.first, real_in, in_offset, length );
+  }
+
+  if( cb == nullptr )
+  {
+    r = ::uv_fs_sendfile( loop, req, real_out, real_in, in_offset, length, nullptr );
+
+    SET_REQUEST_FILE_HANDLE(req, out_fd);
+  }
+  else
+  {
+    Sheath( loop, req, cb, out_fd, nullptr );
+    r = ::uv_fs_sendfile( loop, req, real_out, real_in, in_offset, length, &Manager::fs_sendfile_on );
+  }
 
   return r;
 }
 
 int Manager::fs_futime(uv_loop_t* loop, uv_fs_t* req, uv_file file, double atime, double mtime, uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_futime" );
+
     int r = 0;
 
   return r;
@@ -1350,6 +2664,8 @@ int Manager::fs_futime(uv_loop_t* loop, uv_fs_t* req, uv_file file, double atime
 
 int Manager::fs_fchmod(uv_loop_t* loop,uv_fs_t* req,uv_file file,int mode,uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_fchmod" );
+
     int r = 0;
 
   return r;
@@ -1357,11 +2673,88 @@ int Manager::fs_fchmod(uv_loop_t* loop,uv_fs_t* req,uv_file file,int mode,uv_fs_
 
 int Manager::fs_fchown(uv_loop_t* loop,  uv_fs_t* req,  uv_file file,  uv_uid_t uid,  uv_gid_t gid,  uv_fs_cb cb)
 {
+  TraceScope trace( "archive.fs_fchown" );
+
   int r = 0;
 
   return r;
 }
 
+// A watch of a path in an archive is started on the node executable, which can't be written while it runs, with one of these callbacks
+// so the handle is active and keeps the loop alive like any other watch but reports nothing.
+static void DropFsEvent(uv_fs_event_t*, const char*, int, int)
+{
+}
+
+static void DropFsPoll(uv_fs_poll_t*, int, const uv_stat_t*, const uv_stat_t*)
+{
+}
+
+static std::string InertWatchPath()
+{
+  char exe_path[ 4096 ];
+  size_t exe_path_size = sizeof( exe_path );
+
+  if( uv_exepath( exe_path, &exe_path_size ) != 0 )
+  {
+    return std::string();
+  }
+
+  return std::string( exe_path, exe_path_size );
+}
+
+int Manager::fs_event_start(uv_fs_event_t* handle, uv_fs_event_cb cb, const char* path, unsigned int flags)
+{
+  TraceScope trace( "archive.fs_event_start", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_event_start handle:%p path:%s flags:%u\n", handle, path, flags);
+  }
+
+  std::string upper_path;
+  if( FindLayered( path, upper_path ) == nullptr )
+  {
+    return ::uv_fs_event_start( handle, cb, path, flags );
+  }
+
+  // a mount isn't reloaded so what the path holds never changes.
+  const std::string inert_path = InertWatchPath();
+  if( inert_path.empty() )
+  {
+    return UV_ENOSYS;
+  }
+
+  Report( "fs_event_start not watching archive path:%s\n", path );
+  return ::uv_fs_event_start( handle, DropFsEvent, inert_path.c_str(), 0 );
+}
+
+int Manager::fs_poll_start(uv_fs_poll_t* handle, uv_fs_poll_cb cb, const char* path, unsigned int interval)
+{
+  TraceScope trace( "archive.fs_poll_start", path );
+
+  if(Get()->report_wrappered_calls_)
+  {
+    std::fprintf(stdout, "@@ fs_poll_start handle:%p path:%s interval:%u\n", handle, path, interval);
+  }
+
+  std::string upper_path;
+  if( FindLayered( path, upper_path ) == nullptr )
+  {
+    return ::uv_fs_poll_start( handle, cb, path, interval );
+  }
+
+  // as fs_event_start(), with the longest interval there is so it's stat()ed once when started and never again.
+  const std::string inert_path = InertWatchPath();
+  if( inert_path.empty() )
+  {
+    return UV_ENOSYS;
+  }
+
+  Report( "fs_poll_start not polling archive path:%s\n", path );
+  return ::uv_fs_poll_start( handle, DropFsPoll, inert_path.c_str(), std::numeric_limits< unsigned int >::max() );
+}
+
 /*************************************************************************************************************/
 
 uv_fs_type uv_fs_get_type(const uv_fs_t* f)
@@ -1409,6 +2802,11 @@ int uv_fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file file, const uv_buf_t bufs[
   return Manager::Get()->fs_read(loop, req, file, bufs, nbufs, offset, cb);
 }
 
+int uv_fs_read_batch(uv_loop_t* loop, ReadBatchRequest* req, ReadBatchItem* items, unsigned int nitems, ReadBatchCb cb)
+{
+  return Manager::Get()->fs_read_batch(loop, req, items, nitems, cb);
+}
+
 int uv_fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file file, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset, uv_fs_cb cb)
 {
   return Manager::Get()->fs_write(loop, req, file, bufs, nbufs, offset, cb);
@@ -1451,8 +2849,7 @@ int uv_fs_fchown(uv_loop_t* loop,  uv_fs_t* req,  uv_file file,  uv_uid_t uid,
 
 int uv_fs_unlink(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
 {
-std::fprintf( stdout, "## uv_fs_scandir path:%s\n", path );
-  return ::uv_fs_unlink(loop, req, path, cb);
+  return Manager::Get()->fs_unlink(loop, req, path, cb);
 }
 
 int uv_fs_copyfile(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* new_path, int flags, uv_fs_cb cb)
@@ -1463,8 +2860,7 @@ std::fprintf( stdout, "## uv_fs_scandir path:%s\n", path );
 
 int uv_fs_mkdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int mode, uv_fs_cb cb)
 {
-std::fprintf( stdout, "## uv_fs_mkdir path:%s\n", path );
-  return ::uv_fs_mkdir(loop, req, path, mode, cb);
+  return Manager::Get()->fs_mkdir(loop, req, path, mode, cb);
 }
 
 int uv_fs_mkdtemp(uv_loop_t* loop, uv_fs_t* req, const char* tpl, uv_fs_cb cb)
@@ -1475,8 +2871,7 @@ std::fprintf( stdout, "## uv_fs_mkdtemp\n");
 
 int uv_fs_rmdir(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
 {
-std::fprintf( stdout, "## uv_fs_rmdir path:%s\n", path );
-  return ::uv_fs_rmdir(loop, req, path, cb);
+  return Manager::Get()->fs_rmdir(loop, req, path, cb);
 }
 
 int uv_fs_scandir(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags, uv_fs_cb cb)
@@ -1489,6 +2884,41 @@ int uv_fs_scandir_next(uv_fs_t* req, uv_dirent_t* ent)
   return Manager::Get()->fs_scandir_next(req, ent);
 }
 
+int uv_fs_readdir_stats(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
+{
+  return Manager::Get()->fs_readdir_stats(loop, req, path, cb);
+}
+
+int uv_fs_readdir_types(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
+{
+  return Manager::Get()->fs_readdir_types(loop, req, path, cb);
+}
+
+const DirStats* uv_fs_get_dir_stats(const uv_fs_t* req)
+{
+  if( req->fs_type != UV_FS_SCANDIR || ( req->flags & EXT_ARCHIVE_DIR_STATS ) == 0 )
+  {
+    return nullptr;
+  }
+
+  return static_cast< const DirStats* >( req->ptr );
+}
+
+int uv_fs_walk(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* pattern, uv_fs_cb cb)
+{
+  return Manager::Get()->fs_walk(loop, req, path, pattern, cb);
+}
+
+const WalkEntries* uv_fs_get_walk_entries(const uv_fs_t* req)
+{
+  if( req->fs_type != UV_FS_SCANDIR || ( req->flags & EXT_ARCHIVE_WALK ) == 0 )
+  {
+    return nullptr;
+  }
+
+  return static_cast< const WalkEntries* >( req->ptr );
+}
+
 int uv_fs_stat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb)
 {
   return Manager::Get()->fs_stat(loop, req, path, cb);
@@ -1506,8 +2936,7 @@ int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb)
 
 int uv_fs_rename(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* new_path, uv_fs_cb cb)
 {
-std::fprintf( stdout, "## uv_fs_rename path:%s\n", path );
-  return ::uv_fs_rename(loop, req, path, new_path, cb);
+  return Manager::Get()->fs_rename(loop, req, path, new_path, cb);
 }
 
 int uv_fs_access(uv_loop_t* loop, uv_fs_t* req, const char* path, int mode, uv_fs_cb cb)
@@ -1564,4 +2993,14 @@ std::fprintf( stdout, "## uv_fs_lchown path:%s\n", path );
   return ::uv_fs_lchown(loop, req, path, uid, gid, cb);
 }
 
+int uv_fs_event_start(uv_fs_event_t* handle, uv_fs_event_cb cb, const char* path, unsigned int flags)
+{
+  return Manager::Get()->fs_event_start(handle, cb, path, flags);
+}
+
+int uv_fs_poll_start(uv_fs_poll_t* handle, uv_fs_poll_cb cb, const char* path, unsigned int interval)
+{
+  return Manager::Get()->fs_poll_start(handle, cb, path, interval);
+}
+
 }
@@ -4,7 +4,11 @@
 #include <uv.h>
 
 #include "archive/archive.h"
+#include "archive/manifest.h"
+#include "archive/overlay.h"
+#include "archive/request_pool.h"
 
+#include <atomic>
 #include <map>
 
 /// Note
@@ -32,6 +36,16 @@
 #define scan_dir_alloc( size ) std::malloc( size )
 #endif
 
+/// Set in uv_fs_t.flags by an archive's fs_scandir when uv_fs_t.ptr is the ArchiveDir whose precomputed listing is being walked.
+/// The listing belongs to the archive so libuv must never see it, see Manager::fs_scandir_next() and Manager::fs_req_cleanup()
+#define EXT_ARCHIVE_LISTING          0x40000000
+
+/// Set in uv_fs_t.flags by Manager::fs_readdir_stats() when uv_fs_t.ptr is the DirStats it made, this is freed by Manager::fs_req_cleanup()
+#define EXT_ARCHIVE_DIR_STATS        0x20000000
+
+/// Set in uv_fs_t.flags by Manager::fs_walk() when uv_fs_t.ptr is the WalkEntries it made, this is freed by Manager::fs_req_cleanup()
+#define EXT_ARCHIVE_WALK             0x10000000
+
 /// Used to tell the outside world when something is not implemented
 #define ARCHIVE_NOT_SUPPORTED( func, path ) std::cerr << "ARCHIVE: NOT SUPPORTED " << func << " for file:" << path << std::endl;
 #define ARCHIVE_NOT_SUPPORTED_MAPPED( func, fakeId, realId ) std::cerr << "ARCHIVE: NOT SUPPORTED " << func << " for fike_fileId:" << fakeId << " real_fileId:" << realId << std::endl;
@@ -48,95 +62,184 @@ typedef struct
   Archive* pArchive_ = nullptr;
 } RequestSheath;
 
+/// One read within a batch passed to Manager::fs_read_batch()
+typedef struct
+{
+  /// The file id as returned by uv_fs_open
+  uv_file file_ = 0;
+  /// Where in the file to read from, must be >= 0
+  int64_t offset_ = 0;
+  /// Were to read to
+  uv_buf_t buf_;
+  /// The number of bytes read or a UV_* error code.
+  ssize_t result_ = 0;
+
+  /// Filled in by the manager before the batch is run.
+  //@{
+  uv_file real_fileId_ = 0;
+  const char* content_ = nullptr;
+  size_t content_size_ = 0;
+  //@}
+} ReadBatchItem;
+
+struct _ReadBatchRequest;
+typedef void (*ReadBatchCb)(struct _ReadBatchRequest* request);
+
+/// A batch of reads resolved with one trip to the threadpool.
+/// data is left for the caller to use.
+typedef struct _ReadBatchRequest : public uv_work_t
+{
+  ReadBatchItem* items_ = nullptr;
+  unsigned int nitems_ = 0;
+  ReadBatchCb cb_ = nullptr;
+} ReadBatchRequest;
+
+/// The children of a dir listed by Manager::fs_readdir_stats()
+using DirStats = std::vector< DirStatsItem >;
+
+/// One mount's metrics as given by Manager::TakeMetrics()
+typedef struct
+{
+  std::string mount_point_;
+  std::string archive_filepath_;
+  Metrics::Snapshot snapshot_;
+} MountMetrics;
+
+/// The per request pools of every loop as given by Manager::TakePoolStats()
+typedef struct
+{
+  /// Summed over the loops, so the high water marks are of each loop's own peak.
+  RequestPool::Stats pools_;
+  /// The queues completing calls answered without libuv, see UvScheduleDelay
+  RequestPool::Counts schedule_queues_;
+} PoolStats;
+
+/// The fake fd table, shared by every thread using the manager (the main thread and each worker).
+/// fds are spread over ShardCount shards by value, each with its own lock, so threads opening and reading different files rarely wait on each other.
 class Mappings
 {
 public:
   using RealSource = std::pair< uv_file, Archive* >;
+
+  static const int ShardCount = 16;
 private:
-  uv_file counter_ = 10;
+  typedef struct
+  {
+    uv_mutex_t lock_;
+    /// fake fileId => { real fileId or Archive* }
+    std::map< uv_file, RealSource > known_;
+  } Shard;
+
+  std::atomic< uv_file > counter_;
+
+  Shard shards_[ ShardCount ];
 
-  /// fake fileId => { real fileId or Archive* }
-  std::map< uv_file, RealSource > known_;
+  Shard& ShardOf( uv_file fake_fileId )
+  {
+    return shards_[ static_cast< unsigned int >( fake_fileId ) % ShardCount ];
+  }
 
 public:
-  Mappings()
+  Mappings() : counter_( 10 )
   {
+    for( int shard = 0; shard < ShardCount; ++shard )
+    {
+      uv_mutex_init( &shards_[ shard ].lock_ );
+    }
   };
 
   ~Mappings()
   {
+    for( int shard = 0; shard < ShardCount; ++shard )
+    {
+      uv_mutex_destroy( &shards_[ shard ].lock_ );
+    }
   }
 
+  Mappings( const Mappings& ) = delete;
+  Mappings& operator=( const Mappings& ) = delete;
+
   uv_file NextFakeId()
   {
-    uv_file r = counter_;
-    ++counter_;
-    if( counter_ < 10 )
+    // skips the ids below 10 once the counter wraps around.
+    uv_file r = counter_.fetch_add( 1 );
+    while( r < 10 )
     {
-      counter_ = 10;
+      r = counter_.fetch_add( 1 );
     }
     return r;
   }
 
   bool Get( uv_file fake_fileId, RealSource& gotten )
   {
-    std::map< uv_file, RealSource >::iterator found = known_.find( fake_fileId );
-    if( found != known_.end() )
+    Shard& shard = ShardOf( fake_fileId );
+    bool found_it = false;
+
+    uv_mutex_lock( &shard.lock_ );
+    std::map< uv_file, RealSource >::iterator found = shard.known_.find( fake_fileId );
+    if( found != shard.known_.end() )
     {
       gotten = found->second;
-
-      return true;
+      found_it = true;
     }
-    return false;
+    uv_mutex_unlock( &shard.lock_ );
+
+    return found_it;
   }
 
   uv_file GetRealFile( uv_file fake_fileId )
   {
-    std::map< uv_file, RealSource >::iterator found = known_.find( fake_fileId );
-    if( found != known_.end() )
-    {
-      return found->second.first;
-    }
-    return 0;
+    RealSource source( 0, nullptr );
+    Get( fake_fileId, source );
+    return source.first;
   }
 
   Archive* GetArchive( uv_file fake_fileId )
   {
-    std::map< uv_file, RealSource >::iterator found = known_.find( fake_fileId );
-    if( found != known_.end() )
-    {
-      return found->second.second;
-    }
-    return nullptr;
+    RealSource source( 0, nullptr );
+    Get( fake_fileId, source );
+    return source.second;
   }
 
   /// Inserts a real file Id(e.g. to be used by fopen et al) and returns a fake fileId
   uv_file Insert( uv_file fake_fileId, uv_file real_fileId, Archive* owning_archive )
   {
-    known_.insert( std::pair< uv_file, RealSource >( fake_fileId, RealSource( real_fileId, owning_archive ) ) );
+    Shard& shard = ShardOf( fake_fileId );
+
+    uv_mutex_lock( &shard.lock_ );
+    shard.known_.insert( std::pair< uv_file, RealSource >( fake_fileId, RealSource( real_fileId, owning_archive ) ) );
+    uv_mutex_unlock( &shard.lock_ );
+
     return fake_fileId;
   }
 
   /// Inserts an Archive and returns a fake fileId
   uv_file Insert( uv_file fake_fileId, Archive* pArchive )
   {
-    known_.insert( std::pair< uv_file, RealSource >( fake_fileId, RealSource( 0, pArchive ) ) );
-    return fake_fileId;
+    return Insert( fake_fileId, 0, pArchive );
   }
 
   /// Remove a fake file mapping
   void Remove( uv_file fake_fileId )
   {
-    std::map< uv_file, RealSource >::iterator found = known_.find( fake_fileId );
-    if( found != known_.end() )
-    {
-      known_.erase( found );
-    }
+    Shard& shard = ShardOf( fake_fileId );
+
+    uv_mutex_lock( &shard.lock_ );
+    shard.known_.erase( fake_fileId );
+    uv_mutex_unlock( &shard.lock_ );
   }
 };
 
+class ArchiveJUnzip;
+
+/// Every thread's loop (the main thread's and each worker_threads worker's) goes through the one manager.
+/// The archives are all mounted by Init() before any worker starts and their indexes are not changed after the mount, so lookups take no locks.
+/// What does change while node runs (the fd table, the overlay and the library images) has its own locks and completions are delivered on the loop the call was made on.
 class Manager : protected UvScheduleDelay
 {
+  /// Lets the cctests look up archives with Find().
+  friend class ManagerTestPeer;
+
   using Archives = std::vector< Archive* >;
 
   /// Use to report all wrapered uv_fs_* calls
@@ -151,29 +254,92 @@ class Manager : protected UvScheduleDelay
   /// Base of archives caches
   std::string cachesRoot_;
 
+  /// Record and replay the entries opened at startup, turned off with --archive.noprefetch
+  bool use_startup_profile_ = true;
+
+  /// Keep V8 code caches for modules loaded from the archives, turned off with --archive.nocodecache
+  bool use_code_cache_ = true;
+
+  /// Share each archive's index with other processes mounting it, turned off with --archive.noshareindex
+  bool use_shared_index_ = true;
+
+  /// Set by --archive.publickey, archives mounted while it's set must carry a Manifest signed with it.
+  EVP_PKEY* public_key_ = nullptr;
+
+  /// Library images made by GetLibraryFileName(), filepath => memfd
+  std::map< std::string, int > library_images_;
+
+  /// Guards library_images_ as workers can dlopen() too.
+  uv_mutex_t library_images_lock_;
+
+  /// Set by --archive.relayout, were to write the relaid out archive.
+  std::string relayout_filepath_;
+
+  /// Set by --archive.dedup, the relaid out archive stores entries with the same bytes once.
+  bool relayout_dedup_ = false;
+
+  /// The writable dir laid over the archives, set by --archive.upper
+  Overlay overlay_;
+
   /// The mapping table.
   Mappings knownFiles_;
 
+  /// Each loop's pool, made on the loop's first async call and kept until the manager goes.
+  /// A loop that is closed and another made at the same address (as worker threads do) carries on with the same pool.
+  std::map< uv_loop_t*, RequestPool* > pools_;
+
+  /// Guards pools_ but not the pools, each is only used by the thread running its loop.
+  mutable uv_rwlock_t pools_lock_;
+
+  /// Used to run a fs_readdir_stats() or fs_walk() on the threadpool.
+  typedef struct : public uv_work_t
+  {
+    uv_fs_t* request_ = nullptr;
+    Archive* archive_ = nullptr;
+    std::string path_;
+    std::string pattern_;
+    bool types_only_ = false;
+  } DirWork;
+
+  /// Lists path and stats each child, the archive does it if there is one else the dir is read and each child stat'ed relative to it.
+  /// With types_only a child on disk is only stat'ed if its dir entry has no type, the others get a stat_result_ of UV_ECANCELED.
+  /// \return the number of children or a UV_* error code.
+  static int ReadDirStats( Archive* archive, const std::string& path, DirStats& items, bool types_only );
+
   /// Used to find the archive that services passed path.
   /// If no mounted archive is found nullptr is returned and the file should exists on the local file system.
   /// \param filePath - The filepath the caller is looking for
   Archive* Find( const std::string& filePath );
 
+  /// Find() for calls that see the overlay, if path has been copied up it is pointed at the copy and nullptr is returned.
+  Archive* FindLayered( const char*& path, std::string& upper_path );
+
+  /// Completes a call that was answered without libuv, if cb is nullptr result is returned else cb is scheduled.
+  int fs_done( uv_loop_t* loop, uv_fs_t* req, uv_fs_type type, int result, uv_fs_cb cb );
+
   // used to build the cache dir.
   bool BuildCacheDir( const std::string& path = std::string() );
 
+  // Mounts an archive set up by one of the Mount*() calls, it is deleted if that fails.
+  bool MountArchive( ArchiveJUnzip* created_archive );
+
 public:
   Manager();
+  /// Unmounts every archive, nothing may be using their memory by now.
   ~Manager();
 
   // called by node
   bool Init(uv_loop_t* loop, int argc, char** argv );
 
+  /// Called by node after Init() to run any archive tools asked for on the command line (e.g. --archive.relayout)
+  /// \return -1 if node should carry on as normal else the exit code to use.
+  int RunTools();
+
   /// Used to handle the sheathing of file requests
   /// Sheathing is used to translate fake file id's to real ones when dealing with real files (e.g. not in an archive)
   //@{
-  /// Use this to sheath a request
-  void Sheath( uv_fs_t* request, uv_fs_cb cb, uv_file fakeFileId, Archive* pArchive );
+  /// Use this to sheath a request, the sheath comes from loop's pool.
+  void Sheath( uv_loop_t* loop, uv_fs_t* request, uv_fs_cb cb, uv_file fakeFileId, Archive* pArchive );
 
   void Unsheath( uv_fs_t* request );
 
@@ -182,6 +348,13 @@ public:
 
   Mappings& KnownFiles();
 
+  /// \return true if filePath is served by a mounted archive, the overlay is not looked at.
+  bool InArchive( const std::string& filePath );
+
+  /// The real path of path from its archive's index, with no walk of the path's parts.
+  /// \return the archive with result 0 or UV_ENOENT, or nullptr if path is not in an archive or has been copied up to the overlay.
+  Archive* RealPath( const char* path, std::string& real_path, int& result );
+
 	void Report(const char*msg, ...);
 
   /// Get the global copy.
@@ -194,10 +367,47 @@ public:
 	/// returns the cache root dir.
 	const std::string& CacheRoot() const;
 
+  /// Lays a writable dir over the archives, see Overlay, an empty upper_dir takes it away.
+  /// \return 0 or a UV_* error code.
+  int SetUpperDir( const std::string& upper_dir );
+
+  /// Tests there is an upper dir, paths in the archives can then be copied up, removed or renamed.
+  bool HasUpperDir() const;
+
+  /// Sums the metrics of every mounted archive, one MountMetrics per mount in mount order.
+  void TakeMetrics( std::vector< MountMetrics >& metrics ) const;
+
+  /// The pool for what an async call on loop needs until it completes, to be used only on the thread running loop.
+  RequestPool* Pool( uv_loop_t* loop );
+
+  /// Sums the pools of every loop.
+  void TakePoolStats( PoolStats& stats ) const;
+
+  /// Should archives record and prefetch their startup profile.
+  bool UseStartupProfile() const;
+  void SetUseStartupProfile( bool use_startup_profile );
+
+  /// Should archives use and write a SharedIndex.
+  bool UseSharedIndex() const;
+  void SetUseSharedIndex( bool use_shared_index );
+
+  /// Makes every archive mounted from now on verify its Manifest with the PEM public key in pem_filepath.
+  /// \return false if the file does not hold a public key, the key in use is kept.
+  bool SetPublicKey( const std::string& pem_filepath );
+  /// nullptr unless SetPublicKey() was called.
+  EVP_PKEY* PublicKey() const;
+
   // Set the cache directory if you want to.
   bool SetCacheRoot( const std::string& cache_location_path );
 
 	bool Mount( const std::string& archiveFilePath, const std::string& mountPoint );
+
+  /// Mounts the archive held in size bytes of fd from offset, name is what ArchiveFilePath() gives for it.
+  /// An offset < 0 finds a zip appended to fd and a size < 0 reads to the end, see ArchiveJUnzip::SetSource().
+  bool MountFd( uv_file fd, int64_t offset, int64_t size, const std::string& name, const std::string& mountPoint );
+
+  /// Mounts the archive held in size bytes of data, which must stay valid until it is unmounted.
+  bool MountMemory( const char* data, size_t size, const std::string& name, const std::string& mountPoint );
   
   /// Bind to the loop we want to host the manager and archives.
   bool Bind(uv_loop_t* loop);
@@ -208,10 +418,31 @@ public:
   /// Shutdown call this to do all the dirty work
   void Release();
 
+  /// Ends the startup profiles being recorded, node calls this when it exits without returning from Start() (e.g. process.exit()).
+  void EndStartupProfiles();
+
   /// Returns the true filepath of a file.
   /// If the file is in a mounted archive the cache file filepath is returned.  This is used for loading SO/Dylib/DLL
   std::string GetTrueFileName(const std::string& filepath);
 
+  /// Returns the filepath to pass to dlopen() for a shared library.
+  /// On Linux libraries in a mounted archive are loaded into a memfd straight from the archive and /proc/self/fd/N is returned so the cache file is not needed.
+  /// Everywhere else this is the same as GetTrueFileName().
+  std::string GetLibraryFileName(const std::string& filepath);
+
+  /// The V8 code cache of a module in an archive, used by the CJS loader to skip compiling it.
+  /// tag names what made the cache (the V8 version) as a cache made by another V8 is no use.
+  /// The cache written by WriteCodeCache() is used first, then an entry filepath + ".v8cache" shipped in the archive.
+  /// \return false if filepath is not in an archive or code caching is off, else true with content empty if there is no cache yet.
+  bool ReadCodeCache(const std::string& filepath, const std::string& tag, std::vector< char >& content);
+
+  /// Writes the V8 code cache of a module in an archive to the archive's cache dir.
+  bool WriteCodeCache(const std::string& filepath, const std::string& tag, const char* data, size_t size);
+
+  /// Gives the in memory view of a file opened with uv_fs_open(), see Archive::ContentView()
+  /// \return false if the file is not in an archive or can only be read using uv_fs_read().
+  bool ContentView( uv_file fake_fileId, const char** content, size_t* content_size );
+
   /// libuv file system proxy layer
   //@{
 
@@ -235,6 +466,17 @@ public:
   static void fs_write_on(uv_fs_t* request);
   static void fs_fsync_on(uv_fs_t* request);
   static void fs_fdatasync_on(uv_fs_t* request);
+  static void fs_sendfile_on(uv_fs_t* request);
+
+  static void fs_read_batch_work(uv_work_t* request);
+  static void fs_read_batch_on(uv_work_t* request, int status);
+
+  // used by both fs_readdir_stats() and fs_readdir_types()
+  int fs_readdir(uv_loop_t* loop, uv_fs_t* req, const char* path, bool types_only, uv_fs_cb cb);
+  static void fs_readdir_stats_work(uv_work_t* request);
+  static void fs_walk_work(uv_work_t* request);
+  // used by both fs_readdir_stats() and fs_walk()
+  static void fs_dir_work_on(uv_work_t* request, int status);
 
   //@}
 
@@ -249,9 +491,37 @@ public:
   int fs_open(uv_loop_t* loop, uv_fs_t* req, const char* path, int flags, int mode, uv_fs_cb cb);
   int fs_read(uv_loop_t* loop, uv_fs_t* req, uv_file hFake, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset, uv_fs_cb cb);
   int fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file hFake,  uv_fs_cb cb);
+
+  /// Reads many (file, offset, buffer) items in one go.
+  /// Items served from an archive's memory are memcpy'ed, the rest use a blocking read.
+  /// If cb is nullptr the batch is run on the calling thread, otherwise it's run on the threadpool and cb is called on loop.
+  /// The result of each read is in item.result_, the return is 0 or a UV_* error code if the batch could not be started.
+  int fs_read_batch(uv_loop_t* loop, ReadBatchRequest* req, ReadBatchItem* items, unsigned int nitems, ReadBatchCb cb);
   int fs_fstat(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb);
+
+  /// Lists a dir and stats every child in one call, archive dirs are answered from the archive's index and real dirs on the threadpool.
+  /// req->result is the number of children or a UV_* error code, use uv_fs_get_dir_stats() to get them.
+  /// A child that could not be stat'ed has its DirStatsItem::stat_result_ set, the call as a whole still passes.
+  int fs_readdir_stats(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb);
+
+  /// fs_readdir_stats() for when only the children's types are wanted, as fs.readdir() withFileTypes.
+  /// A child in a real dir is only stat'ed if its dir entry has no type, the others have a stat_result_ of UV_ECANCELED.
+  int fs_readdir_types(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb);
+
+  /// Walks every item below a dir, archive dirs are walked straight off the archive's tree and real dirs on the threadpool.
+  /// Only items whose path (relative to path) match the glob pattern are listed, nullptr or "" lists everything. See Walk::Match()
+  /// req->result is the number of items or a UV_* error code, use uv_fs_get_walk_entries() to get them.
+  int fs_walk(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* pattern, uv_fs_cb cb);
   int fs_realpath(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb);
 
+  /// Changes to paths in an archive go to the overlay, without one they fail with UV_EROFS.
+  //@{
+  int fs_unlink(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb);
+  int fs_mkdir(uv_loop_t* loop, uv_fs_t* req, const char* path, int mode, uv_fs_cb cb);
+  int fs_rmdir(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb);
+  int fs_rename(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* new_path, uv_fs_cb cb);
+  //@}
+
   int fs_write(uv_loop_t* loop, uv_fs_t* req, uv_file file, const uv_buf_t bufs[], unsigned int nbufs, int64_t offset, uv_fs_cb cb);
   int fs_fsync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb);
   int fs_fdatasync(uv_loop_t* loop, uv_fs_t* req, uv_file file, uv_fs_cb cb);
@@ -261,6 +531,14 @@ public:
   int fs_fchmod(uv_loop_t* loop,uv_fs_t* req,uv_file file,int mode,uv_fs_cb cb);
   int fs_fchown(uv_loop_t* loop,  uv_fs_t* req,  uv_file file,  uv_uid_t uid,  uv_gid_t gid,  uv_fs_cb cb);
   //@}
+
+  /// libuv watcher proxy layer
+  /// A mount is never reloaded so a path in a mounted archive gets an inert watch: the handle is started and keeps the loop alive but its callback is never called and nothing is polled.
+  /// A path that has been copied up to the upper dir has the copy watched as normal, one copied up after the watch started keeps the inert watch.
+  //@{
+  int fs_event_start(uv_fs_event_t* handle, uv_fs_event_cb cb, const char* path, unsigned int flags);
+  int fs_poll_start(uv_fs_poll_t* handle, uv_fs_poll_cb cb, const char* path, unsigned int interval);
+  //@}
 };
 
 
@@ -273,6 +551,7 @@ void uv_fs_req_cleanup(uv_fs_t* req);
 int uv_fs_close(uv_loop_t* loop, uv_fs_t* req, uv_file file,  uv_fs_cb cb);
 int uv_fs_open(uv_loop_t* loop,  uv_fs_t* req, const char* path, int flags, int mode,  uv_fs_cb cb);
 int uv_fs_read(uv_loop_t* loop, uv_fs_t* req,  uv_file file, const uv_buf_t bufs[], unsigned int nbufs,   int64_t offset,  uv_fs_cb cb);
+int uv_fs_read_batch(uv_loop_t* loop, ReadBatchRequest* req, ReadBatchItem* items, unsigned int nitems, ReadBatchCb cb);
 int uv_fs_unlink(uv_loop_t* loop, uv_fs_t* req,  const char* path,  uv_fs_cb cb);
 int uv_fs_write(uv_loop_t* loop,  uv_fs_t* req,  uv_file file, const uv_buf_t bufs[], unsigned int nbufs,  int64_t offset, uv_fs_cb cb);
 int uv_fs_copyfile(uv_loop_t* loop,  uv_fs_t* req, const char* path,  const char* new_path,  int flags,  uv_fs_cb cb);
@@ -281,6 +560,11 @@ int uv_fs_mkdtemp(uv_loop_t* loop, uv_fs_t* req, const char* tpl, uv_fs_cb cb);
 int uv_fs_rmdir(uv_loop_t* loop, uv_fs_t* req, const char* path,  uv_fs_cb cb);
 int uv_fs_scandir(uv_loop_t* loop, uv_fs_t* req, const char* path,  int flags, uv_fs_cb cb);
 int uv_fs_scandir_next(uv_fs_t* req, uv_dirent_t* ent);
+int uv_fs_readdir_stats(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb);
+int uv_fs_readdir_types(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb);
+const DirStats* uv_fs_get_dir_stats(const uv_fs_t* req);
+int uv_fs_walk(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* pattern, uv_fs_cb cb);
+const WalkEntries* uv_fs_get_walk_entries(const uv_fs_t* req);
 int uv_fs_stat(uv_loop_t* loop, uv_fs_t* req, const char* path, uv_fs_cb cb);
 int uv_fs_fstat(uv_loop_t* loop, uv_fs_t* req,  uv_file file, uv_fs_cb cb);
 int uv_fs_rename(uv_loop_t* loop, uv_fs_t* req, const char* path, const char* new_path,  uv_fs_cb cb);
@@ -301,6 +585,8 @@ int uv_fs_fchmod(uv_loop_t* loop, uv_fs_t* req, uv_file file,  int mode,  uv_fs_
 int uv_fs_chown(uv_loop_t* loop, uv_fs_t* req,  const char* path, uv_uid_t uid, uv_gid_t gid, uv_fs_cb cb);
 int uv_fs_fchown(uv_loop_t* loop, uv_fs_t* req,  uv_file file, uv_uid_t uid, uv_gid_t gid, uv_fs_cb cb);
 int uv_fs_lchown(uv_loop_t* loop,uv_fs_t* req, const char* path, uv_uid_t uid, uv_gid_t gid, uv_fs_cb cb);
+int uv_fs_event_start(uv_fs_event_t* handle, uv_fs_event_cb cb, const char* path, unsigned int flags);
+int uv_fs_poll_start(uv_fs_poll_t* handle, uv_fs_poll_cb cb, const char* path, unsigned int interval);
 }
 
 #endif /* SRC_ARCHIVE_MANAGER_H_ */
@@ -0,0 +1,175 @@
+#include "archive/manifest.h"
+
+#include <cstring>
+
+#include <openssl/bio.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+
+namespace archive
+{
+
+const char* const Manifest::EntryName = ".archive-manifest";
+const char* const Manifest::SignatureEntryName = ".archive-manifest.sig";
+
+EVP_PKEY* Manifest::LoadPublicKey( const std::string& filepath )
+{
+  // a BIO rather than a FILE* as Windows builds of openssl can't use the caller's FILE*s.
+  BIO* bio = ::BIO_new_file( filepath.c_str(), "r" );
+  if( bio == nullptr )
+  {
+    return nullptr;
+  }
+
+  EVP_PKEY* key = ::PEM_read_bio_PUBKEY( bio, nullptr, nullptr, nullptr );
+
+  ::BIO_free( bio );
+
+  return key;
+}
+
+void Manifest::FreePublicKey( EVP_PKEY* key )
+{
+  if( key != nullptr )
+  {
+    ::EVP_PKEY_free( key );
+  }
+}
+
+bool Manifest::VerifySignature( EVP_PKEY* key, const char* data, size_t size, const char* signature, size_t signature_size )
+{
+  EVP_MD_CTX* context = ::EVP_MD_CTX_new();
+  if( context == nullptr )
+  {
+    return false;
+  }
+
+  bool verified = ::EVP_DigestVerifyInit( context, nullptr, ::EVP_sha256(), nullptr, key ) == 1 &&
+                  ::EVP_DigestVerifyUpdate( context, data, size ) == 1 &&
+                  ::EVP_DigestVerifyFinal( context, reinterpret_cast< const unsigned char* >( signature ), signature_size ) == 1;
+
+  ::EVP_MD_CTX_free( context );
+
+  return verified;
+}
+
+void Manifest::Sha256( const char* data, size_t size, unsigned char digest[ DigestLength ] )
+{
+  ::SHA256( reinterpret_cast< const unsigned char* >( data ), size, digest );
+}
+
+static int HexValue( char c )
+{
+  if( c >= '0' && c <= '9' )
+  {
+    return c - '0';
+  }
+  if( c >= 'a' && c <= 'f' )
+  {
+    return c - 'a' + 10;
+  }
+  if( c >= 'A' && c <= 'F' )
+  {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+bool Manifest::Parse( const char* data, size_t size )
+{
+  entries_.clear();
+
+  const char* line = data;
+  const char* end = data + size;
+
+  while( line < end )
+  {
+    const char* line_end = static_cast< const char* >( std::memchr( line, '\n', end - line ) );
+    if( line_end == nullptr )
+    {
+      line_end = end;
+    }
+
+    const char* next_line = ( line_end < end ) ? line_end + 1 : end;
+
+    if( line_end > line && line_end[ -1 ] == '\r' )
+    {
+      --line_end;
+    }
+
+    // blank lines are allowed so a trailing new line is.
+    if( line_end == line )
+    {
+      line = next_line;
+      continue;
+    }
+
+    Entry entry;
+    const char* current = line;
+
+    if( line_end - current < static_cast< ptrdiff_t >( DigestLength * 2 + 1 ) )
+    {
+      return false;
+    }
+
+    for( size_t i=0; i<DigestLength; ++i )
+    {
+      const int high = HexValue( current[ i * 2 ] );
+      const int low = HexValue( current[ i * 2 + 1 ] );
+      if( high < 0 || low < 0 )
+      {
+        return false;
+      }
+      entry.sha256_[ i ] = static_cast< unsigned char >( ( high << 4 ) | low );
+    }
+
+    current += DigestLength * 2;
+    if( *current != ' ' )
+    {
+      return false;
+    }
+    ++current;
+
+    entry.size_ = 0;
+    const char* size_start = current;
+    while( current < line_end && *current >= '0' && *current <= '9' )
+    {
+      entry.size_ = ( entry.size_ * 10 ) + static_cast< uint64_t >( *current - '0' );
+      ++current;
+    }
+
+    // the rest of the line is the name, it may have spaces in it.
+    if( current == size_start || current == line_end || *current != ' ' || current + 1 == line_end )
+    {
+      return false;
+    }
+    ++current;
+
+    if( entries_.insert( std::make_pair( std::string( current, line_end - current ), entry ) ).second == false )
+    {
+      return false;
+    }
+
+    line = next_line;
+  }
+
+  return true;
+}
+
+const Manifest::Entry* Manifest::Find( const char* name ) const
+{
+  std::map< std::string, Entry >::const_iterator found = entries_.find( name );
+  if( found == entries_.end() )
+  {
+    return nullptr;
+  }
+  return &found->second;
+}
+
+size_t Manifest::Count() const
+{
+  return entries_.size();
+}
+
+}
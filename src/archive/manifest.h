@@ -0,0 +1,59 @@
+#ifndef SRC_ARCHIVE_MANIFEST_H_
+#define SRC_ARCHIVE_MANIFEST_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <map>
+#include <string>
+
+typedef struct evp_pkey_st EVP_PKEY;
+
+namespace archive
+{
+
+/// A signed list of the files in an archive and their SHA-256, so tampering is found without hashing the whole archive at mount.
+/// The archive holds it as the entry EntryName, one "<sha256 as hex> <size> <name>" line per file with the name as in the central directory,
+/// and its signature as the entry SignatureEntryName, made over EntryName's bytes with SHA-256, e.g. by `openssl dgst -sha256 -sign key.pem`.
+/// At mount the signature is checked and every file in the central directory has to be listed with its size,
+/// a file's content is only hashed the first time it is opened, extracted or loaded.
+class Manifest
+{
+public:
+  static const char* const EntryName;
+  static const char* const SignatureEntryName;
+
+  static const size_t DigestLength = 32;
+
+  typedef struct
+  {
+    uint64_t size_;
+    unsigned char sha256_[ DigestLength ];
+  } Entry;
+
+  /// Reads a PEM public key.
+  /// \return the key, free it with FreePublicKey(), or nullptr if filepath does not hold one.
+  static EVP_PKEY* LoadPublicKey( const std::string& filepath );
+  static void FreePublicKey( EVP_PKEY* key );
+
+  /// \return true if signature is key's signature of data.
+  static bool VerifySignature( EVP_PKEY* key, const char* data, size_t size, const char* signature, size_t signature_size );
+
+  static void Sha256( const char* data, size_t size, unsigned char digest[ DigestLength ] );
+
+  /// Reads the content of EntryName.
+  /// \return false if a line is not understood or a name is listed twice.
+  bool Parse( const char* data, size_t size );
+
+  /// \return the listing of name or nullptr if it's not listed, the listing lives as long as the manifest.
+  const Entry* Find( const char* name ) const;
+
+  size_t Count() const;
+
+private:
+  std::map< std::string, Entry > entries_;
+};
+
+}
+
+#endif /* SRC_ARCHIVE_MANIFEST_H_ */
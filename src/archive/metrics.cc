@@ -0,0 +1,262 @@
+#include "archive/metrics.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace archive
+{
+
+/// Only written by the owning thread, relaxed atomics let Take() read them from any thread.
+struct Metrics::Shard
+{
+  struct ShardHistogram
+  {
+    std::atomic< uint64_t > count_;
+    std::atomic< uint64_t > total_;
+    std::atomic< uint64_t > max_;
+    std::atomic< uint64_t > buckets_[ BucketCount ];
+  };
+
+  std::atomic< uint64_t > counters_[ CounterCount ];
+  ShardHistogram histograms_[ TimerCount ];
+
+  Shard()
+  {
+    for( int i=0; i<CounterCount; ++i )
+    {
+      counters_[ i ].store( 0, std::memory_order_relaxed );
+    }
+
+    for( int i=0; i<TimerCount; ++i )
+    {
+      histograms_[ i ].count_.store( 0, std::memory_order_relaxed );
+      histograms_[ i ].total_.store( 0, std::memory_order_relaxed );
+      histograms_[ i ].max_.store( 0, std::memory_order_relaxed );
+
+      for( int x=0; x<BucketCount; ++x )
+      {
+        histograms_[ i ].buckets_[ x ].store( 0, std::memory_order_relaxed );
+      }
+    }
+  }
+};
+
+thread_local std::vector< std::pair< uint64_t, Metrics::Shard* > > Metrics::local_shards_;
+
+static std::atomic< uint64_t > gNextMetricsId( 1 );
+
+// A single writer so there is no need for a locked add.
+static inline void Bump( std::atomic< uint64_t >& value, uint64_t by )
+{
+  value.store( value.load( std::memory_order_relaxed ) + by, std::memory_order_relaxed );
+}
+
+static inline int HighestBit( uint64_t value )
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64( &index, value );
+  return static_cast< int >( index );
+#else
+  return 63 - __builtin_clzll( value );
+#endif
+}
+
+static int BucketIndex( uint64_t value )
+{
+  const uint64_t sub_bucket_count = ( 1 << Metrics::SubBucketBits );
+
+  if( value < sub_bucket_count )
+  {
+    return static_cast< int >( value );
+  }
+
+  const int shift = HighestBit( value ) - Metrics::SubBucketBits;
+
+  return static_cast< int >( ( ( shift + 1 ) << Metrics::SubBucketBits ) + ( ( value >> shift ) & ( sub_bucket_count - 1 ) ) );
+}
+
+// The highest value that lands in the bucket.
+static uint64_t BucketValue( int index )
+{
+  const uint64_t sub_bucket_count = ( 1 << Metrics::SubBucketBits );
+
+  if( index < static_cast< int >( sub_bucket_count ) )
+  {
+    return index;
+  }
+
+  const int shift = ( index >> Metrics::SubBucketBits ) - 1;
+  const uint64_t sub_bucket = sub_bucket_count + ( index & ( sub_bucket_count - 1 ) );
+
+  return ( ( sub_bucket + 1 ) << shift ) - 1;
+}
+
+/*************************************************************************************************************/
+
+Metrics::Histogram::Histogram()
+  : buckets_( BucketCount, 0 )
+{
+}
+
+uint64_t Metrics::Histogram::Percentile( double percentile ) const
+{
+  if( count_ == 0 )
+  {
+    return 0;
+  }
+
+  uint64_t target = static_cast< uint64_t >( ( percentile / 100.0 ) * count_ + 0.5 );
+  if( target == 0 )
+  {
+    target = 1;
+  }
+
+  uint64_t seen = 0;
+
+  for( int i=0; i<BucketCount; ++i )
+  {
+    seen += buckets_[ i ];
+
+    if( seen >= target )
+    {
+      const uint64_t value = BucketValue( i );
+      return ( value < max_ ) ? value : max_;
+    }
+  }
+
+  return max_;
+}
+
+Metrics::Snapshot::Snapshot()
+{
+  for( int i=0; i<CounterCount; ++i )
+  {
+    counters_[ i ] = 0;
+  }
+}
+
+const char* const Metrics::CounterNames[ CounterCount ] = { "stats", "opens", "reads", "bytesRead", "memoryReads", "cacheHits", "cacheMisses" };
+const char* const Metrics::TimerNames[ TimerCount ] = { "stat", "open", "read", "inflate", "extract" };
+const char* const Metrics::HistogramFieldNames[ HistogramFieldsLength ] = { "count", "total", "max", "p50", "p90", "p99" };
+
+void Metrics::Snapshot::Fill( double* fields ) const
+{
+  static const double NsPerMs = 1e6;
+
+  for( int i=0; i<CounterCount; ++i )
+  {
+    *fields++ = static_cast< double >( counters_[ i ] );
+  }
+
+  for( int i=0; i<TimerCount; ++i )
+  {
+    const Histogram& histogram = histograms_[ i ];
+
+    *fields++ = static_cast< double >( histogram.count_ );
+    *fields++ = histogram.total_ / NsPerMs;
+    *fields++ = histogram.max_ / NsPerMs;
+    *fields++ = histogram.Percentile( 50 ) / NsPerMs;
+    *fields++ = histogram.Percentile( 90 ) / NsPerMs;
+    *fields++ = histogram.Percentile( 99 ) / NsPerMs;
+  }
+}
+
+/*************************************************************************************************************/
+
+Metrics::Metrics()
+  : id_( gNextMetricsId++ )
+{
+  uv_mutex_init( &lock_ );
+}
+
+Metrics::~Metrics()
+{
+  // Threads keep our id in local_shards_ but ids are never reused so the shards are never looked at again.
+  for( std::vector< Shard* >::iterator shard=shards_.begin(); shard!=shards_.end(); ++shard )
+  {
+    delete *shard;
+  }
+
+  uv_mutex_destroy( &lock_ );
+}
+
+Metrics::Shard* Metrics::LocalShard()
+{
+  for( std::vector< std::pair< uint64_t, Shard* > >::const_iterator local=local_shards_.begin(); local!=local_shards_.end(); ++local )
+  {
+    if( local->first == id_ )
+    {
+      return local->second;
+    }
+  }
+
+  Shard* shard = new Shard();
+
+  uv_mutex_lock( &lock_ );
+  shards_.push_back( shard );
+  uv_mutex_unlock( &lock_ );
+
+  local_shards_.push_back( std::pair< uint64_t, Shard* >( id_, shard ) );
+
+  return shard;
+}
+
+void Metrics::Add( Counter counter, uint64_t value )
+{
+  Bump( LocalShard()->counters_[ counter ], value );
+}
+
+void Metrics::Record( Timer timer, uint64_t start )
+{
+  const uint64_t elapsed = uv_hrtime() - start;
+
+  Shard::ShardHistogram& histogram = LocalShard()->histograms_[ timer ];
+
+  Bump( histogram.count_, 1 );
+  Bump( histogram.total_, elapsed );
+  Bump( histogram.buckets_[ BucketIndex( elapsed ) ], 1 );
+
+  if( elapsed > histogram.max_.load( std::memory_order_relaxed ) )
+  {
+    histogram.max_.store( elapsed, std::memory_order_relaxed );
+  }
+}
+
+void Metrics::Take( Snapshot& snapshot ) const
+{
+  uv_mutex_lock( &lock_ );
+
+  for( std::vector< Shard* >::const_iterator shard=shards_.begin(); shard!=shards_.end(); ++shard )
+  {
+    for( int i=0; i<CounterCount; ++i )
+    {
+      snapshot.counters_[ i ] += ( *shard )->counters_[ i ].load( std::memory_order_relaxed );
+    }
+
+    for( int i=0; i<TimerCount; ++i )
+    {
+      const Shard::ShardHistogram& from = ( *shard )->histograms_[ i ];
+      Histogram& to = snapshot.histograms_[ i ];
+
+      to.count_ += from.count_.load( std::memory_order_relaxed );
+      to.total_ += from.total_.load( std::memory_order_relaxed );
+
+      const uint64_t max = from.max_.load( std::memory_order_relaxed );
+      if( max > to.max_ )
+      {
+        to.max_ = max;
+      }
+
+      for( int x=0; x<BucketCount; ++x )
+      {
+        to.buckets_[ x ] += from.buckets_[ x ].load( std::memory_order_relaxed );
+      }
+    }
+  }
+
+  uv_mutex_unlock( &lock_ );
+}
+
+}
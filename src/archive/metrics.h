@@ -0,0 +1,116 @@
+#ifndef SRC_ARCHIVE_METRICS_H_
+#define SRC_ARCHIVE_METRICS_H_
+
+#include <uv.h>
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace archive
+{
+
+/// I/O counters and latency histograms for one archive, cheap enough to leave on in production.
+/// Each thread that records gets its own shard so recording never takes a lock, Take() sums the shards on demand.
+class Metrics
+{
+public:
+  enum Counter
+  {
+    Stats = 0,
+    Opens,
+    Reads,
+    /// Bytes returned by reads
+    BytesRead,
+    /// Reads served from the in memory view rather than the cache file
+    MemoryReads,
+    /// Entries whose extraction cache file was reused at mount
+    CacheHits,
+    /// Entries that had to be extracted at mount
+    CacheMisses,
+    CounterCount
+  };
+
+  enum Timer
+  {
+    StatTime = 0,
+    OpenTime,
+    ReadTime,
+    InflateTime,
+    ExtractTime,
+    TimerCount
+  };
+
+  /// Buckets are log-linear like HdrHistogram, 2^SubBucketBits per power of two so a value is within 12.5% of its bucket.
+  static const int SubBucketBits = 3;
+  static const int BucketCount = ( 64 << SubBucketBits );
+
+  /// The fields Snapshot::Fill() writes per histogram, count, total, max, p50, p90 and p99 with times in ms.
+  static const int HistogramFieldsLength = 6;
+  /// The fields Snapshot::Fill() writes, the counters in Counter order followed by the histograms in Timer order.
+  static const int FieldsLength = CounterCount + ( TimerCount * HistogramFieldsLength );
+
+  /// The names process.archiveStats() gives the counters, timers and histogram fields, in the order Snapshot::Fill() writes them.
+  static const char* const CounterNames[ CounterCount ];
+  static const char* const TimerNames[ TimerCount ];
+  static const char* const HistogramFieldNames[ HistogramFieldsLength ];
+
+  /// A histogram of nanosecond timings.
+  struct Histogram
+  {
+    uint64_t count_ = 0;
+    uint64_t total_ = 0;
+    uint64_t max_ = 0;
+    std::vector< uint64_t > buckets_;
+
+    Histogram();
+
+    /// The value at or below which percentile % of the timings fall.
+    uint64_t Percentile( double percentile ) const;
+  };
+
+  /// The metrics summed over every thread.
+  struct Snapshot
+  {
+    uint64_t counters_[ CounterCount ];
+    Histogram histograms_[ TimerCount ];
+
+    Snapshot();
+
+    /// Writes FieldsLength doubles to fields.
+    void Fill( double* fields ) const;
+  };
+
+  Metrics();
+  ~Metrics();
+
+  void Add( Counter counter, uint64_t value = 1 );
+
+  /// Records the time since start, which came from uv_hrtime()
+  void Record( Timer timer, uint64_t start );
+
+  void Take( Snapshot& snapshot ) const;
+
+private:
+  struct Shard;
+
+  /// Tells the metrics apart in local_shards_, never reused.
+  uint64_t id_ = 0;
+
+  /// Guards shards_
+  mutable uv_mutex_t lock_;
+  std::vector< Shard* > shards_;
+
+  /// The shard of every Metrics this thread has recorded to, by id_
+  static thread_local std::vector< std::pair< uint64_t, Shard* > > local_shards_;
+
+  Shard* LocalShard();
+
+  Metrics( const Metrics& ) = delete;
+  Metrics& operator=( const Metrics& ) = delete;
+};
+
+}
+
+#endif /* SRC_ARCHIVE_METRICS_H_ */
@@ -0,0 +1,520 @@
+#include "archive/overlay.h"
+#include "archive/walk.h"
+
+#include <fcntl.h>
+
+namespace archive
+{
+
+namespace
+{
+
+// Holds the read side of a lock for a scope.
+class ReadLock
+{
+  uv_rwlock_t* lock_;
+
+public:
+  explicit ReadLock( uv_rwlock_t* lock ) : lock_( lock )
+  {
+    uv_rwlock_rdlock( lock_ );
+  }
+
+  ~ReadLock()
+  {
+    uv_rwlock_rdunlock( lock_ );
+  }
+};
+
+// Holds the write side of a lock for a scope.
+class WriteLock
+{
+  uv_rwlock_t* lock_;
+
+public:
+  explicit WriteLock( uv_rwlock_t* lock ) : lock_( lock )
+  {
+    uv_rwlock_wrlock( lock_ );
+  }
+
+  ~WriteLock()
+  {
+    uv_rwlock_wrunlock( lock_ );
+  }
+};
+
+// The name of the empty file that records a whiteout of name in the same dir, as aufs does it.
+const char WhiteoutPrefix[] = ".wh.";
+
+}
+
+Overlay::Overlay()
+{
+  uv_rwlock_init( &lock_ );
+}
+
+Overlay::~Overlay()
+{
+  uv_rwlock_destroy( &lock_ );
+}
+
+std::string Overlay::Relative( Archive* archive, const char* path )
+{
+  std::string relative;
+  const std::vector< std::string > parts = archive->FilePathToParts( path );
+
+  for( std::vector< std::string >::const_iterator part=parts.begin(); part!=parts.end(); ++part )
+  {
+    relative += ( relative.length() ? "/" : "" ) + *part;
+  }
+
+  return relative;
+}
+
+std::string Overlay::Key( Archive* archive, const std::string& relative )
+{
+  const std::string& mount_point = archive->MountPoint();
+
+  return Archive::GetMD5( mount_point.data(), mount_point.length() ) + ( relative.length() ? "/" : "" ) + relative;
+}
+
+bool Overlay::WhitedOut( const std::string& key ) const
+{
+  if( whiteouts_.empty() )
+  {
+    return false;
+  }
+
+  for( size_t sep = key.find( '/' ); sep != std::string::npos; sep = key.find( '/', sep + 1 ) )
+  {
+    if( whiteouts_.find( key.substr( 0, sep ) ) != whiteouts_.end() )
+    {
+      return true;
+    }
+  }
+
+  return whiteouts_.find( key ) != whiteouts_.end();
+}
+
+int Overlay::AddWhiteout( const std::string& key )
+{
+  if( WhitedOut( key ) )
+  {
+    return 0;
+  }
+
+  whiteouts_.insert( key );
+
+  const size_t last_sep = key.rfind( '/' );
+  const std::string marker = upper_dir_ + "/" + key.substr( 0, last_sep + 1 ) + WhiteoutPrefix + key.substr( last_sep + 1 );
+
+  uv_fs_t marker_req;
+  int r = ::uv_fs_open( nullptr, &marker_req, marker.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666, nullptr );
+  ::uv_fs_req_cleanup( &marker_req );
+
+  if( r >= 0 )
+  {
+    ::uv_fs_close( nullptr, &marker_req, r, nullptr );
+    ::uv_fs_req_cleanup( &marker_req );
+    r = 0;
+  }
+
+  return r;
+}
+
+bool Overlay::ParentExists( Archive* archive, const std::string& relative )
+{
+  const size_t last_sep = relative.rfind( '/' );
+
+  // the mount point itself.
+  if( last_sep == std::string::npos )
+  {
+    return true;
+  }
+
+  const std::string parent = relative.substr( 0, last_sep );
+  const std::string parent_key = Key( archive, parent );
+
+  if( entries_.find( parent_key ) != entries_.end() )
+  {
+    return true;
+  }
+
+  if( WhitedOut( parent_key ) )
+  {
+    return false;
+  }
+
+  const ArchiveItem* item = archive->Lookup( ( archive->MountPoint() + "/" + parent ).c_str() );
+
+  return item != nullptr && item->IsFile() == false;
+}
+
+int Overlay::MakeParentDirs( const std::string& key )
+{
+  for( size_t sep = key.find( '/' ); sep != std::string::npos; sep = key.find( '/', sep + 1 ) )
+  {
+    const std::string dir = upper_dir_ + "/" + key.substr( 0, sep );
+
+    uv_fs_t mkdir_req;
+    int r = ::uv_fs_mkdir( nullptr, &mkdir_req, dir.c_str(), 0777, nullptr );
+    ::uv_fs_req_cleanup( &mkdir_req );
+
+    if( r < 0 && r != UV_EEXIST )
+    {
+      return r;
+    }
+  }
+
+  return 0;
+}
+
+void Overlay::Forget( const std::string& key )
+{
+  entries_.erase( key );
+
+  const std::string below = key + "/";
+
+  std::set< std::string >::iterator entry = entries_.lower_bound( below );
+  while( entry != entries_.end() && entry->compare( 0, below.length(), below ) == 0 )
+  {
+    entry = entries_.erase( entry );
+  }
+}
+
+void Overlay::Remember( const std::string& key )
+{
+  entries_.insert( key );
+
+  // a renamed dir brings everything below it.
+  WalkEntries below;
+
+  if( Walk::Disk( upper_dir_ + "/" + key, std::string(), below ) > 0 )
+  {
+    for( WalkEntries::const_iterator entry=below.begin(); entry!=below.end(); ++entry )
+    {
+      Add( key + "/" + entry->path_ );
+    }
+  }
+}
+
+void Overlay::Add( const std::string& key )
+{
+  const size_t name_start = key.rfind( '/' ) + 1;
+
+  if( key.compare( name_start, sizeof( WhiteoutPrefix ) - 1, WhiteoutPrefix ) == 0 )
+  {
+    whiteouts_.insert( key.substr( 0, name_start ) + key.substr( name_start + sizeof( WhiteoutPrefix ) - 1 ) );
+  }
+  else
+  {
+    entries_.insert( key );
+  }
+}
+
+int Overlay::SetUpperDir( const std::string& upper_dir )
+{
+  WriteLock lock( &lock_ );
+
+  upper_dir_ = upper_dir;
+  entries_.clear();
+  whiteouts_.clear();
+
+  // no upper dir turns the overlay off.
+  if( upper_dir_.length() == 0 )
+  {
+    return 0;
+  }
+
+  while( upper_dir_.length() > 1 && ( upper_dir_.back() == '/' || upper_dir_.back() == '\\' ) )
+  {
+    upper_dir_.pop_back();
+  }
+
+  uv_fs_t req;
+  int r = ::uv_fs_mkdir( nullptr, &req, upper_dir_.c_str(), 0777, nullptr );
+  ::uv_fs_req_cleanup( &req );
+
+  if( r < 0 && r != UV_EEXIST )
+  {
+    upper_dir_.clear();
+    return r;
+  }
+
+  WalkEntries entries;
+
+  r = Walk::Disk( upper_dir_, std::string(), entries );
+  if( r < 0 )
+  {
+    upper_dir_.clear();
+    return r;
+  }
+
+  for( WalkEntries::const_iterator entry=entries.begin(); entry!=entries.end(); ++entry )
+  {
+    Add( entry->path_ );
+  }
+
+  return 0;
+}
+
+bool Overlay::IsEnabled() const
+{
+  return upper_dir_.length() != 0;
+}
+
+bool Overlay::Find( Archive* archive, const char* path, std::string& upper_path )
+{
+  if( IsEnabled() == false )
+  {
+    return false;
+  }
+
+  ReadLock lock( &lock_ );
+
+  if( entries_.empty() && whiteouts_.empty() )
+  {
+    return false;
+  }
+
+  const std::string relative = Relative( archive, path );
+  if( relative.length() == 0 )
+  {
+    return false;
+  }
+
+  const std::string key = Key( archive, relative );
+
+  // a whited out path is only what the upper dir has, which may be nothing.
+  if( entries_.find( key ) == entries_.end() && WhitedOut( key ) == false )
+  {
+    return false;
+  }
+
+  upper_path = upper_dir_ + "/" + key;
+  return true;
+}
+
+int Overlay::Open( Archive* archive, const char* path, int flags, std::string& upper_path )
+{
+  WriteLock lock( &lock_ );
+
+  if( IsEnabled() == false )
+  {
+    return UV_EROFS;
+  }
+
+  const std::string relative = Relative( archive, path );
+  if( relative.length() == 0 )
+  {
+    return UV_EISDIR;
+  }
+
+  const std::string key = Key( archive, relative );
+  upper_path = upper_dir_ + "/" + key;
+
+  if( entries_.find( key ) != entries_.end() )
+  {
+    return 0;
+  }
+
+  const ArchiveItem* item = WhitedOut( key ) ? nullptr : archive->Lookup( path );
+
+  if( item != nullptr && item->IsFile() == false )
+  {
+    return UV_EISDIR;
+  }
+
+  if( item == nullptr && ( ( flags & O_CREAT ) == 0 || ParentExists( archive, relative ) == false ) )
+  {
+    return UV_ENOENT;
+  }
+
+  int r = MakeParentDirs( key );
+  if( r < 0 )
+  {
+    return r;
+  }
+
+  // No point copying what the open is going to truncate.
+  if( item != nullptr && ( flags & ( O_CREAT | O_TRUNC ) ) != ( O_CREAT | O_TRUNC ) )
+  {
+    const std::string cache_filepath = archive->CacheFilePath( path );
+    if( cache_filepath.length() == 0 )
+    {
+      return UV_EIO;
+    }
+
+    // a reflink if the file system can else libuv copies it in the kernel.
+    uv_fs_t copy_req;
+    r = ::uv_fs_copyfile( nullptr, &copy_req, cache_filepath.c_str(), upper_path.c_str(), UV_FS_COPYFILE_FICLONE, nullptr );
+    ::uv_fs_req_cleanup( &copy_req );
+
+    if( r < 0 )
+    {
+      return r;
+    }
+  }
+
+  entries_.insert( key );
+
+  return 0;
+}
+
+int Overlay::Mkdir( Archive* archive, const char* path, int mode )
+{
+  WriteLock lock( &lock_ );
+
+  const std::string relative = Relative( archive, path );
+
+  if( relative.length() == 0 )
+  {
+    return UV_EEXIST;
+  }
+
+  const std::string key = Key( archive, relative );
+
+  if( WhitedOut( key ) == false && archive->Lookup( path ) != nullptr )
+  {
+    return UV_EEXIST;
+  }
+
+  if( IsEnabled() == false )
+  {
+    return UV_EROFS;
+  }
+
+  if( ParentExists( archive, relative ) == false )
+  {
+    return UV_ENOENT;
+  }
+
+  int r = MakeParentDirs( key );
+  if( r < 0 )
+  {
+    return r;
+  }
+
+  uv_fs_t mkdir_req;
+  r = ::uv_fs_mkdir( nullptr, &mkdir_req, ( upper_dir_ + "/" + key ).c_str(), mode, nullptr );
+  ::uv_fs_req_cleanup( &mkdir_req );
+
+  if( r == 0 )
+  {
+    entries_.insert( key );
+  }
+
+  return r;
+}
+
+int Overlay::Remove( Archive* archive, const char* path, bool is_dir )
+{
+  WriteLock lock( &lock_ );
+
+  const std::string relative = Relative( archive, path );
+  const std::string key = Key( archive, relative );
+
+  if( IsEnabled() && relative.length() != 0 && ( entries_.find( key ) != entries_.end() || WhitedOut( key ) ) )
+  {
+    const std::string upper_path = upper_dir_ + "/" + key;
+
+    uv_fs_t remove_req;
+    int r = is_dir ? ::uv_fs_rmdir( nullptr, &remove_req, upper_path.c_str(), nullptr ) : ::uv_fs_unlink( nullptr, &remove_req, upper_path.c_str(), nullptr );
+    ::uv_fs_req_cleanup( &remove_req );
+
+    if( r == 0 )
+    {
+      Forget( key );
+
+      // else the archive's version would be seen again.
+      if( archive->Lookup( path ) != nullptr )
+      {
+        r = AddWhiteout( key );
+      }
+    }
+
+    return r;
+  }
+
+  return ( archive->Lookup( path ) != nullptr ) ? UV_EROFS : UV_ENOENT;
+}
+
+int Overlay::Rename( Archive* from_archive, const char* path, Archive* to_archive, const char* new_path )
+{
+  WriteLock lock( &lock_ );
+
+  std::string from_key;
+  std::string from_path( path );
+
+  if( from_archive != nullptr )
+  {
+    const std::string from_relative = Relative( from_archive, path );
+    from_key = Key( from_archive, from_relative );
+
+    if( IsEnabled() == false || from_relative.length() == 0 || ( entries_.find( from_key ) == entries_.end() && WhitedOut( from_key ) == false ) )
+    {
+      return ( from_archive->Lookup( path ) != nullptr ) ? UV_EROFS : UV_ENOENT;
+    }
+
+    from_path = upper_dir_ + "/" + from_key;
+  }
+
+  std::string to_key;
+  std::string to_path( new_path );
+
+  if( to_archive != nullptr )
+  {
+    if( IsEnabled() == false )
+    {
+      return UV_EROFS;
+    }
+
+    const std::string to_relative = Relative( to_archive, new_path );
+
+    if( to_relative.length() == 0 )
+    {
+      return UV_EBUSY;
+    }
+
+    if( ParentExists( to_archive, to_relative ) == false )
+    {
+      return UV_ENOENT;
+    }
+
+    to_key = Key( to_archive, to_relative );
+
+    int r = MakeParentDirs( to_key );
+    if( r < 0 )
+    {
+      return r;
+    }
+
+    to_path = upper_dir_ + "/" + to_key;
+  }
+
+  uv_fs_t rename_req;
+  int r = ::uv_fs_rename( nullptr, &rename_req, from_path.c_str(), to_path.c_str(), nullptr );
+  ::uv_fs_req_cleanup( &rename_req );
+
+  if( r == 0 )
+  {
+    if( from_archive != nullptr )
+    {
+      Forget( from_key );
+
+      if( from_archive->Lookup( path ) != nullptr )
+      {
+        r = AddWhiteout( from_key );
+      }
+    }
+
+    if( to_archive != nullptr )
+    {
+      Remember( to_key );
+    }
+  }
+
+  return r;
+}
+
+}
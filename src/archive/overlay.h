@@ -0,0 +1,96 @@
+#ifndef SRC_ARCHIVE_OVERLAY_H_
+#define SRC_ARCHIVE_OVERLAY_H_
+
+#include "archive/archive.h"
+
+#include <set>
+#include <string>
+
+namespace archive
+{
+
+/// A writable upper dir laid over the archive mounts, set with --archive.upper.
+/// Archives are read only so the first write to an archive path copies the entry up into the upper dir and from then on the path is served from there.
+/// Each mount has a dir of its own in the upper dir named by the MD5 of its mount point, e.g. <mount>/lib/a.js is copied up to <upper>/<mount id>/lib/a.js.
+/// Removing or renaming away a path the archive has leaves a whiteout, an empty .wh.<name> file next to where it was, so the archive's version stays hidden.
+/// Without an upper dir every write to an archive path fails with UV_EROFS.
+/// All of the calls are synchronous, they are rare and a copy up is a reflink where the file system allows it.
+/// Any thread can use the overlay, Find() only takes the read side of its lock so lookups from different threads don't wait on each other.
+class Overlay
+{
+  /// The upper dir, empty if there is no overlay.
+  std::string upper_dir_;
+
+  /// Every path (as a Key()) in the upper dir, these hide the archive's version.
+  std::set< std::string > entries_;
+
+  /// Every whited out path (as a Key()), these and whatever is below them are only what the upper dir has.
+  std::set< std::string > whiteouts_;
+
+  /// Guards entries_ and whiteouts_, the calls that change the upper dir hold the write side for all of their work.
+  uv_rwlock_t lock_;
+
+  /// Joins the path's parts below the mount point with '/'
+  static std::string Relative( Archive* archive, const char* path );
+
+  /// The path in the upper dir of relative, the mount's id then relative.
+  static std::string Key( Archive* archive, const std::string& relative );
+
+  /// Tests key or a dir above it has been whited out.
+  bool WhitedOut( const std::string& key ) const;
+
+  /// Records a whiteout of key in whiteouts_ and on disk.
+  /// \return 0 or a UV_* error code.
+  int AddWhiteout( const std::string& key );
+
+  /// Adds a path found on disk to entries_ or, if it's a whiteout, to whiteouts_.
+  void Add( const std::string& key );
+
+  /// Tests the parent of path is a dir in the archive or the upper dir.
+  bool ParentExists( Archive* archive, const std::string& relative );
+
+  /// Makes the upper dir's copy of every dir above key.
+  int MakeParentDirs( const std::string& key );
+
+  /// Forgets key and anything below it.
+  void Forget( const std::string& key );
+
+  /// Adds key and, if it's a dir, whatever is below it on disk.
+  void Remember( const std::string& key );
+
+public:
+  Overlay();
+  ~Overlay();
+
+  Overlay( const Overlay& ) = delete;
+  Overlay& operator=( const Overlay& ) = delete;
+
+  /// Sets the upper dir, making it if need be and picking up what earlier runs left there, an empty upper_dir turns the overlay off.
+  /// \return 0 or a UV_* error code.
+  int SetUpperDir( const std::string& upper_dir );
+
+  bool IsEnabled() const;
+
+  /// If path has been copied up gives the upper dir's copy.
+  bool Find( Archive* archive, const char* path, std::string& upper_path );
+
+  /// Readies the upper dir for an open of path with write access.
+  /// A file in the archive is copied up, else the parent dir must exist and flags must hold O_CREAT.
+  /// \return 0 and the path to open or a UV_* error code.
+  int Open( Archive* archive, const char* path, int flags, std::string& upper_path );
+
+  /// mkdir() in the upper dir, fails with UV_EEXIST if the archive has path.
+  int Mkdir( Archive* archive, const char* path, int mode );
+
+  /// unlink() or rmdir() of a copied up path, the archive's version (if any) is whited out.
+  /// Items only in the archive can't be removed so fail with UV_EROFS.
+  int Remove( Archive* archive, const char* path, bool is_dir );
+
+  /// rename() where either path is in an archive, the one in an archive must have been copied up and the archive's version of path (if any) is whited out.
+  /// from_archive or to_archive is nullptr if that path is on the local file system.
+  int Rename( Archive* from_archive, const char* path, Archive* to_archive, const char* new_path );
+};
+
+}
+
+#endif /* SRC_ARCHIVE_OVERLAY_H_ */
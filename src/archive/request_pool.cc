@@ -0,0 +1,144 @@
+#include "archive/request_pool.h"
+
+#include <cstdlib>
+
+namespace archive
+{
+
+/// Ahead of every block, what follows it is aligned as malloc() would.
+union RequestPool::Header
+{
+  struct
+  {
+    RequestPool* pool_;
+    /// ClassCount for a large block.
+    int size_class_;
+    /// The next free block of the class while this one is free.
+    Header* next_;
+  } block_;
+
+  std::max_align_t align_;
+};
+
+// A single writer so there is no need for a locked add.
+static inline void Bump( std::atomic< uint64_t >& value, int64_t by )
+{
+  value.store( value.load( std::memory_order_relaxed ) + by, std::memory_order_relaxed );
+}
+
+RequestPool::AtomicCounts::AtomicCounts()
+  : in_use_( 0 ), high_water_( 0 ), created_( 0 )
+{
+}
+
+RequestPool::RequestPool()
+{
+  for( int i=0; i<ClassCount; ++i )
+  {
+    free_[ i ] = nullptr;
+  }
+}
+
+RequestPool::~RequestPool()
+{
+  for( int i=0; i<ClassCount; ++i )
+  {
+    while( free_[ i ] != nullptr )
+    {
+      Header* header = free_[ i ];
+      free_[ i ] = header->block_.next_;
+      std::free( header );
+    }
+  }
+}
+
+void RequestPool::Used( AtomicCounts& counts )
+{
+  Bump( counts.in_use_, 1 );
+
+  const uint64_t in_use = counts.in_use_.load( std::memory_order_relaxed );
+  if( in_use > counts.high_water_.load( std::memory_order_relaxed ) )
+  {
+    counts.high_water_.store( in_use, std::memory_order_relaxed );
+  }
+}
+
+void* RequestPool::Allocate( size_t size )
+{
+  int size_class = 0;
+  while( size_class < ClassCount && ( SmallestBlock << size_class ) < size )
+  {
+    ++size_class;
+  }
+
+  Header* header = nullptr;
+
+  if( size_class == ClassCount )
+  {
+    header = static_cast< Header* >( std::malloc( sizeof( Header ) + size ) );
+    Bump( large_.created_, 1 );
+    Used( large_ );
+  }
+  else if( free_[ size_class ] != nullptr )
+  {
+    header = free_[ size_class ];
+    free_[ size_class ] = header->block_.next_;
+    Used( counts_[ size_class ] );
+  }
+  else
+  {
+    header = static_cast< Header* >( std::malloc( sizeof( Header ) + ( SmallestBlock << size_class ) ) );
+    Bump( counts_[ size_class ].created_, 1 );
+    Used( counts_[ size_class ] );
+  }
+
+  if( header == nullptr )
+  {
+    throw std::bad_alloc();
+  }
+
+  header->block_.pool_ = this;
+  header->block_.size_class_ = size_class;
+  header->block_.next_ = nullptr;
+
+  return header + 1;
+}
+
+void RequestPool::Free( void* block )
+{
+  if( block == nullptr )
+  {
+    return;
+  }
+
+  Header* header = static_cast< Header* >( block ) - 1;
+  RequestPool* pool = header->block_.pool_;
+  const int size_class = header->block_.size_class_;
+
+  if( size_class == ClassCount )
+  {
+    Bump( pool->large_.in_use_, -1 );
+    std::free( header );
+    return;
+  }
+
+  Bump( pool->counts_[ size_class ].in_use_, -1 );
+
+  header->block_.next_ = pool->free_[ size_class ];
+  pool->free_[ size_class ] = header;
+}
+
+void RequestPool::Take( Stats& stats ) const
+{
+  for( int i=0; i<=ClassCount; ++i )
+  {
+    const AtomicCounts& counts = ( i < ClassCount ) ? counts_[ i ] : large_;
+    Counts& total = ( i < ClassCount ) ? stats.classes_[ i ] : stats.large_;
+
+    total.in_use_ += counts.in_use_.load( std::memory_order_relaxed );
+    total.high_water_ += counts.high_water_.load( std::memory_order_relaxed );
+    total.created_ += counts.created_.load( std::memory_order_relaxed );
+  }
+}
+
+}
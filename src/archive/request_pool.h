@@ -0,0 +1,93 @@
+#ifndef SRC_ARCHIVE_REQUEST_POOL_H_
+#define SRC_ARCHIVE_REQUEST_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace archive
+{
+
+/// Size class free lists for the objects an async call needs until it completes (sheaths, threadpool work), so a steady stream of calls never reaches the allocator.
+/// Each loop has its own pool, see Manager::Pool(), and only the thread running that loop uses it so nothing here takes a lock.
+/// Every block is headed by the pool it came from, Free() needs no loop.
+class RequestPool
+{
+public:
+  /// Blocks are 64 << class bytes, larger ones go straight to malloc().
+  static const int ClassCount = 7;
+  static const size_t SmallestBlock = 64;
+  static const size_t LargestBlock = SmallestBlock << ( ClassCount - 1 );
+
+  /// The counts of one size class, in blocks.
+  typedef struct
+  {
+    /// Handed out and not yet freed.
+    uint64_t in_use_ = 0;
+    /// The most that were ever in use at once.
+    uint64_t high_water_ = 0;
+    /// Taken from malloc(), once a pool is warm this stops going up.
+    uint64_t created_ = 0;
+  } Counts;
+
+  typedef struct
+  {
+    Counts classes_[ ClassCount ];
+    /// Blocks larger than LargestBlock, these are never kept.
+    Counts large_;
+  } Stats;
+
+  RequestPool();
+  ~RequestPool();
+
+  /// \return size bytes aligned for any type, never nullptr.
+  void* Allocate( size_t size );
+
+  /// Gives back a block from Allocate(), on the thread running the pool's loop.
+  static void Free( void* block );
+
+  template< typename T >
+  T* New()
+  {
+    return new ( Allocate( sizeof( T ) ) ) T();
+  }
+
+  template< typename T >
+  static void Delete( T* item )
+  {
+    item->~T();
+    Free( item );
+  }
+
+  /// Adds this pool's counts to stats, safe from any thread.
+  void Take( Stats& stats ) const;
+
+private:
+  /// Only written by the pool's thread, relaxed atomics let Take() read them from any thread.
+  struct AtomicCounts
+  {
+    std::atomic< uint64_t > in_use_;
+    std::atomic< uint64_t > high_water_;
+    std::atomic< uint64_t > created_;
+
+    AtomicCounts();
+  };
+
+  union Header;
+
+  /// The free blocks of each class, linked through their headers.
+  Header* free_[ ClassCount ];
+
+  AtomicCounts counts_[ ClassCount ];
+  AtomicCounts large_;
+
+  static void Used( AtomicCounts& counts );
+
+  RequestPool( const RequestPool& ) = delete;
+  RequestPool& operator=( const RequestPool& ) = delete;
+};
+
+}
+
+#endif /* SRC_ARCHIVE_REQUEST_POOL_H_ */
@@ -0,0 +1,271 @@
+#include "archive/shared_index.h"
+#include "archive/archive.h"
+
+#include <cstring>
+#include <fcntl.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace archive
+{
+
+static const char IndexMagic[ 8 ] = { 'N', 'A', 'R', 'C', 'I', 'D', 'X', 0 };
+
+/// Bumped whenever Header or Entry change.
+static const uint32_t IndexVersion = 1;
+
+SharedIndex::SharedIndex()
+{
+}
+
+SharedIndex::~SharedIndex()
+{
+  Close();
+}
+
+std::string SharedIndex::Identity( uv_file fd, size_t base, size_t size )
+{
+  std::string identity;
+  uv_fs_t request;
+
+  if( ::uv_fs_fstat( nullptr, &request, fd, nullptr ) == 0 && ( request.statbuf.st_mode & S_IFMT ) == S_IFREG )
+  {
+    const uv_stat_t& file_stat = request.statbuf;
+    const std::string key = std::to_string( file_stat.st_dev ) + ":" + std::to_string( file_stat.st_ino ) + ":" + std::to_string( file_stat.st_size ) + ":" +
+                            std::to_string( file_stat.st_mtim.tv_sec ) + "." + std::to_string( file_stat.st_mtim.tv_nsec ) + ":" +
+                            std::to_string( base ) + ":" + std::to_string( size );
+
+    identity = Archive::GetMD5( key.data(), key.length() );
+  }
+
+  ::uv_fs_req_cleanup( &request );
+
+  return identity;
+}
+
+std::string SharedIndex::IndexFilePath( const std::string& caches_root, const std::string& identity )
+{
+  std::string dir = caches_root;
+
+#if defined(__linux__)
+  // tmpfs, so the index is only ever in memory and goes away with a reboot like the pages it describes.
+  struct stat shm_stat;
+  if( ::stat( "/dev/shm", &shm_stat ) == 0 && S_ISDIR( shm_stat.st_mode ) && ::access( "/dev/shm", W_OK ) == 0 )
+  {
+    dir = "/dev/shm";
+  }
+#endif
+
+  // an index describes the cache dir under one caches root, mounts with another root don't share it.
+  const std::string key = caches_root + "\n" + identity;
+
+  return dir + std::string( "/node-archive-" ) + Archive::GetMD5( key.data(), key.length() ) + std::string( ".index" );
+}
+
+bool SharedIndex::Open( const std::string& index_filepath )
+{
+  Close();
+
+#if defined(_WIN32)
+  return false;
+#else
+  int fd = ::open( index_filepath.c_str(), O_RDONLY | O_CLOEXEC );
+  if( fd < 0 )
+  {
+    return false;
+  }
+
+  // /dev/shm is writable by everyone so only trust an index we wrote and no one else can change.
+  struct stat index_stat;
+  if( ::fstat( fd, &index_stat ) != 0 || static_cast< size_t >( index_stat.st_size ) < sizeof( Header ) ||
+      index_stat.st_uid != ::geteuid() || ( index_stat.st_mode & ( S_IWGRP | S_IWOTH ) ) != 0 )
+  {
+    ::close( fd );
+    return false;
+  }
+
+  const size_t size = static_cast< size_t >( index_stat.st_size );
+  void* mapped = ::mmap( nullptr, size, PROT_READ, MAP_SHARED, fd, 0 );
+  ::close( fd );
+
+  if( mapped == MAP_FAILED )
+  {
+    return false;
+  }
+
+  map_ = mapped;
+  map_size_ = size;
+
+  const Header* header = static_cast< const Header* >( map_ );
+
+  // anything unexpected and the index is treated as missing.
+  const uint64_t entries_size = static_cast< uint64_t >( header->entry_count_ ) * sizeof( Entry );
+  if( std::memcmp( header->magic_, IndexMagic, sizeof( IndexMagic ) ) != 0 || header->version_ != IndexVersion || header->entry_size_ != sizeof( Entry ) ||
+      sizeof( Header ) + entries_size + header->names_size_ != size )
+  {
+    Close();
+    return false;
+  }
+
+  header_ = header;
+  entries_ = reinterpret_cast< const Entry* >( static_cast< const char* >( map_ ) + sizeof( Header ) );
+  names_ = static_cast< const char* >( map_ ) + sizeof( Header ) + entries_size;
+
+  for( uint32_t i = 0; i < header_->entry_count_; ++i )
+  {
+    const Entry& entry = entries_[ i ];
+    if( static_cast< uint64_t >( entry.name_offset_ ) + entry.name_length_ >= header_->names_size_ || names_[ entry.name_offset_ + entry.name_length_ ] != 0 )
+    {
+      Close();
+      return false;
+    }
+  }
+
+  return true;
+#endif
+}
+
+void SharedIndex::Close()
+{
+#if !defined(_WIN32)
+  if( map_ != nullptr )
+  {
+    ::munmap( map_, map_size_ );
+  }
+#endif
+
+  map_ = nullptr;
+  map_size_ = 0;
+  header_ = nullptr;
+  entries_ = nullptr;
+  names_ = nullptr;
+}
+
+std::string SharedIndex::Md5() const
+{
+  return std::string( header_->md5_, sizeof( header_->md5_ ) );
+}
+
+uint32_t SharedIndex::Count() const
+{
+  return header_ != nullptr ? header_->entry_count_ : 0;
+}
+
+const SharedIndex::Entry& SharedIndex::At( uint32_t position ) const
+{
+  return entries_[ position ];
+}
+
+const char* SharedIndex::Name( const Entry& entry ) const
+{
+  return names_ + entry.name_offset_;
+}
+
+void SharedIndex::Add( std::vector< Entry >& entries, std::string& names, int index, uint32_t offset, uint32_t crc32, uint32_t compressed_size, uint32_t uncompressed_size, uint16_t compression_method, uint16_t last_mod_file_time, uint16_t last_mod_file_date, const char* name )
+{
+  Entry entry;
+  std::memset( &entry, 0, sizeof( entry ) );
+
+  entry.name_offset_ = static_cast< uint32_t >( names.length() );
+  entry.name_length_ = static_cast< uint32_t >( std::strlen( name ) );
+  entry.index_ = static_cast< uint32_t >( index );
+  entry.offset_ = offset;
+  entry.crc32_ = crc32;
+  entry.compressed_size_ = compressed_size;
+  entry.uncompressed_size_ = uncompressed_size;
+  entry.compression_method_ = compression_method;
+  entry.last_mod_file_time_ = last_mod_file_time;
+  entry.last_mod_file_date_ = last_mod_file_date;
+
+  names.append( name, entry.name_length_ );
+  names.push_back( 0 );
+
+  entries.push_back( entry );
+}
+
+bool SharedIndex::Write( const std::string& index_filepath, const std::string& md5, const std::vector< Entry >& entries, const std::string& names )
+{
+#if defined(_WIN32)
+  return false;
+#else
+  if( md5.length() != sizeof( Header::md5_ ) )
+  {
+    return false;
+  }
+
+  Header header;
+  std::memset( &header, 0, sizeof( header ) );
+  std::memcpy( header.magic_, IndexMagic, sizeof( IndexMagic ) );
+  header.version_ = IndexVersion;
+  header.entry_size_ = sizeof( Entry );
+  header.entry_count_ = static_cast< uint32_t >( entries.size() );
+  header.names_size_ = static_cast< uint32_t >( names.length() );
+  std::memcpy( header.md5_, md5.data(), sizeof( header.md5_ ) );
+
+  const std::string temp_filepath = index_filepath + "." + std::to_string( uv_os_getpid() ) + ".tmp";
+
+  // O_EXCL so a link someone else left at the name is never followed, a temp file from an earlier process with our pid is removed first.
+  uv_fs_t request;
+  ::uv_fs_unlink( nullptr, &request, temp_filepath.c_str(), nullptr );
+  ::uv_fs_req_cleanup( &request );
+
+  uv_file fd = ::uv_fs_open( nullptr, &request, temp_filepath.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644, nullptr );
+  ::uv_fs_req_cleanup( &request );
+
+  if( fd < 0 )
+  {
+    return false;
+  }
+
+  uv_buf_t buffers[ 3 ];
+  buffers[ 0 ] = ::uv_buf_init( reinterpret_cast< char* >( &header ), sizeof( header ) );
+  buffers[ 1 ] = ::uv_buf_init( reinterpret_cast< char* >( const_cast< Entry* >( entries.data() ) ), static_cast< unsigned int >( entries.size() * sizeof( Entry ) ) );
+  buffers[ 2 ] = ::uv_buf_init( const_cast< char* >( names.data() ), static_cast< unsigned int >( names.length() ) );
+
+  const size_t total = buffers[ 0 ].len + buffers[ 1 ].len + buffers[ 2 ].len;
+  size_t done = 0;
+  bool written = true;
+
+  for( int i = 0; i < 3 && written; ++i )
+  {
+    size_t buffer_done = 0;
+    while( buffer_done < buffers[ i ].len )
+    {
+      uv_buf_t rest = ::uv_buf_init( buffers[ i ].base + buffer_done, static_cast< unsigned int >( buffers[ i ].len - buffer_done ) );
+      int r = ::uv_fs_write( nullptr, &request, fd, &rest, 1, static_cast< int64_t >( done ), nullptr );
+      ::uv_fs_req_cleanup( &request );
+
+      if( r <= 0 )
+      {
+        written = false;
+        break;
+      }
+
+      buffer_done += static_cast< size_t >( r );
+      done += static_cast< size_t >( r );
+    }
+  }
+
+  ::uv_fs_close( nullptr, &request, fd, nullptr );
+  ::uv_fs_req_cleanup( &request );
+
+  // another process may have got there first, its index is the same so either can win.
+  if( written && done == total && ::uv_fs_rename( nullptr, &request, temp_filepath.c_str(), index_filepath.c_str(), nullptr ) == 0 )
+  {
+    ::uv_fs_req_cleanup( &request );
+    return true;
+  }
+
+  ::uv_fs_req_cleanup( &request );
+  ::uv_fs_unlink( nullptr, &request, temp_filepath.c_str(), nullptr );
+  ::uv_fs_req_cleanup( &request );
+
+  return false;
+#endif
+}
+
+}
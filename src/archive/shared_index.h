@@ -0,0 +1,97 @@
+#ifndef SRC_ARCHIVE_SHARED_INDEX_H_
+#define SRC_ARCHIVE_SHARED_INDEX_H_
+
+#include <uv.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <string>
+#include <vector>
+
+namespace archive
+{
+
+/// A mount's index shared by every process on the host that mounts the same archive, e.g. cluster workers.
+/// The first process to mount an archive writes what it read from the central directory, and the archive's MD5, to a flat file.
+/// Later mounts map that file read only and build their tree from it without hashing the archive or reading its central directory.
+/// The file is in /dev/shm where there is one, else in the caches root, and is named after the archive's identity
+/// (the device, inode, size and modification time of its file and where in that file it is) so a changed archive never sees a stale index.
+class SharedIndex
+{
+public:
+  /// One central directory entry, the layout is fixed as the file is shared.
+  typedef struct
+  {
+    /// The entry's name in the names that follow the entries, it is nul terminated.
+    uint32_t name_offset_;
+    uint32_t name_length_;
+    /// The entry's number in the central directory.
+    uint32_t index_;
+    uint32_t offset_;
+    uint32_t crc32_;
+    uint32_t compressed_size_;
+    uint32_t uncompressed_size_;
+    uint16_t compression_method_;
+    uint16_t last_mod_file_time_;
+    uint16_t last_mod_file_date_;
+    uint16_t reserved_;
+  } Entry;
+
+private:
+  typedef struct
+  {
+    char magic_[ 8 ];
+    uint32_t version_;
+    uint32_t entry_size_;
+    uint32_t entry_count_;
+    uint32_t names_size_;
+    /// The archive's MD5 as hex, not nul terminated.
+    char md5_[ 32 ];
+  } Header;
+
+  /// The mapped file, nullptr if none is open.
+  void* map_ = nullptr;
+  size_t map_size_ = 0;
+
+  const Header* header_ = nullptr;
+  const Entry* entries_ = nullptr;
+  const char* names_ = nullptr;
+
+public:
+  SharedIndex();
+  ~SharedIndex();
+
+  SharedIndex( const SharedIndex& ) = delete;
+  SharedIndex& operator=( const SharedIndex& ) = delete;
+
+  /// Names the bytes of an archive size bytes long at base in a file, from what fstat() says of the file.
+  /// \return the identity or empty if fd is not a file.
+  static std::string Identity( uv_file fd, size_t base, size_t size );
+
+  /// Returns where the index of an archive with identity, cached under caches_root, lives.
+  static std::string IndexFilePath( const std::string& caches_root, const std::string& identity );
+
+  /// Maps an index made by Write().
+  /// \return false if there is no index or it's not one this build understands.
+  bool Open( const std::string& index_filepath );
+
+  /// Releases the mapping, entries and names are not valid afterwards.
+  void Close();
+
+  std::string Md5() const;
+  uint32_t Count() const;
+  const Entry& At( uint32_t position ) const;
+  const char* Name( const Entry& entry ) const;
+
+  /// Adds an entry to entries, with its name added to names, ready for Write().
+  static void Add( std::vector< Entry >& entries, std::string& names, int index, uint32_t offset, uint32_t crc32, uint32_t compressed_size, uint32_t uncompressed_size, uint16_t compression_method, uint16_t last_mod_file_time, uint16_t last_mod_file_date, const char* name );
+
+  /// Writes an index, it's written to a temporary file first then renamed so readers never see part of one.
+  /// \return false if the index could not be written.
+  static bool Write( const std::string& index_filepath, const std::string& md5, const std::vector< Entry >& entries, const std::string& names );
+};
+
+}
+
+#endif /* SRC_ARCHIVE_SHARED_INDEX_H_ */
@@ -0,0 +1,286 @@
+#include "archive/startup_profile.h"
+
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace archive
+{
+
+StartupProfile::StartupProfile()
+  : prefetch_stop_( false )
+{
+}
+
+StartupProfile::~StartupProfile()
+{
+  Stop();
+}
+
+std::string StartupProfile::ProfileFilePath( const std::string& cache_path )
+{
+  return cache_path + std::string( "/startup.profile" );
+}
+
+static const char Md5Prefix[] = "#md5 ";
+
+bool StartupProfile::Load( const std::string& profile_filepath, std::vector< std::string >& entries, std::string* archive_md5 )
+{
+  FILE* profile_file = nullptr;
+
+#if defined(_WIN32)
+  if( ::fopen_s( &profile_file, profile_filepath.c_str(), "rb" ) )
+  {
+    profile_file = nullptr;
+  }
+#else
+  profile_file = std::fopen( profile_filepath.c_str(), "rb" );
+#endif
+
+  if( profile_file == nullptr )
+  {
+    return false;
+  }
+
+  char line[ 4096 ];
+
+  if( archive_md5 != nullptr )
+  {
+    archive_md5->clear();
+  }
+
+  while( std::fgets( line, sizeof( line ), profile_file ) != nullptr )
+  {
+    size_t length = std::strlen( line );
+
+    while( length != 0 && ( line[ length - 1 ] == '\n' || line[ length - 1 ] == '\r' ) )
+    {
+      line[ --length ] = 0;
+    }
+
+    if( length == 0 )
+    {
+      continue;
+    }
+
+    if( std::strncmp( line, Md5Prefix, sizeof( Md5Prefix ) - 1 ) == 0 )
+    {
+      if( archive_md5 != nullptr )
+      {
+        archive_md5->assign( line + sizeof( Md5Prefix ) - 1 );
+      }
+      continue;
+    }
+
+    entries.push_back( std::string( line, length ) );
+  }
+
+  std::fclose( profile_file );
+
+  return true;
+}
+
+bool StartupProfile::IsStale( const std::string& profile_filepath )
+{
+  uv_fs_t request;
+  bool stale = false;
+
+  if( ::uv_fs_stat( nullptr, &request, profile_filepath.c_str(), nullptr ) == 0 )
+  {
+    const int64_t age = static_cast< int64_t >( std::time( nullptr ) ) - static_cast< int64_t >( request.statbuf.st_mtim.tv_sec );
+    stale = ( age > static_cast< int64_t >( RerecordAfterSecs ) );
+  }
+  ::uv_fs_req_cleanup( &request );
+
+  return stale;
+}
+
+bool StartupProfile::Record( const std::string& profile_filepath, const std::string& archive_md5 )
+{
+  EndRecording();
+
+  recording_filepath_ = profile_filepath;
+  recording_temp_filepath_ = profile_filepath + "." + std::to_string( uv_os_getpid() ) + ".tmp";
+
+#if defined(_WIN32)
+  if( ::fopen_s( &recording_, recording_temp_filepath_.c_str(), "wb" ) )
+  {
+    recording_ = nullptr;
+  }
+#else
+  recording_ = std::fopen( recording_temp_filepath_.c_str(), "wb" );
+#endif
+
+  recording_started_ = uv_hrtime();
+  recorded_.clear();
+
+  if( recording_ == nullptr )
+  {
+    return false;
+  }
+
+  std::fprintf( recording_, "%s%s\n", Md5Prefix, archive_md5.c_str() );
+
+  return true;
+}
+
+bool StartupProfile::IsRecording() const
+{
+  return recording_ != nullptr;
+}
+
+void StartupProfile::Add( const std::string& entry )
+{
+  if( recording_ == nullptr )
+  {
+    return;
+  }
+
+  // startup is over.
+  if( ( uv_hrtime() - recording_started_ ) > ( RecordWindowMs * 1000000 ) )
+  {
+    EndRecording();
+    return;
+  }
+
+  if( recorded_.insert( entry ).second == false )
+  {
+    return;
+  }
+
+  std::fprintf( recording_, "%s\n", entry.c_str() );
+}
+
+void StartupProfile::EndRecording()
+{
+  if( recording_ != nullptr )
+  {
+    // a run which opened nothing (e.g. one only doing a --archive.relayout) leaves the profile that is there.
+    bool written = ( std::fclose( recording_ ) == 0 ) && ( recorded_.empty() == false );
+    recording_ = nullptr;
+
+    uv_fs_t request;
+
+    if( written )
+    {
+      written = ( ::uv_fs_rename( nullptr, &request, recording_temp_filepath_.c_str(), recording_filepath_.c_str(), nullptr ) == 0 );
+      ::uv_fs_req_cleanup( &request );
+    }
+
+    if( written == false )
+    {
+      ::uv_fs_unlink( nullptr, &request, recording_temp_filepath_.c_str(), nullptr );
+      ::uv_fs_req_cleanup( &request );
+    }
+  }
+
+  recorded_.clear();
+}
+
+void StartupProfile::PrefetchFile( const std::string& cache_filepath )
+{
+#if defined(__linux__)
+  int fd = ::open( cache_filepath.c_str(), O_RDONLY );
+  if( fd >= 0 )
+  {
+    ::posix_fadvise( fd, 0, 0, POSIX_FADV_WILLNEED );
+    ::close( fd );
+  }
+#else
+  // no read ahead hint so pull the file through the page cache.
+  uv_fs_t req;
+  uv_file fd = ::uv_fs_open( nullptr, &req, cache_filepath.c_str(), O_RDONLY, 0, nullptr );
+  ::uv_fs_req_cleanup( &req );
+
+  if( fd < 0 )
+  {
+    return;
+  }
+
+  char buffer[ 1024 * 64 ];
+  uv_buf_t buf = uv_buf_init( buffer, sizeof( buffer ) );
+  int64_t offset = 0;
+  int r;
+
+  while( ( r = ::uv_fs_read( nullptr, &req, fd, &buf, 1, offset, nullptr ) ) > 0 )
+  {
+    ::uv_fs_req_cleanup( &req );
+    offset += r;
+  }
+  ::uv_fs_req_cleanup( &req );
+
+  ::uv_fs_close( nullptr, &req, fd, nullptr );
+  ::uv_fs_req_cleanup( &req );
+#endif
+}
+
+void StartupProfile::OnPrefetch( void* arg )
+{
+  StartupProfile* pThis = static_cast< StartupProfile* >( arg );
+
+  for( PrefetchItems::const_iterator item=pThis->prefetch_items_.begin(); item!=pThis->prefetch_items_.end(); ++item )
+  {
+    if( pThis->prefetch_stop_.load() )
+    {
+      return;
+    }
+
+#if !defined(_WIN32)
+    if( item->view_ != nullptr )
+    {
+      // madvise wants a page aligned start.
+      static const uintptr_t page_size = static_cast< uintptr_t >( ::sysconf( _SC_PAGESIZE ) );
+
+      uintptr_t start = reinterpret_cast< uintptr_t >( item->view_ );
+      uintptr_t aligned_start = start & ~( page_size - 1 );
+
+      ::madvise( reinterpret_cast< void* >( aligned_start ), item->view_size_ + ( start - aligned_start ), MADV_WILLNEED );
+      continue;
+    }
+#endif
+
+    if( item->cache_filepath_.length() != 0 )
+    {
+      PrefetchFile( item->cache_filepath_ );
+    }
+  }
+}
+
+void StartupProfile::Prefetch( const PrefetchItems& items )
+{
+  Stop();
+
+  if( items.size() == 0 )
+  {
+    return;
+  }
+
+  prefetch_items_ = items;
+  prefetch_stop_.store( false );
+
+  if( uv_thread_create( &prefetch_thread_, &StartupProfile::OnPrefetch, this ) == 0 )
+  {
+    prefetch_running_ = true;
+  }
+}
+
+void StartupProfile::Stop()
+{
+  EndRecording();
+
+  if( prefetch_running_ )
+  {
+    prefetch_stop_.store( true );
+    uv_thread_join( &prefetch_thread_ );
+    prefetch_running_ = false;
+  }
+
+  prefetch_items_.clear();
+}
+
+}
@@ -0,0 +1,97 @@
+#ifndef SRC_ARCHIVE_STARTUP_PROFILE_H_
+#define SRC_ARCHIVE_STARTUP_PROFILE_H_
+
+#include <uv.h>
+
+#include <atomic>
+#include <cstdio>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace archive
+{
+
+/// Records the order entries are opened in while an app starts and uses it on later starts to warm them up.
+/// The profile is a text file in the archive's cache dir, a "#md5 " line naming the archive it was recorded for then one entry path (relative to the mount point) per line.
+/// A recording goes to a temp file which only replaces the profile once it has ended with entries in it.
+class StartupProfile
+{
+public:
+  /// An entry to be prefetched, the archive fills these in as only it knows were the bytes live.
+  typedef struct
+  {
+    /// The entry's bytes if they are mapped into memory, these get madvise(WILLNEED).
+    const char* view_ = nullptr;
+    size_t view_size_ = 0;
+    /// else the cache file holding the entry, this gets read ahead.
+    std::string cache_filepath_;
+  } PrefetchItem;
+
+  using PrefetchItems = std::vector< PrefetchItem >;
+
+  /// How long after mounting we record opened entries for.
+  static const uint64_t RecordWindowMs = 10000;
+
+  /// How old a profile gets before it is recorded again, an app opens other entries as it is worked on.
+  static const uint64_t RerecordAfterSecs = 7 * 24 * 60 * 60;
+
+private:
+  /// The temp file being written to, nullptr if not recording
+  FILE* recording_ = nullptr;
+  /// Where the temp file goes once recording ends and its own path.
+  std::string recording_filepath_;
+  std::string recording_temp_filepath_;
+  /// When recording started (uv_hrtime)
+  uint64_t recording_started_ = 0;
+  /// Entries already recorded.
+  std::set< std::string > recorded_;
+
+  /// The prefetch thread.
+  uv_thread_t prefetch_thread_;
+  bool prefetch_running_ = false;
+  std::atomic< bool > prefetch_stop_;
+  PrefetchItems prefetch_items_;
+
+  static void OnPrefetch( void* arg );
+
+  static void PrefetchFile( const std::string& cache_filepath );
+
+public:
+  StartupProfile();
+  ~StartupProfile();
+
+  /// Returns where the profile lives for an archive cache dir.
+  static std::string ProfileFilePath( const std::string& cache_path );
+
+  /// Loads a profile.
+  /// \param archive_md5 if not nullptr set to the MD5 the profile was recorded for, empty if it doesn't say.
+  /// \return false if there is no profile.
+  static bool Load( const std::string& profile_filepath, std::vector< std::string >& entries, std::string* archive_md5 = nullptr );
+
+  /// Tests if a profile was last written more than RerecordAfterSecs ago.
+  static bool IsStale( const std::string& profile_filepath );
+
+  /// Start recording opened entries for the archive with archive_md5, profile_filepath is left as it is until recording ends.
+  bool Record( const std::string& profile_filepath, const std::string& archive_md5 );
+
+  /// Used to test if entries are being recorded.
+  bool IsRecording() const;
+
+  /// Called when an entry is opened, only the first open of an entry is recorded.
+  void Add( const std::string& entry );
+
+  /// Stops recording, the profile is replaced if any entries were recorded.
+  void EndRecording();
+
+  /// Starts a background thread which warms up items in order.
+  void Prefetch( const PrefetchItems& items );
+
+  /// Stops any recording and waits for the prefetch thread to end.
+  /// Must be called before any memory a PrefetchItem points at is released.
+  void Stop();
+};
+
+}
+
+#endif /* SRC_ARCHIVE_STARTUP_PROFILE_H_ */
@@ -0,0 +1,171 @@
+#include "archive/trace.h"
+
+#include <atomic>
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+#include "node_internals.h"
+#include "tracing/trace_event.h"
+
+#define ARCHIVE_TRACE_CATEGORY TRACING_CATEGORY_NODE1(archive)
+#endif
+
+namespace archive
+{
+
+/// Enough for the extraction of a big archive on a cold cache, anything more is dropped.
+static const size_t MaxPendingEvents = 16384;
+
+static std::atomic< bool > gFlushed( false );
+static std::atomic< bool > gExpected( false );
+
+static uv_once_t gPendingOnce = UV_ONCE_INIT;
+static uv_mutex_t gPendingLock;
+static std::vector< Trace::Event >* gPending = nullptr;
+
+static void InitPending()
+{
+  uv_mutex_init( &gPendingLock );
+  gPending = new std::vector< Trace::Event >();
+}
+
+#if defined(NODE_WANT_INTERNALS) && NODE_WANT_INTERNALS
+
+static bool IsTracing()
+{
+  if( node::tracing::TraceEventHelper::GetTracingController() == nullptr )
+  {
+    return false;
+  }
+
+  static const uint8_t* enabled = TRACE_EVENT_API_GET_CATEGORY_GROUP_ENABLED( ARCHIVE_TRACE_CATEGORY );
+
+  return *enabled != 0;
+}
+
+static void AddEvent( const char* name, const char* path, uint64_t size, uint64_t start, uint64_t end )
+{
+  // the tracing timestamps are uv_hrtime() in microseconds.
+  INTERNAL_TRACE_EVENT_ADD_WITH_TIMESTAMP( TRACE_EVENT_PHASE_BEGIN, ARCHIVE_TRACE_CATEGORY, name, static_cast< int64_t >( start / 1000 ), TRACE_EVENT_FLAG_COPY, "path", TRACE_STR_COPY( path ) );
+  INTERNAL_TRACE_EVENT_ADD_WITH_TIMESTAMP( TRACE_EVENT_PHASE_END, ARCHIVE_TRACE_CATEGORY, name, static_cast< int64_t >( end / 1000 ), TRACE_EVENT_FLAG_COPY, "size", size );
+}
+
+#else
+
+static bool IsTracing()
+{
+  return false;
+}
+
+static void AddEvent( const char* /*name*/, const char* /*path*/, uint64_t /*size*/, uint64_t /*start*/, uint64_t /*end*/ )
+{
+}
+
+#endif
+
+bool Trace::IsEnabled()
+{
+  if( gFlushed.load( std::memory_order_acquire ) == false )
+  {
+    return gExpected.load( std::memory_order_relaxed );
+  }
+
+  return IsTracing();
+}
+
+void Trace::SetCategories( const std::string& categories )
+{
+  bool expected = false;
+  std::string category;
+
+  // node.archive is also on when its parent, node, is.
+  for( size_t i = 0; i <= categories.length(); ++i )
+  {
+    if( i == categories.length() || categories[ i ] == ',' )
+    {
+      expected = expected || category == "node" || category == "node.archive";
+      category.clear();
+    }
+    else if( categories[ i ] != ' ' )
+    {
+      category += categories[ i ];
+    }
+  }
+
+  gExpected.store( expected, std::memory_order_relaxed );
+}
+
+void Trace::Add( const char* name, const char* path, uint64_t size, uint64_t start )
+{
+  const uint64_t end = uv_hrtime();
+
+  if( path == nullptr )
+  {
+    path = "";
+  }
+
+  if( gFlushed.load( std::memory_order_acquire ) )
+  {
+    AddEvent( name, path, size, start, end );
+    return;
+  }
+
+  uv_once( &gPendingOnce, InitPending );
+  uv_mutex_lock( &gPendingLock );
+
+  // Flush() got in first.
+  if( gFlushed.load( std::memory_order_acquire ) )
+  {
+    uv_mutex_unlock( &gPendingLock );
+    AddEvent( name, path, size, start, end );
+    return;
+  }
+
+  if( gPending->size() < MaxPendingEvents )
+  {
+    Event event;
+
+    event.name_ = name;
+    event.path_ = path;
+    event.size_ = size;
+    event.start_ = start;
+    event.end_ = end;
+
+    gPending->push_back( event );
+  }
+
+  uv_mutex_unlock( &gPendingLock );
+}
+
+void Trace::Flush()
+{
+  uv_once( &gPendingOnce, InitPending );
+  uv_mutex_lock( &gPendingLock );
+
+  gFlushed.store( true, std::memory_order_release );
+
+  if( IsTracing() )
+  {
+    for( std::vector< Event >::const_iterator event=gPending->begin(); event!=gPending->end(); ++event )
+    {
+      AddEvent( event->name_, event->path_.c_str(), event->size_, event->start_, event->end_ );
+    }
+  }
+
+  std::vector< Event >().swap( *gPending );
+
+  uv_mutex_unlock( &gPendingLock );
+}
+
+std::vector< Trace::Event > Trace::Pending()
+{
+  uv_once( &gPendingOnce, InitPending );
+  uv_mutex_lock( &gPendingLock );
+
+  std::vector< Event > pending( *gPending );
+
+  uv_mutex_unlock( &gPendingLock );
+
+  return pending;
+}
+
+}
@@ -0,0 +1,85 @@
+#ifndef SRC_ARCHIVE_TRACE_H_
+#define SRC_ARCHIVE_TRACE_H_
+
+#include <uv.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace archive
+{
+
+/// Trace events for archive work under the node.archive category, e.g. node --trace-event-categories node.archive
+/// Outside of node (e.g. the tests) events are only ever kept for Flush(), which drops them.
+class Trace
+{
+public:
+  /// An event added before Flush()
+  typedef struct
+  {
+    const char* name_ = nullptr;
+    std::string path_;
+    uint64_t size_ = 0;
+    uint64_t start_ = 0;
+    uint64_t end_ = 0;
+  } Event;
+
+  /// Is node.archive being traced, before Flush() that's whether SetCategories() was given it.
+  static bool IsEnabled();
+
+  /// The categories node will trace (from --trace-event-categories), Manager::Init() passes them on before it mounts anything.
+  /// Until Flush() events are only kept if node or node.archive is one of them.
+  static void SetCategories( const std::string& categories );
+
+  /// Adds an event that ran from start (from uv_hrtime()) until now, name must be a string literal.
+  /// Events from before Flush() (i.e. the mounts done by Manager::Init()) are kept until then.
+  static void Add( const char* name, const char* path, uint64_t size, uint64_t start );
+
+  /// Called by node once tracing has started, the kept events are added with the times they really happened.
+  static void Flush();
+
+  /// The events kept for Flush().
+  static std::vector< Event > Pending();
+};
+
+/// Traces the scope it lives in as one event with path and size args.
+class TraceScope
+{
+  const char* name_;
+  const char* path_;
+  uint64_t size_ = 0;
+  uint64_t start_ = 0;
+
+public:
+  /// name must be a string literal, path must outlive the scope and may be nullptr.
+  TraceScope( const char* name, const char* path = nullptr )
+    : name_( name ), path_( path )
+  {
+    if( Trace::IsEnabled() )
+    {
+      start_ = uv_hrtime();
+    }
+  }
+
+  ~TraceScope()
+  {
+    if( start_ != 0 )
+    {
+      Trace::Add( name_, path_, size_, start_ );
+    }
+  }
+
+  void SetSize( uint64_t size )
+  {
+    size_ = size;
+  }
+
+private:
+  TraceScope( const TraceScope& ) = delete;
+  TraceScope& operator=( const TraceScope& ) = delete;
+};
+
+}
+
+#endif /* SRC_ARCHIVE_TRACE_H_ */
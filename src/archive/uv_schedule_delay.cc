@@ -1,5 +1,7 @@
 #include "archive/uv_schedule_delay.h"
 
+#include <algorithm>
+
 namespace archive
 {
 
@@ -11,21 +13,61 @@ UvScheduleDelay::~UvScheduleDelay()
 {
 }
 
+UvScheduleDelay::Queues UvScheduleDelay::queues_;
+std::vector< UvScheduleDelay::ScheduleRequest* > UvScheduleDelay::free_queues_;
+RequestPool::Counts UvScheduleDelay::queue_counts_;
+
+// Guards UvScheduleDelay::queues_, free_queues_, queue_counts_ and each queue's requests.
+static uv_mutex_t gQueuesLock;
+static uv_once_t gQueuesLockOnce = UV_ONCE_INIT;
+
+static void InitQueuesLock()
+{
+  uv_mutex_init( &gQueuesLock );
+}
+
 void UvScheduleDelay::OnProcessScheduleRequest(uv_async_t* async)
 {
-  UvScheduleDelay::ScheduleRequest* schedule_item = static_cast< UvScheduleDelay::ScheduleRequest* >( async );
+  UvScheduleDelay::ScheduleRequest* queue = static_cast< UvScheduleDelay::ScheduleRequest* >( async );
 
-	uv_fs_cb cb_ = schedule_item->request_->cb;
+  uv_mutex_lock( &gQueuesLock );
+  queue->running_.swap( queue->requests_ );
+  uv_mutex_unlock( &gQueuesLock );
 
-	( *cb_ )( schedule_item->request_ );
+  for( std::vector< uv_fs_t* >::iterator request=queue->running_.begin(); request!=queue->running_.end(); ++request )
+  {
+    uv_fs_cb cb_ = ( *request )->cb;
+
+    ( *cb_ )( *request );
+  }
+
+  queue->running_.clear();
+
+  // a callback may have scheduled more, they were sent to this queue so it's kept for them.
+  uv_mutex_lock( &gQueuesLock );
+  const bool drained = queue->requests_.empty();
+  if( drained )
+  {
+    Queues::iterator found = std::find( queues_.begin(), queues_.end(), queue );
+    *found = queues_.back();
+    queues_.pop_back();
+  }
+  uv_mutex_unlock( &gQueuesLock );
 
-  uv_close( reinterpret_cast< uv_handle_t* >( async ), &UvScheduleDelay::OnCloseScheduleRequest );
+  if( drained )
+  {
+    uv_close( reinterpret_cast< uv_handle_t* >( async ), &UvScheduleDelay::OnCloseScheduleRequest );
+  }
 }
 
 void UvScheduleDelay::OnCloseScheduleRequest( uv_handle_t* handle )
 {
   UvScheduleDelay::ScheduleRequest* schedule_request = reinterpret_cast< UvScheduleDelay::ScheduleRequest* >( handle );
-  delete schedule_request;
+
+  uv_mutex_lock( &gQueuesLock );
+  free_queues_.push_back( schedule_request );
+  queue_counts_.in_use_--;
+  uv_mutex_unlock( &gQueuesLock );
 }
 
 void UvScheduleDelay::Schedule(uv_loop_t* owning_loop, uv_fs_t* reqeust)
@@ -35,14 +77,91 @@ void UvScheduleDelay::Schedule(uv_loop_t* owning_loop, uv_fs_t* reqeust)
     return;
   }
 
-  UvScheduleDelay::ScheduleRequest* new_schedule_item = new UvScheduleDelay::ScheduleRequest();
+  uv_once( &gQueuesLockOnce, &InitQueuesLock );
+
+  uv_mutex_lock( &gQueuesLock );
+
+  UvScheduleDelay::ScheduleRequest* queue = nullptr;
+
+  for( Queues::iterator open_queue=queues_.begin(); open_queue!=queues_.end(); ++open_queue )
+  {
+    if( ( *open_queue )->loop == owning_loop )
+    {
+      queue = *open_queue;
+      break;
+    }
+  }
+
+  if( queue == nullptr )
+  {
+    // only this loop's thread makes its queue so uv_async_init() is safe here.
+    if( free_queues_.empty() )
+    {
+      queue = new UvScheduleDelay::ScheduleRequest();
+      queue_counts_.created_++;
+    }
+    else
+    {
+      queue = free_queues_.back();
+      free_queues_.pop_back();
+    }
 
-  new_schedule_item->data = this;
-  new_schedule_item->request_ = reqeust;
+    if( ++queue_counts_.in_use_ > queue_counts_.high_water_ )
+    {
+      queue_counts_.high_water_ = queue_counts_.in_use_;
+    }
 
-  uv_async_init( owning_loop, new_schedule_item, &UvScheduleDelay::OnProcessScheduleRequest );
+    queue->data = this;
+    uv_async_init( owning_loop, queue, &UvScheduleDelay::OnProcessScheduleRequest );
+    queues_.push_back( queue );
+  }
+
+  queue->requests_.push_back( reqeust );
+  uv_async_send( queue );
+
+  uv_mutex_unlock( &gQueuesLock );
+}
+
+void UvScheduleDelay::OnWork(uv_work_t* work)
+{
+  static_cast< UvScheduleDelay::WorkItem* >( work )->Run();
+}
+
+void UvScheduleDelay::OnAfterWork(uv_work_t* work, int status)
+{
+  UvScheduleDelay::WorkItem* item = static_cast< UvScheduleDelay::WorkItem* >( work );
+  uv_fs_t* request = item->request_;
+
+  if( status != 0 )
+  {
+    request->result = status;
+  }
+
+  delete item;
+
+  ( *request->cb )( request );
+}
+
+void UvScheduleDelay::TakeQueueCounts( RequestPool::Counts& counts )
+{
+  uv_once( &gQueuesLockOnce, &InitQueuesLock );
+
+  uv_mutex_lock( &gQueuesLock );
+  counts = queue_counts_;
+  uv_mutex_unlock( &gQueuesLock );
+}
+
+int UvScheduleDelay::ScheduleWork(uv_loop_t* owning_loop, UvScheduleDelay::WorkItem* item)
+{
+  item->data = this;
+
+  int r = uv_queue_work( owning_loop, item, &UvScheduleDelay::OnWork, &UvScheduleDelay::OnAfterWork );
+  if( r != 0 )
+  {
+    delete item;
+  }
 
-  uv_async_send( new_schedule_item ); 
+  return r;
 }
 
 }
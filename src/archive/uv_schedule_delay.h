@@ -1,6 +1,8 @@
 #ifndef SRC_ARCHIVE_UV_SCHEDULE_DELAY_H_
 #define SRC_ARCHIVE_UV_SCHEDULE_DELAY_H_
 
+#include "archive/request_pool.h"
+
 #include <uv.h>
 
 #include <vector>
@@ -9,22 +11,68 @@ namespace archive
 {
 
 /// Used to handle pending uv_fs_t
-/// TODO - Think about atomics! node.js is currently mainly single threaded but worker threads are experimental at time of writing.
+/// Each loop (the main thread's and every worker's) has its own queue of pending requests, drained by one uv_async_t on that loop.
+/// A queue only lives while it has requests so it never holds a loop open or stops a worker's loop from closing,
+/// once closed it is kept for the next loop that needs one rather than freed.
 class UvScheduleDelay
 {
   typedef struct : public uv_async_t
   {
-    uv_fs_t* request_ = nullptr;
+    /// Requests to complete, in the order they were scheduled.
+    std::vector< uv_fs_t* > requests_;
+    /// The requests being completed, swapped with requests_ so neither gives up its capacity.
+    std::vector< uv_fs_t* > running_;
   } ScheduleRequest;
 
+  /// There are only ever a few loops so a vector is searched rather than a map that would allocate a node per queue.
+  using Queues = std::vector< ScheduleRequest* >;
+
+  /// The queue of each loop that has requests pending.
+  static Queues queues_;
+
+  /// Closed queues ready for reuse, their requests_ keep the capacity they grew to.
+  static std::vector< ScheduleRequest* > free_queues_;
+
+  /// The queues made and how many are open, see TakeQueueCounts()
+  static RequestPool::Counts queue_counts_;
+
   static void OnProcessScheduleRequest(uv_async_t* check);
   static void OnCloseScheduleRequest(uv_handle_t* handle);
 
+  static void OnWork(uv_work_t* work);
+  static void OnAfterWork(uv_work_t* work, int status);
+
 public:
+  /// Work done off the loop thread for ScheduleWork(), derived items carry what the work needs.
+  /// Items are made in a block from the loop's RequestPool, deleting one gives the block back.
+  struct WorkItem : public uv_work_t
+  {
+    uv_fs_t* request_ = nullptr;
+
+    virtual ~WorkItem() {}
+
+    static void operator delete( void* block )
+    {
+      RequestPool::Free( block );
+    }
+
+    /// Called on a threadpool thread, must set request_->result.
+    virtual void Run() = 0;
+  };
+
   UvScheduleDelay();
   virtual ~UvScheduleDelay();
 
+  /// Calls request->cb on owning_loop's next iteration, it must be called on the thread running owning_loop.
   void Schedule( uv_loop_t* owning_loop, uv_fs_t* request );
+
+  /// Runs item on the libuv threadpool then calls item->request_->cb on owning_loop, so the loop thread only does the completion.
+  /// Takes ownership of item.
+  /// \return 0 or the uv_queue_work() error, on error the item has been deleted and the callback will not be called.
+  int ScheduleWork( uv_loop_t* owning_loop, WorkItem* item );
+
+  /// The counts of the queues of every loop, a queue is in use while it has requests.
+  static void TakeQueueCounts( RequestPool::Counts& counts );
 };
 
 }
@@ -0,0 +1,306 @@
+#include "archive/walk.h"
+
+#if !defined(_WIN32)
+#include <ftw.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
+namespace archive
+{
+
+// pattern points just after the '[', on return it's just after the ']'
+static bool MatchClass( const char*& pattern, char c )
+{
+  bool negate = false;
+  bool matched = false;
+  bool first = true;
+
+  if( *pattern == '!' || *pattern == '^' )
+  {
+    negate = true;
+    ++pattern;
+  }
+
+  // a ']' straight after the '[' is part of the class.
+  while( *pattern != 0 && ( first || *pattern != ']' ) )
+  {
+    first = false;
+
+    char low = *pattern++;
+    char high = low;
+
+    if( pattern[ 0 ] == '-' && pattern[ 1 ] != 0 && pattern[ 1 ] != ']' )
+    {
+      high = pattern[ 1 ];
+      pattern += 2;
+    }
+
+    if( c >= low && c <= high )
+    {
+      matched = true;
+    }
+  }
+
+  if( *pattern == ']' )
+  {
+    ++pattern;
+  }
+
+  return matched != negate;
+}
+
+bool Walk::Match( const char* pattern, const char* path )
+{
+  while( *pattern != 0 )
+  {
+    switch( *pattern )
+    {
+      case '*':
+        if( pattern[ 1 ] == '*' )
+        {
+          const char* rest = pattern + 2;
+
+          // "**/" can match no dirs at all.
+          if( *rest == '/' && Match( rest + 1, path ) )
+          {
+            return true;
+          }
+
+          for( const char* p = path; ; ++p )
+          {
+            if( Match( rest, p ) )
+            {
+              return true;
+            }
+            if( *p == 0 )
+            {
+              return false;
+            }
+          }
+        }
+
+        // '*' never crosses a '/'
+        for( const char* p = path; ; ++p )
+        {
+          if( Match( pattern + 1, p ) )
+          {
+            return true;
+          }
+          if( *p == 0 || *p == '/' )
+          {
+            return false;
+          }
+        }
+
+      case '?':
+        if( *path == 0 || *path == '/' )
+        {
+          return false;
+        }
+        ++pattern;
+        ++path;
+        break;
+
+      case '[':
+        if( *path == 0 || *path == '/' )
+        {
+          return false;
+        }
+        ++pattern;
+        if( MatchClass( pattern, *path ) == false )
+        {
+          return false;
+        }
+        ++path;
+        break;
+
+      default:
+        if( *pattern != *path )
+        {
+          return false;
+        }
+        ++pattern;
+        ++path;
+        break;
+    }
+  }
+
+  return *path == 0;
+}
+
+void Walk::Dir( ArchiveDir* dir, const std::string& prefix, const std::string& pattern, WalkEntries& entries )
+{
+  for( std::vector< uv_dirent_t >::const_iterator child=dir->listing_.begin(); child!=dir->listing_.end(); ++child )
+  {
+    const std::string child_path = ( prefix.length() == 0 ) ? std::string( child->name ) : prefix + std::string( "/" ) + child->name;
+
+    if( pattern.length() == 0 || Match( pattern.c_str(), child_path.c_str() ) )
+    {
+      WalkEntry entry;
+      entry.path_ = child_path;
+      entry.type_ = child->type;
+      entries.push_back( entry );
+    }
+
+    if( child->type == UV_DIRENT_DIR )
+    {
+      Dir( dir->FindDir( child->name ), child_path, pattern, entries );
+    }
+  }
+}
+
+#if defined(_WIN32)
+
+static void DiskScandir( const std::string& path, const std::string& prefix, const std::string& pattern, WalkEntries& entries )
+{
+  uv_fs_t scandir_req;
+
+  if( ::uv_fs_scandir( nullptr, &scandir_req, path.c_str(), 0, nullptr ) >= 0 )
+  {
+    uv_dirent_t ent;
+
+    while( ::uv_fs_scandir_next( &scandir_req, &ent ) != UV_EOF )
+    {
+      const std::string child_path = ( prefix.length() == 0 ) ? std::string( ent.name ) : prefix + std::string( "/" ) + ent.name;
+
+      if( pattern.length() == 0 || Walk::Match( pattern.c_str(), child_path.c_str() ) )
+      {
+        WalkEntry entry;
+        entry.path_ = child_path;
+        entry.type_ = ent.type;
+        entries.push_back( entry );
+      }
+
+      if( ent.type == UV_DIRENT_DIR )
+      {
+        DiskScandir( path + std::string( "/" ) + ent.name, child_path, pattern, entries );
+      }
+    }
+  }
+
+  ::uv_fs_req_cleanup( &scandir_req );
+}
+
+#else
+
+typedef struct
+{
+  size_t root_length_ = 0;
+  const std::string* pattern_ = nullptr;
+  WalkEntries* entries_ = nullptr;
+} DiskWalk;
+
+// nftw() gives no way to pass user data so the walk in progress is kept per thread.
+static thread_local DiskWalk* tDiskWalk = nullptr;
+
+static int OnDiskEntry( const char* fpath, const struct stat* sb, int typeflag, struct FTW* ftwbuf )
+{
+  // the root is not part of the results.
+  if( ftwbuf->level == 0 )
+  {
+    return 0;
+  }
+
+  const char* relative = fpath + tDiskWalk->root_length_;
+  while( *relative == '/' )
+  {
+    ++relative;
+  }
+
+  if( tDiskWalk->pattern_->length() != 0 && Walk::Match( tDiskWalk->pattern_->c_str(), relative ) == false )
+  {
+    return 0;
+  }
+
+  WalkEntry entry;
+  entry.path_ = relative;
+
+  switch( typeflag )
+  {
+    case FTW_D:
+    case FTW_DNR:
+    case FTW_DP:
+      entry.type_ = UV_DIRENT_DIR;
+      break;
+
+    case FTW_SL:
+#if defined(FTW_SLN)
+    case FTW_SLN:
+#endif
+      entry.type_ = UV_DIRENT_LINK;
+      break;
+
+    case FTW_F:
+      if( S_ISREG( sb->st_mode ) )
+      {
+        entry.type_ = UV_DIRENT_FILE;
+      }
+      else if( S_ISFIFO( sb->st_mode ) )
+      {
+        entry.type_ = UV_DIRENT_FIFO;
+      }
+      else if( S_ISSOCK( sb->st_mode ) )
+      {
+        entry.type_ = UV_DIRENT_SOCKET;
+      }
+      else if( S_ISCHR( sb->st_mode ) )
+      {
+        entry.type_ = UV_DIRENT_CHAR;
+      }
+      else if( S_ISBLK( sb->st_mode ) )
+      {
+        entry.type_ = UV_DIRENT_BLOCK;
+      }
+      break;
+
+    default:
+      break;
+  }
+
+  tDiskWalk->entries_->push_back( entry );
+
+  return 0;
+}
+
+#endif
+
+int Walk::Disk( const std::string& path, const std::string& pattern, WalkEntries& entries )
+{
+  uv_fs_t stat_req;
+  int r = ::uv_fs_stat( nullptr, &stat_req, path.c_str(), nullptr );
+  const bool is_dir = ( r == 0 ) && ( ( stat_req.statbuf.st_mode & 0xF000 ) == 0x4000 );  // _S_IFDIR
+  ::uv_fs_req_cleanup( &stat_req );
+
+  if( r < 0 )
+  {
+    return r;
+  }
+
+  if( is_dir == false )
+  {
+    return UV_ENOTDIR;
+  }
+
+#if defined(_WIN32)
+  DiskScandir( path, std::string(), pattern, entries );
+#else
+  DiskWalk walk;
+  walk.root_length_ = path.length();
+  walk.pattern_ = &pattern;
+  walk.entries_ = &entries;
+
+  tDiskWalk = &walk;
+  r = ::nftw( path.c_str(), &OnDiskEntry, 64, FTW_PHYS );
+  tDiskWalk = nullptr;
+
+  if( r != 0 )
+  {
+    return ::uv_translate_sys_error( errno );
+  }
+#endif
+
+  return static_cast< int >( entries.size() );
+}
+
+}
@@ -0,0 +1,31 @@
+#ifndef SRC_ARCHIVE_WALK_H_
+#define SRC_ARCHIVE_WALK_H_
+
+#include "archive/archive.h"
+
+#include <string>
+
+namespace archive
+{
+
+/// Recursive dir walks with optional glob filtering, used by Manager::fs_walk().
+/// Entry paths are relative to the dir walked and always use '/'.
+class Walk
+{
+public:
+  /// Tests path against a glob pattern.
+  /// '*' and '?' match within a path part, '**' matches across parts (so "**/*.js" also matches "a.js") and [a-z] / [!a-z] match a char class.
+  static bool Match( const char* pattern, const char* path );
+
+  /// Walks an archive dir adding every item below it that matches pattern (an empty pattern matches everything), dirs are walked in listing order.
+  static void Dir( ArchiveDir* dir, const std::string& prefix, const std::string& pattern, WalkEntries& entries );
+
+  /// Walks a dir on the local file system in the same way as Dir(), symbolic links are reported but not followed.
+  /// Uses nftw() where there is one, else scandir.
+  /// \return the number of entries or a UV_* error code.
+  static int Disk( const std::string& path, const std::string& pattern, WalkEntries& entries );
+};
+
+}
+
+#endif /* SRC_ARCHIVE_WALK_H_ */
@@ -132,6 +132,7 @@ void SetupBootstrapObject(Environment* env,
   BOOTSTRAP_METHOD(_hrtime, Hrtime);
   BOOTSTRAP_METHOD(_hrtimeBigInt, HrtimeBigInt);
   BOOTSTRAP_METHOD(_memoryUsage, MemoryUsage);
+  BOOTSTRAP_METHOD(_archiveStats, ArchiveStats);
   BOOTSTRAP_METHOD(_rawDebug, RawDebug);
   BOOTSTRAP_METHOD(_umask, Umask);
 
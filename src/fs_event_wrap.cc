@@ -156,7 +156,7 @@ void FSEventWrap::Start(const FunctionCallbackInfo<Value>& args) {
     return args.GetReturnValue().Set(err);
   }
 
-  err = uv_fs_event_start(&wrap->handle_, OnEvent, *path, flags);
+  err = archive::uv_fs_event_start(&wrap->handle_, OnEvent, *path, flags);
   wrap->MarkAsInitialized();
 
   if (err != 0) {
@@ -32,6 +32,7 @@
 #include "node_context_data.h"
 #include "tracing/traced_value.h"
 #include "archive/manager.h"
+#include "archive/trace.h"
 
 #if defined HAVE_PERFCTR
 #include "node_counters.h"
@@ -1312,7 +1313,8 @@ class DLib {
 
 #ifdef __POSIX__
 bool DLib::Open() {
-  std::string true_filename = archive::Manager::Get()->GetTrueFileName(filename_);
+  std::string true_filename =
+      archive::Manager::Get()->GetLibraryFileName(filename_);
   handle_ = dlopen(true_filename.c_str(), flags_);
   if (handle_ != nullptr)
     return true;
@@ -2987,6 +2989,18 @@ static void ParseArgs(int* argc,
       args_consumed += 1;
     } else if (strcmp(arg, "--archive.trace") == 0) {
       args_consumed += 1;
+    } else if (strcmp(arg, "--archive.relayout") == 0) {
+      args_consumed += 1;
+    } else if (strcmp(arg, "--archive.upper") == 0) {
+      args_consumed += 1;
+    } else if (strcmp(arg, "--archive.publickey") == 0) {
+      args_consumed += 1;
+    } else if (strcmp(arg, "--archive.noprefetch") == 0 ||
+               strcmp(arg, "--archive.nocodecache") == 0 ||
+               strcmp(arg, "--archive.noshareindex") == 0 ||
+               strcmp(arg, "--archive.dedup") == 0 ||
+               strcmp(arg, "--archive.self") == 0) {
+      // Consumed by archive::Manager::Init().
     } else if (strcmp(arg, "--loader") == 0) {
       const char* module = argv[index + 1];
       if (!config_experimental_modules) {
@@ -3827,6 +3841,11 @@ int Start(int argc, char** argv) {
     return 1;
   }
 
+  const int archive_tools_exit_code = archive_manager.RunTools();
+  if (archive_tools_exit_code >= 0) {
+    return archive_tools_exit_code;
+  }
+
   // Hack around with the argv pointer. Used for process.title = "blah".
   argv = uv_setup_args(argc, argv);
 
@@ -3853,6 +3872,8 @@ int Start(int argc, char** argv) {
 #endif  // HAVE_OPENSSL
 
   v8_platform.Initialize(v8_thread_pool_size);
+  // The archives were mounted before tracing started, add what they traced.
+  archive::Trace::Flush();
   V8::Initialize();
   performance::performance_v8_start = PERFORMANCE_NOW();
   v8_initialized = true;
@@ -609,6 +609,10 @@ class ContextifyScript : public BaseObject {
 
     target->Set(class_name, script_tmpl->GetFunction());
     env->set_script_context_constructor_template(script_tmpl);
+
+    env->SetMethod(target, "compileFunction", CompileFunction);
+    env->SetMethod(target, "createFunctionCachedData",
+                   CreateFunctionCachedData);
   }
 
 
@@ -763,6 +767,98 @@ class ContextifyScript : public BaseObject {
   }
 
 
+  // compileFunction(code, filename, params, cachedData)
+  // Compiles code as the body of a function taking params.  V8 does this
+  // without concatenating a wrapper onto code so an external code string
+  // stays external.  Returns [function, cachedDataRejected].
+  static void CompileFunction(const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    Isolate* isolate = env->isolate();
+    Local<Context> context = env->context();
+
+    CHECK_EQ(args.Length(), 4);
+
+    CHECK(args[0]->IsString());
+    Local<String> code = args[0].As<String>();
+
+    CHECK(args[1]->IsString());
+    Local<String> filename = args[1].As<String>();
+
+    CHECK(args[2]->IsArray());
+    Local<Array> params_array = args[2].As<Array>();
+    std::vector<Local<String>> params;
+    for (uint32_t n = 0; n < params_array->Length(); n++) {
+      Local<Value> param = params_array->Get(context, n).ToLocalChecked();
+      CHECK(param->IsString());
+      params.push_back(param.As<String>());
+    }
+
+    ScriptCompiler::CachedData* cached_data = nullptr;
+    if (!args[3]->IsUndefined()) {
+      CHECK(args[3]->IsUint8Array());
+      Local<Uint8Array> cached_data_buf = args[3].As<Uint8Array>();
+      ArrayBuffer::Contents contents = cached_data_buf->Buffer()->GetContents();
+      uint8_t* data = static_cast<uint8_t*>(contents.Data());
+      cached_data = new ScriptCompiler::CachedData(
+          data + cached_data_buf->ByteOffset(), cached_data_buf->ByteLength());
+    }
+
+    ScriptOrigin origin(filename,
+                        Integer::New(isolate, 0),
+                        Integer::New(isolate, 0));
+    ScriptCompiler::Source source(code, origin, cached_data);
+    ScriptCompiler::CompileOptions compile_options =
+        ScriptCompiler::kNoCompileOptions;
+
+    if (source.GetCachedData() != nullptr)
+      compile_options = ScriptCompiler::kConsumeCodeCache;
+
+    TryCatch try_catch(isolate);
+    Environment::ShouldNotAbortOnUncaughtScope no_abort_scope(env);
+
+    MaybeLocal<Function> maybe_fn = ScriptCompiler::CompileFunctionInContext(
+        context, &source, params.size(), params.data(), 0, nullptr,
+        compile_options);
+
+    Local<Function> fn;
+    if (!maybe_fn.ToLocal(&fn)) {
+      DecorateErrorStack(env, try_catch);
+      no_abort_scope.Close();
+      try_catch.ReThrow();
+      return;
+    }
+
+    const bool rejected =
+        compile_options == ScriptCompiler::kConsumeCodeCache &&
+        source.GetCachedData()->rejected;
+
+    Local<Array> result = Array::New(isolate, 2);
+    result->Set(context, 0, fn).FromJust();
+    result->Set(context, 1, Boolean::New(isolate, rejected)).FromJust();
+    args.GetReturnValue().Set(result);
+  }
+
+
+  // The code cache of a function made by compileFunction(), made after it
+  // has run it also covers the functions compiled while it ran.
+  static void CreateFunctionCachedData(
+      const FunctionCallbackInfo<Value>& args) {
+    Environment* env = Environment::GetCurrent(args);
+    CHECK(args[0]->IsFunction());
+    std::unique_ptr<ScriptCompiler::CachedData> cached_data(
+        ScriptCompiler::CreateCodeCacheForFunction(args[0].As<Function>()));
+    if (!cached_data) {
+      args.GetReturnValue().Set(Buffer::New(env, 0).ToLocalChecked());
+    } else {
+      MaybeLocal<Object> buf = Buffer::Copy(
+          env,
+          reinterpret_cast<const char*>(cached_data->data),
+          cached_data->length);
+      args.GetReturnValue().Set(buf.ToLocalChecked());
+    }
+  }
+
+
   static void RunInThisContext(const FunctionCallbackInfo<Value>& args) {
     Environment* env = Environment::GetCurrent(args);
 
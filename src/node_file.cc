@@ -50,6 +50,7 @@ namespace node {
 namespace fs {
 
 using v8::Array;
+using v8::ArrayBuffer;
 using v8::BigUint64Array;
 using v8::Context;
 using v8::EscapableHandleScope;
@@ -613,7 +614,36 @@ void AfterScanDir(uv_fs_t* req) {
   req_wrap->Resolve(names);
 }
 
-void AfterScanDirWithTypes(uv_fs_t* req) {
+// Turns the children listed by archive::uv_fs_readdir_types() into
+// [names, types], as readdir() withFileTypes gives them.
+static MaybeLocal<Value> DirTypesToArray(Environment* env,
+                                         const archive::DirStats& items,
+                                         enum encoding encoding,
+                                         Local<Value>* error) {
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  const uint32_t count = static_cast<uint32_t>(items.size());
+
+  Local<Array> names = Array::New(isolate, count);
+  Local<Array> types = Array::New(isolate, count);
+
+  for (uint32_t i = 0; i < count; i++) {
+    MaybeLocal<Value> filename =
+        StringBytes::Encode(isolate, items[i].name_.c_str(), encoding, error);
+    if (filename.IsEmpty())
+      return MaybeLocal<Value>();
+
+    names->Set(context, i, filename.ToLocalChecked()).FromJust();
+    types->Set(context, i, Integer::New(isolate, items[i].type_)).FromJust();
+  }
+
+  Local<Array> result = Array::New(isolate, 2);
+  result->Set(context, 0, names).FromJust();
+  result->Set(context, 1, types).FromJust();
+  return result;
+}
+
+void AfterReaddirTypes(uv_fs_t* req) {
   FSReqBase* req_wrap = FSReqBase::from_req(req);
   FSReqAfterScope after(req_wrap, req);
 
@@ -621,80 +651,129 @@ void AfterScanDirWithTypes(uv_fs_t* req) {
     return;
   }
 
-  Environment* env = req_wrap->env();
   Local<Value> error;
-  int r;
-  Local<Array> names = Array::New(env->isolate(), 0);
-  Local<Function> fn = env->push_values_to_array_function();
-  Local<Value> name_argv[NODE_PUSH_VAL_TO_ARRAY_MAX];
-  size_t name_idx = 0;
-  Local<Value> types = Array::New(env->isolate(), 0);
-  Local<Value> type_argv[NODE_PUSH_VAL_TO_ARRAY_MAX];
-  size_t type_idx = 0;
-
-  for (int i = 0; ; i++) {
-    uv_dirent_t ent;
-
-    r = archive::uv_fs_scandir_next(req, &ent);
-    if (r == UV_EOF)
-      break;
-    if (r != 0) {
-      return req_wrap->Reject(
-          UVException(r, nullptr, req_wrap->syscall(),
-            static_cast<const char*>(req->path)));
+  MaybeLocal<Value> result =
+      DirTypesToArray(req_wrap->env(), *archive::uv_fs_get_dir_stats(req),
+                      req_wrap->encoding(), &error);
+  if (result.IsEmpty())
+    return req_wrap->Reject(error);
+
+  req_wrap->Resolve(result.ToLocalChecked());
+}
+
+// Turns the children listed by archive::uv_fs_readdir_stats() into
+// [names, types, stats, errors]. stats holds kFsStatsFieldsLength values per
+// child and errors is 0 or the errno from stat'ing the child.
+static MaybeLocal<Value> DirStatsToArray(Environment* env,
+                                         const archive::DirStats& items,
+                                         enum encoding encoding,
+                                         Local<Value>* error) {
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  const uint32_t count = static_cast<uint32_t>(items.size());
+  const size_t fields_length = count * env->kFsStatsFieldsLength;
+
+  Local<Array> names = Array::New(isolate, count);
+  Local<Array> types = Array::New(isolate, count);
+  Local<Array> errors = Array::New(isolate, count);
+  Local<ArrayBuffer> ab =
+      ArrayBuffer::New(isolate, fields_length * sizeof(double));
+
+  if (count > 0) {
+    AliasedBuffer<double, Float64Array> fields(isolate, fields_length);
+
+    for (uint32_t i = 0; i < count; i++) {
+      const archive::DirStatsItem& item = items[i];
+
+      MaybeLocal<Value> filename =
+          StringBytes::Encode(isolate, item.name_.c_str(), encoding, error);
+      if (filename.IsEmpty())
+        return MaybeLocal<Value>();
+
+      names->Set(context, i, filename.ToLocalChecked()).FromJust();
+      types->Set(context, i, Integer::New(isolate, item.type_)).FromJust();
+      errors->Set(context, i,
+                  Integer::New(isolate, item.stat_result_)).FromJust();
+
+      if (item.stat_result_ == 0)
+        node::FillStatsArray(&fields, &item.stat_,
+                             i * env->kFsStatsFieldsLength);
     }
 
-    MaybeLocal<Value> filename =
-      StringBytes::Encode(env->isolate(),
-          ent.name,
-          req_wrap->encoding(),
-          &error);
-    if (filename.IsEmpty())
-      return req_wrap->Reject(error);
-
-    name_argv[name_idx++] = filename.ToLocalChecked();
+    memcpy(ab->GetContents().Data(), fields.GetNativeBuffer(),
+           fields_length * sizeof(double));
+  }
 
-    if (name_idx >= arraysize(name_argv)) {
-      MaybeLocal<Value> ret = fn->Call(env->context(), names, name_idx,
-                                       name_argv);
-      if (ret.IsEmpty()) {
-        return;
-      }
-      name_idx = 0;
-    }
+  Local<Array> result = Array::New(isolate, 4);
+  result->Set(context, 0, names).FromJust();
+  result->Set(context, 1, types).FromJust();
+  result->Set(context, 2, Float64Array::New(ab, 0, fields_length)).FromJust();
+  result->Set(context, 3, errors).FromJust();
+  return result;
+}
 
-    type_argv[type_idx++] = Integer::New(env->isolate(), ent.type);
+void AfterReaddirStats(uv_fs_t* req) {
+  FSReqBase* req_wrap = FSReqBase::from_req(req);
+  FSReqAfterScope after(req_wrap, req);
 
-    if (type_idx >= arraysize(type_argv)) {
-      MaybeLocal<Value> ret = fn->Call(env->context(), types, type_idx,
-          type_argv);
-      if (ret.IsEmpty()) {
-        return;
-      }
-      type_idx = 0;
-    }
+  if (!after.Proceed()) {
+    return;
   }
 
-  if (name_idx > 0) {
-    MaybeLocal<Value> ret = fn->Call(env->context(), names, name_idx,
-        name_argv);
-    if (ret.IsEmpty()) {
-      return;
-    }
+  Local<Value> error;
+  MaybeLocal<Value> result =
+      DirStatsToArray(req_wrap->env(), *archive::uv_fs_get_dir_stats(req),
+                      req_wrap->encoding(), &error);
+  if (result.IsEmpty())
+    return req_wrap->Reject(error);
+
+  req_wrap->Resolve(result.ToLocalChecked());
+}
+
+// Turns the items found by archive::uv_fs_walk() into [paths, types].
+static MaybeLocal<Value> WalkEntriesToArray(Environment* env,
+                                            const archive::WalkEntries& items,
+                                            enum encoding encoding,
+                                            Local<Value>* error) {
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+  const uint32_t count = static_cast<uint32_t>(items.size());
+
+  Local<Array> paths = Array::New(isolate, count);
+  Local<Array> types = Array::New(isolate, count);
+
+  for (uint32_t i = 0; i < count; i++) {
+    MaybeLocal<Value> item_path =
+        StringBytes::Encode(isolate, items[i].path_.c_str(), encoding, error);
+    if (item_path.IsEmpty())
+      return MaybeLocal<Value>();
+
+    paths->Set(context, i, item_path.ToLocalChecked()).FromJust();
+    types->Set(context, i, Integer::New(isolate, items[i].type_)).FromJust();
   }
 
-  if (type_idx > 0) {
-    MaybeLocal<Value> ret = fn->Call(env->context(), types, type_idx,
-        type_argv);
-    if (ret.IsEmpty()) {
-      return;
-    }
+  Local<Array> result = Array::New(isolate, 2);
+  result->Set(context, 0, paths).FromJust();
+  result->Set(context, 1, types).FromJust();
+  return result;
+}
+
+void AfterWalk(uv_fs_t* req) {
+  FSReqBase* req_wrap = FSReqBase::from_req(req);
+  FSReqAfterScope after(req_wrap, req);
+
+  if (!after.Proceed()) {
+    return;
   }
 
-  Local<Array> result = Array::New(env->isolate(), 2);
-  result->Set(0, names);
-  result->Set(1, types);
-  req_wrap->Resolve(result);
+  Local<Value> error;
+  MaybeLocal<Value> result =
+      WalkEntriesToArray(req_wrap->env(), *archive::uv_fs_get_walk_entries(req),
+                         req_wrap->encoding(), &error);
+  if (result.IsEmpty())
+    return req_wrap->Reject(error);
+
+  req_wrap->Resolve(result.ToLocalChecked());
 }
 
 
@@ -899,6 +978,150 @@ static void InternalModuleReadJSON(const FunctionCallbackInfo<Value>& args) {
   }
 }
 
+// The source of a module in an archive.  The memory belongs to the archive,
+// which stays mounted until the archive::Manager in Start() is destroyed.
+// That is after V8::Dispose(), so no string outlives the memory.
+class ArchiveSourceResource : public String::ExternalOneByteStringResource {
+ public:
+  ArchiveSourceResource(const char* data, size_t length)
+      : data_(data), length_(length) {}
+
+  const char* data() const override { return data_; }
+  size_t length() const override { return length_; }
+
+ private:
+  const char* data_;
+  size_t length_;
+};
+
+static bool IsAscii(const char* data, size_t length) {
+  unsigned char bits = 0;
+  for (size_t i = 0; i < length; i++)
+    bits |= static_cast<unsigned char>(data[i]);
+  return bits < 0x80;
+}
+
+// Used to speed up loading modules from an archive.  Returns the source of a
+// file in a mounted archive as an external string over the archive's memory,
+// so it's neither read into a buffer nor decoded.  Returns undefined when the
+// file is not in an archive, is not all ASCII (where one byte strings and
+// UTF-8 differ) or has no memory view, the caller then reads it as usual.
+static void InternalModuleReadSource(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  uv_loop_t* loop = env->event_loop();
+
+  CHECK(args[0]->IsString());
+  node::Utf8Value path(env->isolate(), args[0]);
+
+  archive::Manager* manager = archive::Manager::Get();
+  if (manager == nullptr || !manager->InArchive(*path))
+    return;
+
+  uv_fs_t open_req;
+  const int fd = archive::uv_fs_open(loop, &open_req, *path, O_RDONLY, 0,
+                                     nullptr);
+  archive::uv_fs_req_cleanup(&open_req);
+
+  if (fd < 0)
+    return;
+
+  const char* content = nullptr;
+  size_t content_size = 0;
+  if (manager->ContentView(fd, &content, &content_size) &&
+      content_size != 0 &&
+      content_size <= static_cast<size_t>(String::kMaxLength) &&
+      IsAscii(content, content_size)) {
+    ArchiveSourceResource* resource =
+        new ArchiveSourceResource(content, content_size);
+    Local<String> source;
+    if (String::NewExternalOneByte(env->isolate(), resource).ToLocal(&source))
+      args.GetReturnValue().Set(source);
+    else
+      delete resource;
+  }
+
+  uv_fs_t close_req;
+  CHECK_EQ(0, archive::uv_fs_close(loop, &close_req, fd, nullptr));
+  archive::uv_fs_req_cleanup(&close_req);
+}
+
+// Used to speed up loading modules from an archive.  Returns undefined when
+// the path is not in a mounted archive, null when it is but there is no V8
+// code cache for it yet or else the code cache as a Buffer.
+static void InternalModuleReadCodeCache(
+    const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  CHECK(args[0]->IsString());
+  node::Utf8Value path(env->isolate(), args[0]);
+
+  archive::Manager* manager = archive::Manager::Get();
+  std::vector<char> content;
+  if (manager == nullptr ||
+      !manager->ReadCodeCache(*path, v8::V8::GetVersion(), content)) {
+    return;
+  }
+
+  if (content.empty())
+    return args.GetReturnValue().SetNull();
+
+  Local<Object> buffer;
+  if (Buffer::Copy(env, content.data(), content.size()).ToLocal(&buffer))
+    args.GetReturnValue().Set(buffer);
+}
+
+// Stores the V8 code cache made by InternalModuleReadCodeCache()'s caller.
+static void InternalModuleWriteCodeCache(
+    const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  CHECK(args[0]->IsString());
+  CHECK(Buffer::HasInstance(args[1]));
+  node::Utf8Value path(env->isolate(), args[0]);
+
+  archive::Manager* manager = archive::Manager::Get();
+  if (manager != nullptr) {
+    manager->WriteCodeCache(*path, v8::V8::GetVersion(),
+                            Buffer::Data(args[1]), Buffer::Length(args[1]));
+  }
+}
+
+// Used to speed up realpath() of files in an archive.  Returns undefined when
+// the path is not in a mounted archive, < 0 when the archive has no such file
+// (usually -ENOENT) or else the real path from the archive's index, so none of
+// the path's parts need an lstat().
+static void ArchiveRealpath(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  CHECK(args[0]->IsString());
+  node::Utf8Value path(env->isolate(), args[0]);
+
+  archive::Manager* manager = archive::Manager::Get();
+  std::string real_path;
+  int result = 0;
+  if (manager == nullptr ||
+      manager->RealPath(*path, real_path, result) == nullptr) {
+    return;
+  }
+
+  if (result < 0)
+    return args.GetReturnValue().Set(result);
+
+  Local<String> real;
+  if (String::NewFromUtf8(env->isolate(), real_path.data(),
+                          v8::NewStringType::kNormal,
+                          static_cast<int>(real_path.size())).ToLocal(&real)) {
+    args.GetReturnValue().Set(real);
+  }
+}
+
+// Tells realpath() whether what ArchiveRealpath() returns can be kept, it
+// can't when there is an upper dir as a path can then be copied up or removed.
+static void ArchiveHasUpperDir(const FunctionCallbackInfo<Value>& args) {
+  archive::Manager* manager = archive::Manager::Get();
+  args.GetReturnValue().Set(manager != nullptr && manager->HasUpperDir());
+}
+
 // Used to speed up module loading.  Returns 0 if the path refers to
 // a file, 1 when it's a directory or < 0 on error (usually -ENOENT.)
 // The speedup comes from not creating thousands of Stat and Error objects.
@@ -1463,16 +1686,40 @@ static void ReadDir(const FunctionCallbackInfo<Value>& args) {
 
   bool with_types = args[2]->BooleanValue();
 
+  // With types the listing comes from archive::uv_fs_readdir_types(), which
+  // stats a child whose dir entry has no type in the same call.
   FSReqBase* req_wrap_async = GetReqWrap(env, args[3]);
   if (req_wrap_async != nullptr) {  // readdir(path, encoding, withTypes, req)
     if (with_types) {
       AsyncCall(env, req_wrap_async, args, "scandir", encoding,
-                AfterScanDirWithTypes, archive::uv_fs_scandir, *path, 0 /*flags*/);
+                AfterReaddirTypes, archive::uv_fs_readdir_types, *path);
     } else {
       AsyncCall(env, req_wrap_async, args, "scandir", encoding,
                 AfterScanDir, archive::uv_fs_scandir, *path, 0 /*flags*/);
     }
-  } else {  // readdir(path, encoding, withTypes, undefined, ctx)
+  } else if (with_types) {  // readdir(path, encoding, true, undefined, ctx)
+    CHECK_EQ(argc, 5);
+    FSReqWrapSync req_wrap_sync;
+    FS_SYNC_TRACE_BEGIN(readdir);
+    int err = SyncCall(env, args[4], &req_wrap_sync, "scandir",
+                       archive::uv_fs_readdir_types, *path);
+    FS_SYNC_TRACE_END(readdir);
+    if (err < 0) {
+      return;  // syscall failed, no need to continue, error info is in ctx
+    }
+
+    Local<Value> error;
+    MaybeLocal<Value> result =
+        DirTypesToArray(env, *archive::uv_fs_get_dir_stats(&req_wrap_sync.req),
+                        encoding, &error);
+    if (result.IsEmpty()) {
+      Local<Object> ctx = args[4].As<Object>();
+      ctx->Set(env->context(), env->error_string(), error).FromJust();
+      return;
+    }
+
+    args.GetReturnValue().Set(result.ToLocalChecked());
+  } else {  // readdir(path, encoding, false, undefined, ctx)
     CHECK_EQ(argc, 5);
     FSReqWrapSync req_wrap_sync;
     FS_SYNC_TRACE_BEGIN(readdir);
@@ -1490,14 +1737,6 @@ static void ReadDir(const FunctionCallbackInfo<Value>& args) {
     Local<Value> name_v[NODE_PUSH_VAL_TO_ARRAY_MAX];
     size_t name_idx = 0;
 
-    Local<Value> types;
-    Local<Value> type_v[NODE_PUSH_VAL_TO_ARRAY_MAX];
-    size_t type_idx;
-    if (with_types) {
-      types = Array::New(env->isolate(), 0);
-      type_idx = 0;
-    }
-
     for (int i = 0; ; i++) {
       uv_dirent_t ent;
 
@@ -1535,19 +1774,6 @@ static void ReadDir(const FunctionCallbackInfo<Value>& args) {
         }
         name_idx = 0;
       }
-
-      if (with_types) {
-        type_v[type_idx++] = Integer::New(env->isolate(), ent.type);
-
-        if (type_idx >= arraysize(type_v)) {
-          MaybeLocal<Value> ret = fn->Call(env->context(), types, type_idx,
-              type_v);
-          if (ret.IsEmpty()) {
-            return;
-          }
-          type_idx = 0;
-        }
-      }
     }
 
     if (name_idx > 0) {
@@ -1557,21 +1783,91 @@ static void ReadDir(const FunctionCallbackInfo<Value>& args) {
       }
     }
 
-    if (with_types && type_idx > 0) {
-      MaybeLocal<Value> ret = fn->Call(env->context(), types, type_idx, type_v);
-      if (ret.IsEmpty()) {
-        return;
-      }
+    args.GetReturnValue().Set(names);
+  }
+}
+
+static void Walk(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  const int argc = args.Length();
+  CHECK_GE(argc, 3);
+
+  BufferValue path(env->isolate(), args[0]);
+  CHECK_NOT_NULL(*path);
+
+  const std::string pattern =
+      args[1]->IsString() ? *node::Utf8Value(env->isolate(), args[1]) : "";
+
+  const enum encoding encoding = ParseEncoding(env->isolate(), args[2], UTF8);
+
+  FSReqBase* req_wrap_async = GetReqWrap(env, args[3]);
+  if (req_wrap_async != nullptr) {  // walk(path, pattern, encoding, req)
+    AsyncCall(env, req_wrap_async, args, "scandir", encoding,
+              AfterWalk, archive::uv_fs_walk, *path, pattern.c_str());
+  } else {  // walk(path, pattern, encoding, undefined, ctx)
+    CHECK_EQ(argc, 5);
+    FSReqWrapSync req_wrap_sync;
+    FS_SYNC_TRACE_BEGIN(readdir);
+    int err = SyncCall(env, args[4], &req_wrap_sync, "scandir",
+                       archive::uv_fs_walk, *path, pattern.c_str());
+    FS_SYNC_TRACE_END(readdir);
+    if (err < 0) {
+      return;  // syscall failed, no need to continue, error info is in ctx
     }
 
-    if (with_types) {
-      Local<Array> result = Array::New(env->isolate(), 2);
-      result->Set(0, names);
-      result->Set(1, types);
-      args.GetReturnValue().Set(result);
-    } else {
-      args.GetReturnValue().Set(names);
+    Local<Value> error;
+    MaybeLocal<Value> result =
+        WalkEntriesToArray(env,
+                           *archive::uv_fs_get_walk_entries(&req_wrap_sync.req),
+                           encoding, &error);
+    if (result.IsEmpty()) {
+      Local<Object> ctx = args[4].As<Object>();
+      ctx->Set(env->context(), env->error_string(), error).FromJust();
+      return;
+    }
+
+    args.GetReturnValue().Set(result.ToLocalChecked());
+  }
+}
+
+static void ReaddirStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+
+  const int argc = args.Length();
+  CHECK_GE(argc, 2);
+
+  BufferValue path(env->isolate(), args[0]);
+  CHECK_NOT_NULL(*path);
+
+  const enum encoding encoding = ParseEncoding(env->isolate(), args[1], UTF8);
+
+  FSReqBase* req_wrap_async = GetReqWrap(env, args[2]);
+  if (req_wrap_async != nullptr) {  // readdirStats(path, encoding, req)
+    AsyncCall(env, req_wrap_async, args, "scandir", encoding,
+              AfterReaddirStats, archive::uv_fs_readdir_stats, *path);
+  } else {  // readdirStats(path, encoding, undefined, ctx)
+    CHECK_EQ(argc, 4);
+    FSReqWrapSync req_wrap_sync;
+    FS_SYNC_TRACE_BEGIN(readdir);
+    int err = SyncCall(env, args[3], &req_wrap_sync, "scandir",
+                       archive::uv_fs_readdir_stats, *path);
+    FS_SYNC_TRACE_END(readdir);
+    if (err < 0) {
+      return;  // syscall failed, no need to continue, error info is in ctx
     }
+
+    Local<Value> error;
+    MaybeLocal<Value> result =
+        DirStatsToArray(env, *archive::uv_fs_get_dir_stats(&req_wrap_sync.req),
+                        encoding, &error);
+    if (result.IsEmpty()) {
+      Local<Object> ctx = args[3].As<Object>();
+      ctx->Set(env->context(), env->error_string(), error).FromJust();
+      return;
+    }
+
+    args.GetReturnValue().Set(result.ToLocalChecked());
   }
 }
 
@@ -2190,8 +2486,17 @@ void Initialize(Local<Object> target,
   env->SetMethod(target, "rmdir", RMDir);
   env->SetMethod(target, "mkdir", MKDir);
   env->SetMethod(target, "readdir", ReadDir);
+  env->SetMethod(target, "readdirStats", ReaddirStats);
+  env->SetMethod(target, "walk", Walk);
   env->SetMethod(target, "internalModuleReadJSON", InternalModuleReadJSON);
   env->SetMethod(target, "internalModuleStat", InternalModuleStat);
+  env->SetMethod(target, "internalModuleReadSource", InternalModuleReadSource);
+  env->SetMethod(target, "internalModuleReadCodeCache",
+                 InternalModuleReadCodeCache);
+  env->SetMethod(target, "internalModuleWriteCodeCache",
+                 InternalModuleWriteCodeCache);
+  env->SetMethod(target, "archiveRealpath", ArchiveRealpath);
+  env->SetMethod(target, "archiveHasUpperDir", ArchiveHasUpperDir);
   env->SetMethod(target, "stat", Stat);
   env->SetMethod(target, "lstat", LStat);
   env->SetMethod(target, "fstat", FStat);
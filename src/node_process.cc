@@ -4,6 +4,7 @@
 #include "util-inl.h"
 #include "uv.h"
 #include "v8.h"
+#include "archive/manager.h"
 
 #include <limits.h>  // PATH_MAX
 #include <stdio.h>
@@ -30,12 +31,14 @@ namespace node {
 using v8::Array;
 using v8::ArrayBuffer;
 using v8::BigUint64Array;
+using v8::Context;
 using v8::Float64Array;
 using v8::FunctionCallbackInfo;
 using v8::HeapStatistics;
 using v8::Integer;
 using v8::Isolate;
 using v8::Local;
+using v8::NewStringType;
 using v8::Number;
 using v8::String;
 using v8::Uint32;
@@ -187,6 +190,73 @@ void MemoryUsage(const FunctionCallbackInfo<Value>& args) {
   fields[3] = isolate->AdjustAmountOfExternalAllocatedMemory(0);
 }
 
+static Local<Array> NamesToArray(Isolate* isolate,
+                                 const char* const* names,
+                                 uint32_t count) {
+  Local<Context> context = isolate->GetCurrentContext();
+  Local<Array> array = Array::New(isolate, count);
+  for (uint32_t i = 0; i < count; i++)
+    array->Set(context, i, OneByteString(isolate, names[i])).FromJust();
+  return array;
+}
+
+// Returns [mountPoints, archivePaths, fields, names] for the mounted archives,
+// fields holds archive::Metrics::FieldsLength values per mount as laid out by
+// archive::Metrics::Snapshot::Fill() and names is [counters, timers,
+// timerFields] naming them in that order.
+void ArchiveStats(const FunctionCallbackInfo<Value>& args) {
+  Environment* env = Environment::GetCurrent(args);
+  Isolate* isolate = env->isolate();
+  Local<Context> context = env->context();
+
+  std::vector<archive::MountMetrics> metrics;
+  archive::Manager::Get()->TakeMetrics(metrics);
+
+  const uint32_t count = static_cast<uint32_t>(metrics.size());
+  const size_t fields_length = count * archive::Metrics::FieldsLength;
+
+  Local<Array> mount_points = Array::New(isolate, count);
+  Local<Array> archive_paths = Array::New(isolate, count);
+  Local<ArrayBuffer> ab =
+      ArrayBuffer::New(isolate, fields_length * sizeof(double));
+  double* fields = static_cast<double*>(ab->GetContents().Data());
+
+  for (uint32_t i = 0; i < count; i++) {
+    const archive::MountMetrics& mount = metrics[i];
+
+    mount_points->Set(context, i,
+                      String::NewFromUtf8(isolate,
+                                          mount.mount_point_.c_str(),
+                                          NewStringType::kNormal)
+                          .ToLocalChecked()).FromJust();
+    archive_paths->Set(context, i,
+                       String::NewFromUtf8(isolate,
+                                           mount.archive_filepath_.c_str(),
+                                           NewStringType::kNormal)
+                           .ToLocalChecked()).FromJust();
+
+    mount.snapshot_.Fill(fields + i * archive::Metrics::FieldsLength);
+  }
+
+  Local<Array> names = Array::New(isolate, 3);
+  names->Set(context, 0,
+             NamesToArray(isolate, archive::Metrics::CounterNames,
+                          archive::Metrics::CounterCount)).FromJust();
+  names->Set(context, 1,
+             NamesToArray(isolate, archive::Metrics::TimerNames,
+                          archive::Metrics::TimerCount)).FromJust();
+  names->Set(context, 2,
+             NamesToArray(isolate, archive::Metrics::HistogramFieldNames,
+                          archive::Metrics::HistogramFieldsLength)).FromJust();
+
+  Local<Array> result = Array::New(isolate, 4);
+  result->Set(context, 0, mount_points).FromJust();
+  result->Set(context, 1, archive_paths).FromJust();
+  result->Set(context, 2, Float64Array::New(ab, 0, fields_length)).FromJust();
+  result->Set(context, 3, names).FromJust();
+  args.GetReturnValue().Set(result);
+}
+
 // Most of the time, it's best to use `console.error` to write
 // to the process.stderr stream.  However, in some cases, such as
 // when debugging the stream.Writable class or the process.nextTick
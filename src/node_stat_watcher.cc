@@ -117,7 +117,8 @@ void StatWatcher::Start(const FunctionCallbackInfo<Value>& args) {
 
   // Note that uv_fs_poll_start does not return ENOENT, we are handling
   // mostly memory errors here.
-  const int err = uv_fs_poll_start(&wrap->watcher_, Callback, *path, interval);
+  const int err =
+      archive::uv_fs_poll_start(&wrap->watcher_, Callback, *path, interval);
   if (err != 0) {
     args.GetReturnValue().Set(err);
   }
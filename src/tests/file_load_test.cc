@@ -1,6 +1,8 @@
 #include "archive.test.h"
+#include "archive/walk.h"
 
 #include <sys/stat.h>
+#include <cstring>
 
 namespace archive_test
 {
@@ -439,6 +441,213 @@ public:
   }
 };
 
+// Loads the same files off disk and from the archive in one batch and checks they match
+class BatchFileLoadTest : public AsyncTest
+{
+  static const size_t MaxReadSize = ( 1024 * 64 );
+
+  std::vector< std::string > filepaths_;
+  std::vector< uv_file > files_;
+  std::vector< std::vector< char > > buffers_;
+  std::vector< archive::ReadBatchItem > items_;
+  archive::ReadBatchRequest request_;
+
+  void CloseAll()
+  {
+    uv_fs_t request;
+
+    for( size_t i=0; i<files_.size(); ++i )
+    {
+      archive::uv_fs_close( Loop(), &request, files_[ i ], nullptr );
+      archive::uv_fs_req_cleanup( &request );
+    }
+    files_.clear();
+  }
+
+  void OnRead()
+  {
+    bool passed = true;
+
+    // items are in pairs, disk then archive.
+    for( size_t i=0; i<items_.size(); i+=2 )
+    {
+      const archive::ReadBatchItem& from_disk = items_[ i ];
+      const archive::ReadBatchItem& from_archive = items_[ i + 1 ];
+
+      if( from_disk.result_ <= 0 || from_disk.result_ != from_archive.result_ )
+      {
+        passed = false;
+      }
+      else if( std::memcmp( from_disk.buf_.base, from_archive.buf_.base, from_disk.result_ ) != 0 )
+      {
+        passed = false;
+      }
+    }
+
+    CloseAll();
+
+    AsyncTest::Finished( passed ? AsyncTest::RunState::Passed : AsyncTest::RunState::Failed );
+  }
+
+public:
+  BatchFileLoadTest( const char* name, const std::vector< std::string >& filepaths ) : AsyncTest( name ), filepaths_( filepaths )
+  {
+  }
+
+  void Run()
+  {
+    uv_fs_t request;
+
+    for( size_t i=0; i<filepaths_.size(); ++i )
+    {
+      const std::string paths[ 2 ] = { the_application_info->extracted_root_path_ + filepaths_[ i ], the_application_info->mount_root_path_ + filepaths_[ i ] };
+
+      for( int x=0; x<2; ++x )
+      {
+        int r = archive::uv_fs_open( Loop(), &request, paths[ x ].c_str(), O_RDONLY, 0777, nullptr );
+        archive::uv_fs_req_cleanup( &request );
+
+        if( r < 0 )
+        {
+          CloseAll();
+          AsyncTest::Finished( AsyncTest::RunState::Failed );
+          return;
+        }
+
+        files_.push_back( ( uv_file )r );
+      }
+    }
+
+    buffers_.resize( files_.size(), std::vector< char >( MaxReadSize ) );
+    items_.resize( files_.size() );
+
+    for( size_t i=0; i<files_.size(); ++i )
+    {
+      items_[ i ].file_ = files_[ i ];
+      items_[ i ].offset_ = 0;
+      items_[ i ].buf_ = uv_buf_init( buffers_[ i ].data(), MaxReadSize );
+    }
+
+    request_.data = this;
+
+    int r = archive::uv_fs_read_batch( Loop(), &request_, items_.data(), static_cast< unsigned int >( items_.size() ), []( archive::ReadBatchRequest* req )
+    {
+      BatchFileLoadTest* pThis = reinterpret_cast< BatchFileLoadTest* >( req->data );
+      pThis->OnRead();
+    } );
+
+    if( r < 0 )
+    {
+      CloseAll();
+      AsyncTest::Finished( AsyncTest::RunState::Failed );
+    }
+  }
+};
+
+// Writes to an archive file through the overlay and checks later reads see the copy, then removes it
+class OverlayWriteTest : public AsyncTest
+{
+  std::string filepath_;
+  uv_fs_t request_;
+
+  bool ReadFirst( char& first )
+  {
+    int r = archive::uv_fs_open( Loop(), &request_, filepath_.c_str(), O_RDONLY, 0777, nullptr );
+    archive::uv_fs_req_cleanup( &request_ );
+
+    if( r < 0 )
+    {
+      return false;
+    }
+
+    uv_file file = ( uv_file )r;
+    uv_buf_t buf = uv_buf_init( &first, 1 );
+
+    r = archive::uv_fs_read( Loop(), &request_, file, &buf, 1, 0, nullptr );
+    archive::uv_fs_req_cleanup( &request_ );
+
+    archive::uv_fs_close( Loop(), &request_, file, nullptr );
+    archive::uv_fs_req_cleanup( &request_ );
+
+    return r == 1;
+  }
+
+  // Turns the overlay off and removes the upper dir so later tests see the archive as it is.
+  void TearDown( const std::string& upper_dir )
+  {
+    archive::Manager::Get()->SetUpperDir( std::string() );
+
+    archive::WalkEntries entries;
+    archive::Walk::Disk( upper_dir, std::string(), entries );
+
+    // children come after their dir so go backwards.
+    for( archive::WalkEntries::const_reverse_iterator entry=entries.rbegin(); entry!=entries.rend(); ++entry )
+    {
+      const std::string path = upper_dir + "/" + entry->path_;
+      ( entry->type_ == UV_DIRENT_DIR ) ? ::uv_fs_rmdir( nullptr, &request_, path.c_str(), nullptr ) : ::uv_fs_unlink( nullptr, &request_, path.c_str(), nullptr );
+      ::uv_fs_req_cleanup( &request_ );
+    }
+
+    ::uv_fs_rmdir( nullptr, &request_, upper_dir.c_str(), nullptr );
+    ::uv_fs_req_cleanup( &request_ );
+  }
+
+public:
+  OverlayWriteTest( const char* name, const std::string& filepath ) : AsyncTest( name ), filepath_( the_application_info->mount_root_path_ + filepath )
+  {
+  }
+
+  void Run()
+  {
+    char original = 0;
+    char now = 0;
+    char marker = '#';
+    const std::string upper_dir = the_application_info->dir_root_path_ + "/upper";
+
+    if( archive::Manager::Get()->SetUpperDir( upper_dir ) != 0 || !ReadFirst( original ) )
+    {
+      TearDown( upper_dir );
+      AsyncTest::Finished( AsyncTest::RunState::Aborted );
+      return;
+    }
+
+    // the first write copies the file up.
+    int r = archive::uv_fs_open( Loop(), &request_, filepath_.c_str(), O_WRONLY, 0777, nullptr );
+    archive::uv_fs_req_cleanup( &request_ );
+
+    if( r < 0 )
+    {
+      TearDown( upper_dir );
+      AsyncTest::Finished( AsyncTest::RunState::Failed );
+      return;
+    }
+
+    uv_file file = ( uv_file )r;
+    uv_buf_t buf = uv_buf_init( &marker, 1 );
+
+    archive::uv_fs_write( Loop(), &request_, file, &buf, 1, 0, nullptr );
+    archive::uv_fs_req_cleanup( &request_ );
+
+    archive::uv_fs_close( Loop(), &request_, file, nullptr );
+    archive::uv_fs_req_cleanup( &request_ );
+
+    bool passed = ReadFirst( now ) && now == marker;
+
+    // removing the copy leaves a whiteout so the archive's version stays hidden.
+    r = archive::uv_fs_unlink( Loop(), &request_, filepath_.c_str(), nullptr );
+    archive::uv_fs_req_cleanup( &request_ );
+
+    passed = passed && r == 0 && !ReadFirst( now );
+
+    // without the overlay the archive's version is back.
+    TearDown( upper_dir );
+
+    passed = passed && ReadFirst( now ) && now == original;
+
+    AsyncTest::Finished( passed ? AsyncTest::RunState::Passed : AsyncTest::RunState::Failed );
+  }
+};
+
 void file_load_test_register( AppInfo* appInfo )
 {
   #if 1
@@ -469,6 +678,16 @@ void file_load_test_register( AppInfo* appInfo )
   appInfo->tests_.Add( new SyncFileLoadTestFromDisk( "Sync File Load From Archive /public/unknown.ejs", the_application_info->mount_root_path_, "/public/unknown.ejs", true ) );
   #endif
 
+  #if 1
+  // Batched loads
+  appInfo->tests_.Add( new BatchFileLoadTest( "Batch File Load Off Disk and From Archive", { "/package.json", "/public/index.ejs" } ) );
+  #endif
+
+  #if 1
+  // Writes via the overlay
+  appInfo->tests_.Add( new OverlayWriteTest( "Overlay Write To Archive /package.json", "/package.json" ) );
+  #endif
+
 }
 
 
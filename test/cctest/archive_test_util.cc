@@ -0,0 +1,165 @@
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <stdio.h>
+#include <zlib.h>
+
+namespace archive_test {
+
+namespace {
+
+void Put16(std::string* out, uint16_t value) {
+  out->push_back(static_cast<char>(value & 0xff));
+  out->push_back(static_cast<char>(value >> 8));
+}
+
+void Put32(std::string* out, uint32_t value) {
+  Put16(out, static_cast<uint16_t>(value & 0xffff));
+  Put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+}  // anonymous namespace
+
+uint32_t Crc32(const std::string& data) {
+  uint32_t crc = 0xffffffff;
+  for (unsigned char c : data) {
+    crc ^= c;
+    for (int bit = 0; bit < 8; bit++)
+      crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+std::string RawDeflate(const std::string& data) {
+  z_stream stream = z_stream();
+  deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+               Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&stream, data.size()), '\0');
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+  stream.avail_in = static_cast<uInt>(data.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+  stream.avail_out = static_cast<uInt>(out.size());
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+std::string MakeZip(const std::vector<ZipEntry>& entries) {
+  std::string local;
+  std::string central;
+
+  for (const ZipEntry& entry : entries) {
+    const uint32_t offset = static_cast<uint32_t>(local.size());
+    const std::string body =
+        entry.deflate ? RawDeflate(entry.data) : entry.data;
+    const uint16_t method = entry.deflate ? 8 : 0;
+    const uint32_t crc32 =
+        entry.forged_crc32 != 0 ? entry.forged_crc32 : Crc32(entry.data);
+
+    Put32(&local, 0x04034b50);
+    Put16(&local, 20);  // version needed
+    Put16(&local, 0);  // flags
+    Put16(&local, method);
+    Put16(&local, 0);  // time
+    Put16(&local, 33);  // 1980-01-01
+    Put32(&local, crc32);
+    Put32(&local, static_cast<uint32_t>(body.size()));
+    Put32(&local, static_cast<uint32_t>(entry.data.size()));
+    Put16(&local, static_cast<uint16_t>(entry.name.size()));
+    Put16(&local, 0);  // extra length
+    local += entry.name;
+    local += body;
+
+    Put32(&central, 0x02014b50);
+    Put16(&central, 20);  // version made by
+    Put16(&central, 20);  // version needed
+    Put16(&central, 0);  // flags
+    Put16(&central, method);
+    Put16(&central, 0);  // time
+    Put16(&central, 33);  // 1980-01-01
+    Put32(&central, crc32);
+    Put32(&central, static_cast<uint32_t>(body.size()));
+    Put32(&central, static_cast<uint32_t>(entry.data.size()));
+    Put16(&central, static_cast<uint16_t>(entry.name.size()));
+    Put16(&central, 0);  // extra length
+    Put16(&central, 0);  // comment length
+    Put16(&central, 0);  // disk
+    Put16(&central, 0);  // internal attributes
+    Put32(&central, entry.name.back() == '/' ? 0x10 : 0);
+    Put32(&central, offset);
+    central += entry.name;
+  }
+
+  std::string end;
+  Put32(&end, 0x06054b50);
+  Put16(&end, 0);  // disk
+  Put16(&end, 0);  // central directory disk
+  Put16(&end, static_cast<uint16_t>(entries.size()));
+  Put16(&end, static_cast<uint16_t>(entries.size()));
+  Put32(&end, static_cast<uint32_t>(central.size()));
+  Put32(&end, static_cast<uint32_t>(local.size()));
+  Put16(&end, 0);  // comment length
+
+  return local + central + end;
+}
+
+bool WriteFile(const std::string& path, const std::string& content) {
+  FILE* out = fopen(path.c_str(), "wb");
+  if (out == nullptr)
+    return false;
+  const bool written =
+      fwrite(content.data(), 1, content.size(), out) == content.size();
+  return fclose(out) == 0 && written;
+}
+
+std::string ReadFile(const std::string& path) {
+  FILE* in = fopen(path.c_str(), "rb");
+  if (in == nullptr)
+    return std::string();
+  std::string content;
+  char buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0)
+    content.append(buffer, read);
+  fclose(in);
+  return content;
+}
+
+std::string MakeTempDir(const std::string& prefix) {
+  char tmp[1024];
+  size_t tmp_size = sizeof(tmp);
+  if (uv_os_tmpdir(tmp, &tmp_size) != 0)
+    return std::string();
+
+  const std::string path = std::string(tmp) + "/" + prefix + "_" +
+                           std::to_string(uv_os_getpid());
+  uv_fs_t req;
+  uv_fs_mkdir(nullptr, &req, path.c_str(), 0777, nullptr);
+  uv_fs_req_cleanup(&req);
+  return path;
+}
+
+void RemoveTree(const std::string& path) {
+  uv_fs_t req;
+  if (uv_fs_scandir(nullptr, &req, path.c_str(), 0, nullptr) >= 0) {
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+      const std::string child = path + "/" + ent.name;
+      if (ent.type == UV_DIRENT_DIR) {
+        RemoveTree(child);
+      } else {
+        uv_fs_t unlink_req;
+        uv_fs_unlink(nullptr, &unlink_req, child.c_str(), nullptr);
+        uv_fs_req_cleanup(&unlink_req);
+      }
+    }
+  }
+  uv_fs_req_cleanup(&req);
+
+  uv_fs_rmdir(nullptr, &req, path.c_str(), nullptr);
+  uv_fs_req_cleanup(&req);
+}
+
+}  // namespace archive_test
@@ -0,0 +1,54 @@
+#ifndef TEST_CCTEST_ARCHIVE_TEST_UTIL_H_
+#define TEST_CCTEST_ARCHIVE_TEST_UTIL_H_
+
+#include "archive/manager.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+// What the archive cctests share: building the zips they mount, writing
+// them out and removing what a test left behind.
+
+namespace archive {
+
+// Reaches the parts of the manager only the tests look at.
+class ManagerTestPeer {
+ public:
+  static Archive* Find(Manager* manager, const std::string& path) {
+    return manager->Find(path);
+  }
+};
+
+}  // namespace archive
+
+namespace archive_test {
+
+struct ZipEntry {
+  std::string name;
+  std::string data;
+  bool deflate = false;
+  // Written as the entry's CRC-32 in place of the real one if not 0.
+  uint32_t forged_crc32 = 0;
+};
+
+uint32_t Crc32(const std::string& data);
+
+// data deflated without a zlib header, as a zip stores it.
+std::string RawDeflate(const std::string& data);
+
+// A zip of entries in the order given, names ending in '/' are dirs. Offsets
+// are from the start of the returned bytes.
+std::string MakeZip(const std::vector<ZipEntry>& entries);
+
+bool WriteFile(const std::string& path, const std::string& content);
+std::string ReadFile(const std::string& path);
+
+// A new dir in the temp dir named after prefix and the pid.
+std::string MakeTempDir(const std::string& prefix);
+void RemoveTree(const std::string& path);
+
+}  // namespace archive_test
+
+#endif  // TEST_CCTEST_ARCHIVE_TEST_UTIL_H_
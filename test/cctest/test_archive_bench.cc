@@ -0,0 +1,251 @@
+#include "archive/manager.h"
+#include "archive/shared_index.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Micro-benchmarks for the archive index and the fd table. Each one prints
+// ns/op and allocations/op so changes to either can be judged on numbers,
+// the assertions only check that the lookups found what they should.
+//
+// They are built as archive_bench rather than into cctest as counting
+// allocations replaces the global operator new. Only the 10 entry archives
+// run by default, `make archive-bench` runs the 10k and 60k ones too. 60k is
+// about as many files as fit in a zip without zip64, which the archive reader
+// doesn't support.
+
+namespace {
+
+std::atomic<uint64_t> allocation_count(0);
+
+}  // anonymous namespace
+
+// Counts every allocation in the archive_bench process, only the deltas
+// around a measured loop are reported.
+void* operator new(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void* ptr = malloc(size != 0 ? size : 1);
+  if (ptr == nullptr)
+    throw std::bad_alloc();
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  free(ptr);
+}
+
+namespace {
+
+enum class Shape { kWide, kDeep };
+
+const char kMountPoint[] = "/archive_bench_mount";
+
+using archive::ManagerTestPeer;
+
+// The path of entry i below the mount point. Wide trees put 1000 files in
+// each dir, deep trees nest dirs 2 wide and 8 deep.
+std::string EntryPath(size_t i, Shape shape) {
+  std::string path;
+  if (shape == Shape::kWide) {
+    path = "d" + std::to_string(i / 1000) + "/";
+  } else {
+    for (size_t depth = 0, n = i; depth < 8; depth++, n /= 2)
+      path += "n" + std::to_string(n % 2) + "/";
+  }
+  return path + "f" + std::to_string(i) + ".js";
+}
+
+// Writes a zip of stored entries, with an entry for every dir.
+void WriteZip(const std::string& filepath, size_t entries, Shape shape) {
+  std::vector<archive_test::ZipEntry> zip_entries;
+  std::set<std::string> dirs;
+
+  for (size_t i = 0; i < entries; i++) {
+    const std::string path = EntryPath(i, shape);
+    for (size_t sep = path.find('/'); sep != std::string::npos;
+         sep = path.find('/', sep + 1)) {
+      const std::string dir = path.substr(0, sep + 1);
+      if (dirs.insert(dir).second)
+        zip_entries.push_back({dir, ""});
+    }
+    zip_entries.push_back({path, "module.exports=" + std::to_string(i) + ";"});
+  }
+
+  ASSERT_TRUE(archive_test::WriteFile(filepath,
+                                      archive_test::MakeZip(zip_entries)));
+}
+
+void Report(const std::string& name, size_t ops, uint64_t elapsed,
+            uint64_t allocated) {
+  printf("[ BENCH    ] %-40s %10.1f ns/op %8.2f allocs/op\n", name.c_str(),
+         static_cast<double>(elapsed) / ops,
+         static_cast<double>(allocated) / ops);
+}
+
+// Runs fn(i) ops times and prints the cost of one call.
+template <typename Fn>
+void Measure(const std::string& name, size_t ops, Fn fn) {
+  const uint64_t allocations =
+      allocation_count.load(std::memory_order_relaxed);
+  const uint64_t start = uv_hrtime();
+
+  for (size_t i = 0; i < ops; i++)
+    fn(i);
+
+  Report(name, ops, uv_hrtime() - start,
+         allocation_count.load(std::memory_order_relaxed) - allocations);
+}
+
+class ArchiveBenchTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_bench");
+    ASSERT_FALSE(base_.empty());
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+  }
+
+  void TearDown() override {
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  void Run(size_t entries, Shape shape) {
+    const std::string label = std::to_string(entries) +
+                              (shape == Shape::kWide ? " wide " : " deep ");
+    const std::string zip = base_ + "/bench.zip";
+    WriteZip(zip, entries, shape);
+
+    // A cold mount extracts every entry, a warm one checks the cache.
+    for (const char* cache : { "cold", "warm" }) {
+      archive::Manager manager;
+      manager.Bind(&loop_);
+      manager.SetUseStartupProfile(false);
+      ASSERT_TRUE(manager.SetCacheRoot(base_ + "/cache"));
+
+      const uint64_t allocations =
+          allocation_count.load(std::memory_order_relaxed);
+      const uint64_t start = uv_hrtime();
+
+      ASSERT_TRUE(manager.Mount(zip, kMountPoint));
+
+      Report(label + "mount " + cache + " (per entry)", entries,
+             uv_hrtime() - start,
+             allocation_count.load(std::memory_order_relaxed) - allocations);
+    }
+
+    archive::Manager manager;
+    manager.Bind(&loop_);
+    manager.SetUseStartupProfile(false);
+    ASSERT_TRUE(manager.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager.Mount(zip, kMountPoint));
+
+    // Up to 1000 paths spread over the whole archive.
+    std::vector<std::string> paths;
+    const size_t step = entries > 1000 ? entries / 1000 : 1;
+    for (size_t i = 0; i < entries; i += step)
+      paths.push_back(std::string(kMountPoint) + "/" + EntryPath(i, shape));
+
+    const size_t ops = 100000;
+    const std::string miss = "/usr/lib/node_modules/npm/lib/npm.js";
+    size_t found = 0;
+
+    archive::Archive* archive = ManagerTestPeer::Find(&manager, paths[0]);
+    ASSERT_NE(archive, nullptr);
+
+    Measure(label + "FilePathToParts", ops, [&](size_t i) {
+      found += archive->FilePathToParts(paths[i % paths.size()].c_str())
+                   .size() != 0;
+    });
+    EXPECT_EQ(found, ops);
+
+    found = 0;
+    Measure(label + "Archive::Lookup", ops, [&](size_t i) {
+      found += archive->Lookup(paths[i % paths.size()].c_str()) != nullptr;
+    });
+    EXPECT_EQ(found, ops);
+
+    found = 0;
+    Measure(label + "Manager::Find hit", ops, [&](size_t i) {
+      found += ManagerTestPeer::Find(&manager, paths[i % paths.size()]) !=
+               nullptr;
+    });
+    EXPECT_EQ(found, ops);
+
+    found = 0;
+    Measure(label + "Manager::Find miss", ops, [&](size_t i) {
+      found += ManagerTestPeer::Find(&manager, miss) != nullptr;
+    });
+    EXPECT_EQ(found, 0u);
+
+    // As many open files as there are entries.
+    archive::Mappings mappings;
+    std::vector<uv_file> fake_ids;
+    for (size_t i = 0; i < entries; i++) {
+      fake_ids.push_back(mappings.Insert(mappings.NextFakeId(),
+                                         static_cast<uv_file>(i + 100),
+                                         archive));
+    }
+
+    found = 0;
+    Measure(label + "Mappings::Get", ops, [&](size_t i) {
+      archive::Mappings::RealSource source;
+      found += mappings.Get(fake_ids[i % fake_ids.size()], source);
+    });
+    EXPECT_EQ(found, ops);
+
+    // The warm mount came from the shared index, which outlives base_.
+    uv_fs_t req;
+    uv_file fd = uv_fs_open(nullptr, &req, zip.c_str(), O_RDONLY, 0, nullptr);
+    uv_fs_req_cleanup(&req);
+    if (fd >= 0) {
+      const std::string index = archive::SharedIndex::IndexFilePath(
+          base_ + "/cache", archive::SharedIndex::Identity(fd, 0, 0));
+      uv_fs_close(nullptr, &req, fd, nullptr);
+      uv_fs_req_cleanup(&req);
+      uv_fs_unlink(nullptr, &req, index.c_str(), nullptr);
+      uv_fs_req_cleanup(&req);
+    }
+  }
+
+  std::string base_;
+  uv_loop_t loop_;
+};
+
+}  // anonymous namespace
+
+TEST_F(ArchiveBenchTest, Wide10) {
+  Run(10, Shape::kWide);
+}
+
+TEST_F(ArchiveBenchTest, Deep10) {
+  Run(10, Shape::kDeep);
+}
+
+TEST_F(ArchiveBenchTest, DISABLED_Wide10k) {
+  Run(10000, Shape::kWide);
+}
+
+TEST_F(ArchiveBenchTest, DISABLED_Deep10k) {
+  Run(10000, Shape::kDeep);
+}
+
+TEST_F(ArchiveBenchTest, DISABLED_Wide60k) {
+  Run(60000, Shape::kWide);
+}
+
+TEST_F(ArchiveBenchTest, DISABLED_Deep60k) {
+  Run(60000, Shape::kDeep);
+}
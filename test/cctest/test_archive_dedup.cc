@@ -0,0 +1,210 @@
+#include "archive/archive_junzip.h"
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Entries with the same content, like the LICENSE files of a node_modules
+// tree, are extracted to one cache file and share one in memory view. A
+// relayout with store_identical_once writes their bytes once.
+
+namespace {
+
+const char kMountPoint[] = "/archive_dedup_mount";
+
+using archive::ManagerTestPeer;
+using archive_test::Crc32;
+using archive_test::MakeZip;
+using archive_test::RawDeflate;
+using archive_test::ZipEntry;
+
+std::string License() {
+  std::string data;
+  for (int i = 0; i < 32; i++)
+    data += "Permission is hereby granted, free of charge, line " +
+            std::to_string(i) + "\n";
+  return data;
+}
+
+// Two deflated copies of the license, a stored one and a stored file of the
+// same size whose CRC-32 claims it's the license too.
+std::vector<ZipEntry> Entries() {
+  std::string forged = License();
+  forged[0] = 'p';
+  return {{"a/", std::string(), false, 0},
+          {"a/LICENSE", License(), true, 0},
+          {"b/", std::string(), false, 0},
+          {"b/LICENSE", License(), true, 0},
+          {"c/", std::string(), false, 0},
+          {"c/LICENSE", License(), false, 0},
+          {"c/FORGED", forged, false, Crc32(License())}};
+}
+
+class ArchiveDedupTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_dedup");
+    ASSERT_FALSE(base_.empty());
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+  }
+
+  void TearDown() override {
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_run(&loop_, UV_RUN_DEFAULT);
+    uv_loop_close(&loop_);
+  }
+
+  std::string Write(const std::string& name, const std::string& content) {
+    const std::string path = base_ + "/" + name;
+    archive_test::WriteFile(path, content);
+    return path;
+  }
+
+  static size_t FileSize(const std::string& path) {
+    uv_fs_t req;
+    size_t size = 0;
+    if (uv_fs_stat(nullptr, &req, path.c_str(), nullptr) == 0)
+      size = static_cast<size_t>(req.statbuf.st_size);
+    uv_fs_req_cleanup(&req);
+    return size;
+  }
+
+  std::string CacheFilePath(const char* name) {
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    archive::Archive* found = ManagerTestPeer::Find(&manager_, path);
+    return found != nullptr ? found->CacheFilePath(path) : std::string();
+  }
+
+  // The files in the mounted archive's cache dir.
+  size_t CacheFiles() {
+    archive::Archive* found = ManagerTestPeer::Find(&manager_, kMountPoint);
+    if (found == nullptr)
+      return 0;
+
+    uv_fs_t req;
+    size_t count = 0;
+    if (uv_fs_scandir(nullptr, &req, found->CachePath().c_str(), 0,
+                      nullptr) >= 0) {
+      uv_dirent_t ent;
+      while (uv_fs_scandir_next(&req, &ent) != UV_EOF)
+        count++;
+    }
+    uv_fs_req_cleanup(&req);
+    return count;
+  }
+
+  uv_file Open(const char* name) {
+    uv_fs_t req;
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return fd;
+  }
+
+  void Close(uv_file fd) {
+    uv_fs_t req;
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+  }
+
+  std::string ReadAll(const char* name) {
+    uv_file fd = Open(name);
+    if (fd < 0)
+      return std::string();
+
+    std::vector<char> buffer(8192);
+    uv_buf_t buf = uv_buf_init(buffer.data(), buffer.size());
+    uv_fs_t req;
+    int read = archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    Close(fd);
+
+    return read > 0 ? std::string(buffer.data(), read) : std::string();
+  }
+
+  const char* View(uv_file fd) {
+    archive::Mappings::RealSource source;
+    const char* content = nullptr;
+    size_t content_size = 0;
+    if (!manager_.KnownFiles().Get(fd, source) ||
+        !source.second->ContentView(source.first, &content, &content_size))
+      return nullptr;
+    return content;
+  }
+
+  std::string base_;
+  uv_loop_t loop_;
+  archive::Manager manager_;
+};
+
+}  // anonymous namespace
+
+TEST_F(ArchiveDedupTest, CopiesShareCacheFile) {
+  ASSERT_TRUE(manager_.Mount(Write("assets.zip", MakeZip(Entries())),
+                             kMountPoint));
+
+  EXPECT_EQ(CacheFilePath("a/LICENSE"), CacheFilePath("b/LICENSE"));
+  // Another method, so other bytes in the archive.
+  EXPECT_NE(CacheFilePath("a/LICENSE"), CacheFilePath("c/LICENSE"));
+  // The same CRC-32 and sizes but not the same bytes.
+  EXPECT_NE(CacheFilePath("c/LICENSE"), CacheFilePath("c/FORGED"));
+  EXPECT_EQ(CacheFiles(), 3u);
+
+  EXPECT_EQ(ReadAll("a/LICENSE"), License());
+  EXPECT_EQ(ReadAll("b/LICENSE"), License());
+  EXPECT_EQ(ReadAll("c/LICENSE"), License());
+  EXPECT_NE(ReadAll("c/FORGED"), License());
+  EXPECT_EQ(ReadAll("c/FORGED").size(), License().size());
+
+#if !defined(_WIN32)
+  uv_file a = Open("a/LICENSE");
+  uv_file b = Open("b/LICENSE");
+  ASSERT_GT(a, 0);
+  ASSERT_GT(b, 0);
+  EXPECT_NE(View(a), nullptr);
+  EXPECT_EQ(View(a), View(b));
+  Close(a);
+  Close(b);
+#endif
+}
+
+TEST_F(ArchiveDedupTest, RelayoutStoresCopiesOnce) {
+  const std::string zip = Write("assets.zip", MakeZip(Entries()));
+  const std::string plain = base_ + "/plain.zip";
+  const std::string once = base_ + "/once.zip";
+  const std::vector<std::string> no_startup_entries;
+
+  ASSERT_TRUE(archive::ArchiveJUnzip::Relayout(
+      zip, no_startup_entries, plain,
+      archive::ArchiveJUnzip::RelayoutStoreBelowSize, false));
+  ASSERT_TRUE(archive::ArchiveJUnzip::Relayout(
+      zip, no_startup_entries, once,
+      archive::ArchiveJUnzip::RelayoutStoreBelowSize, true));
+
+  // b/LICENSE's local record and deflated bytes are not written.
+  const size_t saved = FileSize(plain) - FileSize(once);
+  EXPECT_EQ(saved, 30 + strlen("b/LICENSE") + RawDeflate(License()).size());
+
+  ASSERT_TRUE(manager_.Mount(once, kMountPoint));
+  EXPECT_EQ(CacheFilePath("a/LICENSE"), CacheFilePath("b/LICENSE"));
+  EXPECT_EQ(ReadAll("a/LICENSE"), License());
+  EXPECT_EQ(ReadAll("b/LICENSE"), License());
+  EXPECT_EQ(ReadAll("c/LICENSE"), License());
+  EXPECT_NE(ReadAll("c/FORGED"), License());
+}
@@ -0,0 +1,93 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// Native addons in a mounted archive are handed to dlopen() from a memfd on
+// Linux, filled straight from the archive so the cache file is not read.
+
+namespace {
+
+const char kMountPoint[] = "/archive_library_mount";
+
+// Not real libraries, only their bytes are looked at.
+std::string Image(char fill) {
+  std::string data("\x7f" "ELF", 4);
+  data += std::string(8192, fill);
+  return data;
+}
+
+class ArchiveLibraryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_library");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/app.zip";
+    // stored.node is copied from the mapped archive, deflated.node inflated.
+    ASSERT_TRUE(archive_test::WriteFile(
+        zip_, archive_test::MakeZip({{"build/", ""},
+                                     {"build/stored.node", Image('s')},
+                                     {"build/deflated.node", Image('d'),
+                                      true}})));
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.Mount(zip_, kMountPoint));
+  }
+
+  void TearDown() override {
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  std::string Path(const char* name) {
+    return std::string(kMountPoint) + "/" + name;
+  }
+
+  // Removes the entry's cache file so only the archive can supply it.
+  void RemoveCacheFile(const char* name) {
+    const std::string cache_file = manager_.GetTrueFileName(Path(name));
+    ASSERT_NE(cache_file, Path(name));
+
+    uv_fs_t req;
+    uv_fs_unlink(nullptr, &req, cache_file.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+
+  archive::Manager manager_;
+  std::string base_;
+  std::string zip_;
+  uv_loop_t loop_;
+};
+
+}  // anonymous namespace
+
+#if defined(__linux__)
+TEST_F(ArchiveLibraryTest, LoadedFromMemfd) {
+  for (const char* name : {"build/stored.node", "build/deflated.node"}) {
+    RemoveCacheFile(name);
+
+    const std::string library = manager_.GetLibraryFileName(Path(name));
+    EXPECT_EQ(library.compare(0, 14, "/proc/self/fd/"), 0) << library;
+    // Each is filled with the first letter of its name.
+    EXPECT_EQ(archive_test::ReadFile(library), Image(name[6])) << name;
+
+    // Loading it again hands out the same file.
+    EXPECT_EQ(manager_.GetLibraryFileName(Path(name)), library);
+  }
+}
+#endif  // defined(__linux__)
+
+#if !defined(_WIN32)
+TEST_F(ArchiveLibraryTest, OutsideArchive) {
+  const std::string library = base_ + "/outside.node";
+  EXPECT_EQ(manager_.GetLibraryFileName(library), library);
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,283 @@
+#include "archive/manager.h"
+#include "archive/manifest.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <openssl/bio.h>
+#include <openssl/ec.h>
+#include <openssl/evp.h>
+#include <openssl/objects.h>
+#include <openssl/pem.h>
+#include <openssl/sha.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Archives mounted with a public key must carry a manifest signed with it
+// that lists every file. The listing is checked at mount, each file's
+// content only when it's first opened, extracted or loaded.
+
+namespace {
+
+const char kMountPoint[] = "/archive_manifest_mount";
+const char kStored[] = "public/stored.txt";
+const char kDeflated[] = "public/deflated.txt";
+
+using archive::ManagerTestPeer;
+using archive_test::MakeZip;
+using archive_test::ZipEntry;
+
+std::string StoredData() {
+  return "stored content, read straight out of the archive\n";
+}
+
+std::string DeflatedData() {
+  std::string data;
+  for (int i = 0; i < 64; i++)
+    data += "deflated content line " + std::to_string(i) + "\n";
+  return data;
+}
+
+std::string Sha256Hex(const std::string& data) {
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const unsigned char*>(data.data()), data.size(),
+         digest);
+  static const char hex[] = "0123456789abcdef";
+  std::string text;
+  for (unsigned char c : digest) {
+    text.push_back(hex[c >> 4]);
+    text.push_back(hex[c & 0xf]);
+  }
+  return text;
+}
+
+std::string ManifestLine(const std::string& name, const std::string& data) {
+  return Sha256Hex(data) + " " + std::to_string(data.size()) + " " + name +
+         "\n";
+}
+
+EVP_PKEY* MakeKey() {
+  EVP_PKEY* key = nullptr;
+  EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+  EVP_PKEY_keygen_init(context);
+  EVP_PKEY_CTX_set_ec_paramgen_curve_nid(context, NID_X9_62_prime256v1);
+  EVP_PKEY_keygen(context, &key);
+  EVP_PKEY_CTX_free(context);
+  return key;
+}
+
+std::string Sign(EVP_PKEY* key, const std::string& data) {
+  EVP_MD_CTX* context = EVP_MD_CTX_new();
+  EVP_DigestSignInit(context, nullptr, EVP_sha256(), nullptr, key);
+  EVP_DigestSignUpdate(context, data.data(), data.size());
+  size_t size = 0;
+  EVP_DigestSignFinal(context, nullptr, &size);
+  std::string signature(size, '\0');
+  EVP_DigestSignFinal(context, reinterpret_cast<unsigned char*>(&signature[0]),
+                      &size);
+  signature.resize(size);
+  EVP_MD_CTX_free(context);
+  return signature;
+}
+
+class ArchiveManifestTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_manifest");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/assets.zip";
+    key_path_ = base_ + "/key.pem";
+
+    key_ = MakeKey();
+    ASSERT_NE(key_, nullptr);
+    BIO* bio = BIO_new_file(key_path_.c_str(), "w");
+    ASSERT_NE(bio, nullptr);
+    PEM_write_bio_PUBKEY(bio, key_);
+    BIO_free(bio);
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.SetPublicKey(key_path_));
+  }
+
+  void TearDown() override {
+    manager_.Release();
+    EVP_PKEY_free(key_);
+    archive_test::RemoveTree(base_);
+    uv_run(&loop_, UV_RUN_DEFAULT);
+    uv_loop_close(&loop_);
+  }
+
+  // The files with a manifest of manifest_files, signed by signer.
+  static std::vector<ZipEntry> Signed(
+      const std::vector<ZipEntry>& manifest_files, EVP_PKEY* signer) {
+    std::string manifest;
+    for (const ZipEntry& entry : manifest_files) {
+      if (entry.name.back() != '/')
+        manifest += ManifestLine(entry.name, entry.data);
+    }
+
+    std::vector<ZipEntry> entries = Files();
+    entries.push_back({archive::Manifest::EntryName, manifest, false});
+    entries.push_back(
+        {archive::Manifest::SignatureEntryName, Sign(signer, manifest), false});
+    return entries;
+  }
+
+  static std::vector<ZipEntry> Files() {
+    return {{"public/", std::string(), false},
+            {kStored, StoredData(), false},
+            {kDeflated, DeflatedData(), true}};
+  }
+
+  bool Mount(const std::string& content) {
+    return archive_test::WriteFile(zip_, content) &&
+           manager_.Mount(zip_, kMountPoint);
+  }
+
+  uv_file Open(const char* name) {
+    uv_fs_t req;
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return fd;
+  }
+
+  bool Load(const char* name, std::vector<char>* content) {
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    archive::Archive* found = ManagerTestPeer::Find(&manager_, path);
+    return found != nullptr && found->LoadFile(path, *content);
+  }
+
+  std::string ReadAll(const char* name) {
+    uv_file fd = Open(name);
+    if (fd < 0)
+      return std::string();
+
+    char buffer[4096];
+    uv_buf_t buf = uv_buf_init(buffer, sizeof(buffer));
+    uv_fs_t req;
+    int read = archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+
+    return read > 0 ? std::string(buffer, read) : std::string();
+  }
+
+  std::string base_;
+  std::string zip_;
+  std::string key_path_;
+  EVP_PKEY* key_ = nullptr;
+  uv_loop_t loop_;
+  archive::Manager manager_;
+};
+
+}  // anonymous namespace
+
+TEST(ArchiveManifestParseTest, Lines) {
+  archive::Manifest manifest;
+  const std::string text = ManifestLine("a.js", "a") +
+                           ManifestLine("dir/with space.js", "b") + "\r\n";
+  ASSERT_TRUE(manifest.Parse(text.data(), text.size()));
+  EXPECT_EQ(manifest.Count(), 2u);
+
+  const archive::Manifest::Entry* entry = manifest.Find("dir/with space.js");
+  ASSERT_NE(entry, nullptr);
+  EXPECT_EQ(entry->size_, 1u);
+  EXPECT_EQ(manifest.Find("missing.js"), nullptr);
+
+  const std::string twice = ManifestLine("a.js", "a") +
+                            ManifestLine("a.js", "a");
+  EXPECT_FALSE(manifest.Parse(twice.data(), twice.size()));
+
+  const std::string short_hash = "abcd 1 a.js\n";
+  EXPECT_FALSE(manifest.Parse(short_hash.data(), short_hash.size()));
+}
+
+TEST_F(ArchiveManifestTest, SignedArchiveIsServed) {
+  ASSERT_TRUE(Mount(MakeZip(Signed(Files(), key_))));
+
+  EXPECT_EQ(ReadAll(kStored), StoredData());
+  EXPECT_EQ(ReadAll(kDeflated), DeflatedData());
+  // Checked once, the result is kept.
+  EXPECT_EQ(ReadAll(kStored), StoredData());
+
+  std::vector<char> content;
+  EXPECT_TRUE(Load(kDeflated, &content));
+  EXPECT_EQ(std::string(content.begin(), content.end()), DeflatedData());
+}
+
+TEST_F(ArchiveManifestTest, TamperedFileFailsWhenOpened) {
+  std::string zip = MakeZip(Signed(Files(), key_));
+  const size_t at = zip.find(StoredData());
+  ASSERT_NE(at, std::string::npos);
+  zip[at] ^= 0x20;
+
+  // Only the listing is checked at mount so it still mounts.
+  ASSERT_TRUE(Mount(zip));
+
+  EXPECT_EQ(Open(kStored), UV_EIO);
+  EXPECT_EQ(Open(kStored), UV_EIO);
+  EXPECT_EQ(ReadAll(kDeflated), DeflatedData());
+
+  std::vector<char> content;
+  EXPECT_FALSE(Load(kStored, &content));
+}
+
+TEST_F(ArchiveManifestTest, TamperedFileIsNotExtracted) {
+  std::vector<ZipEntry> listed = Files();
+  listed[2].data[0] ^= 0x20;
+  ASSERT_TRUE(Mount(MakeZip(Signed(listed, key_))));
+
+  EXPECT_EQ(Open(kDeflated), UV_EIO);
+  EXPECT_EQ(ReadAll(kStored), StoredData());
+}
+
+TEST_F(ArchiveManifestTest, ListingMustMatch) {
+  // A file that is not listed.
+  std::vector<ZipEntry> listed = Files();
+  listed.pop_back();
+  EXPECT_FALSE(Mount(MakeZip(Signed(listed, key_))));
+
+  // A listed file that is not in the archive.
+  listed = Files();
+  listed.push_back({"public/missing.txt", "missing", false});
+  EXPECT_FALSE(Mount(MakeZip(Signed(listed, key_))));
+
+  // A file with another size.
+  listed = Files();
+  listed[1].data += "more";
+  EXPECT_FALSE(Mount(MakeZip(Signed(listed, key_))));
+}
+
+TEST_F(ArchiveManifestTest, SignatureMustMatch) {
+  EXPECT_FALSE(Mount(MakeZip(Files())));
+
+  EVP_PKEY* other = MakeKey();
+  ASSERT_NE(other, nullptr);
+  EXPECT_FALSE(Mount(MakeZip(Signed(Files(), other))));
+  EVP_PKEY_free(other);
+
+  std::vector<ZipEntry> entries = Signed(Files(), key_);
+  entries[3].data += ManifestLine("public/extra.txt", "extra");
+  EXPECT_FALSE(Mount(MakeZip(entries)));
+}
+
+TEST_F(ArchiveManifestTest, PublicKeyMustBeReadable) {
+  EXPECT_FALSE(manager_.SetPublicKey(base_ + "/missing.pem"));
+  // The key in use is kept.
+  EXPECT_NE(manager_.PublicKey(), nullptr);
+  ASSERT_TRUE(Mount(MakeZip(Signed(Files(), key_))));
+  EXPECT_EQ(ReadAll(kStored), StoredData());
+}
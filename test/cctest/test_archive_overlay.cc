@@ -0,0 +1,174 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// Writes to archive paths land in the upper dir, each mount in a dir of its
+// own, and what is removed or renamed away stays hidden.
+
+namespace {
+
+const char kMountA[] = "/archive_overlay_a";
+const char kMountB[] = "/archive_overlay_b";
+
+class ArchiveOverlayTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_overlay");
+    ASSERT_FALSE(base_.empty());
+    upper_ = base_ + "/upper";
+
+    // Both archives have x.js so their copies would meet in one upper dir.
+    const std::string zip_a = base_ + "/a.zip";
+    const std::string zip_b = base_ + "/b.zip";
+    ASSERT_TRUE(archive_test::WriteFile(
+        zip_a, archive_test::MakeZip({{"lib/", ""}, {"lib/x.js", "a"}})));
+    ASSERT_TRUE(archive_test::WriteFile(
+        zip_b, archive_test::MakeZip({{"lib/", ""}, {"lib/x.js", "b"}})));
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.Mount(zip_a, kMountA));
+    ASSERT_TRUE(manager_.Mount(zip_b, kMountB));
+    ASSERT_EQ(manager_.SetUpperDir(upper_), 0);
+  }
+
+  void TearDown() override {
+    manager_.SetUpperDir(std::string());
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  std::string Path(const char* mount, const char* name) {
+    return std::string(mount) + "/" + name;
+  }
+
+  // The file's content or "" if it can't be opened.
+  std::string Read(const std::string& path) {
+    uv_fs_t req;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    if (fd < 0)
+      return std::string();
+
+    char buffer[64];
+    uv_buf_t buf = uv_buf_init(buffer, sizeof(buffer));
+    int read = archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+
+    return std::string(buffer, read > 0 ? read : 0);
+  }
+
+  int Write(const std::string& path, const std::string& content) {
+    uv_fs_t req;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(),
+                                     O_WRONLY | O_CREAT | O_TRUNC, 0644,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    if (fd < 0)
+      return fd;
+
+    uv_buf_t buf = uv_buf_init(const_cast<char*>(content.data()),
+                               content.size());
+    int r = archive::uv_fs_write(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return r < 0 ? r : 0;
+  }
+
+  int Stat(const std::string& path) {
+    uv_fs_t req;
+    int r = archive::uv_fs_stat(&loop_, &req, path.c_str(), nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return r;
+  }
+
+  int Unlink(const std::string& path) {
+    uv_fs_t req;
+    int r = archive::uv_fs_unlink(&loop_, &req, path.c_str(), nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return r;
+  }
+
+  int Rename(const std::string& path, const std::string& new_path) {
+    uv_fs_t req;
+    int r = archive::uv_fs_rename(&loop_, &req, path.c_str(),
+                                  new_path.c_str(), nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return r;
+  }
+
+  archive::Manager manager_;
+  std::string base_;
+  std::string upper_;
+  uv_loop_t loop_;
+};
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveOverlayTest, MountsDoNotShareCopies) {
+  ASSERT_EQ(Write(Path(kMountA, "lib/x.js"), "a2"), 0);
+
+  EXPECT_EQ(Read(Path(kMountA, "lib/x.js")), "a2");
+  EXPECT_EQ(Read(Path(kMountB, "lib/x.js")), "b");
+
+  ASSERT_EQ(Write(Path(kMountB, "lib/x.js"), "b2"), 0);
+  EXPECT_EQ(Read(Path(kMountA, "lib/x.js")), "a2");
+  EXPECT_EQ(Read(Path(kMountB, "lib/x.js")), "b2");
+}
+
+TEST_F(ArchiveOverlayTest, UnlinkLeavesWhiteout) {
+  // Only copied up paths can be removed.
+  EXPECT_EQ(Unlink(Path(kMountA, "lib/x.js")), UV_EROFS);
+
+  ASSERT_EQ(Write(Path(kMountA, "lib/x.js"), "a2"), 0);
+  ASSERT_EQ(Unlink(Path(kMountA, "lib/x.js")), 0);
+
+  EXPECT_EQ(Stat(Path(kMountA, "lib/x.js")), UV_ENOENT);
+  EXPECT_EQ(Read(Path(kMountA, "lib/x.js")), "");
+  EXPECT_EQ(Unlink(Path(kMountA, "lib/x.js")), UV_ENOENT);
+  EXPECT_EQ(Read(Path(kMountB, "lib/x.js")), "b");
+
+  // The whiteout outlives the run that made it.
+  ASSERT_EQ(manager_.SetUpperDir(upper_), 0);
+  EXPECT_EQ(Stat(Path(kMountA, "lib/x.js")), UV_ENOENT);
+
+  // A new file takes its place, not the archive's.
+  ASSERT_EQ(Write(Path(kMountA, "lib/x.js"), "new"), 0);
+  EXPECT_EQ(Read(Path(kMountA, "lib/x.js")), "new");
+}
+
+TEST_F(ArchiveOverlayTest, RenameLeavesWhiteout) {
+  ASSERT_EQ(Write(Path(kMountA, "lib/x.js"), "a2"), 0);
+  ASSERT_EQ(Rename(Path(kMountA, "lib/x.js"), Path(kMountA, "lib/y.js")), 0);
+
+  EXPECT_EQ(Stat(Path(kMountA, "lib/x.js")), UV_ENOENT);
+  EXPECT_EQ(Read(Path(kMountA, "lib/y.js")), "a2");
+
+  ASSERT_EQ(manager_.SetUpperDir(upper_), 0);
+  EXPECT_EQ(Stat(Path(kMountA, "lib/x.js")), UV_ENOENT);
+  EXPECT_EQ(Read(Path(kMountA, "lib/y.js")), "a2");
+}
+
+TEST_F(ArchiveOverlayTest, Off) {
+  ASSERT_EQ(Write(Path(kMountA, "lib/x.js"), "a2"), 0);
+  ASSERT_EQ(manager_.SetUpperDir(std::string()), 0);
+
+  EXPECT_EQ(Read(Path(kMountA, "lib/x.js")), "a");
+  EXPECT_EQ(Write(Path(kMountA, "lib/x.js"), "a3"), UV_EROFS);
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,113 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <sys/stat.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// readdir() withFileTypes lists a dir with the types of its children, a dir
+// on disk only has the children its dir entries give no type for stat'ed.
+
+namespace {
+
+const char kMountPoint[] = "/archive_readdir_mount";
+
+class ArchiveReaddirTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_readdir");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/app.zip";
+    ASSERT_TRUE(archive_test::WriteFile(
+        zip_, archive_test::MakeZip({{"lib/", ""},
+                                     {"lib/b.js", "module.exports = 2;\n"},
+                                     {"lib/a.js", "module.exports = 1;\n"},
+                                     {"lib/sub/", ""}})));
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.Mount(zip_, kMountPoint));
+  }
+
+  void TearDown() override {
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  // Lists path with types, "name:type" for each child in order.
+  std::string ReadTypes(const std::string& path, bool stats) {
+    uv_fs_t req;
+    int r = stats ?
+        archive::uv_fs_readdir_stats(&loop_, &req, path.c_str(), nullptr) :
+        archive::uv_fs_readdir_types(&loop_, &req, path.c_str(), nullptr);
+    std::string listed;
+    if (r >= 0) {
+      const archive::DirStats& items = *archive::uv_fs_get_dir_stats(&req);
+      for (const archive::DirStatsItem& item : items) {
+        listed += item.name_ + ":" + std::to_string(item.type_) + " ";
+        if (stats)
+          EXPECT_EQ(item.stat_result_, 0) << item.name_;
+      }
+    }
+    archive::uv_fs_req_cleanup(&req);
+    return listed;
+  }
+
+  std::string base_;
+  std::string zip_;
+  uv_loop_t loop_;
+  archive::Manager manager_;
+};
+
+std::string Listed(std::initializer_list<
+                       std::pair<const char*, uv_dirent_type_t>> children) {
+  std::string listed;
+  for (const auto& child : children)
+    listed += std::string(child.first) + ":" + std::to_string(child.second) +
+              " ";
+  return listed;
+}
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveReaddirTest, ArchiveDir) {
+  // Dirs then files, as the archive lists them.
+  const std::string expected = Listed({{"sub", UV_DIRENT_DIR},
+                                       {"a.js", UV_DIRENT_FILE},
+                                       {"b.js", UV_DIRENT_FILE}});
+  const std::string lib = std::string(kMountPoint) + "/lib";
+  EXPECT_EQ(ReadTypes(lib, false), expected);
+  EXPECT_EQ(ReadTypes(lib, true), expected);
+}
+
+TEST_F(ArchiveReaddirTest, RealDir) {
+  const std::string dir = base_ + "/real";
+  ASSERT_EQ(mkdir(dir.c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((dir + "/sub").c_str(), 0755), 0);
+  ASSERT_TRUE(archive_test::WriteFile(dir + "/b.js", "2"));
+  ASSERT_TRUE(archive_test::WriteFile(dir + "/a.js", "1"));
+
+  // Sorted as scandir() would.
+  const std::string expected = Listed({{"a.js", UV_DIRENT_FILE},
+                                       {"b.js", UV_DIRENT_FILE},
+                                       {"sub", UV_DIRENT_DIR}});
+  EXPECT_EQ(ReadTypes(dir, false), expected);
+  EXPECT_EQ(ReadTypes(dir, true), expected);
+}
+
+TEST_F(ArchiveReaddirTest, Missing) {
+  uv_fs_t req;
+  const std::string path = base_ + "/missing";
+  EXPECT_EQ(archive::uv_fs_readdir_types(&loop_, &req, path.c_str(), nullptr),
+            UV_ENOENT);
+  archive::uv_fs_req_cleanup(&req);
+}
+#endif  // !defined(_WIN32)
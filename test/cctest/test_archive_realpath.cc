@@ -0,0 +1,156 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// realpath() of a path in a mounted archive comes from the archive's index,
+// with "." and ".." applied, rather than from a walk of the path.
+
+namespace {
+
+const char kMountPoint[] = "/archive_realpath_mount";
+const char kFile[] = "public/lib/index.js";
+
+// A zip of public/lib/ with a file in it.
+std::string MakeZip() {
+  return archive_test::MakeZip({{"public/", ""},
+                                {"public/lib/", ""},
+                                {kFile, "module.exports = 42;\n"}});
+}
+
+class ArchiveRealpathTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_realpath");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/assets.zip";
+
+    ASSERT_TRUE(archive_test::WriteFile(zip_, MakeZip()));
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.Mount(zip_, kMountPoint));
+  }
+
+  void TearDown() override {
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_run(&loop_, UV_RUN_DEFAULT);
+    uv_loop_close(&loop_);
+  }
+
+  std::string base_;
+  std::string zip_;
+  uv_loop_t loop_;
+  archive::Manager manager_;
+};
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveRealpathTest, FromIndex) {
+  const std::string expected = std::string(kMountPoint) + "/" + kFile;
+  std::string real_path;
+  int result = -1;
+
+  EXPECT_NE(manager_.RealPath(expected.c_str(), real_path, result), nullptr);
+  EXPECT_EQ(result, 0);
+  EXPECT_EQ(real_path, expected);
+
+  const std::string dotted =
+      std::string(kMountPoint) + "//public/./lib/../lib/index.js";
+  result = -1;
+  EXPECT_NE(manager_.RealPath(dotted.c_str(), real_path, result), nullptr);
+  EXPECT_EQ(result, 0);
+  EXPECT_EQ(real_path, expected);
+
+  result = -1;
+  EXPECT_NE(manager_.RealPath(kMountPoint, real_path, result), nullptr);
+  EXPECT_EQ(result, 0);
+  EXPECT_EQ(real_path, kMountPoint);
+}
+
+TEST_F(ArchiveRealpathTest, Missing) {
+  std::string real_path;
+  int result = 0;
+
+  const std::string missing = std::string(kMountPoint) + "/public/missing.js";
+  EXPECT_NE(manager_.RealPath(missing.c_str(), real_path, result), nullptr);
+  EXPECT_EQ(result, UV_ENOENT);
+
+  // Only a file is listed at lib/index.js, it can't be gone through.
+  const std::string through_file =
+      std::string(kMountPoint) + "/public/lib/index.js/x";
+  result = 0;
+  EXPECT_NE(manager_.RealPath(through_file.c_str(), real_path, result),
+            nullptr);
+  EXPECT_EQ(result, UV_ENOENT);
+
+  const std::string above = std::string(kMountPoint) + "/../public";
+  result = 0;
+  EXPECT_NE(manager_.RealPath(above.c_str(), real_path, result), nullptr);
+  EXPECT_EQ(result, UV_ENOENT);
+}
+
+TEST_F(ArchiveRealpathTest, NotInArchive) {
+  std::string real_path;
+  int result = 0;
+  EXPECT_EQ(manager_.RealPath(base_.c_str(), real_path, result), nullptr);
+}
+
+TEST_F(ArchiveRealpathTest, Sync) {
+  const std::string expected = std::string(kMountPoint) + "/" + kFile;
+  const std::string dotted =
+      std::string(kMountPoint) + "/public/lib/./index.js";
+
+  uv_fs_t req;
+  ASSERT_EQ(archive::uv_fs_realpath(&loop_, &req, dotted.c_str(), nullptr),
+            0);
+  EXPECT_EQ(std::string(static_cast<const char*>(req.ptr)), expected);
+  archive::uv_fs_req_cleanup(&req);
+
+  const std::string missing = std::string(kMountPoint) + "/public/missing.js";
+  EXPECT_EQ(archive::uv_fs_realpath(&loop_, &req, missing.c_str(), nullptr),
+            UV_ENOENT);
+  archive::uv_fs_req_cleanup(&req);
+}
+
+TEST_F(ArchiveRealpathTest, Async) {
+  const std::string expected = std::string(kMountPoint) + "/" + kFile;
+  const std::string dotted =
+      std::string(kMountPoint) + "/public/lib/../lib/index.js";
+
+  struct Result {
+    ssize_t result = -1;
+    std::string real_path;
+    int calls = 0;
+  } result;
+
+  uv_fs_t req;
+  req.data = &result;
+  ASSERT_EQ(archive::uv_fs_realpath(&loop_, &req, dotted.c_str(),
+                                    [](uv_fs_t* req) {
+    Result* result = static_cast<Result*>(req->data);
+    result->result = req->result;
+    if (req->result == 0)
+      result->real_path = static_cast<const char*>(req->ptr);
+    result->calls++;
+    archive::uv_fs_req_cleanup(req);
+  }), 0);
+  uv_run(&loop_, UV_RUN_DEFAULT);
+
+  EXPECT_EQ(result.calls, 1);
+  EXPECT_EQ(result.result, 0);
+  EXPECT_EQ(result.real_path, expected);
+}
+#endif  // !defined(_WIN32)
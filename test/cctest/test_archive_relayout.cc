@@ -0,0 +1,138 @@
+#include "archive/archive_junzip.h"
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// ArchiveJUnzip::Relayout() writes a copy of an archive with its startup
+// entries first, and nothing at all if it fails part way.
+
+namespace {
+
+const char kMountPoint[] = "/archive_relayout_mount";
+
+std::string AData() {
+  std::string data;
+  for (int i = 0; i < 32; i++)
+    data += "module.exports.a" + std::to_string(i) + " = " +
+            std::to_string(i) + ";\n";
+  return data;
+}
+
+std::string BData() {
+  return "module.exports = 'b';\n";
+}
+
+// lib/a.js is deflated, lib/b.js stored.
+std::vector<archive_test::ZipEntry> Entries() {
+  return {{"lib/", ""}, {"lib/a.js", AData(), true}, {"lib/b.js", BData()}};
+}
+
+class ArchiveRelayoutTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_relayout");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/app.zip";
+    out_ = base_ + "/out.zip";
+    ASSERT_TRUE(archive_test::WriteFile(zip_,
+                                        archive_test::MakeZip(Entries())));
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+  }
+
+  void TearDown() override {
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  std::string Read(const std::string& path) {
+    uv_fs_t req;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    if (fd < 0)
+      return std::string();
+
+    std::vector<char> buffer(4096);
+    uv_buf_t buf = uv_buf_init(buffer.data(), buffer.size());
+    int read = archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+
+    return std::string(buffer.data(), read > 0 ? read : 0);
+  }
+
+  // The files in the dir, to check nothing was left behind.
+  std::vector<std::string> List() {
+    std::vector<std::string> names;
+    uv_fs_t req;
+    uv_dirent_t dirent;
+    if (uv_fs_scandir(nullptr, &req, base_.c_str(), 0, nullptr) >= 0) {
+      while (uv_fs_scandir_next(&req, &dirent) != UV_EOF)
+        names.push_back(dirent.name);
+    }
+    uv_fs_req_cleanup(&req);
+    return names;
+  }
+
+  std::string base_;
+  std::string zip_;
+  std::string out_;
+  uv_loop_t loop_;
+};
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveRelayoutTest, StartupEntriesFirstAndMountable) {
+  ASSERT_TRUE(archive::ArchiveJUnzip::Relayout(zip_, {"lib/a.js"}, out_));
+
+  // The startup entry's local record comes first and is stored.
+  const std::string out = archive_test::ReadFile(out_);
+  ASSERT_GT(out.size(), 30u);
+  EXPECT_EQ(out.compare(0, 4, "PK\x03\x04"), 0);
+  EXPECT_EQ(out[8], 0);
+  EXPECT_EQ(out.compare(30, 8, "lib/a.js"), 0);
+
+  archive::Manager manager;
+  manager.Bind(&loop_);
+  manager.SetUseStartupProfile(false);
+  manager.SetUseSharedIndex(false);
+  ASSERT_TRUE(manager.SetCacheRoot(base_ + "/cache"));
+  ASSERT_TRUE(manager.Mount(out_, kMountPoint));
+
+  EXPECT_EQ(Read(std::string(kMountPoint) + "/lib/a.js"), AData());
+  EXPECT_EQ(Read(std::string(kMountPoint) + "/lib/b.js"), BData());
+
+  manager.Release();
+}
+
+TEST_F(ArchiveRelayoutTest, FailureLeavesNothingBehind) {
+  // lib/b.js's local record, the last, has lost its signature.
+  std::string zip = archive_test::MakeZip(Entries());
+  const size_t b = 30 + 4 + 30 + 8 + archive_test::RawDeflate(AData()).size();
+  ASSERT_EQ(zip.compare(b, 4, "PK\x03\x04"), 0);
+  zip[b] = 0;
+  ASSERT_TRUE(archive_test::WriteFile(zip_, zip));
+
+  // An earlier output is kept as it was.
+  ASSERT_TRUE(archive_test::WriteFile(out_, "earlier"));
+  EXPECT_FALSE(archive::ArchiveJUnzip::Relayout(zip_, {"lib/a.js"}, out_));
+  EXPECT_EQ(archive_test::ReadFile(out_), "earlier");
+  EXPECT_EQ(List().size(), 2u);
+
+  // A new output is not made at all.
+  uv_fs_t req;
+  ASSERT_EQ(uv_fs_unlink(nullptr, &req, out_.c_str(), nullptr), 0);
+  uv_fs_req_cleanup(&req);
+  EXPECT_FALSE(archive::ArchiveJUnzip::Relayout(zip_, {}, out_));
+  EXPECT_EQ(List(), std::vector<std::string>{"app.zip"});
+}
+#endif  // !defined(_WIN32)
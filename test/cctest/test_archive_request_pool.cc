@@ -0,0 +1,282 @@
+#include "archive/manager.h"
+#include "archive/request_pool.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// What an async call needs until it completes comes from its loop's pool, so
+// once the pools are warm a stream of calls takes nothing from the allocator.
+
+namespace {
+
+const char kMountPoint[] = "/archive_request_pool_mount";
+const size_t kFiles = 16;
+const int kRounds = 20;
+
+std::string FileName(size_t i) {
+  return "lib/f" + std::to_string(i) + ".js";
+}
+
+std::string FileData(size_t i) {
+  return "module.exports = " + std::to_string(i) + ";\n";
+}
+
+// A zip of lib/ and kFiles stored files in it.
+std::string MakeZip() {
+  std::vector<archive_test::ZipEntry> entries = {{"lib/", ""}};
+  for (size_t i = 0; i < kFiles; i++)
+    entries.push_back({FileName(i), FileData(i)});
+  return archive_test::MakeZip(entries);
+}
+
+// Stats, opens, reads and closes every file asynchronously one after the
+// other, then lists lib/ once a round.
+struct Walker {
+  uv_loop_t* loop;
+  size_t next = 0;
+  int rounds = 0;
+  int wrong_data = 0;
+  uv_fs_t req;
+  uv_file fd = -1;
+  char buffer[64];
+};
+
+void StatNext(Walker* walker);
+
+void OnClose(uv_fs_t* req) {
+  Walker* walker = static_cast<Walker*>(req->data);
+  archive::uv_fs_req_cleanup(req);
+  walker->next++;
+  StatNext(walker);
+}
+
+void OnRead(uv_fs_t* req) {
+  Walker* walker = static_cast<Walker*>(req->data);
+  const ssize_t read = req->result;
+  archive::uv_fs_req_cleanup(req);
+
+  if (read < 0 ||
+      std::string(walker->buffer, read) != FileData(walker->next)) {
+    walker->wrong_data++;
+  }
+
+  req->data = walker;
+  archive::uv_fs_close(walker->loop, req, walker->fd, OnClose);
+}
+
+void OnOpen(uv_fs_t* req) {
+  Walker* walker = static_cast<Walker*>(req->data);
+  walker->fd = static_cast<uv_file>(req->result);
+  archive::uv_fs_req_cleanup(req);
+
+  if (walker->fd < 0) {
+    walker->wrong_data++;
+    walker->next++;
+    StatNext(walker);
+    return;
+  }
+
+  uv_buf_t buf = uv_buf_init(walker->buffer, sizeof(walker->buffer));
+  req->data = walker;
+  archive::uv_fs_read(walker->loop, req, walker->fd, &buf, 1, 0, OnRead);
+}
+
+void OnStat(uv_fs_t* req) {
+  Walker* walker = static_cast<Walker*>(req->data);
+  if (req->result < 0)
+    walker->wrong_data++;
+  archive::uv_fs_req_cleanup(req);
+
+  const std::string path =
+      std::string(kMountPoint) + "/" + FileName(walker->next);
+  req->data = walker;
+  archive::uv_fs_open(walker->loop, req, path.c_str(), O_RDONLY, 0, OnOpen);
+}
+
+void OnScandir(uv_fs_t* req) {
+  Walker* walker = static_cast<Walker*>(req->data);
+  if (req->result != static_cast<ssize_t>(kFiles))
+    walker->wrong_data++;
+  archive::uv_fs_req_cleanup(req);
+
+  walker->next = 0;
+  walker->rounds--;
+  StatNext(walker);
+}
+
+void StatNext(Walker* walker) {
+  walker->req.data = walker;
+
+  if (walker->next == kFiles) {
+    if (walker->rounds == 0)
+      return;
+
+    const std::string lib = std::string(kMountPoint) + "/lib";
+    archive::uv_fs_scandir(walker->loop, &walker->req, lib.c_str(), 0,
+                           OnScandir);
+    return;
+  }
+
+  const std::string path =
+      std::string(kMountPoint) + "/" + FileName(walker->next);
+  archive::uv_fs_stat(walker->loop, &walker->req, path.c_str(), OnStat);
+}
+
+// Runs rounds of the walk on loop.
+void Walk(uv_loop_t* loop, int rounds, int* wrong_data) {
+  Walker walker;
+  walker.loop = loop;
+  walker.rounds = rounds;
+  walker.next = kFiles;
+  StatNext(&walker);
+  uv_run(loop, UV_RUN_DEFAULT);
+  *wrong_data += walker.wrong_data;
+}
+
+uint64_t Created(const archive::PoolStats& stats) {
+  uint64_t created = stats.pools_.large_.created_ +
+                     stats.schedule_queues_.created_;
+  for (int i = 0; i < archive::RequestPool::ClassCount; i++)
+    created += stats.pools_.classes_[i].created_;
+  return created;
+}
+
+uint64_t InUse(const archive::PoolStats& stats) {
+  uint64_t in_use = stats.pools_.large_.in_use_;
+  for (int i = 0; i < archive::RequestPool::ClassCount; i++)
+    in_use += stats.pools_.classes_[i].in_use_;
+  return in_use;
+}
+
+}  // anonymous namespace
+
+TEST(ArchiveRequestPoolTest, BlocksAreReused) {
+  archive::RequestPool pool;
+
+  void* first = pool.Allocate(40);
+  archive::RequestPool::Free(first);
+  EXPECT_EQ(pool.Allocate(archive::RequestPool::SmallestBlock), first);
+
+  void* second = pool.Allocate(1);
+  EXPECT_NE(second, first);
+  archive::RequestPool::Free(first);
+  archive::RequestPool::Free(second);
+
+  archive::RequestPool::Stats stats = archive::RequestPool::Stats();
+  pool.Take(stats);
+  EXPECT_EQ(stats.classes_[0].created_, 2u);
+  EXPECT_EQ(stats.classes_[0].high_water_, 2u);
+  EXPECT_EQ(stats.classes_[0].in_use_, 0u);
+}
+
+TEST(ArchiveRequestPoolTest, SizeClasses) {
+  archive::RequestPool pool;
+
+  void* small = pool.Allocate(archive::RequestPool::SmallestBlock + 1);
+  void* largest = pool.Allocate(archive::RequestPool::LargestBlock);
+  void* large = pool.Allocate(archive::RequestPool::LargestBlock + 1);
+
+  for (void* block : { small, largest, large }) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(block) % alignof(std::max_align_t),
+              0u);
+  }
+
+  archive::RequestPool::Stats stats = archive::RequestPool::Stats();
+  pool.Take(stats);
+  EXPECT_EQ(stats.classes_[0].created_, 0u);
+  EXPECT_EQ(stats.classes_[1].in_use_, 1u);
+  EXPECT_EQ(stats.classes_[archive::RequestPool::ClassCount - 1].in_use_, 1u);
+  EXPECT_EQ(stats.large_.in_use_, 1u);
+
+  archive::RequestPool::Free(small);
+  archive::RequestPool::Free(largest);
+  archive::RequestPool::Free(large);
+
+  // Large blocks are not kept.
+  archive::RequestPool::Free(pool.Allocate(
+      archive::RequestPool::LargestBlock + 1));
+  stats = archive::RequestPool::Stats();
+  pool.Take(stats);
+  EXPECT_EQ(stats.large_.created_, 2u);
+  EXPECT_EQ(stats.large_.in_use_, 0u);
+}
+
+TEST(ArchiveRequestPoolTest, SteadyState) {
+  char tmp[1024];
+  size_t tmp_size = sizeof(tmp);
+  ASSERT_EQ(uv_os_tmpdir(tmp, &tmp_size), 0);
+
+  const std::string base = std::string(tmp) + "/archive_request_pool_" +
+                           std::to_string(uv_os_getpid());
+  const std::string zip = MakeZip();
+
+  uv_loop_t loop;
+  ASSERT_EQ(uv_loop_init(&loop), 0);
+
+  {
+    archive::Manager manager;
+    manager.Bind(&loop);
+    manager.SetUseStartupProfile(false);
+    manager.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager.SetCacheRoot(base));
+    ASSERT_TRUE(manager.MountMemory(zip.data(), zip.size(), "pool",
+                                    kMountPoint));
+
+    int wrong_data = 0;
+    Walk(&loop, 1, &wrong_data);
+
+    archive::PoolStats warm;
+    manager.TakePoolStats(warm);
+    EXPECT_GT(Created(warm), 0u);
+    EXPECT_EQ(InUse(warm), 0u);
+
+    Walk(&loop, kRounds, &wrong_data);
+    EXPECT_EQ(wrong_data, 0);
+
+    // One call in flight at a time so nothing more was needed.
+    archive::PoolStats stats;
+    manager.TakePoolStats(stats);
+    EXPECT_EQ(Created(stats), Created(warm));
+    EXPECT_EQ(InUse(stats), 0u);
+    EXPECT_EQ(stats.schedule_queues_.in_use_, 0u);
+    for (int i = 0; i < archive::RequestPool::ClassCount; i++) {
+      EXPECT_EQ(stats.pools_.classes_[i].high_water_,
+                warm.pools_.classes_[i].high_water_);
+    }
+
+    manager.Release();
+  }
+
+  uv_fs_t req;
+  if (uv_fs_scandir(nullptr, &req, base.c_str(), 0, nullptr) >= 0) {
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+      const std::string dir = base + "/" + ent.name;
+      uv_fs_t scan_req;
+      if (uv_fs_scandir(nullptr, &scan_req, dir.c_str(), 0, nullptr) >= 0) {
+        uv_dirent_t file;
+        while (uv_fs_scandir_next(&scan_req, &file) != UV_EOF) {
+          uv_fs_t unlink_req;
+          uv_fs_unlink(nullptr, &unlink_req,
+                       (dir + "/" + file.name).c_str(), nullptr);
+          uv_fs_req_cleanup(&unlink_req);
+        }
+      }
+      uv_fs_req_cleanup(&scan_req);
+      uv_fs_rmdir(nullptr, &scan_req, dir.c_str(), nullptr);
+      uv_fs_req_cleanup(&scan_req);
+    }
+  }
+  uv_fs_req_cleanup(&req);
+  uv_fs_rmdir(nullptr, &req, base.c_str(), nullptr);
+  uv_fs_req_cleanup(&req);
+
+  EXPECT_EQ(uv_loop_close(&loop), 0);
+}
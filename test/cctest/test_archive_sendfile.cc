@@ -0,0 +1,239 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// uv_fs_sendfile() from a file in a mounted archive: a stored file is sent
+// straight from the archive file, a deflated one from its cache file.
+
+namespace {
+
+const char kMountPoint[] = "/archive_sendfile_mount";
+const char kStored[] = "public/stored.txt";
+const char kDeflated[] = "public/deflated.txt";
+
+std::string StoredData() {
+  return "stored content, sent from the archive file itself\n";
+}
+
+std::string DeflatedData() {
+  std::string data;
+  for (int i = 0; i < 64; i++)
+    data += "deflated content line " + std::to_string(i) + "\n";
+  return data;
+}
+
+// A zip of public/ with a stored and a deflated file in it.
+std::string MakeZip() {
+  return archive_test::MakeZip({{"public/", ""},
+                                {kStored, StoredData()},
+                                {kDeflated, DeflatedData(), true}});
+}
+
+class ArchiveSendfileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_sendfile");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/assets.zip";
+    out_path_ = base_ + "/out";
+    ASSERT_TRUE(archive_test::WriteFile(zip_, MakeZip()));
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.Mount(zip_, kMountPoint));
+
+    uv_fs_t req;
+    out_fd_ = archive::uv_fs_open(&loop_, &req, out_path_.c_str(),
+                                  O_WRONLY | O_CREAT | O_TRUNC, 0644, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    ASSERT_GE(out_fd_, 0);
+  }
+
+  void TearDown() override {
+    uv_fs_t req;
+    if (out_fd_ >= 0) {
+      archive::uv_fs_close(&loop_, &req, out_fd_, nullptr);
+      archive::uv_fs_req_cleanup(&req);
+    }
+
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_run(&loop_, UV_RUN_DEFAULT);
+    uv_loop_close(&loop_);
+  }
+
+  uv_file Open(const char* name) {
+    uv_fs_t req;
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return fd;
+  }
+
+  void Close(uv_file fd) {
+    uv_fs_t req;
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+  }
+
+  std::string Sent() {
+    return archive_test::ReadFile(out_path_);
+  }
+
+  std::string base_;
+  std::string zip_;
+  std::string out_path_;
+  uv_file out_fd_ = -1;
+  uv_loop_t loop_;
+  archive::Manager manager_;
+};
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveSendfileTest, StoredFromArchiveFile) {
+  uv_file fd = Open(kStored);
+  ASSERT_GT(fd, 0);
+
+  archive::Mappings::RealSource source;
+  ASSERT_TRUE(manager_.KnownFiles().Get(fd, source));
+  ASSERT_NE(source.second, nullptr);
+
+  uv_file from = -1;
+  int64_t offset = 0;
+  size_t length = 1 << 20;
+  ASSERT_TRUE(source.second->SendfileSource(source.first, from, offset,
+                                            length));
+  EXPECT_NE(from, source.first);
+  EXPECT_EQ(length, StoredData().size());
+  EXPECT_EQ(MakeZip().substr(offset, length), StoredData());
+
+  // More than the file holds stops at its end rather than going on into the
+  // rest of the archive.
+  uv_fs_t req;
+  int sent = archive::uv_fs_sendfile(&loop_, &req, out_fd_, fd, 7, 1 << 20,
+                                     nullptr);
+  archive::uv_fs_req_cleanup(&req);
+  EXPECT_EQ(sent, static_cast<int>(StoredData().size() - 7));
+  EXPECT_EQ(Sent(), StoredData().substr(7));
+
+  sent = archive::uv_fs_sendfile(&loop_, &req, out_fd_, fd,
+                                 StoredData().size() + 1, 16, nullptr);
+  archive::uv_fs_req_cleanup(&req);
+  EXPECT_EQ(sent, 0);
+
+  Close(fd);
+}
+
+TEST_F(ArchiveSendfileTest, DeflatedFromCacheFile) {
+  uv_file fd = Open(kDeflated);
+  ASSERT_GT(fd, 0);
+
+  archive::Mappings::RealSource source;
+  ASSERT_TRUE(manager_.KnownFiles().Get(fd, source));
+
+  uv_file from = -1;
+  int64_t offset = 0;
+  size_t length = 16;
+  EXPECT_FALSE(source.second->SendfileSource(source.first, from, offset,
+                                             length));
+
+  uv_fs_t req;
+  int sent = archive::uv_fs_sendfile(&loop_, &req, out_fd_, fd, 0, 1 << 20,
+                                     nullptr);
+  archive::uv_fs_req_cleanup(&req);
+  EXPECT_EQ(sent, static_cast<int>(DeflatedData().size()));
+  EXPECT_EQ(Sent(), DeflatedData());
+
+  Close(fd);
+}
+
+TEST_F(ArchiveSendfileTest, Async) {
+  uv_file fd = Open(kStored);
+  ASSERT_GT(fd, 0);
+
+  struct Result {
+    ssize_t sent = -1;
+    uv_file file = -1;
+    int calls = 0;
+  } result;
+
+  uv_fs_t req;
+  req.data = &result;
+  ASSERT_EQ(archive::uv_fs_sendfile(&loop_, &req, out_fd_, fd, 0,
+                                    StoredData().size(), [](uv_fs_t* req) {
+    Result* result = static_cast<Result*>(req->data);
+    result->sent = req->result;
+    result->file = GET_REQUEST_FILE_HANDLE(req);
+    result->calls++;
+    archive::uv_fs_req_cleanup(req);
+  }), 0);
+  uv_run(&loop_, UV_RUN_DEFAULT);
+
+  EXPECT_EQ(result.calls, 1);
+  EXPECT_EQ(result.sent, static_cast<ssize_t>(StoredData().size()));
+  EXPECT_EQ(result.file, out_fd_);
+  EXPECT_EQ(Sent(), StoredData());
+
+  Close(fd);
+}
+
+TEST_F(ArchiveSendfileTest, ArchiveFileIsNotWritten) {
+  uv_file in = Open(kStored);
+  uv_file out = Open(kDeflated);
+  ASSERT_GT(in, 0);
+  ASSERT_GT(out, 0);
+
+  uv_fs_t req;
+  EXPECT_EQ(archive::uv_fs_sendfile(&loop_, &req, out, in, 0, 16, nullptr),
+            UV_EBADF);
+  archive::uv_fs_req_cleanup(&req);
+
+  Close(in);
+  Close(out);
+}
+
+TEST_F(ArchiveSendfileTest, UnknownInFile) {
+  uv_fs_t req;
+  EXPECT_EQ(archive::uv_fs_sendfile(&loop_, &req, out_fd_, 987654, 0, 16,
+                                    nullptr),
+            UV_EBADF);
+  archive::uv_fs_req_cleanup(&req);
+
+  struct Result {
+    ssize_t result = 0;
+    uv_fs_type type = UV_FS_UNKNOWN;
+    uv_loop_t* loop = nullptr;
+    int calls = 0;
+  } result;
+
+  req.data = &result;
+  ASSERT_EQ(archive::uv_fs_sendfile(&loop_, &req, out_fd_, 987654, 0, 16,
+                                    [](uv_fs_t* req) {
+    Result* result = static_cast<Result*>(req->data);
+    result->result = req->result;
+    result->type = req->fs_type;
+    result->loop = req->loop;
+    result->calls++;
+    archive::uv_fs_req_cleanup(req);
+  }), 0);
+  uv_run(&loop_, UV_RUN_DEFAULT);
+
+  EXPECT_EQ(result.calls, 1);
+  EXPECT_EQ(result.result, UV_EBADF);
+  EXPECT_EQ(result.type, UV_FS_SENDFILE);
+  EXPECT_EQ(result.loop, &loop_);
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,251 @@
+#include "archive/manager.h"
+#include "archive/shared_index.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Mounts of the same archive file share one index: the first mount writes
+// it, later ones (in this process or another) build their tree from it.
+
+namespace {
+
+const char kMountPoint[] = "/archive_shared_index_mount";
+
+using archive::ManagerTestPeer;
+
+// A zip of lib/ with two stored files in it.
+std::string MakeZip() {
+  return archive_test::MakeZip({{"lib/", ""},
+                                {"lib/a.js", "module.exports = 'a';\n"},
+                                {"lib/b.js", "module.exports = 'b';\n"}});
+}
+
+class ArchiveSharedIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_shared_index");
+    ASSERT_FALSE(base_.empty());
+    cache_ = base_ + "/cache";
+    zip_ = base_ + "/app.zip";
+
+    ASSERT_TRUE(archive_test::WriteFile(zip_, MakeZip()));
+
+    uv_fs_t req;
+    uv_file fd = uv_fs_open(nullptr, &req, zip_.c_str(), O_RDONLY, 0, nullptr);
+    uv_fs_req_cleanup(&req);
+    ASSERT_GE(fd, 0);
+    index_ = archive::SharedIndex::IndexFilePath(
+        cache_, archive::SharedIndex::Identity(fd, 0, 0));
+    uv_fs_close(nullptr, &req, fd, nullptr);
+    uv_fs_req_cleanup(&req);
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+  }
+
+  void TearDown() override {
+    uv_fs_t req;
+    uv_fs_unlink(nullptr, &req, index_.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  // Mounts the zip with a manager of its own, runs fn then unmounts.
+  template <typename Fn>
+  void WithMount(bool use_shared_index, Fn fn) {
+    archive::Manager manager;
+    manager.Bind(&loop_);
+    manager.SetUseStartupProfile(false);
+    manager.SetUseSharedIndex(use_shared_index);
+    ASSERT_TRUE(manager.SetCacheRoot(cache_));
+    ASSERT_TRUE(manager.Mount(zip_, kMountPoint));
+
+    archive::Archive* archive = ManagerTestPeer::Find(&manager, kMountPoint);
+    ASSERT_NE(archive, nullptr);
+    fn(&manager, archive);
+
+    manager.Release();
+  }
+
+  std::string ReadEntry(const std::string& name) {
+    uv_fs_t req;
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    if (fd < 0)
+      return std::string();
+
+    char buffer[256];
+    uv_buf_t buf = uv_buf_init(buffer, sizeof(buffer));
+    int read = archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+
+    return std::string(buffer, read > 0 ? read : 0);
+  }
+
+  std::string base_;
+  std::string cache_;
+  std::string zip_;
+  std::string index_;
+  uv_loop_t loop_;
+};
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveSharedIndexTest, WrittenThenUsed) {
+  std::string cache_path;
+  WithMount(true, [&](archive::Manager*, archive::Archive* archive) {
+    cache_path = archive->CachePath();
+    EXPECT_EQ(ReadEntry("lib/a.js"), "module.exports = 'a';\n");
+  });
+
+  archive::SharedIndex index;
+  ASSERT_TRUE(index.Open(index_));
+  EXPECT_EQ(index.Count(), 3u);
+  EXPECT_EQ(cache_path, cache_ + "/" + index.Md5());
+  index.Close();
+
+  // A mount from the index sees the same tree and content.
+  WithMount(true, [&](archive::Manager*, archive::Archive* archive) {
+    EXPECT_EQ(archive->CachePath(), cache_path);
+    EXPECT_NE(archive->Lookup((std::string(kMountPoint) + "/lib").c_str()),
+              nullptr);
+    EXPECT_EQ(ReadEntry("lib/a.js"), "module.exports = 'a';\n");
+    EXPECT_EQ(ReadEntry("lib/b.js"), "module.exports = 'b';\n");
+  });
+}
+
+TEST_F(ArchiveSharedIndexTest, IndexIsTrusted) {
+  WithMount(true, [&](archive::Manager*, archive::Archive*) {});
+
+  archive::SharedIndex index;
+  ASSERT_TRUE(index.Open(index_));
+  const std::string md5 = index.Md5();
+
+  // The same entries with one renamed, only a mount from the index has it.
+  std::vector<archive::SharedIndex::Entry> entries;
+  std::string names;
+  for (uint32_t i = 0; i < index.Count(); i++) {
+    const archive::SharedIndex::Entry& entry = index.At(i);
+    const std::string name = index.Name(entry);
+    archive::SharedIndex::Add(
+        entries, names, entry.index_, entry.offset_, entry.crc32_,
+        entry.compressed_size_, entry.uncompressed_size_,
+        entry.compression_method_, entry.last_mod_file_time_,
+        entry.last_mod_file_date_,
+        name == "lib/b.js" ? "lib/renamed.js" : name.c_str());
+  }
+  index.Close();
+  ASSERT_TRUE(archive::SharedIndex::Write(index_, md5, entries, names));
+
+  WithMount(true, [&](archive::Manager*, archive::Archive*) {
+    EXPECT_EQ(ReadEntry("lib/renamed.js"), "module.exports = 'b';\n");
+    EXPECT_EQ(ReadEntry("lib/b.js"), "");
+  });
+
+  WithMount(false, [&](archive::Manager*, archive::Archive*) {
+    EXPECT_EQ(ReadEntry("lib/renamed.js"), "");
+    EXPECT_EQ(ReadEntry("lib/b.js"), "module.exports = 'b';\n");
+  });
+}
+
+TEST_F(ArchiveSharedIndexTest, PrunedCacheIsExtracted) {
+  std::string cache_path;
+  WithMount(true, [&](archive::Manager*, archive::Archive* archive) {
+    cache_path = archive->CachePath();
+  });
+
+  // Remove one cache file and leave the other with the wrong size.
+  uv_fs_t req;
+  uv_dirent_t dirent;
+  ASSERT_EQ(uv_fs_scandir(nullptr, &req, cache_path.c_str(), 0, nullptr), 2);
+  bool removed = false;
+  while (uv_fs_scandir_next(&req, &dirent) != UV_EOF) {
+    const std::string path = cache_path + "/" + dirent.name;
+    if (removed) {
+      ASSERT_TRUE(archive_test::WriteFile(path, "stale"));
+    } else {
+      uv_fs_t unlink_req;
+      ASSERT_EQ(uv_fs_unlink(nullptr, &unlink_req, path.c_str(), nullptr), 0);
+      uv_fs_req_cleanup(&unlink_req);
+      removed = true;
+    }
+  }
+  uv_fs_req_cleanup(&req);
+
+  WithMount(true, [&](archive::Manager*, archive::Archive* archive) {
+    archive::Metrics::Snapshot snapshot;
+    archive->GetMetrics().Take(snapshot);
+    EXPECT_EQ(snapshot.counters_[archive::Metrics::CacheMisses], 2u);
+    EXPECT_EQ(snapshot.counters_[archive::Metrics::CacheHits], 0u);
+    EXPECT_EQ(ReadEntry("lib/a.js"), "module.exports = 'a';\n");
+    EXPECT_EQ(ReadEntry("lib/b.js"), "module.exports = 'b';\n");
+  });
+}
+
+TEST_F(ArchiveSharedIndexTest, KeyedByCacheRoot) {
+  uv_fs_t req;
+  uv_file fd = uv_fs_open(nullptr, &req, zip_.c_str(), O_RDONLY, 0, nullptr);
+  uv_fs_req_cleanup(&req);
+  ASSERT_GE(fd, 0);
+  const std::string identity = archive::SharedIndex::Identity(fd, 0, 0);
+  uv_fs_close(nullptr, &req, fd, nullptr);
+  uv_fs_req_cleanup(&req);
+
+  std::string other_cache = base_ + "/other_cache";
+  const std::string other_index =
+      archive::SharedIndex::IndexFilePath(other_cache, identity);
+  EXPECT_NE(other_index, index_);
+
+  WithMount(true, [&](archive::Manager*, archive::Archive*) {});
+
+  // A mount under another root has none of the first root's cache files.
+  cache_.swap(other_cache);
+  WithMount(true, [&](archive::Manager*, archive::Archive* archive) {
+    archive::Metrics::Snapshot snapshot;
+    archive->GetMetrics().Take(snapshot);
+    EXPECT_EQ(snapshot.counters_[archive::Metrics::CacheMisses], 2u);
+    EXPECT_EQ(ReadEntry("lib/b.js"), "module.exports = 'b';\n");
+  });
+  cache_.swap(other_cache);
+
+  archive::SharedIndex index;
+  EXPECT_TRUE(index.Open(other_index));
+  index.Close();
+  uv_fs_unlink(nullptr, &req, other_index.c_str(), nullptr);
+  uv_fs_req_cleanup(&req);
+}
+
+TEST_F(ArchiveSharedIndexTest, BadIndexIsReplaced) {
+  ASSERT_TRUE(archive_test::WriteFile(index_, "not an index"));
+
+  archive::SharedIndex index;
+  EXPECT_FALSE(index.Open(index_));
+
+  WithMount(true, [&](archive::Manager*, archive::Archive*) {
+    EXPECT_EQ(ReadEntry("lib/b.js"), "module.exports = 'b';\n");
+  });
+
+  EXPECT_TRUE(index.Open(index_));
+}
+
+TEST_F(ArchiveSharedIndexTest, NotWrittenWhenOff) {
+  WithMount(false, [&](archive::Manager*, archive::Archive*) {
+    EXPECT_EQ(ReadEntry("lib/a.js"), "module.exports = 'a';\n");
+  });
+
+  archive::SharedIndex index;
+  EXPECT_FALSE(index.Open(index_));
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,199 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Mounting archives that are not a file of their own: one appended to
+// another file (as with --archive.self), one in memory and one read from a
+// pipe (as with --archive.path -).
+
+namespace {
+
+const char kEntryName[] = "lib/index.js";
+const char kEntryData[] = "module.exports = 42;\n";
+
+using archive::ManagerTestPeer;
+
+// A zip with lib/ and one stored file in it, offsets are from its start.
+std::string MakeZip() {
+  return archive_test::MakeZip({{"lib/", ""}, {kEntryName, kEntryData}});
+}
+
+class ArchiveSourceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char tmp[1024];
+    size_t tmp_size = sizeof(tmp);
+    ASSERT_EQ(uv_os_tmpdir(tmp, &tmp_size), 0);
+
+    base_ = std::string(tmp) + "/archive_source_" +
+            std::to_string(uv_os_getpid());
+    cache_ = base_ + "/cache";
+    uv_fs_t req;
+    uv_fs_mkdir(nullptr, &req, base_.c_str(), 0777, nullptr);
+    uv_fs_req_cleanup(&req);
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(cache_));
+
+    zip_ = MakeZip();
+  }
+
+  void TearDown() override {
+    manager_.Release();
+
+    // Every source has the same content so shares one cache dir.
+    uv_fs_t req;
+    if (uv_fs_scandir(nullptr, &req, cache_.c_str(), 0, nullptr) >= 0) {
+      uv_dirent_t ent;
+      while (uv_fs_scandir_next(&req, &ent) != UV_EOF)
+        RemoveDir(cache_ + "/" + ent.name);
+    }
+    uv_fs_req_cleanup(&req);
+    RemoveDir(cache_);
+
+    uv_fs_unlink(nullptr, &req, (base_ + "/app").c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+    RemoveDir(base_);
+    uv_loop_close(&loop_);
+  }
+
+  static void RemoveDir(const std::string& path) {
+    uv_fs_t req;
+    if (uv_fs_scandir(nullptr, &req, path.c_str(), 0, nullptr) >= 0) {
+      uv_dirent_t ent;
+      while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+        uv_fs_t unlink_req;
+        uv_fs_unlink(nullptr, &unlink_req,
+                     (path + "/" + ent.name).c_str(), nullptr);
+        uv_fs_req_cleanup(&unlink_req);
+      }
+    }
+    uv_fs_req_cleanup(&req);
+
+    uv_fs_rmdir(nullptr, &req, path.c_str(), nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+
+  // Writes a file of prefix bytes followed by the zip and opens it.
+  uv_file WriteApp(size_t prefix) {
+    const std::string path = base_ + "/app";
+    const std::string content = std::string(prefix, '\x7f') + zip_;
+
+    EXPECT_TRUE(archive_test::WriteFile(path, content));
+
+    uv_fs_t req;
+    uv_file fd = uv_fs_open(nullptr, &req, path.c_str(), O_RDONLY, 0, nullptr);
+    uv_fs_req_cleanup(&req);
+    EXPECT_GE(fd, 0);
+    return fd;
+  }
+
+  static void Close(uv_file fd) {
+    uv_fs_t req;
+    uv_fs_close(nullptr, &req, fd, nullptr);
+    uv_fs_req_cleanup(&req);
+  }
+
+  // Reads the entry through the mount, as node would.
+  std::string ReadEntry(const std::string& mount_point) {
+    uv_fs_t req;
+    const std::string path = mount_point + "/" + kEntryName;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    if (fd < 0)
+      return std::string();
+
+    char buffer[256];
+    uv_buf_t buf = uv_buf_init(buffer, sizeof(buffer));
+    int read = archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+
+    return std::string(buffer, read > 0 ? read : 0);
+  }
+
+  archive::Manager manager_;
+  std::string base_;
+  std::string cache_;
+  std::string zip_;
+  uv_loop_t loop_;
+};
+
+}  // anonymous namespace
+
+TEST_F(ArchiveSourceTest, AppendedToFile) {
+  // Not a multiple of the page size so the map can't start at the archive.
+  uv_file fd = WriteApp(10007);
+  ASSERT_TRUE(manager_.MountFd(fd, -1, -1, base_ + "/app", "/appended"));
+  Close(fd);
+
+  EXPECT_EQ(ReadEntry("/appended"), kEntryData);
+  EXPECT_EQ(ManagerTestPeer::Find(&manager_, "/appended/lib")
+                ->ArchiveFilePath(),
+            base_ + "/app");
+}
+
+TEST_F(ArchiveSourceTest, FileRange) {
+  uv_file fd = WriteApp(100);
+  ASSERT_TRUE(manager_.MountFd(fd, 100, zip_.size(), "range", "/range"));
+  EXPECT_FALSE(manager_.MountFd(fd, 3, -1, "bad", "/bad"));
+  EXPECT_FALSE(manager_.MountFd(fd, 100, zip_.size() + 1, "bad", "/bad"));
+  Close(fd);
+
+  EXPECT_EQ(ReadEntry("/range"), kEntryData);
+}
+
+TEST_F(ArchiveSourceTest, Memory) {
+  ASSERT_TRUE(manager_.MountMemory(zip_.data(), zip_.size(), "memory",
+                                   "/memory"));
+  EXPECT_EQ(ReadEntry("/memory"), kEntryData);
+}
+
+#if !defined(_WIN32)
+TEST_F(ArchiveSourceTest, Pipe) {
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+
+  // Bigger than a pipe's buffer so the mount has to read it in pieces.
+  const std::string content = std::string(256 * 1024, '\x7f') + zip_;
+  std::thread writer([&]() {
+    uv_buf_t buf = uv_buf_init(const_cast<char*>(content.data()),
+                               static_cast<unsigned int>(content.size()));
+    while (buf.len != 0) {
+      uv_fs_t req;
+      int written = uv_fs_write(nullptr, &req, fds[1], &buf, 1, -1, nullptr);
+      uv_fs_req_cleanup(&req);
+      if (written <= 0)
+        break;
+      buf.base += written;
+      buf.len -= written;
+    }
+    Close(fds[1]);
+  });
+
+  const bool mounted = manager_.MountFd(fds[0], -1, -1, "-", "/pipe");
+  writer.join();
+  Close(fds[0]);
+
+  ASSERT_TRUE(mounted);
+  EXPECT_EQ(ReadEntry("/pipe"), kEntryData);
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,183 @@
+#include "archive/manager.h"
+#include "archive/startup_profile.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// The first mount of an archive records the entries opened while starting
+// in its cache dir, later mounts prefetch them and leave the profile as is.
+// A recording only replaces the profile once it ends with entries in it.
+
+namespace {
+
+const char kMountPoint[] = "/archive_startup_profile_mount";
+
+using archive::StartupProfile;
+
+const char kIndex[] =
+    "const add = require('./lib/add'); console.log(add(40, 2));\n";
+const char kAdd[] =
+    "module.exports = function add(a, b) { return a + b; };\n";
+const char kName[] = "module.exports = 'caf\xc3\xa9';\n";
+
+class ArchiveStartupProfileTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_startup_profile");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/app.zip";
+    // A small app, lib/add.js deflated.
+    ASSERT_TRUE(archive_test::WriteFile(
+        zip_, archive_test::MakeZip({{"index.js", kIndex},
+                                     {"lib/", ""},
+                                     {"lib/add.js", kAdd, true},
+                                     {"lib/name.js", kName}})));
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+  }
+
+  void TearDown() override {
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  void Mount(bool use_startup_profile) {
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(use_startup_profile);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.Mount(zip_, kMountPoint));
+    profile_ = ProfileFilePath();
+  }
+
+  // Opens and reads an entry as a require() would.
+  std::string Read(const char* name) {
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    uv_fs_t req;
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    if (fd < 0)
+      return std::string();
+
+    char buffer[128];
+    uv_buf_t buf = uv_buf_init(buffer, sizeof(buffer));
+    int read = archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+
+    return std::string(buffer, read > 0 ? read : 0);
+  }
+
+  int Stat(const char* name) {
+    const std::string path = std::string(kMountPoint) + "/" + name;
+    uv_fs_t req;
+    int r = archive::uv_fs_stat(&loop_, &req, path.c_str(), nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    return r;
+  }
+
+  // The profile sits in the archive's cache dir with the cache files.
+  std::string ProfileFilePath() {
+    const std::string cache_file =
+        manager_.GetTrueFileName(std::string(kMountPoint) + "/index.js");
+    return StartupProfile::ProfileFilePath(
+        cache_file.substr(0, cache_file.find_last_of('/')));
+  }
+
+  // The entries in the last mount's profile, empty if there is none.
+  std::vector<std::string> Profile() {
+    std::vector<std::string> entries;
+    StartupProfile::Load(profile_, entries);
+    return entries;
+  }
+
+  std::string base_;
+  std::string zip_;
+  std::string profile_;
+  uv_loop_t loop_;
+  archive::Manager manager_;
+};
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveStartupProfileTest, FirstMountRecords) {
+  Mount(true);
+
+  // Entries are kept in the order first opened, stats are not opens.
+  EXPECT_EQ(Read("index.js"), kIndex);
+  EXPECT_EQ(Stat("lib/name.js"), 0);
+  EXPECT_EQ(Read("lib/add.js"), kAdd);
+  EXPECT_EQ(Read("index.js"), kIndex);
+  EXPECT_EQ(Profile(), std::vector<std::string>());
+
+  // As when node exits.
+  manager_.EndStartupProfiles();
+  EXPECT_EQ(Profile(), (std::vector<std::string>{"index.js", "lib/add.js"}));
+}
+
+TEST_F(ArchiveStartupProfileTest, LaterMountsPrefetch) {
+  Mount(true);
+  EXPECT_EQ(Read("index.js"), kIndex);
+  EXPECT_EQ(Read("lib/add.js"), kAdd);
+  manager_.Release();
+
+  // The warm mount reads what it prefetched and does not record again.
+  Mount(true);
+  EXPECT_EQ(Read("lib/name.js"), kName);
+  EXPECT_EQ(Read("lib/add.js"), kAdd);
+  EXPECT_EQ(Read("index.js"), kIndex);
+  manager_.Release();
+
+  Mount(true);
+  EXPECT_EQ(Profile(), (std::vector<std::string>{"index.js", "lib/add.js"}));
+}
+
+TEST_F(ArchiveStartupProfileTest, RecordedAgain) {
+  Mount(true);
+  EXPECT_EQ(Read("index.js"), kIndex);
+  manager_.Release();
+
+  // A profile which doesn't name the archive's MD5 is recorded again, a
+  // recording that opens nothing leaves it as it was.
+  ASSERT_TRUE(archive_test::WriteFile(profile_, "lib/name.js\n"));
+  Mount(true);
+  manager_.Release();
+  EXPECT_EQ(Profile(), std::vector<std::string>{"lib/name.js"});
+
+  Mount(true);
+  EXPECT_EQ(Read("lib/add.js"), kAdd);
+  manager_.Release();
+  EXPECT_EQ(Profile(), std::vector<std::string>{"lib/add.js"});
+
+  // So is one older than StartupProfile::RerecordAfterSecs.
+  uv_fs_t req;
+  const double old =
+      static_cast<double>(time(nullptr)) - StartupProfile::RerecordAfterSecs -
+      60;
+  ASSERT_EQ(uv_fs_utime(nullptr, &req, profile_.c_str(), old, old, nullptr),
+            0);
+  uv_fs_req_cleanup(&req);
+  Mount(true);
+  EXPECT_EQ(Read("index.js"), kIndex);
+  manager_.Release();
+  EXPECT_EQ(Profile(), std::vector<std::string>{"index.js"});
+}
+
+TEST_F(ArchiveStartupProfileTest, Off) {
+  Mount(false);
+  EXPECT_EQ(Read("index.js"), kIndex);
+
+  std::vector<std::string> entries;
+  EXPECT_FALSE(StartupProfile::Load(ProfileFilePath(), entries));
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,383 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// One manager used from several threads at once, each with its own loop as
+// worker_threads workers have. Every callback must run on the loop (and so
+// the thread) the call was made on and no thread's loop may be left with
+// handles of the manager's when it closes.
+
+namespace {
+
+const char kMountPoint[] = "/archive_threads_mount";
+const size_t kFiles = 64;
+const int kThreads = 4;
+const int kRounds = 50;
+
+std::string FileName(size_t i) {
+  return "lib/f" + std::to_string(i) + ".js";
+}
+
+std::string FileData(size_t i) {
+  return "module.exports = " + std::to_string(i) + ";\n";
+}
+
+// A zip of lib/ and kFiles stored files in it.
+std::string MakeZip() {
+  std::vector<archive_test::ZipEntry> entries = {{"lib/", ""}};
+  for (size_t i = 0; i < kFiles; i++)
+    entries.push_back({FileName(i), FileData(i)});
+  return archive_test::MakeZip(entries);
+}
+
+// What one thread does: open, read and close every file asynchronously, one
+// after the other, and make a dir in the (read only) archive.
+struct ThreadState {
+  uv_loop_t loop;
+  uv_thread_t thread;
+  size_t next = 0;
+  int round = 0;
+  int wrong_loop = 0;
+  int wrong_thread = 0;
+  int wrong_data = 0;
+  int completed = 0;
+  int read_only = 0;
+  uv_fs_t req;
+  uv_fs_t mkdir_req;
+  uv_file fd = -1;
+  char buffer[64];
+};
+
+void Check(ThreadState* state, uv_fs_t* req) {
+  if (req->loop != &state->loop)
+    state->wrong_loop++;
+  uv_thread_t self = uv_thread_self();
+  if (!uv_thread_equal(&self, &state->thread))
+    state->wrong_thread++;
+}
+
+void OpenNext(ThreadState* state);
+
+void OnClose(uv_fs_t* req) {
+  ThreadState* state = static_cast<ThreadState*>(req->data);
+  Check(state, req);
+  archive::uv_fs_req_cleanup(req);
+  state->completed++;
+  OpenNext(state);
+}
+
+void OnRead(uv_fs_t* req) {
+  ThreadState* state = static_cast<ThreadState*>(req->data);
+  Check(state, req);
+  const ssize_t read = req->result;
+  archive::uv_fs_req_cleanup(req);
+
+  const std::string expected = FileData(state->next);
+  if (read < 0 || std::string(state->buffer, read) != expected)
+    state->wrong_data++;
+
+  state->next++;
+  req->data = state;
+  archive::uv_fs_close(&state->loop, req, state->fd, OnClose);
+}
+
+void OnOpen(uv_fs_t* req) {
+  ThreadState* state = static_cast<ThreadState*>(req->data);
+  Check(state, req);
+  state->fd = static_cast<uv_file>(req->result);
+  archive::uv_fs_req_cleanup(req);
+
+  if (state->fd < 0) {
+    state->wrong_data++;
+    state->next++;
+    OpenNext(state);
+    return;
+  }
+
+  uv_buf_t buf = uv_buf_init(state->buffer, sizeof(state->buffer));
+  req->data = state;
+  archive::uv_fs_read(&state->loop, req, state->fd, &buf, 1, 0, OnRead);
+}
+
+void OnMkdir(uv_fs_t* req) {
+  ThreadState* state = static_cast<ThreadState*>(req->data);
+  Check(state, req);
+  if (req->result == UV_EROFS)
+    state->read_only++;
+  archive::uv_fs_req_cleanup(req);
+}
+
+void OpenNext(ThreadState* state) {
+  if (state->next == kFiles) {
+    if (++state->round == kRounds)
+      return;
+    state->next = 0;
+  }
+
+  // Answered without libuv, so completed through the loop's queue.
+  if (state->next == 0) {
+    const std::string dir = std::string(kMountPoint) + "/made" +
+                            std::to_string(state->round);
+    state->mkdir_req.data = state;
+    archive::uv_fs_mkdir(&state->loop, &state->mkdir_req, dir.c_str(), 0777,
+                         OnMkdir);
+  }
+
+  const std::string path =
+      std::string(kMountPoint) + "/" + FileName(state->next);
+  state->req.data = state;
+  archive::uv_fs_open(&state->loop, &state->req, path.c_str(), O_RDONLY, 0,
+                      OnOpen);
+}
+
+void RunThread(void* arg) {
+  ThreadState* state = static_cast<ThreadState*>(arg);
+  state->thread = uv_thread_self();
+  OpenNext(state);
+  uv_run(&state->loop, UV_RUN_DEFAULT);
+}
+
+// Deflates to more than one of junzip's read chunks so an inflate is many
+// reads of the archive file.
+std::string DeflatedData(size_t i) {
+  static const char digits[] = "0123456789abcdef";
+  std::string data;
+  uint32_t seed = static_cast<uint32_t>(i) + 1;
+  for (size_t n = 0; n < 96 * 1024; n++) {
+    seed = seed * 1103515245 + 12345;
+    data.push_back(digits[(seed >> 16) & 0xf]);
+  }
+  return data;
+}
+
+std::string DeflatedName(size_t i) {
+  return "big/f" + std::to_string(i) + ".txt";
+}
+
+// A zip of big/ and kDeflatedFiles deflated files in it.
+const size_t kDeflatedFiles = 8;
+
+std::string MakeDeflatedZip() {
+  std::vector<archive_test::ZipEntry> entries = {{"big/", ""}};
+  for (size_t i = 0; i < kDeflatedFiles; i++)
+    entries.push_back({DeflatedName(i), DeflatedData(i), true});
+  return archive_test::MakeZip(entries);
+}
+
+}  // anonymous namespace
+
+TEST(ArchiveThreadsTest, LoopPerThread) {
+  char tmp[1024];
+  size_t tmp_size = sizeof(tmp);
+  ASSERT_EQ(uv_os_tmpdir(tmp, &tmp_size), 0);
+
+  const std::string base = std::string(tmp) + "/archive_threads_" +
+                           std::to_string(uv_os_getpid());
+  const std::string zip = MakeZip();
+
+  uv_loop_t main_loop;
+  ASSERT_EQ(uv_loop_init(&main_loop), 0);
+
+  {
+    archive::Manager manager;
+    manager.Bind(&main_loop);
+    manager.SetUseStartupProfile(false);
+    manager.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager.SetCacheRoot(base));
+    ASSERT_TRUE(manager.MountMemory(zip.data(), zip.size(), "threads",
+                                    kMountPoint));
+
+    std::vector<ThreadState> states(kThreads);
+    std::vector<uv_thread_t> threads(kThreads);
+    for (int i = 0; i < kThreads; i++) {
+      ASSERT_EQ(uv_loop_init(&states[i].loop), 0);
+      ASSERT_EQ(uv_thread_create(&threads[i], RunThread, &states[i]), 0);
+    }
+
+    for (int i = 0; i < kThreads; i++) {
+      uv_thread_join(&threads[i]);
+
+      ThreadState& state = states[i];
+      EXPECT_EQ(state.completed, static_cast<int>(kFiles) * kRounds);
+      EXPECT_EQ(state.read_only, kRounds);
+      EXPECT_EQ(state.wrong_data, 0);
+      EXPECT_EQ(state.wrong_loop, 0);
+      EXPECT_EQ(state.wrong_thread, 0);
+      // Nothing of the manager's is left on the thread's loop.
+      EXPECT_EQ(uv_loop_close(&state.loop), 0);
+    }
+
+    manager.Release();
+  }
+
+  uv_fs_t req;
+  if (uv_fs_scandir(nullptr, &req, base.c_str(), 0, nullptr) >= 0) {
+    uv_dirent_t ent;
+    while (uv_fs_scandir_next(&req, &ent) != UV_EOF) {
+      const std::string dir = base + "/" + ent.name;
+      uv_fs_t scan_req;
+      if (uv_fs_scandir(nullptr, &scan_req, dir.c_str(), 0, nullptr) >= 0) {
+        uv_dirent_t file;
+        while (uv_fs_scandir_next(&scan_req, &file) != UV_EOF) {
+          uv_fs_t unlink_req;
+          uv_fs_unlink(nullptr, &unlink_req,
+                       (dir + "/" + file.name).c_str(), nullptr);
+          uv_fs_req_cleanup(&unlink_req);
+        }
+      }
+      uv_fs_req_cleanup(&scan_req);
+      uv_fs_rmdir(nullptr, &scan_req, dir.c_str(), nullptr);
+      uv_fs_req_cleanup(&scan_req);
+    }
+  }
+  uv_fs_req_cleanup(&req);
+  uv_fs_rmdir(nullptr, &req, base.c_str(), nullptr);
+  uv_fs_req_cleanup(&req);
+
+  EXPECT_EQ(uv_loop_close(&main_loop), 0);
+}
+
+// Archive::LoadFile() inflates straight from the archive file, which each
+// archive reads through one handle. Threads inflating from the same archive
+// and from two archives at once must all get the right bytes.
+TEST(ArchiveThreadsTest, InflateFromThreads) {
+  const std::string base = archive_test::MakeTempDir("archive_inflate");
+  ASSERT_FALSE(base.empty());
+  const std::string zip = MakeDeflatedZip();
+  ASSERT_TRUE(archive_test::WriteFile(base + "/a.zip", zip));
+  ASSERT_TRUE(archive_test::WriteFile(base + "/b.zip", zip));
+
+  std::vector<std::string> expected;
+  for (size_t i = 0; i < kDeflatedFiles; i++)
+    expected.push_back(DeflatedData(i));
+
+  uv_loop_t loop;
+  ASSERT_EQ(uv_loop_init(&loop), 0);
+
+  {
+    archive::Manager manager;
+    manager.Bind(&loop);
+    manager.SetUseStartupProfile(false);
+    manager.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager.SetCacheRoot(base + "/cache"));
+    ASSERT_TRUE(manager.Mount(base + "/a.zip", "/archive_inflate_a"));
+    ASSERT_TRUE(manager.Mount(base + "/b.zip", "/archive_inflate_b"));
+
+    std::atomic<int> loaded(0);
+    std::atomic<int> wrong_data(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([&, t]() {
+        for (int round = 0; round < 4; round++) {
+          for (size_t i = 0; i < kDeflatedFiles; i++) {
+            const std::string path =
+                std::string((i + t) % 2 ? "/archive_inflate_a/" :
+                                          "/archive_inflate_b/") +
+                DeflatedName(i);
+            archive::Archive* archive =
+                archive::ManagerTestPeer::Find(&manager, path);
+            std::vector<char> content;
+            if (archive != nullptr && archive->LoadFile(path, content) &&
+                std::string(content.begin(), content.end()) == expected[i]) {
+              loaded++;
+            } else {
+              wrong_data++;
+            }
+          }
+        }
+      });
+    }
+    for (std::thread& thread : threads)
+      thread.join();
+
+    EXPECT_EQ(loaded, kThreads * 4 * static_cast<int>(kDeflatedFiles));
+    EXPECT_EQ(wrong_data, 0);
+
+    manager.Release();
+  }
+
+  archive_test::RemoveTree(base);
+  uv_run(&loop, UV_RUN_DEFAULT);
+  EXPECT_EQ(uv_loop_close(&loop), 0);
+}
+
+// Reads at the current position of one fd from several threads take a
+// range each, every byte of the file is read once.
+TEST(ArchiveThreadsTest, SharedPositionReads) {
+  const std::string base = archive_test::MakeTempDir("archive_position");
+  ASSERT_FALSE(base.empty());
+
+  std::string data;
+  for (size_t i = 0; i < kFiles; i++)
+    data += FileData(i);
+
+  uv_loop_t loop;
+  ASSERT_EQ(uv_loop_init(&loop), 0);
+
+  {
+    archive::Manager manager;
+    manager.Bind(&loop);
+    manager.SetUseStartupProfile(false);
+    manager.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager.SetCacheRoot(base + "/cache"));
+    const std::string zip = archive_test::MakeZip({{"all.js", data}});
+    ASSERT_TRUE(manager.MountMemory(zip.data(), zip.size(), "position",
+                                    "/archive_position_mount"));
+
+    uv_fs_t req;
+    const uv_file fd = archive::uv_fs_open(
+        &loop, &req, "/archive_position_mount/all.js", O_RDONLY, 0, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    ASSERT_GT(fd, 0);
+
+    std::atomic<size_t> total(0);
+    std::atomic<uint64_t> sum(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; t++) {
+      threads.emplace_back([&]() {
+        uv_loop_t thread_loop;
+        uv_loop_init(&thread_loop);
+        for (;;) {
+          char buffer[3];
+          uv_buf_t buf = uv_buf_init(buffer, sizeof(buffer));
+          uv_fs_t read_req;
+          const int read = archive::uv_fs_read(&thread_loop, &read_req, fd,
+                                               &buf, 1, -1, nullptr);
+          archive::uv_fs_req_cleanup(&read_req);
+          if (read <= 0)
+            break;
+          total += read;
+          for (int i = 0; i < read; i++)
+            sum += static_cast<unsigned char>(buffer[i]);
+        }
+        uv_loop_close(&thread_loop);
+      });
+    }
+    for (std::thread& thread : threads)
+      thread.join();
+
+    uint64_t expected_sum = 0;
+    for (unsigned char c : data)
+      expected_sum += c;
+    EXPECT_EQ(total, data.size());
+    EXPECT_EQ(sum, expected_sum);
+
+    archive::uv_fs_close(&loop, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    manager.Release();
+  }
+
+  archive_test::RemoveTree(base);
+  uv_run(&loop, UV_RUN_DEFAULT);
+  EXPECT_EQ(uv_loop_close(&loop), 0);
+}
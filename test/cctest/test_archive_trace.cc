@@ -0,0 +1,139 @@
+#include "archive/manager.h"
+#include "archive/trace.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// node.archive trace events: until node starts tracing they are kept, but
+// only when the categories node was given take in node.archive.
+
+namespace {
+
+const char kMountPoint[] = "/archive_trace_mount";
+
+class ArchiveTraceTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_trace");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/app.zip";
+    ASSERT_TRUE(archive_test::WriteFile(
+        zip_, archive_test::MakeZip({{"lib/", ""},
+                                     {"lib/a.js", "module.exports = 1;\n"}})));
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+  }
+
+  void TearDown() override {
+    archive::Trace::SetCategories(std::string());
+    archive_test::RemoveTree(base_);
+    uv_loop_close(&loop_);
+  }
+
+  // Mounts the zip, stats a path in it and one outside of it and reads the
+  // file in it.
+  void Run() {
+    archive::Manager manager;
+    manager.Bind(&loop_);
+    manager.SetUseStartupProfile(false);
+    manager.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager.Mount(zip_, kMountPoint));
+
+    const std::string path = std::string(kMountPoint) + "/lib/a.js";
+    uv_fs_t req;
+    EXPECT_EQ(archive::uv_fs_stat(&loop_, &req, path.c_str(), nullptr), 0);
+    archive::uv_fs_req_cleanup(&req);
+    EXPECT_EQ(archive::uv_fs_stat(&loop_, &req, zip_.c_str(), nullptr), 0);
+    archive::uv_fs_req_cleanup(&req);
+
+    uv_file fd = archive::uv_fs_open(&loop_, &req, path.c_str(), O_RDONLY, 0,
+                                     nullptr);
+    archive::uv_fs_req_cleanup(&req);
+    ASSERT_GE(fd, 0);
+    char buffer[64];
+    uv_buf_t buf = uv_buf_init(buffer, sizeof(buffer));
+    EXPECT_EQ(archive::uv_fs_read(&loop_, &req, fd, &buf, 1, 0, nullptr), 20);
+    archive::uv_fs_req_cleanup(&req);
+    archive::uv_fs_close(&loop_, &req, fd, nullptr);
+    archive::uv_fs_req_cleanup(&req);
+
+    manager.Release();
+  }
+
+  // The events added since the first skip ones.
+  std::vector<archive::Trace::Event> Since(size_t skip) {
+    std::vector<archive::Trace::Event> events = archive::Trace::Pending();
+    events.erase(events.begin(), events.begin() + skip);
+    return events;
+  }
+
+  static size_t Count(const std::vector<archive::Trace::Event>& events,
+                      const std::string& name,
+                      const std::string& path = std::string()) {
+    size_t count = 0;
+    for (const archive::Trace::Event& event : events) {
+      if (event.name_ == name && (path.empty() || event.path_ == path))
+        count++;
+    }
+    return count;
+  }
+
+  std::string base_;
+  std::string zip_;
+  uv_loop_t loop_;
+};
+
+}  // anonymous namespace
+
+TEST_F(ArchiveTraceTest, Categories) {
+  archive::Trace::SetCategories("v8,node.perf");
+  EXPECT_FALSE(archive::Trace::IsEnabled());
+  archive::Trace::SetCategories("v8, node.archive");
+  EXPECT_TRUE(archive::Trace::IsEnabled());
+  archive::Trace::SetCategories("node");
+  EXPECT_TRUE(archive::Trace::IsEnabled());
+  archive::Trace::SetCategories("node.archive.other");
+  EXPECT_FALSE(archive::Trace::IsEnabled());
+}
+
+TEST_F(ArchiveTraceTest, NothingKeptWhenOff) {
+  archive::Trace::SetCategories("v8,node.async_hooks");
+  const size_t before = archive::Trace::Pending().size();
+
+  Run();
+
+  EXPECT_EQ(archive::Trace::Pending().size(), before);
+}
+
+#if !defined(_WIN32)
+TEST_F(ArchiveTraceTest, EventsKept) {
+  archive::Trace::SetCategories("node.archive");
+  const size_t before = archive::Trace::Pending().size();
+
+  Run();
+
+  const std::vector<archive::Trace::Event> events = Since(before);
+  const std::string path = std::string(kMountPoint) + "/lib/a.js";
+
+  EXPECT_EQ(Count(events, "archive.mount", zip_), 1u);
+  EXPECT_EQ(Count(events, "archive.central_directory", zip_), 1u);
+
+  // Every wrapped call, served by the archive or passed through.
+  EXPECT_EQ(Count(events, "archive.fs_stat", path), 1u);
+  EXPECT_EQ(Count(events, "archive.fs_stat", zip_), 1u);
+  EXPECT_EQ(Count(events, "archive.stat", path), 1u);
+  EXPECT_EQ(Count(events, "archive.fs_open", path), 1u);
+  EXPECT_EQ(Count(events, "archive.open", path), 1u);
+  EXPECT_EQ(Count(events, "archive.fs_read"), 1u);
+  EXPECT_EQ(Count(events, "archive.fs_close"), 1u);
+
+  for (const archive::Trace::Event& event : events)
+    EXPECT_LE(event.start_, event.end_) << event.name_;
+}
+#endif  // !defined(_WIN32)
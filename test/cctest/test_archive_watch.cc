@@ -0,0 +1,176 @@
+#include "archive/manager.h"
+#include "archive_test_util.h"
+#include "uv.h"
+
+#include <fcntl.h>
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+// Watching or polling a path in a mounted archive starts an inert watch, a
+// mount is never reloaded so nothing is reported. A path copied up to the
+// upper dir has its copy watched.
+
+namespace {
+
+const char kMountPoint[] = "/archive_watch_mount";
+const char kPath[] = "/archive_watch_mount/lib/a.js";
+
+struct WatchState {
+  uv_handle_t* watch = nullptr;
+  uv_timer_t touch;
+  uv_timer_t timeout;
+  std::string touched;
+  int events = 0;
+};
+
+// Closes the watch and the timers so the loop ends.
+void CloseAll(WatchState* state) {
+  uv_close(state->watch, nullptr);
+  uv_close(reinterpret_cast<uv_handle_t*>(&state->touch), nullptr);
+  uv_close(reinterpret_cast<uv_handle_t*>(&state->timeout), nullptr);
+}
+
+void OnEvent(uv_fs_event_t* handle, const char*, int, int) {
+  static_cast<WatchState*>(handle->data)->events++;
+}
+
+void OnPoll(uv_fs_poll_t* handle, int, const uv_stat_t*, const uv_stat_t*) {
+  static_cast<WatchState*>(handle->data)->events++;
+}
+
+class ArchiveWatchTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    base_ = archive_test::MakeTempDir("archive_watch");
+    ASSERT_FALSE(base_.empty());
+    zip_ = base_ + "/app.zip";
+    ASSERT_TRUE(archive_test::WriteFile(
+        zip_, archive_test::MakeZip({{"lib/", ""},
+                                     {"lib/a.js", "module.exports = 1;\n"}})));
+
+    ASSERT_EQ(uv_loop_init(&loop_), 0);
+    manager_.Bind(&loop_);
+    manager_.SetUseStartupProfile(false);
+    manager_.SetUseSharedIndex(false);
+    ASSERT_TRUE(manager_.SetCacheRoot(base_ + "/cache"));
+    ASSERT_TRUE(manager_.Mount(zip_, kMountPoint));
+  }
+
+  void TearDown() override {
+    manager_.SetUpperDir(std::string());
+    manager_.Release();
+    archive_test::RemoveTree(base_);
+    uv_run(&loop_, UV_RUN_DEFAULT);
+    uv_loop_close(&loop_);
+  }
+
+  // Touches touched soon and runs the loop until timeout_ms, or the first
+  // event if stop_on_event.
+  void Run(uv_handle_t* handle, const std::string& touched,
+           uint64_t timeout_ms, bool stop_on_event) {
+    handle->data = &state_;
+    state_.watch = handle;
+    state_.touched = touched;
+    ASSERT_EQ(uv_timer_init(&loop_, &state_.touch), 0);
+    ASSERT_EQ(uv_timer_init(&loop_, &state_.timeout), 0);
+    state_.touch.data = &state_;
+    state_.timeout.data = &state_;
+
+    uv_timer_start(&state_.touch, [](uv_timer_t* timer) {
+      WatchState* state = static_cast<WatchState*>(timer->data);
+      uv_fs_t req;
+      const double later = uv_now(timer->loop) / 1000.0 + 60;
+      uv_fs_utime(nullptr, &req, state->touched.c_str(), later, later,
+                  nullptr);
+      uv_fs_req_cleanup(&req);
+    }, 100, 0);
+    uv_timer_start(&state_.timeout, [](uv_timer_t* timer) {
+      CloseAll(static_cast<WatchState*>(timer->data));
+    }, timeout_ms, 0);
+
+    while (uv_run(&loop_, UV_RUN_ONCE) != 0) {
+      if (stop_on_event && state_.events != 0 &&
+          !uv_is_closing(state_.watch)) {
+        CloseAll(&state_);
+      }
+    }
+  }
+
+  std::string base_;
+  std::string zip_;
+  uv_loop_t loop_;
+  archive::Manager manager_;
+  WatchState state_;
+};
+
+}  // anonymous namespace
+
+#if !defined(_WIN32)
+TEST_F(ArchiveWatchTest, EventIsInert) {
+  uv_fs_event_t handle;
+  ASSERT_EQ(uv_fs_event_init(&loop_, &handle), 0);
+  ASSERT_EQ(archive::uv_fs_event_start(&handle, OnEvent, kPath, 0), 0);
+  EXPECT_TRUE(uv_is_active(reinterpret_cast<uv_handle_t*>(&handle)));
+
+  // Swapping the archive file doesn't change what the mount holds.
+  Run(reinterpret_cast<uv_handle_t*>(&handle), zip_, 500, false);
+  EXPECT_EQ(state_.events, 0);
+}
+
+TEST_F(ArchiveWatchTest, PollIsInert) {
+  uv_fs_poll_t handle;
+  ASSERT_EQ(uv_fs_poll_init(&loop_, &handle), 0);
+  ASSERT_EQ(archive::uv_fs_poll_start(&handle, OnPoll, kPath, 20), 0);
+  EXPECT_TRUE(uv_is_active(reinterpret_cast<uv_handle_t*>(&handle)));
+
+  Run(reinterpret_cast<uv_handle_t*>(&handle), zip_, 500, false);
+  EXPECT_EQ(state_.events, 0);
+}
+
+TEST_F(ArchiveWatchTest, NoArchiveFile) {
+  uv_fs_t req;
+  uv_file fd = uv_fs_open(nullptr, &req, zip_.c_str(), O_RDONLY, 0, nullptr);
+  uv_fs_req_cleanup(&req);
+  ASSERT_GE(fd, 0);
+  ASSERT_TRUE(manager_.MountFd(fd, -1, -1, "-", "/archive_watch_stdin"));
+  uv_fs_close(nullptr, &req, fd, nullptr);
+  uv_fs_req_cleanup(&req);
+
+  uv_fs_event_t handle;
+  ASSERT_EQ(uv_fs_event_init(&loop_, &handle), 0);
+  EXPECT_EQ(archive::uv_fs_event_start(&handle, OnEvent,
+                                       "/archive_watch_stdin/lib/a.js", 0),
+            0);
+  EXPECT_TRUE(uv_is_active(reinterpret_cast<uv_handle_t*>(&handle)));
+  uv_close(reinterpret_cast<uv_handle_t*>(&handle), nullptr);
+  uv_run(&loop_, UV_RUN_DEFAULT);
+}
+
+TEST_F(ArchiveWatchTest, UpperCopyWatched) {
+  const std::string upper = base_ + "/upper";
+  ASSERT_EQ(manager_.SetUpperDir(upper), 0);
+
+  // Opening for writing copies the path up.
+  uv_fs_t req;
+  uv_file fd = archive::uv_fs_open(&loop_, &req, kPath, O_WRONLY, 0, nullptr);
+  archive::uv_fs_req_cleanup(&req);
+  ASSERT_GE(fd, 0);
+  archive::uv_fs_close(&loop_, &req, fd, nullptr);
+  archive::uv_fs_req_cleanup(&req);
+
+  // A copied up path's real path is its copy.
+  ASSERT_EQ(archive::uv_fs_realpath(&loop_, &req, kPath, nullptr), 0);
+  const std::string copy = static_cast<const char*>(req.ptr);
+  archive::uv_fs_req_cleanup(&req);
+  ASSERT_EQ(copy.compare(0, upper.length(), upper), 0) << copy;
+
+  uv_fs_event_t handle;
+  ASSERT_EQ(uv_fs_event_init(&loop_, &handle), 0);
+  ASSERT_EQ(archive::uv_fs_event_start(&handle, OnEvent, kPath, 0), 0);
+
+  Run(reinterpret_cast<uv_handle_t*>(&handle), copy, 5000, true);
+  EXPECT_GE(state_.events, 1);
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,73 @@
+'use strict';
+
+// Modules loaded from a mounted archive get a V8 code cache in the archive's
+// cache dir once they have run, later starts compile them from it.
+
+require('../common');
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+const assert = require('assert');
+const { spawnSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+tmpdir.refresh();
+
+const zip = fixtures.path('archive', 'code-cache.zip');
+const mount = path.join(tmpdir.path, 'mount');
+// The archive cache goes in os.tmpdir() so point that at our tmpdir.
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+function run(...flags) {
+  const child = spawnSync(process.execPath, [
+    '--archive.path', zip,
+    '--archive.mount', mount,
+    ...flags,
+    path.join(mount, 'index.js')
+  ], { env });
+  assert.strictEqual(child.status, 0, child.stderr.toString());
+  assert.strictEqual(child.stdout.toString().trim(), '42');
+}
+
+function codeCaches() {
+  const root = path.join(tmpdir.path, 'archive_cache');
+  const caches = [];
+  for (const dir of fs.readdirSync(root)) {
+    for (const file of fs.readdirSync(path.join(root, dir))) {
+      if (file.endsWith('.code'))
+        caches.push(path.join(root, dir, file));
+    }
+  }
+  return caches.sort();
+}
+
+// Nothing is kept when it's turned off.
+run('--archive.nocodecache');
+assert.deepStrictEqual(codeCaches(), []);
+
+// One cache per module, named after the V8 version.
+run();
+const caches = codeCaches();
+assert.strictEqual(caches.length, 2);
+for (const cache of caches) {
+  assert.ok(cache.endsWith(`.${process.versions.v8}.code`), cache);
+  assert.ok(fs.statSync(cache).size > 0);
+}
+
+// The caches are used as they are rather than being made again.
+const written = caches.map((cache) => fs.readFileSync(cache));
+run();
+assert.deepStrictEqual(codeCaches(), caches);
+caches.forEach((cache, i) => {
+  assert.ok(fs.readFileSync(cache).equals(written[i]), cache);
+});
+
+// A cache V8 rejects is replaced.
+fs.writeFileSync(caches[0], 'not a code cache');
+run();
+assert.notStrictEqual(fs.readFileSync(caches[0]).toString(),
+                      'not a code cache');
@@ -0,0 +1,54 @@
+'use strict';
+
+// The source of an ASCII module in a mounted archive is used straight from
+// the archive, anything else is left to fs.readFileSync().
+
+require('../common');
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+const assert = require('assert');
+const { spawnSync } = require('child_process');
+const path = require('path');
+
+tmpdir.refresh();
+
+const zip = fixtures.path('archive', 'code-cache.zip');
+const mount = path.join(tmpdir.path, 'mount');
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+const script = `
+  const assert = require('assert');
+  const fs = require('fs');
+  const path = require('path');
+  const { internalModuleReadSource } = process.binding('fs');
+  const mount = ${JSON.stringify(mount)};
+
+  for (const file of ['index.js', 'lib/add.js']) {
+    const filename = path.join(mount, file);
+    assert.strictEqual(internalModuleReadSource(filename),
+                       fs.readFileSync(filename, 'utf8'));
+  }
+
+  // UTF-8 that isn't ASCII.
+  assert.strictEqual(
+    internalModuleReadSource(path.join(mount, 'lib', 'name.js')), undefined);
+  assert.strictEqual(require(path.join(mount, 'lib', 'name.js')), 'caf\\u00e9');
+
+  assert.strictEqual(internalModuleReadSource(path.join(mount, 'missing.js')),
+                     undefined);
+  assert.strictEqual(internalModuleReadSource(__filename), undefined);
+
+  // Modules compiled from it still run as usual.
+  assert.strictEqual(require(path.join(mount, 'lib', 'add.js'))(40, 2), 42);
+`;
+
+const child = spawnSync(process.execPath, [
+  '--archive.path', zip,
+  '--archive.mount', mount,
+  '-e', script
+], { env });
+assert.strictEqual(child.status, 0, child.stderr.toString());
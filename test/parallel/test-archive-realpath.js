@@ -0,0 +1,86 @@
+'use strict';
+
+// realpath of a path in a mounted archive comes from the archive's index.
+
+require('../common');
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+const assert = require('assert');
+const { spawnSync } = require('child_process');
+const path = require('path');
+
+tmpdir.refresh();
+
+const zip = fixtures.path('archive', 'code-cache.zip');
+const mount = path.join(tmpdir.path, 'mount');
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+const script = `
+  const assert = require('assert');
+  const fs = require('fs');
+  const path = require('path');
+  const { archiveRealpath } = process.binding('fs');
+  const mount = ${JSON.stringify(mount)};
+  const add = path.join(mount, 'lib', 'add.js');
+  const dotted = path.join(mount, 'lib') + path.sep + '..' + path.sep +
+                 'lib' + path.sep + '.' + path.sep + 'add.js';
+
+  assert.strictEqual(archiveRealpath(add), add);
+  assert.strictEqual(archiveRealpath(path.join(mount, 'missing.js')) < 0,
+                     true);
+  assert.strictEqual(archiveRealpath(__filename), undefined);
+
+  assert.strictEqual(fs.realpathSync(dotted), add);
+  assert.strictEqual(fs.realpathSync(add), add);
+  assert.strictEqual(fs.realpathSync(mount), mount);
+  assert.deepStrictEqual(fs.realpathSync(add, 'buffer'), Buffer.from(add));
+  assert.throws(() => fs.realpathSync(path.join(mount, 'missing.js')),
+                { code: 'ENOENT', syscall: 'lstat' });
+
+  fs.realpath(add, (err, real) => {
+    assert.ifError(err);
+    assert.strictEqual(real, add);
+  });
+  fs.realpath(path.join(mount, 'missing.js'), (err) => {
+    assert.strictEqual(err.code, 'ENOENT');
+  });
+  assert.strictEqual(fs.realpathSync.native(dotted), add);
+
+  assert.strictEqual(require(add)(40, 2), 42);
+`;
+
+const child = spawnSync(process.execPath, [
+  '--archive.path', zip,
+  '--archive.mount', mount,
+  '-e', script
+], { env });
+assert.strictEqual(child.status, 0, child.stderr.toString());
+
+// With an upper dir a path can be removed, so what realpath found is not kept.
+const overlayScript = `
+  const assert = require('assert');
+  const fs = require('fs');
+  const path = require('path');
+  const add = path.join(${JSON.stringify(mount)}, 'lib', 'add.js');
+
+  assert.strictEqual(fs.realpathSync(add), add);
+  fs.writeFileSync(add, 'module.exports = (a, b) => a - b;\\n');
+  assert.strictEqual(fs.realpathSync(add), add);
+  fs.unlinkSync(add);
+  assert.throws(() => fs.realpathSync(add), { code: 'ENOENT' });
+  fs.realpath(add, (err) => {
+    assert.strictEqual(err.code, 'ENOENT');
+  });
+`;
+
+const overlayChild = spawnSync(process.execPath, [
+  '--archive.path', zip,
+  '--archive.mount', mount,
+  '--archive.upper', path.join(tmpdir.path, 'upper'),
+  '-e', overlayScript
+], { env });
+assert.strictEqual(overlayChild.status, 0, overlayChild.stderr.toString());
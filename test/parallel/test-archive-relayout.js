@@ -0,0 +1,55 @@
+'use strict';
+
+// --archive.relayout rewrites an archive with its startup entries first and
+// the result mounts like the original.
+
+require('../common');
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+const assert = require('assert');
+const { spawnSync } = require('child_process');
+const fs = require('fs');
+const path = require('path');
+
+tmpdir.refresh();
+
+const zip = fixtures.path('archive', 'code-cache.zip');
+const relaid = path.join(tmpdir.path, 'relaid.zip');
+const mount = path.join(tmpdir.path, 'mount');
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+function node(archive, ...args) {
+  const child = spawnSync(process.execPath, [
+    '--archive.path', archive,
+    '--archive.mount', mount,
+    ...args
+  ], { env });
+  assert.strictEqual(child.status, 0, child.stderr.toString());
+  return child.stdout.toString();
+}
+
+// A run from the archive records its startup profile, which the relayout
+// then follows.
+const index = path.join(mount, 'index.js');
+assert.strictEqual(node(zip, index), '42\n');
+
+// The relayout itself needs no mount point.
+const relayout = spawnSync(process.execPath, [
+  '--archive.path', zip,
+  '--archive.relayout', relaid
+], { env });
+assert.strictEqual(relayout.status, 0, relayout.stderr.toString());
+assert(/Relaid out archive/.test(relayout.stdout.toString()));
+
+// Nothing is left besides the new archive.
+assert.deepStrictEqual(
+  fs.readdirSync(tmpdir.path).filter((name) => name.startsWith('relaid')),
+  ['relaid.zip']);
+
+assert.strictEqual(node(relaid, index), '42\n');
+assert.strictEqual(node(relaid, '-p', `require(${JSON.stringify(
+  path.join(mount, 'lib', 'name.js'))})`), 'café\n');
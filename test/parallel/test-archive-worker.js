@@ -0,0 +1,62 @@
+'use strict';
+
+// worker_threads workers share the main thread's archive mounts, each one
+// loading modules from the archive on its own loop at the same time.
+
+require('../common');
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+const assert = require('assert');
+const { spawnSync } = require('child_process');
+const path = require('path');
+
+tmpdir.refresh();
+
+const zip = fixtures.path('archive', 'code-cache.zip');
+const mount = path.join(tmpdir.path, 'mount');
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+const script = `
+  const assert = require('assert');
+  const { Worker } = require('worker_threads');
+  const mount = ${JSON.stringify(mount)};
+
+  const workerScript = \`
+    const fs = require('fs');
+    const path = require('path');
+    const { parentPort, workerData } = require('worker_threads');
+    const add = require(path.join(workerData, 'lib', 'add.js'));
+    let total = 0;
+    for (let i = 0; i < 50; i++) {
+      total += fs.readFileSync(path.join(workerData, 'index.js')).length;
+      fs.readdirSync(path.join(workerData, 'lib'));
+    }
+    fs.readFile(path.join(workerData, 'lib', 'add.js'), (err, data) => {
+      if (err) throw err;
+      parentPort.postMessage([add(40, 2), total, data.length]);
+    });
+  \`;
+
+  const expected = require('fs').readFileSync(mount + '/index.js').length;
+  for (let i = 0; i < 4; i++) {
+    const worker = new Worker(workerScript, { eval: true, workerData: mount });
+    worker.on('message', ([sum, total, length]) => {
+      assert.strictEqual(sum, 42);
+      assert.strictEqual(total, expected * 50);
+      assert.ok(length > 0);
+    });
+    worker.on('exit', (code) => assert.strictEqual(code, 0));
+  }
+`;
+
+const child = spawnSync(process.execPath, [
+  '--experimental-worker',
+  '--archive.path', zip,
+  '--archive.mount', mount,
+  '-e', script
+], { env });
+assert.strictEqual(child.status, 0, child.stderr.toString());
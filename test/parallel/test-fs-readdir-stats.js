@@ -0,0 +1,119 @@
+'use strict';
+
+const common = require('../common');
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const { spawnSync } = require('child_process');
+
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+
+// The archive's cache goes in tmpdir so list a dir of its own
+const readdirDir = path.join(tmpdir.path, 'readdir');
+const files = ['empty', 'files', 'for', 'testing'];
+
+// Make sure tmp directory is clean
+tmpdir.refresh();
+fs.mkdirSync(readdirDir);
+
+// Create the necessary files, each with its index as its size
+files.forEach(function(currentFile, i) {
+  fs.writeFileSync(path.join(readdirDir, currentFile), 'x'.repeat(i));
+});
+fs.mkdirSync(path.join(readdirDir, 'sub'));
+
+function assertEntries(entries) {
+  assert.strictEqual(entries.length, files.length + 1);
+  const byName = new Map(entries.map((entry) => [entry.name, entry]));
+
+  for (const [i, name] of files.entries()) {
+    const entry = byName.get(name);
+    assert(entry instanceof fs.Dirent);
+    assert.strictEqual(entry.isFile(), true);
+    assert.strictEqual(entry.isDirectory(), false);
+    assert(entry.stats instanceof fs.Stats);
+    assert.strictEqual(entry.stats.isFile(), true);
+    assert.strictEqual(entry.stats.size, i);
+    assert.strictEqual(entry.stats.mtimeMs,
+                       fs.statSync(path.join(readdirDir, name)).mtimeMs);
+  }
+
+  const sub = byName.get('sub');
+  assert.strictEqual(sub.isDirectory(), true);
+  assert.strictEqual(sub.stats.isDirectory(), true);
+}
+
+// Check the readdirStats Sync version
+assertEntries(fs.readdirStatsSync(readdirDir));
+
+// Check the readdirStats async version
+fs.readdirStats(readdirDir, common.mustCall((err, entries) => {
+  assert.ifError(err);
+  assertEntries(entries);
+}));
+
+// Errors are reported as they are for readdir
+assert.throws(() => {
+  fs.readdirStatsSync(path.join(readdirDir, 'empty'));
+}, /Error: ENOTDIR: not a directory/);
+
+fs.readdirStats(path.join(readdirDir, 'missing'), common.mustCall((err) => {
+  assert.strictEqual(err.code, 'ENOENT');
+}));
+
+// Dirs in a mounted archive are answered from the archive's index
+const zip = fixtures.path('archive', 'code-cache.zip');
+const mount = path.join(tmpdir.path, 'mount');
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+const script = `
+  const assert = require('assert');
+  const fs = require('fs');
+  const path = require('path');
+  const mount = ${JSON.stringify(mount)};
+
+  function assertEntries(dir, entries, expected) {
+    assert.deepStrictEqual(entries.map((entry) => entry.name).sort(),
+                           Object.keys(expected));
+    for (const entry of entries) {
+      const stats = fs.statSync(path.join(dir, entry.name));
+      assert(entry instanceof fs.Dirent);
+      assert(entry.stats instanceof fs.Stats);
+      assert.strictEqual(entry.isDirectory(), expected[entry.name] === null);
+      assert.strictEqual(entry.stats.isDirectory(), entry.isDirectory());
+      assert.strictEqual(entry.stats.mtimeMs, stats.mtimeMs);
+      if (!entry.isDirectory())
+        assert.strictEqual(entry.stats.size, expected[entry.name]);
+    }
+  }
+
+  const lib = path.join(mount, 'lib');
+  assertEntries(mount, fs.readdirStatsSync(mount),
+                { 'index.js': 59, 'lib': null });
+  assertEntries(lib, fs.readdirStatsSync(lib), { 'add.js': 57, 'name.js': 26 });
+
+  fs.readdirStats(lib, (err, entries) => {
+    assert.ifError(err);
+    assertEntries(lib, entries, { 'add.js': 57, 'name.js': 26 });
+    process.stdout.write('done');
+  });
+
+  assert.throws(() => {
+    fs.readdirStatsSync(path.join(mount, 'index.js'));
+  }, /Error: ENOTDIR: not a directory/);
+  assert.throws(() => {
+    fs.readdirStatsSync(path.join(mount, 'missing'));
+  }, /Error: ENOENT: no such file or directory/);
+`;
+
+const child = spawnSync(process.execPath,
+                        ['--archive.path', zip, '--archive.mount', mount,
+                         '-e', script],
+                        { env });
+assert.strictEqual(child.status, 0, child.stderr.toString());
+assert.strictEqual(child.stdout.toString(), 'done');
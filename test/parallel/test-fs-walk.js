@@ -0,0 +1,117 @@
+'use strict';
+
+const common = require('../common');
+const assert = require('assert');
+const fs = require('fs');
+const path = require('path');
+const { spawnSync } = require('child_process');
+
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+
+// The archive's cache goes in tmpdir so walk a dir of its own
+const walkDir = path.join(tmpdir.path, 'walk');
+
+// Make sure tmp directory is clean
+tmpdir.refresh();
+fs.mkdirSync(walkDir);
+
+// Create the tree to walk
+fs.mkdirSync(path.join(walkDir, 'lib'));
+fs.mkdirSync(path.join(walkDir, 'lib', 'internal'));
+fs.writeFileSync(path.join(walkDir, 'index.js'), '');
+fs.writeFileSync(path.join(walkDir, 'README.md'), '');
+fs.writeFileSync(path.join(walkDir, 'lib', 'a.js'), '');
+fs.writeFileSync(path.join(walkDir, 'lib', 'internal', 'b.js'), '');
+
+const all = ['README.md', 'index.js', 'lib', 'lib/a.js', 'lib/internal',
+             'lib/internal/b.js'];
+const scripts = ['index.js', 'lib/a.js', 'lib/internal/b.js'];
+
+// Check the walkSync version
+assert.deepStrictEqual(fs.walkSync(walkDir).sort(), all);
+assert.deepStrictEqual(fs.walkSync(walkDir, { pattern: '**/*.js' }).sort(),
+                       scripts);
+assert.deepStrictEqual(fs.walkSync(walkDir, { pattern: '*.js' }), ['index.js']);
+assert.deepStrictEqual(fs.walkSync(walkDir, { pattern: 'lib/?.js' }),
+                       ['lib/a.js']);
+
+const dirents = fs.walkSync(walkDir, { withFileTypes: true });
+for (const dirent of dirents) {
+  assert(dirent instanceof fs.Dirent);
+  assert.strictEqual(dirent.isDirectory(),
+                     dirent.name === 'lib' || dirent.name === 'lib/internal');
+}
+
+// Check the walk async version
+fs.walk(walkDir, { pattern: '**/*.js' }, common.mustCall((err, entries) => {
+  assert.ifError(err);
+  assert.deepStrictEqual(entries.sort(), scripts);
+}));
+
+// Errors are reported as they are for readdir
+assert.throws(() => {
+  fs.walkSync(path.join(walkDir, 'index.js'));
+}, /Error: ENOTDIR: not a directory/);
+
+fs.walk(path.join(walkDir, 'missing'), common.mustCall((err) => {
+  assert.strictEqual(err.code, 'ENOENT');
+}));
+
+common.expectsError(() => {
+  fs.walkSync(walkDir, { pattern: 1 });
+}, {
+  code: 'ERR_INVALID_ARG_TYPE',
+  type: TypeError
+});
+
+// Dirs in a mounted archive are walked off the archive's index
+const zip = fixtures.path('archive', 'code-cache.zip');
+const mount = path.join(tmpdir.path, 'mount');
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+const script = `
+  const assert = require('assert');
+  const fs = require('fs');
+  const path = require('path');
+  const mount = ${JSON.stringify(mount)};
+  const all = ['index.js', 'lib', 'lib/add.js', 'lib/name.js'];
+  const scripts = ['index.js', 'lib/add.js', 'lib/name.js'];
+
+  assert.deepStrictEqual(fs.walkSync(mount).sort(), all);
+  assert.deepStrictEqual(fs.walkSync(mount, { pattern: '**/*.js' }).sort(),
+                         scripts);
+  assert.deepStrictEqual(fs.walkSync(mount, { pattern: '*.js' }),
+                         ['index.js']);
+  assert.deepStrictEqual(fs.walkSync(path.join(mount, 'lib')).sort(),
+                         ['add.js', 'name.js']);
+
+  for (const dirent of fs.walkSync(mount, { withFileTypes: true })) {
+    assert(dirent instanceof fs.Dirent);
+    assert.strictEqual(dirent.isDirectory(), dirent.name === 'lib');
+  }
+
+  fs.walk(mount, { pattern: 'lib/[a-m]*.js' }, (err, entries) => {
+    assert.ifError(err);
+    assert.deepStrictEqual(entries, ['lib/add.js']);
+    process.stdout.write('done');
+  });
+
+  assert.throws(() => {
+    fs.walkSync(path.join(mount, 'index.js'));
+  }, /Error: ENOTDIR: not a directory/);
+  assert.throws(() => {
+    fs.walkSync(path.join(mount, 'missing'));
+  }, /Error: ENOENT: no such file or directory/);
+`;
+
+const child = spawnSync(process.execPath,
+                        ['--archive.path', zip, '--archive.mount', mount,
+                         '-e', script],
+                        { env });
+assert.strictEqual(child.status, 0, child.stderr.toString());
+assert.strictEqual(child.stdout.toString(), 'done');
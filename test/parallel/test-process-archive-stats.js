@@ -0,0 +1,82 @@
+'use strict';
+
+require('../common');
+const fixtures = require('../common/fixtures');
+const tmpdir = require('../common/tmpdir');
+const assert = require('assert');
+const { spawnSync } = require('child_process');
+const path = require('path');
+
+// No archive is mounted so there is nothing to report
+const stats = process.archiveStats();
+assert(Array.isArray(stats));
+assert.strictEqual(stats.length, 0);
+
+// Each call gives a new array
+assert.notStrictEqual(process.archiveStats(), stats);
+
+// With the fixture archive mounted its counters follow what is done with it.
+tmpdir.refresh();
+
+const zip = fixtures.path('archive', 'code-cache.zip');
+const mount = path.join(tmpdir.path, 'mount');
+const env = Object.assign({}, process.env, {
+  TMPDIR: tmpdir.path,
+  TMP: tmpdir.path,
+  TEMP: tmpdir.path
+});
+
+const script = `
+  const assert = require('assert');
+  const fs = require('fs');
+  const path = require('path');
+  const mount = ${JSON.stringify(mount)};
+  const files = ['index.js', 'lib/add.js', 'lib/name.js'];
+  const sizes = { 'index.js': 59, 'lib/add.js': 57, 'lib/name.js': 26 };
+
+  const [before] = process.archiveStats();
+  assert.strictEqual(before.mount, mount);
+  assert.strictEqual(before.archive, ${JSON.stringify(zip)});
+  // The cold cache had every file extracted, a warm one reused.
+  assert.strictEqual(before.cacheHits + before.cacheMisses, files.length);
+
+  let bytes = 0;
+  for (const file of files) {
+    const fd = fs.openSync(path.join(mount, file), 'r');
+    const buffer = Buffer.alloc(256);
+    assert.strictEqual(fs.readSync(fd, buffer, 0, buffer.length, 0),
+                       sizes[file]);
+    assert.strictEqual(fs.fstatSync(fd).size, sizes[file]);
+    fs.closeSync(fd);
+    bytes += sizes[file];
+  }
+  assert.strictEqual(fs.statSync(path.join(mount, 'lib')).isDirectory(), true);
+
+  const [after] = process.archiveStats();
+  assert.strictEqual(after.opens - before.opens, files.length);
+  assert.strictEqual(after.reads - before.reads, files.length);
+  assert.strictEqual(after.bytesRead - before.bytesRead, bytes);
+  assert.strictEqual(after.stats - before.stats, files.length + 1);
+  assert.strictEqual(after.timings.read.count - before.timings.read.count,
+                     files.length);
+  assert.strictEqual(after.timings.open.count - before.timings.open.count,
+                     files.length);
+  assert(after.timings.read.max >= after.timings.read.p50);
+  process.stdout.write(JSON.stringify(after));
+`;
+
+function run() {
+  const child = spawnSync(process.execPath, [
+    '--archive.path', zip,
+    '--archive.mount', mount,
+    '-e', script
+  ], { env });
+  assert.strictEqual(child.status, 0, child.stderr.toString());
+  return JSON.parse(child.stdout.toString());
+}
+
+// The first run extracts the archive, the second finds it in the cache.
+assert.strictEqual(run().cacheMisses, 3);
+const warm = run();
+assert.strictEqual(warm.cacheHits, 3);
+assert.strictEqual(warm.cacheMisses, 0);
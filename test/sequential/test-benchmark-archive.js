@@ -0,0 +1,21 @@
+'use strict';
+
+const common = require('../common');
+
+if (!common.enoughTestMem)
+  common.skip('Insufficient memory for archive benchmark test');
+
+const runBenchmark = require('../common/benchmark');
+
+runBenchmark('archive',
+             [
+               'n=1',
+               'source=archive',
+               'entry=deflated',
+               'api=sync',
+               'call=statSync',
+               'len=1024',
+               'cache=warm',
+               'entries=10'
+             ],
+             { NODEJS_BENCHMARK_ZERO_ALLOWED: 1 });